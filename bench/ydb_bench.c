@@ -0,0 +1,508 @@
+/**
+ * @file ydb_bench.c
+ * @brief Benchmarks of the engine's core operations.
+ *
+ * Every workload starts with a table of its own, built and loaded again before the clock starts, and
+ * prints a JSON line with its configuration, throughput and latency percentiles, so runs could be stored
+ * and compared against a baseline. Page contents and random choices come from a seeded generator, two runs
+ * with the same options do the same operations.
+ *
+ * Run `ydb_bench -h` for options.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/table_page.h>
+#include <YeltsinDB/ydb.h>
+
+#define BENCH_DEFAULT_PAGES (10000)
+#define BENCH_DEFAULT_OPS (10000)
+#define BENCH_DEFAULT_REPEATS (50)
+#define BENCH_DEFAULT_ROW_SIZE (100)
+#define BENCH_DEFAULT_SEED (42)
+#define BENCH_DEFAULT_PATH "ydb_bench.tbl"
+#define BENCH_BATCH_SIZE (16)
+
+typedef struct {
+  const char *path;
+  YDB_PageSize page_size;
+  YDB_IOMode io_mode;
+  int wal;
+  size_t group_commit;
+  int compression;
+  int checksums;
+  size_t cache_capacity;
+  size_t readahead;
+  size_t pages;
+  size_t ops;
+  size_t repeats;
+  YDB_PageSize row_size;
+  uint64_t seed;
+} BenchConfig;
+
+// Latencies of a workload in nanoseconds, one per operation.
+typedef struct {
+  uint64_t *ns;
+  size_t count;
+  size_t capacity;
+  uint64_t bytes;
+  uint64_t extra_ns; // Time not spent in any operation, e.g. the final commit
+} BenchResult;
+
+typedef struct {
+  const char *name;
+  const char *description;
+  void (*run)(const BenchConfig *config, BenchResult *result);
+} BenchWorkload;
+
+static uint64_t bench_rng;
+
+// xorshift64*, good enough to pick pages and fill rows.
+static uint64_t bench_random(void) {
+  bench_rng ^= bench_rng >> 12;
+  bench_rng ^= bench_rng << 25;
+  bench_rng ^= bench_rng >> 27;
+  return bench_rng * UINT64_C(2685821657736338717);
+}
+
+static uint64_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void bench_check(YDB_Error err, const char *what) {
+  if (!err) return;
+  fprintf(stderr, "ydb_bench: %s failed with error %d\n", what, err);
+  exit(1);
+}
+
+static void bench_record(BenchResult *result, uint64_t ns, uint64_t bytes) {
+  if (result->count == result->capacity) {
+    result->capacity = result->capacity ? 2 * result->capacity : 1024;
+    result->ns = realloc(result->ns, result->capacity * sizeof(uint64_t));
+  }
+  result->ns[result->count++] = ns;
+  result->bytes += bytes;
+}
+
+static YDB_Engine *bench_instance(const BenchConfig *config) {
+  YDB_Engine *e = ydb_init_instance();
+  if (!e) bench_check(YDB_ERR_UNKNOWN, "ydb_init_instance");
+  bench_check(ydb_set_io_mode(e, config->io_mode), "ydb_set_io_mode");
+  bench_check(ydb_set_wal(e, config->wal), "ydb_set_wal");
+  bench_check(ydb_set_compression(e, config->compression), "ydb_set_compression");
+  bench_check(ydb_set_checksums(e, config->checksums), "ydb_set_checksums");
+  bench_check(ydb_set_page_size(e, config->page_size), "ydb_set_page_size");
+  bench_check(ydb_set_cache_capacity(e, config->cache_capacity), "ydb_set_cache_capacity");
+  return e;
+}
+
+static void bench_remove_table(const BenchConfig *config) {
+  char wal_path[4096];
+  snprintf(wal_path, sizeof(wal_path), "%s%s", config->path, YDB_WAL_FILE_SUFFIX);
+  unlink(config->path);
+  unlink(wal_path);
+}
+
+// Loads the table and applies settings of a loaded table.
+static void bench_load(const BenchConfig *config, YDB_Engine *e) {
+  bench_check(ydb_load_table(e, config->path), "ydb_load_table");
+  bench_check(ydb_set_readahead(e, config->readahead), "ydb_set_readahead");
+  if (config->wal) bench_check(ydb_set_group_commit(e, config->group_commit), "ydb_set_group_commit");
+}
+
+// Fills a slotted page with rows of half random, half repeated bytes, so that compression has some work.
+static YDB_TablePage *bench_make_page(const BenchConfig *config, YDB_Engine *e) {
+  YDB_PageSize data_size;
+  bench_check(ydb_get_page_data_size(e, &data_size), "ydb_get_page_data_size");
+  YDB_TablePage *page = ydb_page_alloc(data_size);
+  bench_check(ydb_page_slotted_init(page), "ydb_page_slotted_init");
+
+  char *row = malloc(config->row_size);
+  for (;;) {
+    for (YDB_PageSize i = 0; i < config->row_size; i++) {
+      row[i] = i < config->row_size / 2 ? (char) ('a' + bench_random() % 26) : (char) ('A' + i % 26);
+    }
+    if (ydb_page_row_insert(page, row, config->row_size, NULL)) break;
+  }
+  free(row);
+  return page;
+}
+
+// Changes one row of a page.
+static void bench_touch_page(const BenchConfig *config, YDB_TablePage *page) {
+  YDB_PageSize count = ydb_page_row_count_get(page);
+  if (!count) return;
+  char *row = malloc(config->row_size);
+  for (YDB_PageSize i = 0; i < config->row_size; i++) row[i] = (char) ('a' + bench_random() % 26);
+  ydb_page_row_update(page, (YDB_PageSize) (bench_random() % count), row, config->row_size);
+  free(row);
+}
+
+// Creates a table of `config->pages` pages and leaves it unloaded.
+static void bench_build_table(const BenchConfig *config) {
+  bench_remove_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_check(ydb_create_table(e, config->path), "ydb_create_table");
+  if (config->wal) bench_check(ydb_set_group_commit(e, 0), "ydb_set_group_commit");
+
+  YDB_TablePage *batch[BENCH_BATCH_SIZE];
+  for (size_t done = 0; done < config->pages;) {
+    size_t n = config->pages - done < BENCH_BATCH_SIZE ? config->pages - done : BENCH_BATCH_SIZE;
+    for (size_t i = 0; i < n; i++) batch[i] = bench_make_page(config, e);
+    bench_check(ydb_append_pages(e, batch, n), "ydb_append_pages");
+    for (size_t i = 0; i < n; i++) ydb_page_free(batch[i]);
+    done += n;
+  }
+  bench_check(ydb_unload_table(e), "ydb_unload_table");
+  ydb_terminate_instance(e);
+}
+
+static void bench_finish(YDB_Engine *e, BenchResult *result) {
+  uint64_t start = bench_now();
+  bench_check(ydb_commit(e), "ydb_commit");
+  result->extra_ns += bench_now() - start;
+  bench_check(ydb_unload_table(e), "ydb_unload_table");
+  ydb_terminate_instance(e);
+}
+
+static void bench_create(const BenchConfig *config, BenchResult *result) {
+  for (size_t r = 0; r < config->repeats; r++) {
+    bench_remove_table(config);
+    YDB_Engine *e = bench_instance(config);
+    uint64_t start = bench_now();
+    bench_check(ydb_create_table(e, config->path), "ydb_create_table");
+    bench_check(ydb_unload_table(e), "ydb_unload_table");
+    bench_record(result, bench_now() - start, 0);
+    ydb_terminate_instance(e);
+  }
+}
+
+static void bench_load_table(const BenchConfig *config, BenchResult *result) {
+  bench_build_table(config);
+  YDB_Engine *e = bench_instance(config);
+  for (size_t r = 0; r < config->repeats; r++) {
+    uint64_t start = bench_now();
+    bench_check(ydb_load_table(e, config->path), "ydb_load_table");
+    bench_check(ydb_unload_table(e), "ydb_unload_table");
+    bench_record(result, bench_now() - start, 0);
+  }
+  ydb_terminate_instance(e);
+}
+
+static void bench_append(const BenchConfig *config, BenchResult *result) {
+  bench_remove_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_check(ydb_create_table(e, config->path), "ydb_create_table");
+  if (config->wal) bench_check(ydb_set_group_commit(e, config->group_commit), "ydb_set_group_commit");
+
+  for (size_t i = 0; i < config->pages; i++) {
+    YDB_TablePage *page = bench_make_page(config, e);
+    uint64_t start = bench_now();
+    bench_check(ydb_append_page(e, page), "ydb_append_page");
+    bench_record(result, bench_now() - start, config->page_size);
+    ydb_page_free(page);
+  }
+  bench_finish(e, result);
+}
+
+static void bench_append_batch(const BenchConfig *config, BenchResult *result) {
+  bench_remove_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_check(ydb_create_table(e, config->path), "ydb_create_table");
+  if (config->wal) bench_check(ydb_set_group_commit(e, config->group_commit), "ydb_set_group_commit");
+
+  YDB_TablePage *batch[BENCH_BATCH_SIZE];
+  for (size_t done = 0; done < config->pages;) {
+    size_t n = config->pages - done < BENCH_BATCH_SIZE ? config->pages - done : BENCH_BATCH_SIZE;
+    for (size_t i = 0; i < n; i++) batch[i] = bench_make_page(config, e);
+    uint64_t start = bench_now();
+    bench_check(ydb_append_pages(e, batch, n), "ydb_append_pages");
+    bench_record(result, bench_now() - start, (uint64_t) n * config->page_size);
+    for (size_t i = 0; i < n; i++) ydb_page_free(batch[i]);
+    done += n;
+  }
+  bench_finish(e, result);
+}
+
+// Reads the current page, so that lazily mapped pages are actually touched.
+static YDB_PageSize bench_read_current(YDB_Engine *e) {
+  YDB_TablePage *page = ydb_get_current_page(e);
+  const void *row;
+  YDB_PageSize size = 0;
+  if (page && ydb_page_row_count_get(page)) ydb_page_row_get(page, ydb_page_row_count_get(page) - 1, &row, &size);
+  return size;
+}
+
+static void bench_scan(const BenchConfig *config, BenchResult *result, int forward) {
+  bench_build_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_load(config, e);
+  size_t count;
+  bench_check(ydb_get_page_count(e, &count), "ydb_get_page_count");
+  bench_check(ydb_seek_to_page(e, forward ? 0 : count - 1), "ydb_seek_to_page");
+  bench_read_current(e);
+
+  for (;;) {
+    uint64_t start = bench_now();
+    YDB_Error err = forward ? ydb_next_page(e) : ydb_prev_page(e);
+    if (err == YDB_ERR_NO_MORE_PAGES) break;
+    bench_check(err, forward ? "ydb_next_page" : "ydb_prev_page");
+    bench_read_current(e);
+    bench_record(result, bench_now() - start, config->page_size);
+  }
+  bench_check(ydb_unload_table(e), "ydb_unload_table");
+  ydb_terminate_instance(e);
+}
+
+static void bench_scan_next(const BenchConfig *config, BenchResult *result) {
+  bench_scan(config, result, 1);
+}
+
+static void bench_scan_prev(const BenchConfig *config, BenchResult *result) {
+  bench_scan(config, result, 0);
+}
+
+static void bench_replace(const BenchConfig *config, BenchResult *result) {
+  bench_build_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_load(config, e);
+
+  for (size_t i = 0; i < config->ops; i++) {
+    bench_check(ydb_seek_to_page(e, bench_random() % config->pages), "ydb_seek_to_page");
+    YDB_TablePage *page = ydb_page_clone(ydb_get_current_page(e));
+    bench_touch_page(config, page);
+    uint64_t start = bench_now();
+    // The instance keeps the page as its current one
+    bench_check(ydb_replace_current_page(e, page), "ydb_replace_current_page");
+    bench_record(result, bench_now() - start, config->page_size);
+  }
+  bench_finish(e, result);
+}
+
+// Deletes a random page and appends a new one in its place, which is taken from the free pages.
+static void bench_churn(const BenchConfig *config, BenchResult *result) {
+  bench_build_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_load(config, e);
+
+  for (size_t i = 0; i < config->ops; i++) {
+    YDB_TablePage *page = bench_make_page(config, e);
+    bench_check(ydb_seek_to_page(e, bench_random() % config->pages), "ydb_seek_to_page");
+    uint64_t start = bench_now();
+    bench_check(ydb_delete_current_page(e), "ydb_delete_current_page");
+    bench_check(ydb_append_page(e, page), "ydb_append_page");
+    bench_record(result, bench_now() - start, config->page_size);
+    ydb_page_free(page);
+  }
+  bench_finish(e, result);
+}
+
+// A macro workload: point reads of random pages mixed with updates, appends and deletes.
+static void bench_mixed(const BenchConfig *config, BenchResult *result) {
+  bench_build_table(config);
+  YDB_Engine *e = bench_instance(config);
+  bench_load(config, e);
+  size_t page_count = config->pages;
+
+  for (size_t i = 0; i < config->ops; i++) {
+    const unsigned op = (unsigned) (bench_random() % 100);
+    const size_t target = bench_random() % page_count;
+    YDB_TablePage *page = NULL;
+    if (op >= 60 && op < 80) {
+      bench_check(ydb_seek_to_page(e, target), "ydb_seek_to_page");
+      page = ydb_page_clone(ydb_get_current_page(e));
+      bench_touch_page(config, page);
+    } else if (op >= 80 && op < 90) {
+      page = bench_make_page(config, e);
+    }
+
+    uint64_t start = bench_now();
+    if (op < 60) {
+      // 60% point reads
+      bench_check(ydb_seek_to_page(e, target), "ydb_seek_to_page");
+      bench_read_current(e);
+    } else if (op < 80) {
+      // 20% updates
+      bench_check(ydb_replace_current_page(e, page), "ydb_replace_current_page");
+      page = NULL;
+    } else if (op < 90) {
+      // 10% appends
+      bench_check(ydb_append_page(e, page), "ydb_append_page");
+      page_count++;
+    } else if (page_count > 1) {
+      // 10% deletes
+      bench_check(ydb_seek_to_page(e, target), "ydb_seek_to_page");
+      bench_check(ydb_delete_current_page(e), "ydb_delete_current_page");
+      page_count--;
+    }
+    bench_record(result, bench_now() - start, config->page_size);
+    ydb_page_free(page);
+  }
+  bench_finish(e, result);
+}
+
+static const BenchWorkload bench_workloads[] = {
+    {"create", "create an empty table and unload it", bench_create},
+    {"load", "load a table of -n pages and unload it", bench_load_table},
+    {"append", "append -n pages one by one", bench_append},
+    {"append_batch", "append -n pages in batches of 16", bench_append_batch},
+    {"scan_next", "scan a table of -n pages with ydb_next_page", bench_scan_next},
+    {"scan_prev", "scan a table of -n pages with ydb_prev_page", bench_scan_prev},
+    {"replace", "replace -o random pages", bench_replace},
+    {"churn", "delete -o random pages, appending a new one after each", bench_churn},
+    {"mixed", "-o operations: 60% reads, 20% replaces, 10% appends, 10% deletes", bench_mixed},
+};
+
+#define BENCH_WORKLOAD_COUNT (sizeof(bench_workloads) / sizeof(bench_workloads[0]))
+
+static int bench_compare(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return x < y ? -1 : x > y;
+}
+
+static double bench_percentile(const BenchResult *result, double p) {
+  if (!result->count) return 0;
+  size_t i = (size_t) (p * (double) (result->count - 1) + 0.5);
+  return (double) result->ns[i] / 1000.0;
+}
+
+static void bench_report(const BenchConfig *config, const char *name, BenchResult *result) {
+  uint64_t total_ns = result->extra_ns;
+  for (size_t i = 0; i < result->count; i++) total_ns += result->ns[i];
+  qsort(result->ns, result->count, sizeof(uint64_t), bench_compare);
+  const double seconds = (double) total_ns / 1e9;
+
+  printf("{\"workload\":\"%s\",\"page_size\":%u,\"io\":\"%s\",\"wal\":%d,\"group_commit\":%zu,"
+         "\"compression\":%d,\"checksums\":%d,\"cache_capacity\":%zu,\"readahead\":%zu,\"pages\":%zu,"
+         "\"row_size\":%u,\"seed\":%llu,",
+         name, config->page_size, config->io_mode == YDB_IO_MMAP ? "mmap" : "pio", config->wal,
+         config->group_commit, config->compression, config->checksums, config->cache_capacity,
+         config->readahead, config->pages, config->row_size, (unsigned long long) config->seed);
+  printf("\"ops\":%zu,\"bytes\":%llu,\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"mib_per_sec\":%.2f,",
+         result->count, (unsigned long long) result->bytes, seconds,
+         seconds > 0 ? (double) result->count / seconds : 0.0,
+         seconds > 0 ? (double) result->bytes / seconds / (1024.0 * 1024.0) : 0.0);
+  printf("\"latency_us\":{\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}}\n",
+         bench_percentile(result, 0), bench_percentile(result, 0.5), bench_percentile(result, 0.9),
+         bench_percentile(result, 0.99), bench_percentile(result, 0.999), bench_percentile(result, 1));
+  fflush(stdout);
+}
+
+static void bench_usage(FILE *out) {
+  fprintf(out,
+          "Usage: ydb_bench [options] [workload...]\n"
+          "Runs the given workloads, or all of them, and prints a JSON line per workload.\n\n"
+          "Options:\n"
+          "  -t PATH   table file path (default " BENCH_DEFAULT_PATH "), removed afterwards\n"
+          "  -p SIZE   page size (default %d)\n"
+          "  -n PAGES  table size in pages (default %d)\n"
+          "  -o OPS    operations of random workloads (default %d)\n"
+          "  -r COUNT  repeats of create and load (default %d)\n"
+          "  -R SIZE   row size (default %d)\n"
+          "  -i MODE   I/O mode: pio or mmap (default pio)\n"
+          "  -w        use write-ahead log\n"
+          "  -g OPS    operations per log sync (default %d)\n"
+          "  -z        compress pages\n"
+          "  -k        checksum pages\n"
+          "  -c PAGES  page cache capacity (default %d)\n"
+          "  -a PAGES  read-ahead (default 0)\n"
+          "  -s SEED   random seed (default %d)\n"
+          "  -h        show this help\n\n"
+          "Workloads:\n",
+          YDB_TABLE_PAGE_SIZE, BENCH_DEFAULT_PAGES, BENCH_DEFAULT_OPS, BENCH_DEFAULT_REPEATS,
+          BENCH_DEFAULT_ROW_SIZE, YDB_WAL_DEFAULT_GROUP_COMMIT, YDB_CACHE_DEFAULT_CAPACITY, BENCH_DEFAULT_SEED);
+  for (size_t i = 0; i < BENCH_WORKLOAD_COUNT; i++) {
+    fprintf(out, "  %-13s %s\n", bench_workloads[i].name, bench_workloads[i].description);
+  }
+}
+
+static unsigned long long bench_number(const char *arg, int opt) {
+  char *end;
+  errno = 0;
+  unsigned long long value = strtoull(arg, &end, 10);
+  if (errno || end == arg || *end) {
+    fprintf(stderr, "ydb_bench: invalid value of -%c: %s\n", opt, arg);
+    exit(2);
+  }
+  return value;
+}
+
+int main(int argc, char **argv) {
+  BenchConfig config = {
+      .path = BENCH_DEFAULT_PATH,
+      .page_size = YDB_TABLE_PAGE_SIZE,
+      .io_mode = YDB_IO_PIO,
+      .group_commit = YDB_WAL_DEFAULT_GROUP_COMMIT,
+      .cache_capacity = YDB_CACHE_DEFAULT_CAPACITY,
+      .pages = BENCH_DEFAULT_PAGES,
+      .ops = BENCH_DEFAULT_OPS,
+      .repeats = BENCH_DEFAULT_REPEATS,
+      .row_size = BENCH_DEFAULT_ROW_SIZE,
+      .seed = BENCH_DEFAULT_SEED,
+  };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "t:p:n:o:r:R:i:wg:zkc:a:s:h")) != -1) {
+    switch (opt) {
+      case 't': config.path = optarg; break;
+      case 'p': config.page_size = (YDB_PageSize) bench_number(optarg, opt); break;
+      case 'n': config.pages = bench_number(optarg, opt); break;
+      case 'o': config.ops = bench_number(optarg, opt); break;
+      case 'r': config.repeats = bench_number(optarg, opt); break;
+      case 'R': config.row_size = (YDB_PageSize) bench_number(optarg, opt); break;
+      case 'i':
+        if (!strcmp(optarg, "pio")) config.io_mode = YDB_IO_PIO;
+        else if (!strcmp(optarg, "mmap")) config.io_mode = YDB_IO_MMAP;
+        else {
+          fprintf(stderr, "ydb_bench: unknown I/O mode: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'w': config.wal = 1; break;
+      case 'g': config.group_commit = bench_number(optarg, opt); break;
+      case 'z': config.compression = 1; break;
+      case 'k': config.checksums = 1; break;
+      case 'c': config.cache_capacity = bench_number(optarg, opt); break;
+      case 'a': config.readahead = bench_number(optarg, opt); break;
+      case 's': config.seed = bench_number(optarg, opt); break;
+      case 'h': bench_usage(stdout); return 0;
+      default: bench_usage(stderr); return 2;
+    }
+  }
+  if (!config.pages || !config.row_size) {
+    fprintf(stderr, "ydb_bench: table size and row size must not be 0\n");
+    return 2;
+  }
+
+  int selected[BENCH_WORKLOAD_COUNT] = {0};
+  for (int a = optind; a < argc; a++) {
+    size_t i = 0;
+    while (i < BENCH_WORKLOAD_COUNT && strcmp(argv[a], bench_workloads[i].name)) i++;
+    if (i == BENCH_WORKLOAD_COUNT) {
+      fprintf(stderr, "ydb_bench: unknown workload: %s\n", argv[a]);
+      return 2;
+    }
+    selected[i] = 1;
+  }
+
+  for (size_t i = 0; i < BENCH_WORKLOAD_COUNT; i++) {
+    if (optind < argc && !selected[i]) continue;
+    // Every workload gets the same random sequence
+    bench_rng = config.seed ? config.seed : 1;
+    BenchResult result = {0};
+    bench_workloads[i].run(&config, &result);
+    bench_report(&config, bench_workloads[i].name, &result);
+    free(result.ns);
+  }
+  bench_remove_table(&config);
+  return 0;
+}
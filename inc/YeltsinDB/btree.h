@@ -0,0 +1,154 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file btree.h
+ * @brief A header with the definition of B+-tree index file and functions to work with it.
+ *
+ * The tree maps fixed-size keys to row locations. Keys are compared as bytes (`memcmp`), entries with equal keys
+ * are ordered by location, so every entry is unique and could be removed exactly. Nodes are pages with the
+ * page header of table pages, leaves are chained by their next and previous page offsets for range scans.
+ * Pages are accessed through a page cache of their own. See "B+-tree index file" section of table file
+ * specification for the file format.
+ *
+ * The tree is not logged. Its file is marked with `IDX?` signature before the first change and with `IDX!`
+ * once all the changes are written (ydb_btree_flush()), so a tree that was being changed on crash is known
+ * to be stale on open.
+ */
+
+struct __YDB_BTree;
+
+/** @brief A B+-tree type. */
+typedef struct __YDB_BTree YDB_BTree;
+
+/**
+ * @brief Create an empty tree in empty storage.
+ * @param storage Tree storage. The tree owns it on success.
+ * @param page_size Page size, a power of two from #YDB_TABLE_PAGE_SIZE_MIN to #YDB_TABLE_PAGE_SIZE_MAX.
+ * @param key_size Key size, from 1 to #YDB_INDEX_KEY_MAX_SIZE.
+ * @param cache_capacity Page cache capacity in pages.
+ * @param[out] tree Created tree.
+ * @return Operation status.
+ * @sa ydb_btree_close()
+ *
+ * Returns #YDB_ERR_TABLE_EXIST if the storage is not empty, #YDB_ERR_PAGE_SIZE_INVALID or
+ * #YDB_ERR_KEY_SIZE_INVALID if the sizes are not supported.
+ */
+YDB_Error ydb_btree_create(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size, size_t cache_capacity,
+                           YDB_BTree **tree);
+
+/**
+ * @brief Open a tree.
+ * @param storage Tree storage. The tree owns it on success.
+ * @param cache_capacity Page cache capacity in pages.
+ * @param[out] tree Opened tree.
+ * @return Operation status.
+ * @sa ydb_btree_is_stale()
+ */
+YDB_Error ydb_btree_open(YDB_Storage *storage, size_t cache_capacity, YDB_BTree **tree);
+
+/**
+ * @brief Close a tree and its storage.
+ * @param tree A tree.
+ *
+ * Changes are *not* written, call ydb_btree_flush() first.
+ */
+void ydb_btree_close(YDB_BTree *tree);
+
+/**
+ * @brief Write all the changes and mark the tree file clean.
+ * @param tree A tree.
+ * @return Operation status.
+ *
+ * Does nothing if the tree has not been changed since the last flush.
+ */
+YDB_Error ydb_btree_flush(YDB_BTree *tree);
+
+/**
+ * @brief Check if the tree was left half-changed.
+ * @param tree A tree.
+ * @return Non-zero if the tree file had `IDX?` signature on open and the tree has not been cleared since.
+ */
+int ydb_btree_is_stale(const YDB_BTree *tree);
+
+/**
+ * @brief Get the key size of a tree.
+ * @param tree A tree.
+ * @return Key size.
+ */
+size_t ydb_btree_key_size(const YDB_BTree *tree);
+
+/**
+ * @brief Get the amount of entries in a tree.
+ * @param tree A tree.
+ * @return Entry count.
+ */
+uint64_t ydb_btree_entry_count(const YDB_BTree *tree);
+
+/**
+ * @brief Remove all the entries.
+ * @param tree A tree.
+ * @return Operation status.
+ *
+ * The file is cut down to an empty root. Unwritten changes are dropped.
+ */
+YDB_Error ydb_btree_clear(YDB_BTree *tree);
+
+/**
+ * @brief Add an entry.
+ * @param tree A tree.
+ * @param key Key, as many bytes as the key size of the tree.
+ * @param location Row location.
+ * @return Operation status.
+ *
+ * Does nothing if the tree already has the entry.
+ */
+YDB_Error ydb_btree_insert(YDB_BTree *tree, const void *key, YDB_RowLocation location);
+
+/**
+ * @brief Remove an entry.
+ * @param tree A tree.
+ * @param key Key.
+ * @param location Row location.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_KEY_NOT_FOUND if the tree has no such entry. Nodes are not merged, an empty leaf stays
+ * in the tree and takes entries of its key range again.
+ */
+YDB_Error ydb_btree_delete(YDB_BTree *tree, const void *key, YDB_RowLocation location);
+
+/**
+ * @brief Find the first entry of a key.
+ * @param tree A tree.
+ * @param key Key.
+ * @param[out] location Location of the row the entry refers to, the lowest one if the key has several entries.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_KEY_NOT_FOUND if the tree has no entries of the key.
+ */
+YDB_Error ydb_btree_find(YDB_BTree *tree, const void *key, YDB_RowLocation *location);
+
+/**
+ * @brief Visit entries of a key range in key order.
+ * @param tree A tree.
+ * @param from The lowest key, or NULL to start with the first entry.
+ * @param to The highest key, or NULL to go up to the last entry.
+ * @param visit A callback called for every entry.
+ * @param ctx A context passed to the callback.
+ * @return Operation status. If the callback fails, its error is returned and the rest of entries are skipped.
+ *
+ * Both bounds are inclusive. The tree must not be changed by the callback.
+ */
+YDB_Error ydb_btree_scan(YDB_BTree *tree, const void *from, const void *to, YDB_IndexVisitFn visit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
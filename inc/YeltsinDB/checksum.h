@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file checksum.h
+ * @brief A header with the definition of CRC-32C checksums.
+ *
+ * CRC-32C is computed with SSE4.2 `crc32` instruction if the CPU has it, otherwise with slicing-by-8 tables.
+ * The implementation is picked on the first call.
+ *
+ * Pages of a table with #YDB_TABLE_FLAG_CHECKSUMS flag have a checksum of the page image right after the page
+ * header. It covers the whole image except the checksum itself. See table file v1.5 specification.
+ */
+
+/**
+ * @brief Compute CRC-32C of a buffer.
+ * @param crc CRC-32C of the preceding data, 0 for none.
+ * @param data Data.
+ * @param size Data size.
+ * @return CRC-32C of the preceding data followed by this one.
+ */
+uint32_t ydb_crc32c(uint32_t crc, const void *data, size_t size);
+
+/**
+ * @brief Compute a page checksum.
+ * @param page Page image (page bytes or compressed page image).
+ * @param size Image size.
+ * @return Page checksum.
+ */
+uint32_t ydb_page_checksum(const char *page, size_t size);
+
+/**
+ * @brief Store a page checksum in a page image.
+ * @param page Page image.
+ * @param size Image size.
+ */
+void ydb_page_checksum_set(char *page, size_t size);
+
+/**
+ * @brief Check a page checksum.
+ * @param layout Page layout of the table.
+ * @param page Page image.
+ * @param size Image size.
+ * @return #YDB_ERR_PAGE_CHECKSUM_MISMATCH if the checksum does not match, else #YDB_ERR_SUCCESS.
+ *
+ * Does nothing if pages of the table have no checksums, or if the library is built without
+ * checksum verification (`YDB_VERIFY_CHECKSUMS` CMake option).
+ */
+YDB_Error ydb_page_checksum_verify(const YDB_PageLayout *layout, const char *page, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
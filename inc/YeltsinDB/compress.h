@@ -0,0 +1,90 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file compress.h
+ * @brief A header with the definition of page compression.
+ *
+ * Page data is compressed with a byte-oriented LZ77 codec producing LZ4 block format, which is fast enough
+ * to be done on every page read and write. A compressed page image keeps the page header as is, with
+ * #YDB_TABLE_PAGE_FLAG_COMPRESSED flag set (and the page checksum if the table has them), followed by
+ * compressed data size and compressed data. See table file v1.4 specification.
+ */
+
+/**
+ * @brief Compress a buffer.
+ * @param src Data.
+ * @param size Data size.
+ * @param[out] dst Compressed data.
+ * @param capacity Size of `dst`.
+ * @return Compressed data size, 0 if it does not fit into `capacity`.
+ */
+size_t ydb_lz_compress(const void *src, size_t size, void *dst, size_t capacity);
+
+/**
+ * @brief Decompress a buffer.
+ * @param src Compressed data.
+ * @param size Compressed data size.
+ * @param[out] dst Data.
+ * @param dst_size Data size. Exactly that much data is expected.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_TABLE_DATA_CORRUPTED if compressed data is broken.
+ */
+YDB_Error ydb_lz_decompress(const void *src, size_t size, void *dst, size_t dst_size);
+
+/**
+ * @brief Make a compressed image of a page.
+ * @param layout Page layout of the table.
+ * @param page Page bytes (header and data).
+ * @param[out] image Compressed page image, page-sized buffer.
+ * @return Image size, 0 if the page does not get at least 1/16 (#YDB_COMPRESSED_PAGE_MIN_SAVING_SHIFT) smaller.
+ *
+ * The checksum of the image is not set.
+ */
+size_t ydb_page_pack(const YDB_PageLayout *layout, const char *page, char *image);
+
+/**
+ * @brief Get the size of a page image.
+ * @param layout Page layout of the table.
+ * @param page Page image, at least its header and compressed data size.
+ * @return Compressed image size, page size if the page is not compressed, 0 if compressed data size is broken.
+ */
+size_t ydb_page_image_size(const YDB_PageLayout *layout, const char *page);
+
+/**
+ * @brief Decompress a page image in place.
+ * @param layout Page layout of the table.
+ * @param page Page-sized buffer with a page image.
+ * @return Operation status.
+ *
+ * Does nothing if the page is not compressed.
+ */
+YDB_Error ydb_page_unpack(const YDB_PageLayout *layout, char *page);
+
+/**
+ * @brief Read a page image which could be compressed.
+ * @param layout Page layout of the table.
+ * @param storage A storage to read from.
+ * @param offset Page offset.
+ * @param[out] page Page image, page-sized buffer.
+ * @param[out] size Image size.
+ * @return Operation status.
+ *
+ * The page header is read with #YDB_COMPRESSED_PAGE_PROBE_SIZE bytes of data first, then only the rest of
+ * compressed data. Uncompressed pages are read whole. The image is not decompressed.
+ */
+YDB_Error ydb_page_read_image(const YDB_PageLayout *layout, YDB_Storage *storage, YDB_Offset offset,
+                              char *page, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,14 +10,110 @@
  */
 
 #define YDB_TABLE_FILE_SIGN "TBL!"
+#define YDB_TABLE_FILE_SIGN_DIRTY "TBL?"
 #define YDB_TABLE_FILE_SIGN_SIZE (sizeof(YDB_TABLE_FILE_SIGN)-1)
 #define YDB_TABLE_FILE_VER_MAJOR_SIZE (1)
 #define YDB_TABLE_FILE_VER_MINOR_SIZE (1)
+#define YDB_TABLE_FILE_VER_MAJOR (1)
+#define YDB_TABLE_FILE_VER_MINOR (8)
+#define YDB_TABLE_FILE_VER_MINOR_DIRECTORY (2)
+#define YDB_TABLE_FILE_VER_MINOR_FREE_SPACE_MAP (3)
+#define YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS (4)
+#define YDB_TABLE_FILE_VER_MINOR_CHECKSUMS (5)
+#define YDB_TABLE_FILE_VER_MINOR_PAGE_SIZE (6)
+#define YDB_TABLE_FILE_VER_MINOR_SCHEMA (7)
+#define YDB_TABLE_FILE_VER_MINOR_ZONE_MAPS (8)
 #define YDB_TABLE_FILE_DATA_START_OFFSET (YDB_TABLE_FILE_SIGN_SIZE + YDB_TABLE_FILE_VER_MAJOR_SIZE + \
                                           YDB_TABLE_FILE_VER_MINOR_SIZE)
+// Page size of tables older than v1.6, and of new tables by default
 #define YDB_TABLE_PAGE_SIZE (65536)
+#define YDB_TABLE_PAGE_SIZE_MIN (4096)
+#define YDB_TABLE_PAGE_SIZE_MAX (1048576)
+// Row count is stored in 2 bytes
+#define YDB_TABLE_PAGE_MAX_ROW_COUNT (UINT16_MAX)
 
 #define YDB_TABLE_PAGE_FLAG_DELETED (1)
+#define YDB_TABLE_PAGE_FLAG_SLOTTED (2)
+#define YDB_TABLE_PAGE_FLAG_DIRECTORY (4)
+#define YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP (8)
+#define YDB_TABLE_PAGE_FLAG_COMPRESSED (16)
+#define YDB_TABLE_PAGE_FLAG_WIDE_SLOTS (32)
+#define YDB_TABLE_PAGE_FLAG_SCHEMA (64)
+#define YDB_TABLE_PAGE_FLAG_PAX (128)
+
+#define YDB_TABLE_FLAG_COMPRESSED (1)
+#define YDB_TABLE_FLAG_CHECKSUMS (2)
+
+#define YDB_ROW_FLAG_DELETED (1)
+#define YDB_ROW_FLAGS_SIZE (1)
+
+#define YDB_SLOTTED_HEADER_SIZE (2)
+#define YDB_SLOT_SIZE (4)
+#define YDB_SLOTTED_WIDE_HEADER_SIZE (4)
+#define YDB_WIDE_SLOT_SIZE (8)
+
+#define YDB_SCHEMA_MAX_COLUMNS (1024)
+#define YDB_SCHEMA_NAME_MAX_SIZE (63)
+#define YDB_SCHEMA_END_OFFSET_SIZE (4)
+#define YDB_COLUMN_FLAG_NULLABLE (1)
+#define YDB_COLUMN_FLAG_ZONE_MAP (2)
+
+#define YDB_ZONE_MAP_FLAG_UNKNOWN (1)
+
+// Minipages of PAX pages start at multiples of it
+#define YDB_PAX_MINIPAGE_ALIGN (8)
+
+#define YDB_FSM_FREE (0xFF)
+#define YDB_FSM_CATEGORY_COUNT (254)
+
+// A page is stored compressed only if it gets at least 1/16 smaller
+#define YDB_COMPRESSED_PAGE_MIN_SAVING_SHIFT (4)
+#define YDB_COMPRESSED_PAGE_PROBE_SIZE (4096)
+
+#define YDB_PAGE_ALLOC_NO_ZERO (1)
+
+#define YDB_CACHE_LINE_SIZE (64)
+#define YDB_PAGE_ALLOCATOR_DEFAULT_MAX_FREE (16)
+
+#define YDB_CACHE_DEFAULT_CAPACITY (64)
+#define YDB_CACHE_MIN_CAPACITY (4)
+
+#define YDB_PAGE_LATCH_COUNT (64)
+
+// Latency histograms have power-of-two buckets, from 1 ns up to about 2^40 ns (18 minutes)
+#define YDB_STATS_LATENCY_BUCKETS (40)
+
+#define YDB_MMAP_MIN_RESERVE ((size_t) 1 << 30)
+
+#define YDB_WAL_FILE_SUFFIX "-wal"
+#define YDB_WAL_RECORD_DATA (1)
+#define YDB_WAL_RECORD_COMMIT (2)
+#define YDB_WAL_DEFAULT_GROUP_COMMIT (1)
+#define YDB_WAL_CHECKPOINT_SIZE ((YDB_Offset) 64 << 20)
+// With the log, frames changed by an operation stay in the page cache until it's committed. An operation on
+// a single page changes and pins fewer frames than this, with room left for cursors.
+#define YDB_WAL_OPERATION_FRAMES (16)
+#define YDB_WAL_CACHE_MIN_CAPACITY (2 * YDB_WAL_OPERATION_FRAMES)
+
+#define YDB_INDEX_FILE_SIGN "IDX!"
+#define YDB_INDEX_FILE_SIGN_DIRTY "IDX?"
+#define YDB_INDEX_FILE_VER_MAJOR (1)
+#define YDB_INDEX_FILE_VER_MINOR (0)
+#define YDB_INDEX_KEY_MAX_SIZE (255)
+#define YDB_INDEX_MAX_HEIGHT (32)
+
+#define YDB_INDEX_PAGE_FLAG_LEAF (1)
+#define YDB_INDEX_PAGE_FLAG_INNER (2)
+
+#define YDB_HASH_FILE_SIGN "HSH!"
+#define YDB_HASH_FILE_SIGN_DIRTY "HSH?"
+#define YDB_HASH_FILE_VER_MAJOR (1)
+#define YDB_HASH_FILE_VER_MINOR (0)
+// The directory has 2^24 buckets at most, a bucket that can't be split any more gets overflow pages
+#define YDB_HASH_MAX_DEPTH (24)
+
+#define YDB_HASH_PAGE_FLAG_BUCKET (1)
+#define YDB_HASH_PAGE_FLAG_DIRECTORY (2)
 
 // TODO static_assert for sizes
 
@@ -25,10 +121,17 @@ enum YDB_v1_sizes {
   YDB_v1_first_page_size = 8,
   YDB_v1_last_page_size = 8,
   YDB_v1_last_free_page_size = 8,
+  YDB_v1_directory_size = 8,
+  YDB_v1_free_space_map_size = 8,
+  YDB_v1_table_flags_size = 8,
+  YDB_v1_page_size_size = 4,
+  YDB_v1_schema_size = 8,
   YDB_v1_page_flags_size = 1,
   YDB_v1_page_next_size = 8,
   YDB_v1_page_prev_size = 8,
   YDB_v1_page_row_count_size = 2,
+  YDB_v1_page_checksum_size = 4,
+  YDB_v1_page_compressed_size_size = 4,
 };
 
 enum YDB_v1_offsets {
@@ -36,6 +139,21 @@ enum YDB_v1_offsets {
   YDB_v1_last_page_offset = YDB_v1_first_page_offset + YDB_v1_first_page_size,
   YDB_v1_last_free_page_offset = YDB_v1_last_page_offset + YDB_v1_last_page_size,
   YDB_v1_data_offset = YDB_v1_last_free_page_offset + YDB_v1_last_free_page_size,
+  // Since v1.2
+  YDB_v1_directory_offset = YDB_v1_data_offset,
+  YDB_v1_2_data_offset = YDB_v1_directory_offset + YDB_v1_directory_size,
+  // Since v1.3
+  YDB_v1_free_space_map_offset = YDB_v1_2_data_offset,
+  YDB_v1_3_data_offset = YDB_v1_free_space_map_offset + YDB_v1_free_space_map_size,
+  // Since v1.4
+  YDB_v1_table_flags_offset = YDB_v1_3_data_offset,
+  YDB_v1_4_data_offset = YDB_v1_table_flags_offset + YDB_v1_table_flags_size,
+  // Since v1.6
+  YDB_v1_page_size_offset = YDB_v1_4_data_offset,
+  YDB_v1_6_data_offset = YDB_v1_page_size_offset + YDB_v1_page_size_size,
+  // Since v1.7
+  YDB_v1_schema_offset = YDB_v1_6_data_offset,
+  YDB_v1_7_data_offset = YDB_v1_schema_offset + YDB_v1_schema_size,
 };
 
 enum YDB_v1_page_offsets {
@@ -44,4 +162,118 @@ enum YDB_v1_page_offsets {
   YDB_v1_page_prev_offset = YDB_v1_page_next_offset + YDB_v1_page_next_size,
   YDB_v1_page_row_count_offset = YDB_v1_page_prev_offset + YDB_v1_page_prev_size,
   YDB_v1_page_data_offset = YDB_v1_page_row_count_offset + YDB_v1_page_row_count_size,
-};
\ No newline at end of file
+  // Pages of tables with checksums (since v1.5)
+  YDB_v1_page_checksum_offset = YDB_v1_page_data_offset,
+  YDB_v1_page_checksummed_data_offset = YDB_v1_page_checksum_offset + YDB_v1_page_checksum_size,
+};
+
+enum YDB_schema_column_sizes {
+  YDB_schema_column_type_size = 1,
+  YDB_schema_column_flags_size = 1,
+  YDB_schema_column_width_size = 4,
+  YDB_schema_column_name_size_size = 1,
+};
+
+enum YDB_schema_column_offsets {
+  YDB_schema_column_type_offset = 0,
+  YDB_schema_column_flags_offset = YDB_schema_column_type_offset + YDB_schema_column_type_size,
+  YDB_schema_column_width_offset = YDB_schema_column_flags_offset + YDB_schema_column_flags_size,
+  YDB_schema_column_name_size_offset = YDB_schema_column_width_offset + YDB_schema_column_width_size,
+  YDB_schema_column_name_offset = YDB_schema_column_name_size_offset + YDB_schema_column_name_size_size,
+};
+
+enum YDB_zone_map_sizes {
+  YDB_zone_map_min_size = 8,
+  YDB_zone_map_max_size = 8,
+  YDB_zone_map_value_count_size = 2,
+  YDB_zone_map_null_count_size = 2,
+  YDB_zone_map_flags_size = 1,
+  YDB_zone_map_reserved_size = 3,
+};
+
+enum YDB_zone_map_offsets {
+  YDB_zone_map_min_offset = 0,
+  YDB_zone_map_max_offset = YDB_zone_map_min_offset + YDB_zone_map_min_size,
+  YDB_zone_map_value_count_offset = YDB_zone_map_max_offset + YDB_zone_map_max_size,
+  YDB_zone_map_null_count_offset = YDB_zone_map_value_count_offset + YDB_zone_map_value_count_size,
+  YDB_zone_map_flags_offset = YDB_zone_map_null_count_offset + YDB_zone_map_null_count_size,
+  YDB_zone_map_reserved_offset = YDB_zone_map_flags_offset + YDB_zone_map_flags_size,
+  YDB_zone_map_entry_size = YDB_zone_map_reserved_offset + YDB_zone_map_reserved_size,
+};
+
+enum YDB_pax_sizes {
+  YDB_pax_column_count_size = 2,
+  YDB_pax_reserved_size = 2,
+  YDB_pax_values_offset_size = 4,
+  YDB_pax_nulls_offset_size = 4,
+};
+
+enum YDB_pax_offsets {
+  YDB_pax_column_count_offset = 0,
+  YDB_pax_reserved_offset = YDB_pax_column_count_offset + YDB_pax_column_count_size,
+  YDB_pax_directory_offset = YDB_pax_reserved_offset + YDB_pax_reserved_size,
+  // Within a minipage directory entry
+  YDB_pax_values_offset_offset = 0,
+  YDB_pax_nulls_offset_offset = YDB_pax_values_offset_offset + YDB_pax_values_offset_size,
+  YDB_pax_entry_size = YDB_pax_nulls_offset_offset + YDB_pax_nulls_offset_size,
+};
+
+enum YDB_index_sizes {
+  YDB_index_page_size_size = 4,
+  YDB_index_key_size_size = 2,
+  YDB_index_root_size = 8,
+  YDB_index_entry_count_size = 8,
+  YDB_index_entry_page_size = 8,
+  YDB_index_entry_row_size = 2,
+  YDB_index_entry_child_size = 8,
+};
+
+enum YDB_index_offsets {
+  YDB_index_page_size_offset = YDB_TABLE_FILE_DATA_START_OFFSET,
+  YDB_index_key_size_offset = YDB_index_page_size_offset + YDB_index_page_size_size,
+  YDB_index_root_offset = YDB_index_key_size_offset + YDB_index_key_size_size,
+  YDB_index_entry_count_offset = YDB_index_root_offset + YDB_index_root_size,
+  YDB_index_data_offset = YDB_index_entry_count_offset + YDB_index_entry_count_size,
+};
+
+enum YDB_hash_sizes {
+  YDB_hash_page_size_size = 4,
+  YDB_hash_key_size_size = 2,
+  YDB_hash_depth_size = 2,
+  YDB_hash_directory_size = 8,
+  YDB_hash_entry_count_size = 8,
+  YDB_hash_bucket_depth_size = 4,
+  YDB_hash_bucket_hash_size = 4,
+  YDB_hash_directory_entry_size = 8,
+};
+
+enum YDB_hash_offsets {
+  YDB_hash_page_size_offset = YDB_TABLE_FILE_DATA_START_OFFSET,
+  YDB_hash_key_size_offset = YDB_hash_page_size_offset + YDB_hash_page_size_size,
+  YDB_hash_depth_offset = YDB_hash_key_size_offset + YDB_hash_key_size_size,
+  YDB_hash_directory_offset = YDB_hash_depth_offset + YDB_hash_depth_size,
+  YDB_hash_entry_count_offset = YDB_hash_directory_offset + YDB_hash_directory_size,
+  YDB_hash_data_offset = YDB_hash_entry_count_offset + YDB_hash_entry_count_size,
+  // Bucket pages
+  YDB_hash_bucket_depth_offset = YDB_v1_page_data_offset,
+  YDB_hash_bucket_hashes_offset = YDB_hash_bucket_depth_offset + YDB_hash_bucket_depth_size,
+};
+
+enum YDB_wal_record_sizes {
+  YDB_wal_record_type_size = 1,
+  YDB_wal_record_reserved_size = 3,
+  YDB_wal_record_length_size = 4,
+  YDB_wal_record_target_size = 8,
+  YDB_wal_record_checksum_size = 4,
+  YDB_wal_record_padding_size = 4,
+};
+
+enum YDB_wal_record_offsets {
+  YDB_wal_record_type_offset = 0,
+  YDB_wal_record_length_offset = YDB_wal_record_type_offset + YDB_wal_record_type_size +
+                                 YDB_wal_record_reserved_size,
+  YDB_wal_record_target_offset = YDB_wal_record_length_offset + YDB_wal_record_length_size,
+  YDB_wal_record_checksum_offset = YDB_wal_record_target_offset + YDB_wal_record_target_size,
+  YDB_wal_record_data_offset = YDB_wal_record_checksum_offset + YDB_wal_record_checksum_size +
+                               YDB_wal_record_padding_size,
+};
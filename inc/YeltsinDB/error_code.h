@@ -70,6 +70,98 @@
  * @brief The addresses of pages are the same.
  */
 #define YDB_ERR_SAME_PAGE_ADDRESS           (-13)
+/**
+ * @brief The page cache is not initialized.
+ */
+#define YDB_ERR_CACHE_NOT_INITIALIZED       (-14)
+/**
+ * @brief Every page cache frame is pinned, nothing could be evicted.
+ */
+#define YDB_ERR_CACHE_NO_FREE_FRAMES        (-15)
+/**
+ * @brief Failed to write table data.
+ */
+#define YDB_ERR_TABLE_DATA_WRITE_FAILED     (-16)
+/**
+ * @brief The page is a read-only view.
+ */
+#define YDB_ERR_PAGE_READ_ONLY              (-17)
+/**
+ * @brief The storage is not initialized.
+ */
+#define YDB_ERR_STORAGE_NOT_INITIALIZED     (-18)
+/**
+ * @brief The page does not have slotted layout.
+ */
+#define YDB_ERR_PAGE_NOT_SLOTTED            (-19)
+/**
+ * @brief There is no row with such id in the page.
+ */
+#define YDB_ERR_ROW_NOT_EXIST               (-20)
+/**
+ * @brief The write-ahead log is not initialized.
+ */
+#define YDB_ERR_WAL_NOT_INITIALIZED         (-21)
+/**
+ * @brief The cursor is not initialized.
+ */
+#define YDB_ERR_CURSOR_NOT_INITIALIZED      (-22)
+/**
+ * @brief The page has been deleted.
+ */
+#define YDB_ERR_PAGE_DELETED                (-23)
+/**
+ * @brief The page checksum does not match page contents.
+ */
+#define YDB_ERR_PAGE_CHECKSUM_MISMATCH      (-24)
+/**
+ * @brief The page data does not fit a page of the table.
+ */
+#define YDB_ERR_PAGE_TOO_LARGE              (-25)
+/**
+ * @brief The page size is not supported.
+ */
+#define YDB_ERR_PAGE_SIZE_INVALID           (-26)
+/**
+ * @brief The index is not initialized.
+ */
+#define YDB_ERR_INDEX_NOT_INITIALIZED       (-27)
+/**
+ * @brief The index has no such key.
+ */
+#define YDB_ERR_KEY_NOT_FOUND               (-28)
+/**
+ * @brief The key size is not supported.
+ */
+#define YDB_ERR_KEY_SIZE_INVALID            (-29)
+/**
+ * @brief The index keeps no key order.
+ */
+#define YDB_ERR_INDEX_NOT_ORDERED           (-30)
+/**
+ * @brief The schema is not valid.
+ */
+#define YDB_ERR_SCHEMA_INVALID              (-31)
+/**
+ * @brief The schema has no such column.
+ */
+#define YDB_ERR_COLUMN_NOT_EXIST            (-32)
+/**
+ * @brief The row does not match the schema.
+ */
+#define YDB_ERR_ROW_SCHEMA_MISMATCH         (-33)
+/**
+ * @brief The page is not a PAX page.
+ */
+#define YDB_ERR_PAGE_NOT_PAX                (-34)
+/**
+ * @brief The predicate is not valid.
+ */
+#define YDB_ERR_PREDICATE_INVALID           (-35)
+/**
+ * @brief The write-ahead log file cannot be opened.
+ */
+#define YDB_ERR_WAL_OPEN_FAILED             (-36)
 /**
  * @brief An unknown error has occurred.
  */
@@ -0,0 +1,155 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/pax.h>
+#include <YeltsinDB/schema.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file filter.h
+ * @brief A header with predicate filtering over minipages.
+ *
+ * A predicate compares a fixed-width column with constants. It is evaluated over a minipage (see pax.h),
+ * where the values of the column lie one after another, and gives a selection bitmap: a bit for every row,
+ * least significant bit first, set if the row matches. Null values never match.
+ *
+ * 32-bit and 64-bit integer and float columns are compared with AVX2 or SSE4.2 kernels when the CPU has them,
+ * picked at runtime. Other columns, and all of them on other CPUs, are compared a value at a time.
+ *
+ * Zone maps (min/max summaries of a column in a page) tell whether a predicate could match a page at all.
+ */
+
+/** @brief Comparison operators. */
+typedef enum {
+  YDB_CMP_EQ = 1, /**< The value is equal to the constant. */
+  YDB_CMP_LT, /**< The value is less than the constant. */
+  YDB_CMP_GT, /**< The value is greater than the constant. */
+  YDB_CMP_BETWEEN, /**< The value is between two constants, both included. */
+  YDB_CMP_IN, /**< The value is equal to one of the constants. */
+} YDB_CompareOp;
+
+/**
+ * @brief A predicate on a column.
+ *
+ * Constants have the type and width of the column and are in architecture endian, like #YDB_Value data.
+ * Values of #YDB_COLUMN_BYTES columns are compared as with memcmp(). Floats are compared as numbers,
+ * so NaN matches nothing.
+ */
+typedef struct {
+  size_t column; /**< Column index. */
+  YDB_CompareOp op; /**< Comparison operator. */
+  const void *values; /**< Constants, one after another. */
+  size_t value_count; /**< The amount of constants: 2 for #YDB_CMP_BETWEEN, at least 1 for #YDB_CMP_IN,
+                           1 for the rest. */
+} YDB_Predicate;
+
+/** @brief Kernel sets. */
+typedef enum {
+  YDB_FILTER_SCALAR = 0, /**< A value at a time. */
+  YDB_FILTER_SSE, /**< SSE4.2. */
+  YDB_FILTER_AVX2, /**< AVX2. */
+} YDB_FilterIsa;
+
+/**
+ * @brief A callback called for every page of a filtered scan.
+ * @param ctx User context.
+ * @param index Page index.
+ * @param columns Minipages of the requested columns, in the requested order. Valid until the callback returns.
+ * @param row_count The amount of rows.
+ * @param selection Selection bitmap of the page rows, `(row_count + 7) / 8` bytes.
+ * @return Operation status. Anything but #YDB_ERR_SUCCESS stops the scan.
+ */
+typedef YDB_Error (*YDB_FilterScanFn)(void *ctx, size_t index, const YDB_PaxColumn *columns, YDB_PageSize row_count,
+                                      const uint8_t *selection);
+
+/**
+ * @brief A value of a zone map, in architecture endian.
+ *
+ * `i` is set for signed integer columns, `u` for unsigned ones and `f` for float columns.
+ */
+typedef union {
+  int64_t i; /**< Signed integer. */
+  uint64_t u; /**< Unsigned integer. */
+  double f; /**< Float. */
+} YDB_ZoneValue;
+
+/**
+ * @brief A zone map: a summary of the values of a column in a page.
+ *
+ * A filtered scan skips a page if a zone map rules a predicate out (see ydb_zone_map_may_match()).
+ */
+typedef struct {
+  YDB_ZoneValue min; /**< The smallest value, valid if `value_count` is not 0. */
+  YDB_ZoneValue max; /**< The largest value, valid if `value_count` is not 0. */
+  YDB_PageSize value_count; /**< The amount of values that are neither null nor NaN. */
+  YDB_PageSize null_count; /**< The amount of null values. */
+  uint8_t unknown; /**< Set if the page could not be summarized. Such a page is never skipped. */
+} YDB_ZoneMap;
+
+/**
+ * @brief Get the best kernel set of the CPU.
+ * @return Kernel set, detected on the first call.
+ */
+YDB_FilterIsa ydb_filter_isa(void);
+
+/**
+ * @brief Check that a predicate could be evaluated on a schema.
+ * @param schema A schema.
+ * @param predicate A predicate.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_COLUMN_NOT_EXIST if there is no such column, and #YDB_ERR_PREDICATE_INVALID if the column is
+ * variable-width, the operator is unknown or the amount of constants does not fit it.
+ */
+YDB_Error ydb_predicate_check(const YDB_Schema *schema, const YDB_Predicate *predicate);
+
+/**
+ * @brief Evaluate a predicate over a minipage.
+ * @param schema A schema.
+ * @param predicate A predicate checked with ydb_predicate_check().
+ * @param minipage Minipage of the predicate column.
+ * @param isa Kernel set, lowered to ydb_filter_isa() if the CPU lacks it.
+ * @param[out] selection Selection bitmap, `(count + 7) / 8` bytes. Unused bits of the last byte are cleared.
+ */
+void ydb_filter_minipage(const YDB_Schema *schema, const YDB_Predicate *predicate, const YDB_PaxColumn *minipage,
+                         YDB_FilterIsa isa, uint8_t *selection);
+
+/**
+ * @brief Make an empty zone map.
+ * @param[out] zone A zone map.
+ */
+void ydb_zone_map_init(YDB_ZoneMap *zone);
+
+/**
+ * @brief Add a value to a zone map.
+ * @param column An integer or float column.
+ * @param zone A zone map.
+ * @param value A little-endian value, as in rows and minipages. NULL for a null value.
+ */
+void ydb_zone_map_add(const YDB_Column *column, YDB_ZoneMap *zone, const void *value);
+
+/**
+ * @brief Check if a predicate could match any value of a zone map.
+ * @param column The column of the zone map.
+ * @param zone A zone map.
+ * @param predicate A predicate on the column, checked with ydb_predicate_check().
+ * @return 0 if no value of the zone map matches the predicate.
+ */
+int ydb_zone_map_may_match(const YDB_Column *column, const YDB_ZoneMap *zone, const YDB_Predicate *predicate);
+
+/**
+ * @brief Count selected rows.
+ * @param selection Selection bitmap.
+ * @param row_count The amount of rows.
+ * @return The amount of set bits.
+ */
+size_t ydb_selection_count(const uint8_t *selection, YDB_PageSize row_count);
+
+#ifdef __cplusplus
+}
+#endif
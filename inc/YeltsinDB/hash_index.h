@@ -0,0 +1,151 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file hash_index.h
+ * @brief A header with the definition of extendible hash index file and functions to work with it.
+ *
+ * The index maps fixed-size keys to row locations, like a B+-tree (see btree.h), but keeps no key order:
+ * a key is found by its hash in one bucket page, picked by the low bits of the hash in a directory kept
+ * in memory. A full bucket is split in two, doubling the directory if needed. Buckets keep hashes of their
+ * entries in an array of their own, so a lookup compares keys of matching hashes only. See "Hash index file"
+ * section of table file specification for the file format.
+ *
+ * The index is not logged, it's marked with `HSH?` signature before the first change and with `HSH!` once all
+ * the changes are written (ydb_hash_flush()), like a B+-tree.
+ */
+
+struct __YDB_HashIndex;
+
+/** @brief A hash index type. */
+typedef struct __YDB_HashIndex YDB_HashIndex;
+
+/**
+ * @brief Create an empty hash index in empty storage.
+ * @param storage Index storage. The index owns it on success.
+ * @param page_size Page size, a power of two from #YDB_TABLE_PAGE_SIZE_MIN to #YDB_TABLE_PAGE_SIZE_MAX.
+ * @param key_size Key size, from 1 to #YDB_INDEX_KEY_MAX_SIZE.
+ * @param cache_capacity Page cache capacity in pages.
+ * @param[out] index Created index.
+ * @return Operation status.
+ * @sa ydb_hash_close()
+ *
+ * Returns #YDB_ERR_TABLE_EXIST if the storage is not empty, #YDB_ERR_PAGE_SIZE_INVALID or
+ * #YDB_ERR_KEY_SIZE_INVALID if the sizes are not supported.
+ */
+YDB_Error ydb_hash_create(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size, size_t cache_capacity,
+                          YDB_HashIndex **index);
+
+/**
+ * @brief Open a hash index.
+ * @param storage Index storage. The index owns it on success.
+ * @param cache_capacity Page cache capacity in pages.
+ * @param[out] index Opened index.
+ * @return Operation status.
+ * @sa ydb_hash_is_stale()
+ *
+ * Nothing of a stale index could be trusted, so it's opened empty.
+ */
+YDB_Error ydb_hash_open(YDB_Storage *storage, size_t cache_capacity, YDB_HashIndex **index);
+
+/**
+ * @brief Close an index and its storage.
+ * @param index An index.
+ *
+ * Changes are *not* written, call ydb_hash_flush() first.
+ */
+void ydb_hash_close(YDB_HashIndex *index);
+
+/**
+ * @brief Write all the changes and mark the index file clean.
+ * @param index An index.
+ * @return Operation status.
+ */
+YDB_Error ydb_hash_flush(YDB_HashIndex *index);
+
+/**
+ * @brief Check if the index was left half-changed.
+ * @param index An index.
+ * @return Non-zero if the index file had `HSH?` signature on open and the index has not been cleared since.
+ */
+int ydb_hash_is_stale(const YDB_HashIndex *index);
+
+/**
+ * @brief Get the key size of an index.
+ * @param index An index.
+ * @return Key size.
+ */
+size_t ydb_hash_key_size(const YDB_HashIndex *index);
+
+/**
+ * @brief Get the amount of entries in an index.
+ * @param index An index.
+ * @return Entry count.
+ */
+uint64_t ydb_hash_entry_count(const YDB_HashIndex *index);
+
+/**
+ * @brief Remove all the entries.
+ * @param index An index.
+ * @return Operation status.
+ *
+ * The file is cut down to a single empty bucket. Unwritten changes are dropped.
+ */
+YDB_Error ydb_hash_clear(YDB_HashIndex *index);
+
+/**
+ * @brief Add an entry.
+ * @param index An index.
+ * @param key Key, as many bytes as the key size of the index.
+ * @param location Row location.
+ * @return Operation status.
+ *
+ * Does nothing if the index already has the entry.
+ */
+YDB_Error ydb_hash_insert(YDB_HashIndex *index, const void *key, YDB_RowLocation location);
+
+/**
+ * @brief Remove an entry.
+ * @param index An index.
+ * @param key Key.
+ * @param location Row location.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_KEY_NOT_FOUND if the index has no such entry. Buckets are not merged.
+ */
+YDB_Error ydb_hash_delete(YDB_HashIndex *index, const void *key, YDB_RowLocation location);
+
+/**
+ * @brief Find the first entry of a key.
+ * @param index An index.
+ * @param key Key.
+ * @param[out] location Location of the row the entry refers to, the lowest one if the key has several entries.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_KEY_NOT_FOUND if the index has no entries of the key.
+ */
+YDB_Error ydb_hash_find(YDB_HashIndex *index, const void *key, YDB_RowLocation *location);
+
+/**
+ * @brief Visit all the entries of a key.
+ * @param index An index.
+ * @param key Key.
+ * @param visit A callback called for every entry, in no particular order.
+ * @param ctx A context passed to the callback.
+ * @return Operation status. If the callback fails, its error is returned and the rest of entries are skipped.
+ *
+ * The index must not be changed by the callback.
+ */
+YDB_Error ydb_hash_find_all(YDB_HashIndex *index, const void *key, YDB_IndexVisitFn visit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file page_cache.h
+ * @brief A header with the definition of page cache (buffer pool) and functions to work with it.
+ *
+ * The cache keeps a fixed amount of page-sized frames keyed by page offset in a table file.
+ * Frames are evicted with CLOCK (second chance) policy. Pinned frames are never evicted,
+ * dirty frames are written back before eviction or on ydb_cache_flush().
+ *
+ * Every function but ydb_cache_alloc() and ydb_cache_free() could be called from several threads at once.
+ * Lookups are done under the cache lock. Reads on a miss and write-backs of evicted frames are not: the frame
+ * is marked busy for the time of I/O, and other threads pinning the same page wait for it to finish. Other
+ * callbacks (flush and visits of held frames) are called with the lock held.
+ * Frame data itself is not protected: threads sharing a pinned frame agree on their own how to access it.
+ */
+
+struct __YDB_PageCache;
+
+/** @brief A page cache type. */
+typedef struct __YDB_PageCache YDB_PageCache;
+
+/**
+ * @brief A callback used to read a page from the backing storage.
+ * @param ctx User context passed to ydb_cache_alloc().
+ * @param offset Page offset in the backing storage.
+ * @param dst A destination buffer.
+ * @param size An amount of bytes to read.
+ * @return Operation status.
+ */
+typedef YDB_Error (*YDB_CacheReadFn)(void *ctx, YDB_Offset offset, void *dst, size_t size);
+
+/**
+ * @brief A callback used to write a page back to the backing storage.
+ * @param ctx User context passed to ydb_cache_alloc().
+ * @param offset Page offset in the backing storage.
+ * @param src A source buffer.
+ * @param size An amount of bytes to write.
+ * @return Operation status.
+ */
+typedef YDB_Error (*YDB_CacheWriteFn)(void *ctx, YDB_Offset offset, const void *src, size_t size);
+
+/**
+ * @brief A callback used to visit cached pages.
+ * @param ctx User context.
+ * @param offset Page offset in the backing storage.
+ * @param data Page data.
+ * @param size Page size.
+ * @return Operation status.
+ */
+typedef YDB_Error (*YDB_CacheVisitFn)(void *ctx, YDB_Offset offset, const void *data, size_t size);
+
+/** @brief Page cache counters. */
+typedef struct {
+  uint64_t hits; /**< The amount of lookups served from memory. */
+  uint64_t misses; /**< The amount of lookups that required a read. */
+  uint64_t evictions; /**< The amount of valid frames evicted. */
+  uint64_t writebacks; /**< The amount of dirty frames written back. */
+} YDB_CacheStats;
+
+/**
+ * @brief Allocate a new page cache.
+ * @param capacity The amount of frames.
+ * @param frame_size The size of a frame (page size).
+ * @param read A callback to read pages on cache miss.
+ * @param write A callback to write dirty pages back.
+ * @param ctx A context passed to the callbacks.
+ * @return A pointer to allocated cache, or NULL if `capacity` or `frame_size` is 0.
+ * @sa ydb_cache_free()
+ */
+YDB_PageCache *ydb_cache_alloc(size_t capacity, size_t frame_size,
+                               YDB_CacheReadFn read, YDB_CacheWriteFn write, void *ctx);
+
+/**
+ * @brief De-allocate page cache.
+ * @param cache Cache to be de-allocated.
+ *
+ * Notice that dirty frames are *not* written back, call ydb_cache_flush() first.
+ */
+void ydb_cache_free(YDB_PageCache *cache);
+
+/**
+ * @brief Pin a page frame, reading it from the backing storage on a miss.
+ * @param cache A cache.
+ * @param offset Page offset.
+ * @param[out] frame A pointer to the frame data.
+ * @return Operation status.
+ * @sa ydb_cache_unpin()
+ *
+ * Returns #YDB_ERR_CACHE_NO_FREE_FRAMES if every frame is pinned.
+ */
+YDB_Error ydb_cache_pin(YDB_PageCache *cache, YDB_Offset offset, char **frame);
+
+/**
+ * @brief Pin a zero-filled frame for a page that does not exist in the backing storage yet.
+ * @param cache A cache.
+ * @param offset Page offset.
+ * @param[out] frame A pointer to the frame data.
+ * @return Operation status.
+ *
+ * The frame is marked dirty, so it will be written on flush or eviction.
+ */
+YDB_Error ydb_cache_pin_new(YDB_PageCache *cache, YDB_Offset offset, char **frame);
+
+/**
+ * @brief Unpin a page frame.
+ * @param cache A cache.
+ * @param offset Page offset.
+ */
+void ydb_cache_unpin(YDB_PageCache *cache, YDB_Offset offset);
+
+/**
+ * @brief Mark a cached page as modified.
+ * @param cache A cache.
+ * @param offset Page offset.
+ */
+void ydb_cache_mark_dirty(YDB_PageCache *cache, YDB_Offset offset);
+
+/**
+ * @brief Enable or disable no-steal mode.
+ * @param cache A cache.
+ * @param enabled Non-zero to enable.
+ * @sa ydb_cache_release_held()
+ *
+ * In no-steal mode frames that became dirty are *held*: they are not evicted (and so not written back)
+ * until ydb_cache_release_held() is called. This way a half-done change never reaches the backing storage.
+ */
+void ydb_cache_set_no_steal(YDB_PageCache *cache, int enabled);
+
+/**
+ * @brief Call a function for every held frame.
+ * @param cache A cache.
+ * @param visit A callback.
+ * @param ctx A context passed to the callback.
+ * @return Operation status. If the callback fails, its error is returned and the rest of frames are skipped.
+ *
+ * Frames stay held, so the callback could keep referring to frame data until ydb_cache_release_held().
+ */
+YDB_Error ydb_cache_visit_held(YDB_PageCache *cache, YDB_CacheVisitFn visit, void *ctx);
+
+/**
+ * @brief Release held frames, so they could be evicted again.
+ * @param cache A cache.
+ * @param visit A callback called for every held frame before releasing it (could be NULL).
+ * @param ctx A context passed to the callback.
+ * @return Operation status. If the callback fails, its error is returned and the rest of frames stay held.
+ *
+ * Released frames stay dirty until written back.
+ */
+YDB_Error ydb_cache_release_held(YDB_PageCache *cache, YDB_CacheVisitFn visit, void *ctx);
+
+/**
+ * @brief Drop held frames without writing them back.
+ * @param cache A cache.
+ *
+ * Undoes a change that is not going to be committed: the pages are read from the backing storage again on the
+ * next pin. Pinned frames are only released.
+ */
+void ydb_cache_discard_held(YDB_PageCache *cache);
+
+/**
+ * @brief Write all dirty frames back.
+ * @param cache A cache.
+ * @return Operation status.
+ */
+YDB_Error ydb_cache_flush(YDB_PageCache *cache);
+
+/**
+ * @brief Drop frames of pages at or past an offset without writing them back.
+ * @param cache A cache.
+ * @param offset The first offset to drop, e.g. the new end of a truncated file.
+ *
+ * Pinned frames are kept.
+ */
+void ydb_cache_discard(YDB_PageCache *cache, YDB_Offset offset);
+
+/**
+ * @brief Get cache counters.
+ * @param cache A cache.
+ * @param[out] stats Counters destination.
+ */
+void ydb_cache_stats_get(const YDB_PageCache *cache, YDB_CacheStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/schema.h>
+#include <YeltsinDB/table_page.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file pax.h
+ * @brief A header with columnar (PAX) pages.
+ *
+ * A PAX page keeps rows of a schema column by column: every column has a minipage with the values of all
+ * the rows of the page stored contiguously, so reading a few columns touches only their minipages.
+ * The page is marked with #YDB_TABLE_PAGE_FLAG_PAX and stays in the same page chain as row pages.
+ * See table file v1.7 specification for the layout.
+ */
+
+/**
+ * @brief A minipage of a PAX page: the values of a column for all the rows of the page.
+ *
+ * Values are little-endian, as in encoded rows. Fixed-width values are `width` bytes each, one after another.
+ * A variable-width value `i` spans from end offset `i - 1` (0 for the first row) to end offset `i` within `values`.
+ */
+typedef struct {
+  const void *values; /**< Values. */
+  const uint8_t *nulls; /**< Null bitmap, a bit for every row (least significant bit first). NULL if the column
+                             is not nullable. */
+  const void *ends; /**< End offsets of variable-width values (4 bytes each), NULL for fixed-width columns. */
+  YDB_PageSize width; /**< Value width of a fixed-width column, 0 for a variable-width one. */
+  YDB_PageSize count; /**< The amount of values (rows). */
+} YDB_PaxColumn;
+
+/**
+ * @brief A callback called for every page of a column scan.
+ * @param ctx User context.
+ * @param index Page index.
+ * @param columns Minipages of the requested columns, in the requested order. Valid until the callback returns.
+ * @param row_count The amount of rows.
+ * @return Operation status. Anything but #YDB_ERR_SUCCESS stops the scan.
+ */
+typedef YDB_Error (*YDB_ColumnScanFn)(void *ctx, size_t index, const YDB_PaxColumn *columns, YDB_PageSize row_count);
+
+/**
+ * @brief Get the size of a PAX page image of rows.
+ * @param schema A schema.
+ * @param rows Encoded rows (see ydb_row_encode()).
+ * @param sizes Row sizes.
+ * @param count The amount of rows.
+ * @return Image size in bytes.
+ */
+size_t ydb_pax_size(const YDB_Schema *schema, const void *const *rows, const YDB_PageSize *sizes, size_t count);
+
+/**
+ * @brief Write a PAX page image of rows.
+ * @param schema A schema.
+ * @param rows Encoded rows (see ydb_row_encode()).
+ * @param sizes Row sizes.
+ * @param count The amount of rows.
+ * @param[out] dst Image destination.
+ * @param capacity Destination size.
+ * @param[out] written The amount of rows written: the first rows that fit.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_ROW_SCHEMA_MISMATCH if a row does not match the schema (see ydb_row_check()), and
+ * #YDB_ERR_PAGE_NO_MORE_MEM if there are rows but not even the first one fits. At most
+ * #YDB_TABLE_PAGE_MAX_ROW_COUNT rows are written.
+ */
+YDB_Error ydb_pax_write(const YDB_Schema *schema, const void *const *rows, const YDB_PageSize *sizes, size_t count,
+                        void *dst, YDB_PageSize capacity, size_t *written);
+
+/**
+ * @brief Fill a page with rows in PAX layout.
+ * @param page A writable page.
+ * @param schema A schema.
+ * @param rows Encoded rows (see ydb_row_encode()).
+ * @param sizes Row sizes.
+ * @param count The amount of rows.
+ * @param[out] written The amount of rows put into the page: the first rows that fit.
+ * @return Operation status.
+ *
+ * Sets #YDB_TABLE_PAGE_FLAG_PAX flag and row count. Pass the rest of the rows to the next page.
+ */
+YDB_Error ydb_page_pax_build(YDB_TablePage *page, const YDB_Schema *schema, const void *const *rows,
+                             const YDB_PageSize *sizes, size_t count, size_t *written);
+
+/**
+ * @brief Get a minipage from a PAX page image.
+ * @param data Page data.
+ * @param size Page data size.
+ * @param row_count Row count of the page.
+ * @param schema The schema the page was written with.
+ * @param column Column index.
+ * @param[out] minipage Minipage of the column, pointing into `data`.
+ * @return Operation status.
+ *
+ * Only the minipage directory is read. Returns #YDB_ERR_COLUMN_NOT_EXIST if there is no such column,
+ * and #YDB_ERR_ROW_SCHEMA_MISMATCH if the page does not match the schema or the minipage is out of the page.
+ */
+YDB_Error ydb_pax_column(const void *data, YDB_PageSize size, YDB_PageSize row_count, const YDB_Schema *schema,
+                         size_t column, YDB_PaxColumn *minipage);
+
+/**
+ * @brief Get a minipage of a PAX page.
+ * @param page A page with #YDB_TABLE_PAGE_FLAG_PAX flag.
+ * @param schema The schema the page was written with.
+ * @param column Column index.
+ * @param[out] minipage Minipage of the column, valid until the page is changed.
+ * @return Operation status, #YDB_ERR_PAGE_NOT_PAX if the page is not a PAX page.
+ * @sa ydb_pax_column()
+ */
+YDB_Error ydb_page_pax_column(YDB_TablePage *page, const YDB_Schema *schema, size_t column, YDB_PaxColumn *minipage);
+
+/**
+ * @brief Check if a value of a minipage is null.
+ * @param minipage A minipage.
+ * @param row Row index.
+ * @return Non-zero if the value is null.
+ */
+int ydb_pax_is_null(const YDB_PaxColumn *minipage, YDB_PageSize row);
+
+/**
+ * @brief Get a value of a minipage.
+ * @param minipage A minipage.
+ * @param row Row index, less than `count`.
+ * @param[out] data A pointer to the value, NULL if the value is null.
+ * @param[out] size Value size (could be NULL).
+ */
+void ydb_pax_value(const YDB_PaxColumn *minipage, YDB_PageSize row, const void **data, YDB_PageSize *size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file readahead.h
+ * @brief A header with the definition of page read-ahead and functions to work with it.
+ *
+ * Read-ahead follows a chain of pages with a background thread and stages up to `depth` pages
+ * in memory, so a sequential scan finds the next page already read. Pages are taken from staging
+ * with ydb_readahead_take(), the scan position is reported with ydb_readahead_hint().
+ */
+
+struct __YDB_ReadAhead;
+
+/** @brief A read-ahead type. */
+typedef struct __YDB_ReadAhead YDB_ReadAhead;
+
+/**
+ * @brief A callback used to get the offset of the page following a staged one.
+ * @param ctx User context passed to ydb_readahead_start().
+ * @param page Page data.
+ * @return Next page offset, 0 if there is none.
+ *
+ * Called from the read-ahead thread.
+ */
+typedef YDB_Offset (*YDB_ReadAheadNextFn)(void *ctx, const char *page);
+
+/**
+ * @brief Start read-ahead.
+ * @param storage A storage to read from. Must allow concurrent `read_at` calls.
+ * @param page_size Page size.
+ * @param depth The maximum amount of staged pages.
+ * @param next A callback to get next page offset.
+ * @param ctx A context passed to the callback.
+ * @return A pointer to read-ahead, or NULL on error.
+ * @sa ydb_readahead_stop()
+ *
+ * Nothing is read until the first ydb_readahead_hint().
+ */
+YDB_ReadAhead *ydb_readahead_start(YDB_Storage *storage, size_t page_size, size_t depth,
+                                   YDB_ReadAheadNextFn next, void *ctx);
+
+/**
+ * @brief Stop read-ahead and free it.
+ * @param ra Read-ahead.
+ *
+ * Waits for the read in progress.
+ */
+void ydb_readahead_stop(YDB_ReadAhead *ra);
+
+/**
+ * @brief Report the page that is going to be read next.
+ * @param ra Read-ahead.
+ * @param offset Page offset, 0 to pause read-ahead.
+ *
+ * Staged pages before it are dropped. If the page is not staged, read-ahead restarts from it.
+ */
+void ydb_readahead_hint(YDB_ReadAhead *ra, YDB_Offset offset);
+
+/**
+ * @brief Take a page from staging.
+ * @param ra Read-ahead.
+ * @param offset Page offset.
+ * @param[out] dst A buffer of page size.
+ * @return Non-zero if the page was staged and copied to `dst`.
+ *
+ * If the page is being read, waits for it. The page and pages staged before it are dropped.
+ */
+int ydb_readahead_take(YDB_ReadAhead *ra, YDB_Offset offset, void *dst);
+
+/**
+ * @brief Drop staged pages that overlap a changed storage range.
+ * @param ra Read-ahead.
+ * @param offset Range start.
+ * @param size Range size.
+ */
+void ydb_readahead_invalidate(YDB_ReadAhead *ra, YDB_Offset offset, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/table_page.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file scan.h
+ * @brief A header with the definition of parallel page scan.
+ *
+ * Pages are split into equal ranges, one per worker thread. Every worker reads its range with its own
+ * page buffer and, once the range is done, steals half of what is left of the busiest other range,
+ * so the workers finish at about the same time even if pages take different time to process.
+ */
+
+/**
+ * @brief A callback called for every scanned page.
+ * @param ctx User context.
+ * @param worker Index of the worker thread calling it, less than the amount of threads.
+ * @param index Page index.
+ * @param page A read-only view of page data, valid until the callback returns.
+ * @return Operation status. Anything but #YDB_ERR_SUCCESS stops the scan.
+ *
+ * Called from several threads at once, in no particular page order.
+ */
+typedef YDB_Error (*YDB_ScanFn)(void *ctx, size_t worker, size_t index, YDB_TablePage *page);
+
+/**
+ * @brief Call a function for every page in a list with several threads.
+ * @param storage A storage to read from. Must allow concurrent `read_at` calls.
+ * @param layout Page layout of the table.
+ * @param pages Page offsets. Page index passed to the callback is an index in this array.
+ * @param count The amount of pages.
+ * @param nthreads The amount of worker threads, 0 for the amount of online CPUs.
+ * @param fn A callback.
+ * @param ctx A context passed to the callback.
+ * @return Operation status: the first error returned by the callback or met on reading.
+ *
+ * The calling thread is used as worker 0. Returns once all the workers are done.
+ * Page checksums are verified and compressed pages are decompressed on the way.
+ */
+YDB_Error ydb_scan_pages(YDB_Storage *storage, const YDB_PageLayout *layout, const YDB_Offset *pages, size_t count,
+                         size_t nthreads, YDB_ScanFn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
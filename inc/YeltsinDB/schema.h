@@ -0,0 +1,237 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file schema.h
+ * @brief A header with row schemas and the row codec.
+ *
+ * A schema describes the columns of table rows. Its row layout is computed once, when columns are added,
+ * so every fixed-width field and every end offset of a variable-width field is at a known offset in the row:
+ *
+ * 1. Null bitmap, a bit for every nullable column in column order (least significant bit first)
+ * 2. Fixed-width fields in column order: values of fixed-width columns and end offsets (4 bytes) of
+ *    variable-width ones
+ * 3. Values of variable-width columns in column order, each ending at its end offset
+ *
+ * All the values are little-endian. A null field of a fixed-width column is zero-filled, a null field of
+ * a variable-width column is empty. See table file v1.7 specification for the way a schema is stored.
+ */
+
+struct __YDB_Schema;
+
+/** @brief A row schema type. */
+typedef struct __YDB_Schema YDB_Schema;
+
+/** @brief Column types. */
+typedef enum {
+  YDB_COLUMN_INT8 = 1, /**< Signed 8-bit integer. */
+  YDB_COLUMN_INT16, /**< Signed 16-bit integer. */
+  YDB_COLUMN_INT32, /**< Signed 32-bit integer. */
+  YDB_COLUMN_INT64, /**< Signed 64-bit integer. */
+  YDB_COLUMN_UINT8, /**< Unsigned 8-bit integer. */
+  YDB_COLUMN_UINT16, /**< Unsigned 16-bit integer. */
+  YDB_COLUMN_UINT32, /**< Unsigned 32-bit integer. */
+  YDB_COLUMN_UINT64, /**< Unsigned 64-bit integer. */
+  YDB_COLUMN_FLOAT32, /**< IEEE 754 single precision number. */
+  YDB_COLUMN_FLOAT64, /**< IEEE 754 double precision number. */
+  YDB_COLUMN_BYTES, /**< Fixed-width bytes. */
+  YDB_COLUMN_VARBYTES, /**< Variable-width bytes. */
+} YDB_ColumnType;
+
+/** @brief A column of a schema. */
+typedef struct {
+  const char *name; /**< Column name. */
+  YDB_ColumnType type; /**< Column type. */
+  YDB_Flags flags; /**< Column flags: #YDB_COLUMN_FLAG_NULLABLE, #YDB_COLUMN_FLAG_ZONE_MAP. */
+  YDB_PageSize width; /**< Value width of a fixed-width column, the largest value width (0 if unlimited)
+                           of a variable-width one. */
+  YDB_PageSize offset; /**< Offset of the field in a row: the value of a fixed-width column, the end offset
+                            of a variable-width one. */
+  YDB_PageSize null_bit; /**< Index of the bit in the null bitmap, only for nullable columns. */
+} YDB_Column;
+
+/**
+ * @brief A field value to encode.
+ *
+ * `data` is NULL for a null value. Values of integer and float columns are in architecture endian
+ * and have the width of the column.
+ */
+typedef struct {
+  const void *data; /**< Value bytes. */
+  YDB_PageSize size; /**< Value size. */
+} YDB_Value;
+
+/**
+ * @brief Create an empty schema.
+ * @return A pointer to the schema.
+ * @sa ydb_schema_add_column(), ydb_schema_free()
+ */
+YDB_Schema* ydb_schema_new(void);
+
+/**
+ * @brief Destroy a schema.
+ * @param schema A schema (could be NULL).
+ */
+void ydb_schema_free(YDB_Schema* schema);
+
+/**
+ * @brief Copy a schema.
+ * @param schema A schema.
+ * @return A pointer to the copy, destroy it with ydb_schema_free().
+ */
+YDB_Schema* ydb_schema_clone(const YDB_Schema* schema);
+
+/**
+ * @brief Add a column to the end of a schema.
+ * @param schema A schema.
+ * @param name Column name, from 1 to #YDB_SCHEMA_NAME_MAX_SIZE bytes, unique in the schema.
+ * @param type Column type.
+ * @param width Value width of #YDB_COLUMN_BYTES, the largest value width of #YDB_COLUMN_VARBYTES (0 if unlimited),
+ *              ignored for other types.
+ * @param flags Column flags: #YDB_COLUMN_FLAG_NULLABLE, and #YDB_COLUMN_FLAG_ZONE_MAP to keep per-page
+ *              summaries of an integer or float column for filtered scans (see ydb_scan_filter()).
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_SCHEMA_INVALID if the column could not be added: its name is taken or too long, its type,
+ * width or flags are wrong, or the schema has #YDB_SCHEMA_MAX_COLUMNS columns already.
+ */
+YDB_Error ydb_schema_add_column(YDB_Schema* schema, const char* name, YDB_ColumnType type, YDB_PageSize width,
+                                YDB_Flags flags);
+
+/**
+ * @brief Get the amount of columns.
+ * @param schema A schema.
+ * @return Column count.
+ */
+size_t ydb_schema_column_count(const YDB_Schema* schema);
+
+/**
+ * @brief Get a column.
+ * @param schema A schema.
+ * @param index Column index.
+ * @return A pointer to the column, valid until the next column is added. NULL if out of range.
+ *
+ * `offset` of the column lets a field be read with a single load from a row, no matter what other fields are:
+ * @code{.c}
+ * int64_t ts;
+ * memcpy(&ts, (const char*) row + ts_column->offset, sizeof(ts)); // little-endian
+ * @endcode
+ */
+const YDB_Column* ydb_schema_column(const YDB_Schema* schema, size_t index);
+
+/**
+ * @brief Find a column by name.
+ * @param schema A schema.
+ * @param name Column name.
+ * @param[out] index Column index.
+ * @return Operation status, #YDB_ERR_COLUMN_NOT_EXIST if there is no such column.
+ */
+YDB_Error ydb_schema_column_find(const YDB_Schema* schema, const char* name, size_t* index);
+
+/**
+ * @brief Get the size of the part of a row with fixed layout: the null bitmap and fixed-width fields.
+ * @param schema A schema.
+ * @return The smallest row size.
+ */
+YDB_PageSize ydb_schema_fixed_size(const YDB_Schema* schema);
+
+/**
+ * @brief Encode a row.
+ * @param schema A schema.
+ * @param values Field values, one for every column.
+ * @param[out] row Row destination (could be NULL if `capacity` is 0).
+ * @param capacity Row destination size.
+ * @param[out] size Row size.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_ROW_SCHEMA_MISMATCH if a value does not fit its column (a null value of a column that is not
+ * nullable, or a value of a wrong size), and #YDB_ERR_PAGE_NO_MORE_MEM if the row does not fit the destination.
+ * In the latter case `size` is set anyway, so the size of a row could be found with zero capacity.
+ */
+YDB_Error ydb_row_encode(const YDB_Schema* schema, const YDB_Value* values, void* row, YDB_PageSize capacity,
+                         YDB_PageSize* size);
+
+/**
+ * @brief Check that a row has the layout of a schema.
+ * @param schema A schema.
+ * @param row Row data.
+ * @param size Row size.
+ * @return Operation status, #YDB_ERR_ROW_SCHEMA_MISMATCH if the row is too short or its end offsets are out of order.
+ *
+ * Fields of a checked row could be read with ydb_row_get_int(), ydb_row_get_float() or a load at column offset.
+ */
+YDB_Error ydb_row_check(const YDB_Schema* schema, const void* row, YDB_PageSize size);
+
+/**
+ * @brief Get a field of a row.
+ * @param schema A schema.
+ * @param row Row data.
+ * @param size Row size.
+ * @param column Column index.
+ * @param[out] data A pointer to field value inside the row, NULL if the value is null.
+ * @param[out] data_size Field value size (could be NULL).
+ * @return Operation status.
+ *
+ * The value is not copied. Returns #YDB_ERR_COLUMN_NOT_EXIST if there is no such column,
+ * and #YDB_ERR_ROW_SCHEMA_MISMATCH if the field is out of the row.
+ */
+YDB_Error ydb_row_field(const YDB_Schema* schema, const void* row, YDB_PageSize size, size_t column,
+                        const void** data, YDB_PageSize* data_size);
+
+/**
+ * @brief Check if a field of a row is null.
+ * @param schema A schema.
+ * @param row Row data, at least ydb_schema_fixed_size() bytes.
+ * @param column Column index.
+ * @return Non-zero if the value is null.
+ */
+int ydb_row_is_null(const YDB_Schema* schema, const void* row, size_t column);
+
+/**
+ * @brief Get a field of an integer column.
+ * @param schema A schema.
+ * @param row Row data, at least ydb_schema_fixed_size() bytes.
+ * @param column Index of an integer column.
+ * @return The value, sign-extended for signed columns. 0 for null values and other columns.
+ */
+int64_t ydb_row_get_int(const YDB_Schema* schema, const void* row, size_t column);
+
+/**
+ * @brief Get a field of a float column.
+ * @param schema A schema.
+ * @param row Row data, at least ydb_schema_fixed_size() bytes.
+ * @param column Index of a float column.
+ * @return The value. 0 for null values and other columns.
+ */
+double ydb_row_get_float(const YDB_Schema* schema, const void* row, size_t column);
+
+/**
+ * @brief Write a schema in table file format.
+ * @param schema A schema.
+ * @param[out] dst Destination (could be NULL if `capacity` is 0).
+ * @param capacity Destination size.
+ * @return The size of the written schema, 0 if it does not fit.
+ * @sa ydb_schema_read()
+ */
+size_t ydb_schema_write(const YDB_Schema* schema, void* dst, size_t capacity);
+
+/**
+ * @brief Read a schema written by ydb_schema_write().
+ * @param src Schema data.
+ * @param size Schema data size.
+ * @param column_count The amount of columns.
+ * @param[out] schema A pointer to the schema, destroy it with ydb_schema_free().
+ * @return Operation status, #YDB_ERR_SCHEMA_INVALID if the data is not a valid schema.
+ */
+YDB_Error ydb_schema_read(const void* src, size_t size, size_t column_count, YDB_Schema** schema);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/page_cache.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file stats.h
+ * @brief A header with engine statistics and tracing types.
+ *
+ * An instance counts what it does with the table storage and how long it takes, see ydb_get_stats(),
+ * and could call a trace callback for every such event, see ydb_set_trace(). Both are compiled out
+ * when the library is built with `YDB_NO_STATS` (`-DYDB_STATS=OFF`): counters stay zero and the callback
+ * is never called.
+ */
+
+/** @brief Events counted by an instance and passed to the trace callback. */
+typedef enum {
+  YDB_TRACE_PAGE_READ = 0, /**< A page is read from the table storage (a cache miss). */
+  YDB_TRACE_READAHEAD_HIT, /**< A page is taken from read-ahead instead of being read. */
+  YDB_TRACE_PAGE_WRITE, /**< Pages are written to the table storage: a write-back or a batch of appended pages. */
+  YDB_TRACE_HEADER_WRITE, /**< The file header is written. */
+  YDB_TRACE_SYNC, /**< The table storage is synced. */
+  YDB_TRACE_FLUSH, /**< Changes of an operation are flushed: written back or committed to the log. */
+  YDB_TRACE_PAGE_ALLOC, /**< A page is allocated by growing the file. */
+  YDB_TRACE_PAGE_REUSE, /**< A free page is allocated. */
+  YDB_TRACE_PAGE_FREE, /**< A page is freed. */
+  YDB_TRACE_PAGE_SWITCH, /**< Current page is switched (ydb_next_page(), seeks and changes). */
+  YDB_TRACE_APPEND, /**< ydb_append_page() or ydb_append_pages() is done. */
+  YDB_TRACE_REPLACE, /**< ydb_replace_current_page() is done. */
+  YDB_TRACE_DELETE, /**< ydb_delete_current_page() is done. */
+  YDB_TRACE_EVENT_COUNT, /**< The amount of events. */
+} YDB_TraceEvent;
+
+/**
+ * @brief A latency histogram.
+ *
+ * Bucket `i` counts events that took from 2^i to 2^(i+1)-1 nanoseconds (bucket 0 also counts 0 ns),
+ * the last bucket counts all the longer ones too.
+ */
+typedef struct {
+  uint64_t count; /**< The amount of events. */
+  uint64_t total_ns; /**< Total time of events in nanoseconds. */
+  uint64_t max_ns; /**< The longest event in nanoseconds. */
+  uint64_t buckets[YDB_STATS_LATENCY_BUCKETS]; /**< Event counts by latency. */
+} YDB_LatencyHistogram;
+
+/** @brief Instance counters. */
+typedef struct {
+  uint64_t events[YDB_TRACE_EVENT_COUNT]; /**< The amount of events of every kind, indexed by #YDB_TraceEvent. */
+  uint64_t bytes_read; /**< Bytes of pages read from the table storage, as stored (compressed or not). */
+  uint64_t bytes_written; /**< Bytes written to the table storage, as stored. */
+  YDB_LatencyHistogram read_latency; /**< Page read latency. */
+  YDB_LatencyHistogram write_latency; /**< Page write latency. */
+  YDB_LatencyHistogram sync_latency; /**< Table storage sync latency. */
+  YDB_LatencyHistogram flush_latency; /**< Operation flush latency. */
+  YDB_LatencyHistogram switch_latency; /**< Page switch latency, including a read on cache miss. */
+  YDB_LatencyHistogram append_latency; /**< Append latency. */
+  YDB_LatencyHistogram replace_latency; /**< Replace latency. */
+  YDB_LatencyHistogram delete_latency; /**< Delete latency. */
+  YDB_CacheStats cache; /**< Page cache counters of the loaded table, zero if none. */
+} YDB_Stats;
+
+/**
+ * @brief A trace callback.
+ * @param ctx User context.
+ * @param event The event.
+ * @param offset Offset of the page in the table file, 0 if the event has no page.
+ * @param size Bytes read or written, or page size for page events, 0 if the event has no size.
+ * @param ns How long the event took in nanoseconds.
+ *
+ * The callback is called right after the event, by the thread that caused it (cursors read and write back
+ * pages too), sometimes with engine locks held. It must be quick and must not call the engine.
+ */
+typedef void (*YDB_TraceFn)(void *ctx, YDB_TraceEvent event, YDB_Offset offset, size_t size, uint64_t ns);
+
+/**
+ * @brief Get monotonic time used to measure events.
+ * @return Time in nanoseconds.
+ */
+uint64_t ydb_stats_now(void);
+
+/**
+ * @brief Count an event.
+ * @param stats Counters.
+ * @param event The event.
+ * @param size Bytes read or written by the event.
+ * @param ns How long the event took in nanoseconds.
+ */
+void ydb_stats_add(YDB_Stats *stats, YDB_TraceEvent event, size_t size, uint64_t ns);
+
+/**
+ * @brief Add an event to a histogram.
+ * @param histogram A histogram.
+ * @param ns How long the event took in nanoseconds.
+ */
+void ydb_histogram_record(YDB_LatencyHistogram *histogram, uint64_t ns);
+
+/**
+ * @brief Estimate a latency percentile.
+ * @param histogram A histogram.
+ * @param p Percentile from 0 to 1, e.g. 0.99.
+ * @return The upper bound of the bucket the percentile falls into, capped by the longest event;
+ *         0 if the histogram is empty.
+ */
+uint64_t ydb_histogram_percentile(const YDB_LatencyHistogram *histogram, double p);
+
+#ifdef __cplusplus
+}
+#endif
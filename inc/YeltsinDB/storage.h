@@ -0,0 +1,191 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file storage.h
+ * @brief A header with the storage I/O interface and built-in storage backends.
+ *
+ * Storage is a byte-addressable file-like object accessed with positional reads and writes only,
+ * so there is no shared cursor and reads could be issued from several threads at once.
+ * A backend is a struct that starts with #YDB_Storage and a table of operations.
+ */
+
+struct __YDB_Storage;
+
+/** @brief A storage type. */
+typedef struct __YDB_Storage YDB_Storage;
+
+/** @brief A buffer for vectored writes. */
+typedef struct {
+  const void *base; /**< Buffer start. */
+  size_t size; /**< Buffer size. */
+} YDB_IOVec;
+
+/** @brief Storage operations table. */
+typedef struct {
+  /** @brief Backend name. */
+  const char *name;
+  /** @brief Read exactly `size` bytes at `offset`. Reading past the end is an error. */
+  YDB_Error (*read_at)(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size);
+  /** @brief Write `size` bytes at `offset`, growing the storage if needed. */
+  YDB_Error (*write_at)(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size);
+  /**
+   * @brief Write `count` buffers one after another starting at `offset` (optional, could be NULL).
+   *
+   * Backends without it get the buffers written one by one with `write_at`.
+   */
+  YDB_Error (*writev_at)(YDB_Storage *storage, YDB_Offset offset, const YDB_IOVec *iov, size_t count);
+  /** @brief Make written data durable. */
+  YDB_Error (*sync)(YDB_Storage *storage);
+  /** @brief Get storage size. */
+  YDB_Offset (*size)(YDB_Storage *storage);
+  /** @brief Set storage size. New bytes are zero-filled. */
+  YDB_Error (*truncate)(YDB_Storage *storage, YDB_Offset size);
+  /**
+   * @brief Get a pointer to storage bytes (optional, could be NULL).
+   *
+   * Backends that keep data in memory could expose it to avoid copying. Pointers may be invalidated
+   * by growing the storage.
+   */
+  char *(*map)(YDB_Storage *storage, YDB_Offset offset, size_t size);
+  /**
+   * @brief Hint that a range is going to be read soon (optional, could be NULL).
+   *
+   * Starts reading the range in background, without waiting for it.
+   */
+  void (*prefetch)(YDB_Storage *storage, YDB_Offset offset, size_t size);
+  /** @brief Close storage and free it. */
+  void (*close)(YDB_Storage *storage);
+} YDB_StorageOps;
+
+/**
+ * @struct __YDB_Storage
+ * @brief Storage base. Backends embed it as the first member.
+ */
+struct __YDB_Storage {
+  const YDB_StorageOps *ops; /**< Backend operations. */
+};
+
+/**
+ * @brief Open a file with positional `pread`/`pwrite` I/O.
+ * @param path A path to the file.
+ * @param create Create a new file. Fails if the file exists.
+ * @return A pointer to storage, or NULL on error.
+ */
+YDB_Storage *ydb_storage_pio_open(const char *path, int create);
+
+/**
+ * @brief Open a memory-mapped file.
+ * @param path A path to the file.
+ * @param create Create a new file. Fails if the file exists.
+ * @return A pointer to storage, or NULL on error.
+ *
+ * The whole file is mapped with `MAP_SHARED`, reserving more address space than the file size
+ * (at least #YDB_MMAP_MIN_RESERVE), so growing the file rarely moves the mapping.
+ */
+YDB_Storage *ydb_storage_mmap_open(const char *path, int create);
+
+/**
+ * @brief Create an empty in-memory storage.
+ * @return A pointer to storage.
+ *
+ * The data is lost on close. Useful for tests and ephemeral tables.
+ */
+YDB_Storage *ydb_storage_memory_open();
+
+/**
+ * @brief Read exactly `size` bytes at `offset`.
+ * @param storage A storage.
+ * @param offset Data offset.
+ * @param dst A destination buffer.
+ * @param size An amount of bytes to read.
+ * @return Operation status.
+ */
+YDB_Error ydb_storage_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size);
+
+/**
+ * @brief Write `size` bytes at `offset`.
+ * @param storage A storage.
+ * @param offset Data offset.
+ * @param src A source buffer.
+ * @param size An amount of bytes to write.
+ * @return Operation status.
+ */
+YDB_Error ydb_storage_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size);
+
+/**
+ * @brief Write several buffers contiguously starting at `offset`.
+ * @param storage A storage.
+ * @param offset Data offset.
+ * @param iov Buffers to write.
+ * @param count The amount of buffers.
+ * @return Operation status.
+ *
+ * File backends issue as few system calls as possible (`pwritev`).
+ */
+YDB_Error ydb_storage_writev_at(YDB_Storage *storage, YDB_Offset offset, const YDB_IOVec *iov, size_t count);
+
+/**
+ * @brief Make written data durable.
+ * @param storage A storage.
+ * @return Operation status.
+ */
+YDB_Error ydb_storage_sync(YDB_Storage *storage);
+
+/**
+ * @brief Get storage size.
+ * @param storage A storage.
+ * @return Storage size in bytes.
+ */
+YDB_Offset ydb_storage_size(YDB_Storage *storage);
+
+/**
+ * @brief Set storage size.
+ * @param storage A storage.
+ * @param size New size.
+ * @return Operation status.
+ */
+YDB_Error ydb_storage_truncate(YDB_Storage *storage, YDB_Offset size);
+
+/**
+ * @brief Get a pointer to storage bytes.
+ * @param storage A storage.
+ * @param offset Data offset.
+ * @param size The amount of bytes to be accessed.
+ * @return A pointer to data, or NULL if the backend can't map or the range is out of bounds.
+ */
+char *ydb_storage_map(YDB_Storage *storage, YDB_Offset offset, size_t size);
+
+/**
+ * @brief Check if the backend can map its data.
+ * @param storage A storage.
+ * @return Non-zero if ydb_storage_map() is supported.
+ */
+int ydb_storage_can_map(const YDB_Storage *storage);
+
+/**
+ * @brief Hint that a range is going to be read soon.
+ * @param storage A storage.
+ * @param offset Range start.
+ * @param size Range size.
+ *
+ * File backends ask the OS to read the range in background. Does nothing for other backends.
+ */
+void ydb_storage_prefetch(YDB_Storage *storage, YDB_Offset offset, size_t size);
+
+/**
+ * @brief Close storage.
+ * @param storage A storage.
+ */
+void ydb_storage_close(YDB_Storage *storage);
+
+#ifdef __cplusplus
+}
+#endif
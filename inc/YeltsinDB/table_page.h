@@ -17,6 +17,27 @@ struct __YDB_TablePage;
 /** @brief A table page type. */
 typedef struct __YDB_TablePage YDB_TablePage;
 
+struct __YDB_PageAllocator;
+
+/** @brief A page allocator type. */
+typedef struct __YDB_PageAllocator YDB_PageAllocator;
+
+/** @brief Page allocator counters. */
+typedef struct {
+  uint64_t allocations; /**< The amount of pages handed out. */
+  uint64_t reused; /**< The amount of allocations served from the free list. */
+  uint64_t zeroed; /**< The amount of allocations that zero-filled page data. */
+  uint64_t releases; /**< The amount of pages given back. */
+  uint64_t in_use; /**< The amount of pages currently handed out. */
+  uint64_t cached; /**< The amount of pages in the free list. */
+} YDB_PageAllocatorStats;
+
+/**
+ * @brief A callback to release memory borrowed by a page view.
+ * @param ctx A context passed to ydb_page_view_set().
+ */
+typedef void (*YDB_PageReleaseFn)(void* ctx);
+
 /**
  * @brief Allocate a new page.
  * @param size Page size.
@@ -28,9 +49,108 @@ YDB_TablePage* ydb_page_alloc(YDB_PageSize size);
 /**
  * @brief De-allocate page.
  * @param page Page to be de-allocated.
+ *
+ * If the page is a view, its memory is released with ydb_page_view_reset() instead of being freed.
+ * If the page has been allocated with ydb_page_alloc_from(), it is returned to the allocator.
  */
 void ydb_page_free(YDB_TablePage* page);
 
+/**
+ * @brief Create a page allocator.
+ * @param page_size Data size of allocated pages.
+ * @param max_free Maximum amount of released pages kept for reuse.
+ * @return A pointer to allocator.
+ * @sa ydb_page_alloc_from(), ydb_page_allocator_free()
+ *
+ * The allocator keeps a free list of released pages, so a page switch-heavy workload does not hit malloc.
+ * Page struct and data are allocated in a single block, page data is aligned to #YDB_CACHE_LINE_SIZE.
+ * Notice that allocator is not thread-safe.
+ */
+YDB_PageAllocator* ydb_page_allocator_new(YDB_PageSize page_size, size_t max_free);
+
+/**
+ * @brief Destroy a page allocator.
+ * @param allocator An allocator.
+ *
+ * If some pages are still in use, the allocator is destroyed when the last of them is freed.
+ */
+void ydb_page_allocator_free(YDB_PageAllocator* allocator);
+
+/**
+ * @brief Allocate a page from an allocator.
+ * @param allocator An allocator.
+ * @param alloc_flags Allocation flags, e.g. #YDB_PAGE_ALLOC_NO_ZERO.
+ * @return A pointer to allocated page, or NULL if the allocator is being destroyed.
+ *
+ * Pass #YDB_PAGE_ALLOC_NO_ZERO if the page data will be fully overwritten, so it is not zero-filled.
+ * Deallocate the page with ydb_page_free().
+ */
+YDB_TablePage* ydb_page_alloc_from(YDB_PageAllocator* allocator, YDB_Flags alloc_flags);
+
+/**
+ * @brief Get allocator counters.
+ * @param allocator An allocator.
+ * @param[out] stats Counters destination.
+ */
+void ydb_page_allocator_stats_get(const YDB_PageAllocator* allocator, YDB_PageAllocatorStats* stats);
+
+/**
+ * @brief Allocate a page view.
+ * @return A pointer to allocated view, which does not point to any memory yet.
+ * @sa ydb_page_view_set(), ydb_page_free()
+ *
+ * A view is a read-only page that borrows its data (e.g. a page cache frame or mapped file)
+ * instead of owning a copy. ydb_page_data_write() fails with #YDB_ERR_PAGE_READ_ONLY on a view,
+ * flags and row count setters are ignored. Use ydb_page_clone() to get a writable copy.
+ */
+YDB_TablePage* ydb_page_view_alloc();
+
+/**
+ * @brief Point a view to the memory it borrows.
+ * @param view A page view.
+ * @param data Page data.
+ * @param size Page data size.
+ * @param flags Page flags.
+ * @param row_count Row count.
+ * @param release A callback to be called when the memory is no longer used by the view (could be NULL).
+ * @param ctx Release callback context.
+ *
+ * Previously borrowed memory is released first. The position is reset to 0.
+ */
+void ydb_page_view_set(YDB_TablePage* view, const char* data, YDB_PageSize size, YDB_Flags flags,
+                       YDB_PageSize row_count, YDB_PageReleaseFn release, void* ctx);
+
+/**
+ * @brief Release the memory borrowed by a view.
+ * @param view A page view.
+ *
+ * The view becomes empty but could be pointed to other memory with ydb_page_view_set().
+ */
+void ydb_page_view_reset(YDB_TablePage* view);
+
+/**
+ * @brief Check if a page is a view.
+ * @param page A page.
+ * @return Non-zero if the page is a view.
+ */
+int ydb_page_is_view(const YDB_TablePage* page);
+
+/**
+ * @brief Get a pointer to page data.
+ * @param page A page.
+ * @return A pointer to the beginning of page data.
+ *
+ * The data could be read directly, without copying it with ydb_page_data_read().
+ */
+const void* ydb_page_data_ptr(const YDB_TablePage* page);
+
+/**
+ * @brief Get page data size.
+ * @param page A page.
+ * @return Page data size.
+ */
+YDB_PageSize ydb_page_size_get(const YDB_TablePage* page);
+
 /**
  * @brief Seek page data position to `pos`.
  * @param page A page.
@@ -104,12 +224,84 @@ YDB_PageSize ydb_page_row_count_get(YDB_TablePage* page);
  */
 void ydb_page_row_count_set(YDB_TablePage* page, YDB_PageSize row_count);
 
+/**
+ * @brief Format a page with slotted layout.
+ * @param page A page.
+ * @return Operation status.
+ * @sa ydb_page_row_insert()
+ *
+ * Sets #YDB_TABLE_PAGE_FLAG_SLOTTED flag and clears the slot directory. See table file v1.1 specification.
+ * For a slotted page, row count is the amount of slots (including the slots of deleted rows), at most
+ * #YDB_TABLE_PAGE_MAX_ROW_COUNT. A page larger than 64 KiB also gets #YDB_TABLE_PAGE_FLAG_WIDE_SLOTS flag:
+ * its slots have 32-bit fields (see table file v1.6 specification).
+ */
+YDB_Error ydb_page_slotted_init(YDB_TablePage* page);
+
+/**
+ * @brief Get the largest row size that could be inserted into a slotted page.
+ * @param page A slotted page.
+ * @return Free space in bytes, 0 if the page is not slotted.
+ *
+ * Free space is counted on the first call for the page data, then row operations keep it up to date.
+ */
+YDB_PageSize ydb_page_free_space(const YDB_TablePage* page);
+
+/**
+ * @brief Insert a row into a slotted page.
+ * @param page A slotted page.
+ * @param row Row data.
+ * @param size Row data size.
+ * @param[out] row_id Id of inserted row (could be NULL).
+ * @return Operation status.
+ *
+ * Slots of deleted rows are reused. The page is compacted if free space is fragmented.
+ * Returns #YDB_ERR_PAGE_NO_MORE_MEM if the row does not fit.
+ */
+YDB_Error ydb_page_row_insert(YDB_TablePage* page, const void* row, YDB_PageSize size, YDB_PageSize* row_id);
+
+/**
+ * @brief Get a row from a slotted page.
+ * @param page A slotted page.
+ * @param row_id Row id.
+ * @param[out] row A pointer to row data inside the page.
+ * @param[out] size Row data size (could be NULL).
+ * @return Operation status.
+ *
+ * Row data is not copied, the pointer is valid until the page is modified.
+ * Returns #YDB_ERR_ROW_NOT_EXIST if the row is deleted or the id is out of range.
+ */
+YDB_Error ydb_page_row_get(const YDB_TablePage* page, YDB_PageSize row_id, const void** row, YDB_PageSize* size);
+
+/**
+ * @brief Update a row in a slotted page.
+ * @param page A slotted page.
+ * @param row_id Row id.
+ * @param row New row data.
+ * @param size New row data size.
+ * @return Operation status.
+ *
+ * Row id is kept. Returns #YDB_ERR_PAGE_NO_MORE_MEM if the new row does not fit.
+ */
+YDB_Error ydb_page_row_update(YDB_TablePage* page, YDB_PageSize row_id, const void* row, YDB_PageSize size);
+
+/**
+ * @brief Delete a row from a slotted page.
+ * @param page A slotted page.
+ * @param row_id Row id.
+ * @return Operation status.
+ *
+ * The row is marked with #YDB_ROW_FLAG_DELETED and its space is reclaimed on the next compaction.
+ */
+YDB_Error ydb_page_row_delete(YDB_TablePage* page, YDB_PageSize row_id);
+
 /**
  * @brief Clone a page.
  * @param page A page to clone.
  * @return A cloned page.
  *
  * Notice that you should deallocate it with ydb_page_free().
+ * A clone of a view owns a copy of the data and is writable.
+ * A clone of a page allocated with ydb_page_alloc_from() is allocated from the same allocator.
  */
 YDB_TablePage* ydb_page_clone(const YDB_TablePage* page);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -11,6 +12,33 @@
 typedef int16_t YDB_Error;
 /** @brief YeltsinDB data file offset type. */
 typedef uint64_t YDB_Offset;
-/** */
-typedef uint16_t YDB_PageSize;
+/** @brief Page size type, also used for sizes and positions within a page. */
+typedef uint32_t YDB_PageSize;
 typedef uint8_t YDB_Flags;
+
+/**
+ * @brief Page layout of a table.
+ *
+ * Pages of all the tables have the same header, tables with checksums have a checksum right after it.
+ * Page data (or compressed data size and compressed data) follows up to the end of the page.
+ */
+typedef struct {
+  size_t page_size; /**< Page size, chosen on table creation (since v1.6). */
+  size_t data_offset; /**< Page data offset in a page. */
+  uint8_t checksums; /**< Whether pages have a checksum. */
+} YDB_PageLayout;
+
+/** @brief A location of a row in a table. */
+typedef struct {
+  YDB_Offset page; /**< Offset of the page in the table file. */
+  YDB_PageSize row; /**< Row id in the page. */
+} YDB_RowLocation;
+
+/**
+ * @brief A callback used to visit index entries.
+ * @param ctx User context.
+ * @param key Entry key.
+ * @param location Location of the row the entry refers to.
+ * @return Operation status.
+ */
+typedef YDB_Error (*YDB_IndexVisitFn)(void *ctx, const void *key, YDB_RowLocation location);
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/types.h>
+
+/**
+ * @file wal.h
+ * @brief A header with the definition of write-ahead log and functions to work with it.
+ *
+ * The log keeps images of table data changed by operations. Changes of an operation are appended with
+ * ydb_wal_append() and become a transaction on ydb_wal_commit(), which writes them all with a single
+ * vectored write. Several commits could share one storage sync (group commit).
+ * See "Write-ahead log" section of table file specification for the log format.
+ */
+
+struct __YDB_Wal;
+
+/** @brief A write-ahead log type. */
+typedef struct __YDB_Wal YDB_Wal;
+
+/**
+ * @brief A callback used to apply logged data on replay.
+ * @param ctx User context passed to ydb_wal_replay().
+ * @param offset Data offset in the table.
+ * @param data Logged data.
+ * @param size Data size.
+ * @return Operation status.
+ */
+typedef YDB_Error (*YDB_WalApplyFn)(void *ctx, YDB_Offset offset, const void *data, size_t size);
+
+/**
+ * @brief Open a write-ahead log.
+ * @param storage Log storage. The log owns it from now on.
+ * @return A pointer to the log, or NULL if `storage` is NULL.
+ * @sa ydb_wal_close()
+ *
+ * New records are appended after existing ones, call ydb_wal_replay() and ydb_wal_reset() first
+ * to recover a table.
+ */
+YDB_Wal *ydb_wal_open(YDB_Storage *storage);
+
+/**
+ * @brief Close a write-ahead log and its storage.
+ * @param wal A log.
+ *
+ * Pending (not committed) records are dropped.
+ */
+void ydb_wal_close(YDB_Wal *wal);
+
+/**
+ * @brief Set how many commits share one storage sync.
+ * @param wal A log.
+ * @param commits The amount of commits per sync. 0 means the log is synced on ydb_wal_sync() only.
+ *
+ * A committed transaction is durable only after the log is synced.
+ */
+void ydb_wal_set_group_commit(YDB_Wal *wal, size_t commits);
+
+/**
+ * @brief Add a data change to the current transaction.
+ * @param wal A log.
+ * @param offset Data offset in the table.
+ * @param iov Buffers with new data, written one after another starting at `offset`.
+ * @param count The amount of buffers.
+ * @return Operation status.
+ *
+ * The data is not copied, so the buffers must stay valid until ydb_wal_commit().
+ */
+YDB_Error ydb_wal_append(YDB_Wal *wal, YDB_Offset offset, const YDB_IOVec *iov, size_t count);
+
+/**
+ * @brief Commit the current transaction.
+ * @param wal A log.
+ * @return Operation status.
+ *
+ * Writes all the appended records and a commit record. Syncs the log if group commit size is reached.
+ */
+YDB_Error ydb_wal_commit(YDB_Wal *wal);
+
+/**
+ * @brief Drop the records of the current transaction.
+ * @param wal A log.
+ *
+ * Nothing is written: the records were only kept in memory.
+ */
+void ydb_wal_abort(YDB_Wal *wal);
+
+/**
+ * @brief Make all committed transactions durable.
+ * @param wal A log.
+ * @return Operation status.
+ *
+ * Does nothing if there is nothing to sync.
+ */
+YDB_Error ydb_wal_sync(YDB_Wal *wal);
+
+/**
+ * @brief Check if there are committed transactions that are not durable yet.
+ * @param wal A log.
+ * @return Non-zero if the log needs a sync.
+ */
+int ydb_wal_needs_sync(const YDB_Wal *wal);
+
+/**
+ * @brief Get log size.
+ * @param wal A log.
+ * @return Log size in bytes.
+ */
+YDB_Offset ydb_wal_size(const YDB_Wal *wal);
+
+/**
+ * @brief Apply all committed transactions in the log.
+ * @param wal A log.
+ * @param apply A callback called for every record of committed transactions, in log order.
+ * @param ctx A context passed to the callback.
+ * @param[out] applied The amount of transactions applied (could be NULL).
+ * @return Operation status.
+ *
+ * Replay stops at the first broken record or at the transaction without commit record:
+ * that is the tail of a log that was being written on crash.
+ */
+YDB_Error ydb_wal_replay(YDB_Wal *wal, YDB_WalApplyFn apply, void *ctx, size_t *applied);
+
+/**
+ * @brief Empty the log.
+ * @param wal A log.
+ * @return Operation status.
+ *
+ * Call it once the changes are durable in the table itself (checkpoint). The log is synced.
+ */
+YDB_Error ydb_wal_reset(YDB_Wal *wal);
+
+#ifdef __cplusplus
+}
+#endif
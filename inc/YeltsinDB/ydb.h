@@ -5,12 +5,25 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 #include <YeltsinDB/types.h>
+#include <YeltsinDB/filter.h>
+#include <YeltsinDB/page_cache.h>
+#include <YeltsinDB/pax.h>
+#include <YeltsinDB/scan.h>
+#include <YeltsinDB/schema.h>
+#include <YeltsinDB/stats.h>
+#include <YeltsinDB/storage.h>
 #include <YeltsinDB/table_page.h>
 
 /**
  * @file ydb.h
  * @brief The main engine include file.
+ *
+ * An instance is used by one thread at a time, its *owner*. Other threads read the loaded table with cursors
+ * (see ydb_cursor_open()), while the owner keeps reading and changing it. Cursors copy pages under page
+ * latches, so they run in parallel with each other and with ydb_append_page() or ydb_replace_current_page(),
+ * and wait only for changes of the page chain.
  */
 
 struct __YDB_Engine;
@@ -18,6 +31,32 @@ struct __YDB_Engine;
 /** @brief YDB engine instance type. */
 typedef struct __YDB_Engine YDB_Engine;
 
+struct __YDB_Cursor;
+
+/** @brief Table cursor type. */
+typedef struct __YDB_Cursor YDB_Cursor;
+
+struct __YDB_Index;
+
+/** @brief Secondary index type. */
+typedef struct __YDB_Index YDB_Index;
+
+/**
+ * @brief A callback that makes the index key of a row.
+ * @param ctx User context.
+ * @param row Row data, without row flags.
+ * @param size Row data size.
+ * @param[out] key Key buffer, as many bytes as the key size of the index.
+ * @return Non-zero if the key is filled, zero to leave the row out of the index.
+ */
+typedef int (*YDB_IndexKeyFn)(void *ctx, const void *row, YDB_PageSize size, void *key);
+
+/** @brief Storage backend used for tables loaded or created by path. */
+typedef enum {
+  YDB_IO_PIO = 0, /**< Positional `pread`/`pwrite` with page cache (default). */
+  YDB_IO_MMAP, /**< Memory-mapped file, pages are read and written in place. */
+} YDB_IOMode;
+
 /**
  * @brief Initialize YeltsinDB instance.
  *
@@ -45,6 +84,21 @@ void ydb_terminate_instance(YDB_Engine* instance);
  */
 YDB_Error ydb_load_table(YDB_Engine* instance, const char *path);
 
+/**
+ * @brief Load table data from storage to the instance.
+ *
+ * @param instance A YeltsinDB instance.
+ * @param storage Table data storage.
+ * @return Operation status.
+ * @sa ydb_create_table_in(), ydb_unload_table()
+ *
+ * On success the instance takes ownership of the storage and closes it on unload.
+ * If storage can map its data (see ydb_storage_can_map()), pages are accessed in place and the page cache
+ * is not used.
+ * If the instance is not free (has already been loaded with table data), returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_load_table_from(YDB_Engine* instance, YDB_Storage* storage);
+
 /**
  * @brief Create table data, write a file and load it to the instance.
  *
@@ -53,16 +107,31 @@ YDB_Error ydb_load_table(YDB_Engine* instance, const char *path);
  * @return Operation status.
  * @sa ydb_load_table(), ydb_unload_table()
  *
+ * The table gets the page size set with ydb_set_page_size().
  * If the instance is not free (has already been loaded with table data), returns #YDB_ERR_INSTANCE_IN_USE.
  * @todo Possible error codes.
  */
 YDB_Error ydb_create_table(YDB_Engine* instance, const char *path);
 
+/**
+ * @brief Create table data in empty storage and load it to the instance.
+ *
+ * @param instance A YeltsinDB instance.
+ * @param storage Empty storage, e.g. ydb_storage_memory_open() for an ephemeral table.
+ * @return Operation status.
+ * @sa ydb_load_table_from()
+ *
+ * If the storage is not empty, returns #YDB_ERR_TABLE_EXIST.
+ * On success the instance takes ownership of the storage and closes it on unload.
+ */
+YDB_Error ydb_create_table_in(YDB_Engine* instance, YDB_Storage* storage);
+
 /**
  * @brief Unload table instance, making it free for further table loading.
  * @param instance A *busy* YeltsinDB instance.
  * @return Operation status.
  *
+ * If some cursors or indexes are still open, returns #YDB_ERR_INSTANCE_IN_USE.
  * @todo Possible error codes.
  */
 YDB_Error ydb_unload_table(YDB_Engine* instance);
@@ -91,6 +160,8 @@ YDB_Error ydb_next_page(YDB_Engine* instance);
  * @param page A page to replace current one.
  * @return Operation status.
  *
+ * Returns #YDB_ERR_PAGE_TOO_LARGE if page data is larger than ydb_get_page_data_size().
+ * Smaller page data is padded with zeros.
  * @todo Possible error codes.
  */
 YDB_Error ydb_replace_current_page(YDB_Engine* instance, YDB_TablePage* page);
@@ -101,16 +172,40 @@ YDB_Error ydb_replace_current_page(YDB_Engine* instance, YDB_TablePage* page);
  * @param page A page to be inserted.
  * @return Operation status.
  *
+ * Returns #YDB_ERR_PAGE_TOO_LARGE if page data is larger than ydb_get_page_data_size().
+ * Smaller page data is padded with zeros.
  * @todo Possible error codes.
  */
 YDB_Error ydb_append_page(YDB_Engine* instance, YDB_TablePage* page);
 
+/**
+ * @brief Appends several pages to a table at once.
+ * @param instance A YeltsinDB instance.
+ * @param pages Pages to be inserted, in table order.
+ * @param n The amount of pages.
+ * @return Operation status.
+ *
+ * The pages are placed contiguously and linked after the last page of the table, then the former last page,
+ * the directory and the file header are updated once. The batch takes a run of free pages from the free space map
+ * if there is one long enough, else it goes to the end of the table file. Pages going to free pages, and all the
+ * pages of a compressed table, are written through the page cache, like single page changes. Otherwise the batch
+ * is written to the end of the file with a single vectored write.
+ * Pages smaller than table page data are padded with zeros.
+ *
+ * With write-ahead log, a batch written through the page cache is committed in parts that fit into the cache
+ * (see #YDB_WAL_OPERATION_FRAMES). If a part fails, it is rolled back, while parts committed before it stay.
+ */
+YDB_Error ydb_append_pages(YDB_Engine* instance, YDB_TablePage** pages, size_t n);
+
 /**
  * @brief Get current page object.
  * @param instance A YeltsinDB instance.
  * @return Current page object.
  *
  * Returns NULL on error.
+ * The page is owned by the instance. Usually it is a read-only view of the page cache frame or mapped file
+ * (see ydb_page_view_alloc()), so reading it neither allocates nor copies anything. The view is only valid
+ * until the next page switch. Use ydb_page_clone() to keep a copy or to modify the page.
  */
 YDB_TablePage* ydb_get_current_page(YDB_Engine* instance);
 
@@ -121,6 +216,21 @@ YDB_TablePage* ydb_get_current_page(YDB_Engine* instance);
  */
 YDB_Error ydb_delete_current_page(YDB_Engine* instance);
 
+/**
+ * @brief Compact a table file in place.
+ * @param instance A YeltsinDB instance.
+ * @param max_steps The most compaction steps to make, 0 to compact the whole table.
+ * @param[out] done Set to 1 if the table is compact, else to 0 (could be NULL).
+ * @return Operation status.
+ *
+ * Pages are moved to the start of the file in page chain order, so that the table is read sequentially,
+ * then free pages at the end of the file are cut off. A step moves one or two pages, every move is written
+ * as a separate operation, so the table could be used and changed between calls. Current page is kept.
+ * Cursors standing on a moved page get #YDB_ERR_PAGE_DELETED.
+ * Returns #YDB_ERR_TABLE_DATA_VERSION_MISMATCH for tables older than v1.3 (see ydb_seek_to_free_space()).
+ */
+YDB_Error ydb_compact(YDB_Engine* instance, size_t max_steps, int* done);
+
 /**
  * @brief Seek to the first page.
  * @param instance A YeltsinDB instance.
@@ -135,6 +245,573 @@ YDB_Error ydb_seek_to_begin(YDB_Engine* instance);
  */
 YDB_Error ydb_seek_to_end(YDB_Engine* instance);
 
+/**
+ * @brief Seek to a page by its index in the table.
+ * @param instance A YeltsinDB instance.
+ * @param index Page index, starting with 0.
+ * @return Operation status.
+ *
+ * The page is found with the page directory in O(1). Since v1.2 the directory is stored in the table file,
+ * for older tables it is built on the first call by walking all the pages.
+ * Returns #YDB_ERR_PAGE_INDEX_OUT_OF_RANGE if there is no such page.
+ */
+YDB_Error ydb_seek_to_page(YDB_Engine* instance, size_t index);
+
+/**
+ * @brief Seek to a page by its offset in the table file.
+ * @param instance A YeltsinDB instance.
+ * @param offset Page offset, e.g. the one of a row location found with an index.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_PAGE_INDEX_OUT_OF_RANGE if there is no table page at the offset.
+ */
+YDB_Error ydb_seek_to_offset(YDB_Engine* instance, YDB_Offset offset);
+
+/**
+ * @brief Get the amount of pages in a table.
+ * @param instance A YeltsinDB instance.
+ * @param[out] count The amount of pages.
+ * @return Operation status.
+ * @sa ydb_seek_to_page()
+ */
+YDB_Error ydb_get_page_count(YDB_Engine* instance, size_t* count);
+
+/**
+ * @brief Seek to a page with enough free space for a row.
+ * @param instance A YeltsinDB instance.
+ * @param size Row data size.
+ * @return Operation status.
+ * @sa ydb_page_free_space()
+ *
+ * The page is found with the free space map (see table file v1.3 specification) without reading any page,
+ * so only slotted pages are found. The map keeps free space rounded down, so the page could have a bit more.
+ * Returns #YDB_ERR_NO_MORE_PAGES if there is no such page, and #YDB_ERR_TABLE_DATA_VERSION_MISMATCH for
+ * tables older than v1.3.
+ */
+YDB_Error ydb_seek_to_free_space(YDB_Engine* instance, YDB_PageSize size);
+
+/**
+ * @brief Call a function for every page in a table with several threads.
+ * @param instance A YeltsinDB instance.
+ * @param nthreads The amount of worker threads, 0 for the amount of online CPUs.
+ * @param callback A callback called for every page.
+ * @param ctx A context passed to the callback.
+ * @return Operation status.
+ * @sa ydb_scan_pages()
+ *
+ * Pages are split into ranges by the page directory, and every worker reads its pages with its own buffer
+ * straight from the table storage, balancing the load by work stealing. Page index passed to the callback
+ * is the one accepted by ydb_seek_to_page(). Current page is not changed.
+ * The callback must not use the instance.
+ */
+YDB_Error ydb_parallel_scan(YDB_Engine* instance, size_t nthreads, YDB_ScanFn callback, void* ctx);
+
+/**
+ * @brief Open a cursor over a loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @return A cursor standing on the first page, or NULL on error.
+ * @sa ydb_cursor_close()
+ *
+ * Cursors are opened and closed by the owner of the instance, and every cursor could then be used by
+ * another thread. A cursor keeps its own position and its own copy of current page, so any amount of them
+ * read the table at once, while the owner changes it.
+ * The page directory is built here if the table does not store one (see ydb_seek_to_page()).
+ */
+YDB_Cursor* ydb_cursor_open(YDB_Engine* instance);
+
+/**
+ * @brief Close a cursor.
+ * @param cursor A cursor.
+ */
+void ydb_cursor_close(YDB_Cursor* cursor);
+
+/**
+ * @brief Switch cursor to next page.
+ * @param cursor A cursor.
+ * @return Operation status.
+ *
+ * The page is found by the link stored in the table now, so pages appended or deleted by the owner since
+ * the last switch are taken into account. If current page has been deleted, returns #YDB_ERR_PAGE_DELETED,
+ * seek the cursor to continue.
+ */
+YDB_Error ydb_cursor_next(YDB_Cursor* cursor);
+
+/**
+ * @brief Switch cursor to previous page.
+ * @param cursor A cursor.
+ * @return Operation status.
+ * @sa ydb_cursor_next()
+ */
+YDB_Error ydb_cursor_prev(YDB_Cursor* cursor);
+
+/**
+ * @brief Seek cursor to the first page.
+ * @param cursor A cursor.
+ * @return Operation status.
+ */
+YDB_Error ydb_cursor_seek_to_begin(YDB_Cursor* cursor);
+
+/**
+ * @brief Seek cursor to the last page.
+ * @param cursor A cursor.
+ * @return Operation status.
+ */
+YDB_Error ydb_cursor_seek_to_end(YDB_Cursor* cursor);
+
+/**
+ * @brief Seek cursor to a page by its index in the table.
+ * @param cursor A cursor.
+ * @param index Page index, starting with 0.
+ * @return Operation status.
+ *
+ * Returns #YDB_ERR_PAGE_INDEX_OUT_OF_RANGE if there is no such page.
+ */
+YDB_Error ydb_cursor_seek_to_page(YDB_Cursor* cursor, size_t index);
+
+/**
+ * @brief Get cursor page.
+ * @param cursor A cursor.
+ * @return Current page of the cursor, or NULL on error.
+ *
+ * The page is a copy owned by the cursor, it's overwritten by the next cursor switch.
+ * Use ydb_page_clone() to keep it.
+ */
+YDB_TablePage* ydb_cursor_get_page(YDB_Cursor* cursor);
+
+/**
+ * @brief Create a B+-tree index over rows of a loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param path A path to the index file.
+ * @param key_size Key size, from 1 to #YDB_INDEX_KEY_MAX_SIZE.
+ * @param key_fn A callback that makes the key of a row.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Created index.
+ * @return Operation status.
+ * @sa ydb_index_close(), btree.h
+ *
+ * The index is filled with rows of all the slotted pages, then kept up to date by every change of the table
+ * made through the instance, including compaction. Rows of pages without slots are not indexed.
+ * If the file exists, returns #YDB_ERR_TABLE_EXIST.
+ */
+YDB_Error ydb_index_create(YDB_Engine* instance, const char* path, size_t key_size, YDB_IndexKeyFn key_fn,
+                           void* ctx, YDB_Index** index);
+
+/**
+ * @brief Create a B+-tree index in given storage.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param storage Empty storage, e.g. ydb_storage_memory_open() for an ephemeral index.
+ * @param key_size Key size.
+ * @param key_fn A callback that makes the key of a row.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Created index.
+ * @return Operation status.
+ * @sa ydb_index_create()
+ *
+ * The index owns the storage from now on, it is closed if the index could not be created.
+ */
+YDB_Error ydb_index_create_in(YDB_Engine* instance, YDB_Storage* storage, size_t key_size, YDB_IndexKeyFn key_fn,
+                              void* ctx, YDB_Index** index);
+
+/**
+ * @brief Create a hash index over rows of a loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param path A path to the index file.
+ * @param key_size Key size, from 1 to #YDB_INDEX_KEY_MAX_SIZE.
+ * @param key_fn A callback that makes the key of a row.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Created index.
+ * @return Operation status.
+ * @sa ydb_index_create(), hash_index.h
+ *
+ * A hash index is kept up to date like a B+-tree index and finds a key in about one page read, but it can't
+ * visit rows in key order: ydb_index_scan() returns #YDB_ERR_INDEX_NOT_ORDERED.
+ * If the file exists, returns #YDB_ERR_TABLE_EXIST.
+ */
+YDB_Error ydb_hash_index_create(YDB_Engine* instance, const char* path, size_t key_size, YDB_IndexKeyFn key_fn,
+                                void* ctx, YDB_Index** index);
+
+/**
+ * @brief Create a hash index in given storage.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param storage Empty storage. The index owns it from now on, it is closed if the index could not be created.
+ * @param key_size Key size.
+ * @param key_fn A callback that makes the key of a row.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Created index.
+ * @return Operation status.
+ * @sa ydb_hash_index_create()
+ */
+YDB_Error ydb_hash_index_create_in(YDB_Engine* instance, YDB_Storage* storage, size_t key_size,
+                                   YDB_IndexKeyFn key_fn, void* ctx, YDB_Index** index);
+
+/**
+ * @brief Open an index of a loaded table, either a B+-tree or a hash one.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param path A path to the index file.
+ * @param key_fn A callback that makes the key of a row, the same the index was created with.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Opened index.
+ * @return Operation status.
+ *
+ * An index that was being changed when the process stopped is rebuilt (see ydb_index_rebuild()). An index
+ * is not changed while it's closed, so rebuild it after the table is changed without it.
+ * If the file does not exist, returns #YDB_ERR_TABLE_NOT_EXIST.
+ */
+YDB_Error ydb_index_open(YDB_Engine* instance, const char* path, YDB_IndexKeyFn key_fn, void* ctx,
+                         YDB_Index** index);
+
+/**
+ * @brief Open an index in given storage.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param storage Index storage. The index owns it from now on.
+ * @param key_fn A callback that makes the key of a row.
+ * @param ctx A context passed to the callback.
+ * @param[out] index Opened index.
+ * @return Operation status.
+ * @sa ydb_index_open()
+ */
+YDB_Error ydb_index_open_from(YDB_Engine* instance, YDB_Storage* storage, YDB_IndexKeyFn key_fn, void* ctx,
+                              YDB_Index** index);
+
+/**
+ * @brief Write all the changes of an index and close it.
+ * @param index An index.
+ * @return Operation status.
+ */
+YDB_Error ydb_index_close(YDB_Index* index);
+
+/**
+ * @brief Build an index from scratch by reading all the table pages.
+ * @param index An index.
+ * @return Operation status.
+ */
+YDB_Error ydb_index_rebuild(YDB_Index* index);
+
+/**
+ * @brief Find a row by its key.
+ * @param index An index.
+ * @param key Key, as many bytes as the key size of the index.
+ * @param[out] location Location of the row, the lowest one if several rows have the key.
+ * @return Operation status.
+ * @sa ydb_seek_to_offset(), ydb_page_row_get()
+ *
+ * Returns #YDB_ERR_KEY_NOT_FOUND if there is no row with the key.
+ */
+YDB_Error ydb_index_find(YDB_Index* index, const void* key, YDB_RowLocation* location);
+
+/**
+ * @brief Visit rows of a key range in key order.
+ * @param index An index.
+ * @param from The lowest key, or NULL to start with the first row.
+ * @param to The highest key, or NULL to go up to the last row.
+ * @param visit A callback called for every row.
+ * @param ctx A context passed to the callback.
+ * @return Operation status.
+ *
+ * Both bounds are inclusive. The callback must not change the table.
+ * Returns #YDB_ERR_INDEX_NOT_ORDERED for a hash index.
+ */
+YDB_Error ydb_index_scan(YDB_Index* index, const void* from, const void* to, YDB_IndexVisitFn visit, void* ctx);
+
+/**
+ * @brief Visit all rows of a key.
+ * @param index An index.
+ * @param key Key.
+ * @param visit A callback called for every row, in location order for a B+-tree index and in no particular
+ * order for a hash one.
+ * @param ctx A context passed to the callback.
+ * @return Operation status.
+ *
+ * The callback must not change the table.
+ */
+YDB_Error ydb_index_find_all(YDB_Index* index, const void* key, YDB_IndexVisitFn visit, void* ctx);
+
+/**
+ * @brief Store a row schema in the loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param schema A schema, copied by the instance. NULL to remove the schema.
+ * @return Operation status.
+ * @sa ydb_get_schema()
+ *
+ * The schema is kept in a page of its own referred to from the file header (see table file v1.7 specification),
+ * replacing the previous one. Rows already in the table are not checked or converted. Since v1.8 page directory
+ * entries are written again with zone maps of the new schema, reading every page.
+ * Returns #YDB_ERR_SCHEMA_INVALID if the schema has no columns, does not fit a page or has more zone-mapped
+ * columns than a directory entry fits, and
+ * #YDB_ERR_TABLE_DATA_VERSION_MISMATCH if the table is older than v1.7.
+ */
+YDB_Error ydb_set_schema(YDB_Engine* instance, const YDB_Schema* schema);
+
+/**
+ * @brief Get the row schema of the loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @return The schema owned by the instance, valid until it's changed or the table is unloaded. NULL if none.
+ */
+const YDB_Schema* ydb_get_schema(YDB_Engine* instance);
+
+/**
+ * @brief Read some columns of all the rows of the loaded table.
+ * @param instance A *busy* YeltsinDB instance with a schema.
+ * @param columns Indexes of the columns to read.
+ * @param column_count The amount of columns to read.
+ * @param callback A callback called for every page with rows, in page order.
+ * @param ctx A context passed to the callback.
+ * @return Operation status.
+ *
+ * Minipages of PAX pages (see pax.h) are passed as they are, so only the requested minipages are touched.
+ * Rows of slotted pages are put into PAX layout first, leaving deleted rows out. Other pages are skipped.
+ * Returns #YDB_ERR_SCHEMA_INVALID if the table has no schema, #YDB_ERR_COLUMN_NOT_EXIST if there is no such
+ * column, and #YDB_ERR_ROW_SCHEMA_MISMATCH if a page does not match the schema.
+ * The callback must not use the instance.
+ */
+YDB_Error ydb_scan_columns(YDB_Engine* instance, const size_t* columns, size_t column_count,
+                           YDB_ColumnScanFn callback, void* ctx);
+
+/**
+ * @brief Read some columns of the rows of the loaded table that match predicates.
+ * @param instance A *busy* YeltsinDB instance with a schema.
+ * @param predicates Predicates a row has to match all of (see filter.h).
+ * @param predicate_count The amount of predicates, 0 to match all the rows.
+ * @param columns Indexes of the columns to read.
+ * @param column_count The amount of columns to read.
+ * @param callback A callback called for every page with matching rows, in page order.
+ * @param ctx A context passed to the callback.
+ * @return Operation status.
+ *
+ * Works like ydb_scan_columns(), evaluating the predicates over minipages of their columns with the best
+ * kernels of the CPU. Pages without matching rows are skipped. Returns #YDB_ERR_PREDICATE_INVALID or
+ * #YDB_ERR_COLUMN_NOT_EXIST if a predicate does not fit the schema (see ydb_predicate_check()).
+ *
+ * Pages whose zone maps rule a predicate out are skipped without being read. Zone maps of columns with
+ * #YDB_COLUMN_FLAG_ZONE_MAP flag are stored in the page directory since table file v1.8 and loaded with it,
+ * page changes made through the instance keep them up to date. For older tables the first filtered scan after
+ * a load builds them in memory reading every page.
+ */
+YDB_Error ydb_scan_filter(YDB_Engine* instance, const YDB_Predicate* predicates, size_t predicate_count,
+                          const size_t* columns, size_t column_count, YDB_FilterScanFn callback, void* ctx);
+
+/**
+ * @brief Get the zone map of a column in a page of the loaded table.
+ * @param instance A *busy* YeltsinDB instance with a schema.
+ * @param page_index Page index, in page order.
+ * @param column Index of a column with #YDB_COLUMN_FLAG_ZONE_MAP flag.
+ * @param[out] zone Zone map of the column in the page.
+ * @return Operation status.
+ *
+ * Builds zone maps of tables older than v1.8 if they are not built yet. Returns #YDB_ERR_COLUMN_NOT_EXIST if the column has no zone maps,
+ * and #YDB_ERR_PAGE_INDEX_OUT_OF_RANGE if there is no such page.
+ */
+YDB_Error ydb_get_zone_map(YDB_Engine* instance, size_t page_index, size_t column, YDB_ZoneMap* zone);
+
+/**
+ * @brief Get the allocator of pages that fit the table.
+ * @param instance A YeltsinDB instance.
+ * @return Page allocator owned by the instance.
+ *
+ * Pages allocated with ydb_page_alloc_from() are reused after ydb_page_free() instead of hitting malloc,
+ * which is useful for pages built for ydb_append_page() or ydb_replace_current_page().
+ * The allocator is destroyed by ydb_terminate_instance() once all its pages are freed. It is replaced on
+ * loading a table with another page data size, so get it again after a table load.
+ */
+YDB_PageAllocator* ydb_get_page_allocator(YDB_Engine* instance);
+
+/**
+ * @brief Get the size of page data in the loaded table.
+ * @param instance A YeltsinDB instance.
+ * @param[out] size Page data size.
+ * @return Operation status.
+ *
+ * It depends on the page size of the table (see ydb_set_page_size()). Pages of tables with checksums
+ * (see ydb_set_checksums()) have less room for data.
+ */
+YDB_Error ydb_get_page_data_size(YDB_Engine* instance, YDB_PageSize* size);
+
+/**
+ * @brief Set page cache capacity.
+ * @param instance A *free* YeltsinDB instance.
+ * @param capacity Cache capacity in pages.
+ * @return Operation status.
+ * @sa ydb_get_cache_stats()
+ *
+ * The capacity is applied on the next table load. Values below #YDB_CACHE_MIN_CAPACITY (or
+ * #YDB_WAL_CACHE_MIN_CAPACITY with write-ahead log enabled) are rounded up.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_cache_capacity(YDB_Engine* instance, size_t capacity);
+
+/**
+ * @brief Set storage backend for tables loaded or created by path.
+ * @param instance A *free* YeltsinDB instance.
+ * @param mode I/O mode.
+ * @return Operation status.
+ *
+ * The mode is applied on the next table load. In #YDB_IO_MMAP mode the page cache is not used.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_io_mode(YDB_Engine* instance, YDB_IOMode mode);
+
+/**
+ * @brief Set the amount of pages read ahead during page scans.
+ * @param instance A YeltsinDB instance.
+ * @param pages The amount of pages, 0 to disable read-ahead (default).
+ * @return Operation status.
+ *
+ * With the page cache, a background thread follows the page chain from the current page and keeps up to
+ * `pages` next pages read, so ydb_next_page() does not wait for the storage. Pages are staged in memory
+ * besides the cache. With mapped storage the OS is asked to read the next page instead.
+ * Could be changed while a table is loaded.
+ */
+YDB_Error ydb_set_readahead(YDB_Engine* instance, size_t pages);
+
+/**
+ * @brief Enable or disable write-ahead log for tables loaded or created by path.
+ * @param instance A *free* YeltsinDB instance.
+ * @param enabled Non-zero to enable.
+ * @return Operation status.
+ * @sa ydb_set_group_commit()
+ *
+ * The log is kept next to the table file, in a file with #YDB_WAL_FILE_SUFFIX appended to the table path.
+ * Every operation is committed to the log, while changed pages are written to the table file on eviction
+ * from the page cache and on checkpoint. On load the log is replayed, so a table with `TBL?` signature
+ * (left by a crash) is recovered to the last committed operation.
+ * An operation that fails is rolled back to the last committed state, both in memory and in the files.
+ *
+ * The log is used with the page cache, even in #YDB_IO_MMAP mode. Loading or creating a table returns
+ * #YDB_ERR_WAL_OPEN_FAILED if the log file cannot be opened.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_wal(YDB_Engine* instance, int enabled);
+
+/**
+ * @brief Enable or disable page compression for tables loaded or created next.
+ * @param instance A *free* YeltsinDB instance.
+ * @param enabled Non-zero to enable.
+ * @return Operation status.
+ *
+ * Pages are compressed on their way from the page cache to the table file and decompressed on their way back,
+ * so the cache holds plain pages. A page keeps its place in the file, only compressed bytes are read and
+ * written; pages that do not get at least 1/16 smaller are stored as is.
+ * Tables older than v1.4 are never compressed. Once enabled for a table, the table is marked with
+ * #YDB_TABLE_FLAG_COMPRESSED and is always used with the page cache, even in #YDB_IO_MMAP mode.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_compression(YDB_Engine* instance, int enabled);
+
+/**
+ * @brief Enable or disable page checksums for tables created next.
+ * @param instance A *free* YeltsinDB instance.
+ * @param enabled Non-zero to enable.
+ * @return Operation status.
+ *
+ * A table created with checksums is marked with #YDB_TABLE_FLAG_CHECKSUMS, and every page of it gets a CRC-32C
+ * of its image in the page header, which leaves 4 bytes less for page data (see ydb_get_page_data_size()).
+ * Checksums are filled on the way from the page cache to the table file and the log, and checked on the way
+ * back and by ydb_parallel_scan(). A page that does not match fails with #YDB_ERR_PAGE_CHECKSUM_MISMATCH.
+ * Such a table is always used with the page cache, even in #YDB_IO_MMAP mode.
+ * The setting does not affect existing tables. If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_checksums(YDB_Engine* instance, int enabled);
+
+/**
+ * @brief Set page size for tables created next.
+ * @param instance A *free* YeltsinDB instance.
+ * @param size Page size in bytes: a power of two from #YDB_TABLE_PAGE_SIZE_MIN to #YDB_TABLE_PAGE_SIZE_MAX.
+ * @return Operation status.
+ *
+ * The page size is stored in the table file header and can't be changed later. Small pages make point reads
+ * cheaper, large pages make scans do less I/O calls. The default is #YDB_TABLE_PAGE_SIZE, which is also
+ * the page size of tables older than v1.6. Page data is smaller than the page by the page header
+ * (see ydb_get_page_data_size()).
+ * Returns #YDB_ERR_PAGE_SIZE_INVALID if the size is not supported.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_page_size(YDB_Engine* instance, YDB_PageSize size);
+
+/**
+ * @brief Set write-ahead log storage for the next table load.
+ * @param instance A *free* YeltsinDB instance.
+ * @param storage Log storage, or NULL to load the next table without a log.
+ * @return Operation status.
+ * @sa ydb_load_table_from()
+ *
+ * The instance owns the storage. Useful for tables loaded with ydb_load_table_from() or
+ * created with ydb_create_table_in(), which do not use the log otherwise.
+ * If the instance is not free, returns #YDB_ERR_INSTANCE_IN_USE.
+ */
+YDB_Error ydb_set_wal_storage(YDB_Engine* instance, YDB_Storage* storage);
+
+/**
+ * @brief Set the amount of operations that share one write-ahead log sync.
+ * @param instance A YeltsinDB instance.
+ * @param ops The amount of operations per sync, #YDB_WAL_DEFAULT_GROUP_COMMIT by default.
+ *            0 means the log is synced only by ydb_commit() and checkpoints.
+ * @return Operation status.
+ *
+ * An operation is durable once the log is synced. Larger groups trade the last few operations
+ * lost on crash for fewer syncs. The value could be changed while a table is loaded.
+ */
+YDB_Error ydb_set_group_commit(YDB_Engine* instance, size_t ops);
+
+/**
+ * @brief Make all finished operations durable.
+ * @param instance A *busy* YeltsinDB instance.
+ * @return Operation status.
+ *
+ * Syncs write-ahead log if it is used, otherwise syncs the table file.
+ */
+YDB_Error ydb_commit(YDB_Engine* instance);
+
+/**
+ * @brief Write all logged changes to the table file and empty write-ahead log.
+ * @param instance A *busy* YeltsinDB instance.
+ * @return Operation status.
+ *
+ * Checkpoints are also done when the log grows past #YDB_WAL_CHECKPOINT_SIZE and on table unload.
+ * Without the log, just syncs the table file.
+ */
+YDB_Error ydb_checkpoint(YDB_Engine* instance);
+
+/**
+ * @brief Get page cache counters of a loaded table.
+ * @param instance A *busy* YeltsinDB instance.
+ * @param[out] stats Counters destination.
+ * @return Operation status.
+ */
+YDB_Error ydb_get_cache_stats(YDB_Engine* instance, YDB_CacheStats* stats);
+
+/**
+ * @brief Get instance counters.
+ * @param instance A YeltsinDB instance.
+ * @param[out] stats Counters destination.
+ * @return Operation status.
+ * @sa ydb_reset_stats()
+ *
+ * Counters are kept since the instance was initialized or the last ydb_reset_stats(), over all the tables
+ * it loaded. Cache counters are those of the loaded table, zero if the instance is free.
+ * Pages of a table in mapped I/O mode (see ydb_set_io_mode()) are used in place, so their reads are not counted.
+ */
+YDB_Error ydb_get_stats(YDB_Engine* instance, YDB_Stats* stats);
+
+/**
+ * @brief Zero instance counters.
+ * @param instance A YeltsinDB instance.
+ * @return Operation status.
+ *
+ * Cache counters are kept by the cache and are not reset.
+ */
+YDB_Error ydb_reset_stats(YDB_Engine* instance);
+
+/**
+ * @brief Set a trace callback called after every counted event.
+ * @param instance A YeltsinDB instance.
+ * @param trace Trace callback, NULL to disable tracing.
+ * @param ctx User context passed to the callback.
+ * @return Operation status.
+ *
+ * See #YDB_TraceFn for what the callback may do.
+ */
+YDB_Error ydb_set_trace(YDB_Engine* instance, YDB_TraceFn trace, void* ctx);
+
 // TODO: rebuild page offsets, etc.
 
 /**
@@ -148,6 +825,28 @@ YDB_Error ydb_seek_to_end(YDB_Engine* instance);
  *
  * - table_page.h
  *
+ * - page_cache.h
+ *
+ * - storage.h
+ *
+ * - wal.h
+ *
+ * - readahead.h
+ *
+ * - scan.h
+ *
+ * - btree.h
+ *
+ * - hash_index.h
+ *
+ * - schema.h
+ *
+ * - pax.h
+ *
+ * - filter.h
+ *
+ * - stats.h
+ *
  * - error_code.h
  *
  * - types.h
@@ -0,0 +1,597 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/btree.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/page_cache.h>
+
+/**
+ * @struct __YDB_BTree
+ * @brief A struct that defines a B+-tree index file.
+ */
+struct __YDB_BTree {
+  YDB_Storage *storage; /**< Tree storage. */
+  YDB_PageCache *cache; /**< Page cache of tree nodes. */
+  YDB_PageSize page_size; /**< Node page size. */
+  size_t key_size; /**< Key size. */
+  size_t leaf_capacity; /**< The most entries in a leaf. */
+  size_t inner_capacity; /**< The most entries in an inner node. */
+  YDB_Offset root; /**< A location of the root node. */
+  YDB_Offset file_size; /**< Tree file size including nodes allocated in cache only. */
+  uint64_t entry_count; /**< The amount of entries. */
+  uint8_t dirty; /**< Whether the tree file signature is `IDX?`. */
+  uint8_t stale; /**< Whether the tree was found half-changed on open. */
+};
+
+// Leaf entries are keys followed by row locations, inner entries also have a child node offset.
+// The key of the first inner entry is never compared: its child takes everything below the second entry.
+
+static size_t __ydb_btree_leaf_entry_size(const YDB_BTree *tree) {
+  return tree->key_size + YDB_index_entry_page_size + YDB_index_entry_row_size;
+}
+
+static size_t __ydb_btree_inner_entry_size(const YDB_BTree *tree) {
+  return __ydb_btree_leaf_entry_size(tree) + YDB_index_entry_child_size;
+}
+
+static int __ydb_btree_is_leaf(const char *node) {
+  return node[YDB_v1_page_flags_offset] & YDB_INDEX_PAGE_FLAG_LEAF;
+}
+
+static size_t __ydb_btree_entry_size(const YDB_BTree *tree, const char *node) {
+  return __ydb_btree_is_leaf(node) ? __ydb_btree_leaf_entry_size(tree) : __ydb_btree_inner_entry_size(tree);
+}
+
+static size_t __ydb_btree_capacity(const YDB_BTree *tree, const char *node) {
+  return __ydb_btree_is_leaf(node) ? tree->leaf_capacity : tree->inner_capacity;
+}
+
+static char *__ydb_btree_entry(const YDB_BTree *tree, char *node, size_t i) {
+  return node + YDB_v1_page_data_offset + i * __ydb_btree_entry_size(tree, node);
+}
+
+static size_t __ydb_btree_count(const char *node) {
+  uint16_t count;
+  memcpy(&count, node + YDB_v1_page_row_count_offset, sizeof(count));
+  return FROM_LE(count);
+}
+
+static void __ydb_btree_count_set(char *node, size_t count) {
+  uint16_t count_le = TO_LE((uint16_t) count);
+  memcpy(node + YDB_v1_page_row_count_offset, &count_le, sizeof(count_le));
+}
+
+static YDB_Offset __ydb_btree_link(const char *node, enum YDB_v1_page_offsets field) {
+  YDB_Offset offset;
+  memcpy(&offset, node + field, sizeof(offset));
+  return FROM_LE(offset);
+}
+
+static void __ydb_btree_link_set(char *node, enum YDB_v1_page_offsets field, YDB_Offset offset) {
+  YDB_Offset offset_le = TO_LE(offset);
+  memcpy(node + field, &offset_le, sizeof(offset_le));
+}
+
+static YDB_Offset __ydb_btree_child(const YDB_BTree *tree, const char *entry) {
+  YDB_Offset child;
+  memcpy(&child, entry + __ydb_btree_leaf_entry_size(tree), sizeof(child));
+  return FROM_LE(child);
+}
+
+static YDB_RowLocation __ydb_btree_location(const YDB_BTree *tree, const char *entry) {
+  YDB_Offset page;
+  uint16_t row;
+  memcpy(&page, entry + tree->key_size, sizeof(page));
+  memcpy(&row, entry + tree->key_size + YDB_index_entry_page_size, sizeof(row));
+  return (YDB_RowLocation) {FROM_LE(page), FROM_LE(row)};
+}
+
+// Fills an entry with a key, a location and (for inner entries) a child offset.
+static void __ydb_btree_entry_fill(const YDB_BTree *tree, char *entry, const void *key, YDB_RowLocation location,
+                                   YDB_Offset child) {
+  YDB_Offset page_le = TO_LE(location.page);
+  uint16_t row_le = TO_LE((uint16_t) location.row);
+  YDB_Offset child_le = TO_LE(child);
+  memcpy(entry, key, tree->key_size);
+  memcpy(entry + tree->key_size, &page_le, sizeof(page_le));
+  memcpy(entry + tree->key_size + YDB_index_entry_page_size, &row_le, sizeof(row_le));
+  memcpy(entry + __ydb_btree_leaf_entry_size(tree), &child_le, sizeof(child_le));
+}
+
+// Compares a key and a location with an entry: by key bytes, then by page offset, then by row id.
+static int __ydb_btree_compare(const YDB_BTree *tree, const void *key, YDB_RowLocation location, const char *entry) {
+  int c = memcmp(key, entry, tree->key_size);
+  if (c) return c;
+  YDB_RowLocation other = __ydb_btree_location(tree, entry);
+  if (location.page != other.page) return location.page < other.page ? -1 : 1;
+  if (location.row != other.row) return location.row < other.row ? -1 : 1;
+  return 0;
+}
+
+// Finds the first entry of a leaf not less than the key and the location.
+static size_t __ydb_btree_lower_bound(const YDB_BTree *tree, char *node, const void *key,
+                                      YDB_RowLocation location) {
+  size_t lo = 0, hi = __ydb_btree_count(node);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (__ydb_btree_compare(tree, key, location, __ydb_btree_entry(tree, node, mid)) > 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Finds the entry of an inner node whose child could have the key and the location.
+static size_t __ydb_btree_child_index(const YDB_BTree *tree, char *node, const void *key,
+                                      YDB_RowLocation location) {
+  size_t lo = 1, hi = __ydb_btree_count(node);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (__ydb_btree_compare(tree, key, location, __ydb_btree_entry(tree, node, mid)) >= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+static YDB_Error __ydb_btree_read(void *ctx, YDB_Offset offset, void *dst, size_t size) {
+  YDB_BTree *tree = ctx;
+  return ydb_storage_read_at(tree->storage, offset, dst, size);
+}
+
+static YDB_Error __ydb_btree_write(void *ctx, YDB_Offset offset, const void *src, size_t size) {
+  YDB_BTree *tree = ctx;
+  return ydb_storage_write_at(tree->storage, offset, src, size);
+}
+
+static YDB_Error __ydb_btree_write_header(YDB_BTree *tree, const char *sign) {
+  char header[YDB_index_data_offset] = {0};
+  memcpy(header, sign, YDB_TABLE_FILE_SIGN_SIZE);
+  header[YDB_TABLE_FILE_SIGN_SIZE] = YDB_INDEX_FILE_VER_MAJOR;
+  header[YDB_TABLE_FILE_SIGN_SIZE + YDB_TABLE_FILE_VER_MAJOR_SIZE] = YDB_INDEX_FILE_VER_MINOR;
+  uint32_t page_size_le = TO_LE((uint32_t) tree->page_size);
+  uint16_t key_size_le = TO_LE((uint16_t) tree->key_size);
+  YDB_Offset root_le = TO_LE(tree->root);
+  uint64_t count_le = TO_LE(tree->entry_count);
+  memcpy(header + YDB_index_page_size_offset, &page_size_le, sizeof(page_size_le));
+  memcpy(header + YDB_index_key_size_offset, &key_size_le, sizeof(key_size_le));
+  memcpy(header + YDB_index_root_offset, &root_le, sizeof(root_le));
+  memcpy(header + YDB_index_entry_count_offset, &count_le, sizeof(count_le));
+  return ydb_storage_write_at(tree->storage, 0, header, sizeof(header));
+}
+
+// Marks the file `IDX?` before the first change, so no changed node reaches the file while it's marked clean.
+static YDB_Error __ydb_btree_touch(YDB_BTree *tree) {
+  if (tree->dirty) return YDB_ERR_SUCCESS;
+  YDB_Error err = __ydb_btree_write_header(tree, YDB_INDEX_FILE_SIGN_DIRTY);
+  if (!err) err = ydb_storage_sync(tree->storage);
+  if (!err) tree->dirty = 1;
+  return err;
+}
+
+// Allocates a node past the end of the file. The node comes pinned and zero-filled.
+static YDB_Error __ydb_btree_node_new(YDB_BTree *tree, YDB_Flags flags, YDB_Offset *offset, char **node) {
+  YDB_Error err = ydb_cache_pin_new(tree->cache, tree->file_size, node);
+  if (err) return err;
+  *offset = tree->file_size;
+  tree->file_size += tree->page_size;
+  (*node)[YDB_v1_page_flags_offset] = (char) flags;
+  return YDB_ERR_SUCCESS;
+}
+
+// Creates an empty root leaf in an empty file.
+static YDB_Error __ydb_btree_init_root(YDB_BTree *tree) {
+  tree->file_size = YDB_index_data_offset;
+  tree->entry_count = 0;
+  char *node;
+  YDB_Error err = __ydb_btree_node_new(tree, YDB_INDEX_PAGE_FLAG_LEAF, &tree->root, &node);
+  if (err) return err;
+  ydb_cache_unpin(tree->cache, tree->root);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_btree_init(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size,
+                                  size_t cache_capacity, YDB_BTree **tree) {
+  THROW_IF_NULL(page_size >= YDB_TABLE_PAGE_SIZE_MIN && page_size <= YDB_TABLE_PAGE_SIZE_MAX &&
+                !(page_size & (page_size - 1)), YDB_ERR_PAGE_SIZE_INVALID);
+  THROW_IF_NULL(key_size > 0 && key_size <= YDB_INDEX_KEY_MAX_SIZE, YDB_ERR_KEY_SIZE_INVALID);
+
+  YDB_BTree *t = calloc(1, sizeof(YDB_BTree));
+  t->storage = storage;
+  t->page_size = page_size;
+  t->key_size = key_size;
+
+  // Entry count is stored in the row count field
+  const size_t data_size = page_size - YDB_v1_page_data_offset;
+  t->leaf_capacity = data_size / __ydb_btree_leaf_entry_size(t);
+  t->inner_capacity = data_size / __ydb_btree_inner_entry_size(t);
+  if (t->leaf_capacity > YDB_TABLE_PAGE_MAX_ROW_COUNT) t->leaf_capacity = YDB_TABLE_PAGE_MAX_ROW_COUNT;
+  if (t->inner_capacity > YDB_TABLE_PAGE_MAX_ROW_COUNT) t->inner_capacity = YDB_TABLE_PAGE_MAX_ROW_COUNT;
+
+  t->cache = ydb_cache_alloc(cache_capacity, page_size, __ydb_btree_read, __ydb_btree_write, t);
+  *tree = t;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_btree_create(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size, size_t cache_capacity,
+                           YDB_BTree **tree) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(tree, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(ydb_storage_size(storage) == 0, YDB_ERR_TABLE_EXIST);
+
+  YDB_BTree *t;
+  YDB_Error err = __ydb_btree_init(storage, page_size, key_size, cache_capacity, &t);
+  if (err) return err;
+
+  // A new tree is written clean right away
+  err = __ydb_btree_init_root(t);
+  if (!err) err = ydb_cache_flush(t->cache);
+  if (!err) err = __ydb_btree_write_header(t, YDB_INDEX_FILE_SIGN);
+  if (!err) err = ydb_storage_sync(storage);
+  if (err) {
+    t->storage = NULL;
+    ydb_btree_close(t);
+    return err;
+  }
+  *tree = t;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_btree_open(YDB_Storage *storage, size_t cache_capacity, YDB_BTree **tree) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(tree, YDB_ERR_WRITE_TO_NULLPTR);
+
+  char header[YDB_index_data_offset];
+  YDB_Error err = ydb_storage_read_at(storage, 0, header, sizeof(header));
+  if (err) return YDB_ERR_TABLE_DATA_CORRUPTED;
+
+  int stale = !memcmp(header, YDB_INDEX_FILE_SIGN_DIRTY, YDB_TABLE_FILE_SIGN_SIZE);
+  if (!stale && memcmp(header, YDB_INDEX_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE)) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  if (header[YDB_TABLE_FILE_SIGN_SIZE] != YDB_INDEX_FILE_VER_MAJOR) {
+    return YDB_ERR_TABLE_DATA_VERSION_MISMATCH;
+  }
+
+  uint32_t page_size;
+  uint16_t key_size;
+  YDB_Offset root;
+  uint64_t count;
+  memcpy(&page_size, header + YDB_index_page_size_offset, sizeof(page_size));
+  memcpy(&key_size, header + YDB_index_key_size_offset, sizeof(key_size));
+  memcpy(&root, header + YDB_index_root_offset, sizeof(root));
+  memcpy(&count, header + YDB_index_entry_count_offset, sizeof(count));
+  REASSIGN_FROM_LE(page_size);
+  REASSIGN_FROM_LE(key_size);
+  REASSIGN_FROM_LE(root);
+  REASSIGN_FROM_LE(count);
+
+  YDB_BTree *t;
+  err = __ydb_btree_init(storage, page_size, key_size, cache_capacity, &t);
+  if (err) return YDB_ERR_TABLE_DATA_CORRUPTED;
+  t->root = root;
+  t->entry_count = count;
+  t->file_size = ydb_storage_size(storage);
+  t->dirty = (uint8_t) stale;
+  t->stale = (uint8_t) stale;
+  if (root < YDB_index_data_offset || root + page_size > t->file_size) {
+    t->storage = NULL;
+    ydb_btree_close(t);
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  *tree = t;
+  return YDB_ERR_SUCCESS;
+}
+
+void ydb_btree_close(YDB_BTree *tree) {
+  if (!tree) return;
+  ydb_cache_free(tree->cache);
+  ydb_storage_close(tree->storage);
+  free(tree);
+}
+
+YDB_Error ydb_btree_flush(YDB_BTree *tree) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  if (!tree->dirty) return YDB_ERR_SUCCESS;
+
+  // Nodes go first, so that the file is marked clean only once they are durable
+  YDB_Error err = ydb_cache_flush(tree->cache);
+  if (!err) err = ydb_storage_sync(tree->storage);
+  if (!err) err = __ydb_btree_write_header(tree, YDB_INDEX_FILE_SIGN);
+  if (!err) err = ydb_storage_sync(tree->storage);
+  if (!err) tree->dirty = 0;
+  return err;
+}
+
+int ydb_btree_is_stale(const YDB_BTree *tree) {
+  return tree && tree->stale;
+}
+
+size_t ydb_btree_key_size(const YDB_BTree *tree) {
+  return tree ? tree->key_size : 0;
+}
+
+uint64_t ydb_btree_entry_count(const YDB_BTree *tree) {
+  return tree ? tree->entry_count : 0;
+}
+
+YDB_Error ydb_btree_clear(YDB_BTree *tree) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  YDB_Error err = __ydb_btree_touch(tree);
+  if (err) return err;
+
+  ydb_cache_discard(tree->cache, 0);
+  err = ydb_storage_truncate(tree->storage, YDB_index_data_offset);
+  if (err) return err;
+  err = __ydb_btree_init_root(tree);
+  if (err) return err;
+  tree->stale = 0;
+  return YDB_ERR_SUCCESS;
+}
+
+// Inserts an entry into a pinned node at `pos`. A full node is split in two: the upper entries go to a new
+// right sibling, which is returned in `right` along with its first entry in `separator`. The node is unpinned.
+static YDB_Error __ydb_btree_node_insert(YDB_BTree *tree, YDB_Offset offset, char *node, size_t pos,
+                                         const char *entry, char *separator, YDB_Offset *right) {
+  const size_t entry_size = __ydb_btree_entry_size(tree, node);
+  const size_t count = __ydb_btree_count(node);
+  *right = 0;
+
+  if (count < __ydb_btree_capacity(tree, node)) {
+    char *at = __ydb_btree_entry(tree, node, pos);
+    memmove(at + entry_size, at, (count - pos) * entry_size);
+    memcpy(at, entry, entry_size);
+    __ydb_btree_count_set(node, count + 1);
+    ydb_cache_mark_dirty(tree->cache, offset);
+    ydb_cache_unpin(tree->cache, offset);
+    return YDB_ERR_SUCCESS;
+  }
+
+  // Keys are often inserted in ascending order, then the node is left full and the new entry starts the sibling
+  const size_t mid = pos == count ? count : count / 2;
+  char *sibling;
+  YDB_Flags flags = node[YDB_v1_page_flags_offset];
+  YDB_Error err = __ydb_btree_node_new(tree, flags, right, &sibling);
+  if (err) {
+    ydb_cache_unpin(tree->cache, offset);
+    return err;
+  }
+
+  memcpy(__ydb_btree_entry(tree, sibling, 0), __ydb_btree_entry(tree, node, mid), (count - mid) * entry_size);
+  __ydb_btree_count_set(sibling, count - mid);
+  __ydb_btree_count_set(node, mid);
+
+  // Leaves are chained
+  YDB_Offset next = 0;
+  if (flags & YDB_INDEX_PAGE_FLAG_LEAF) {
+    next = __ydb_btree_link(node, YDB_v1_page_next_offset);
+    __ydb_btree_link_set(sibling, YDB_v1_page_next_offset, next);
+    __ydb_btree_link_set(sibling, YDB_v1_page_prev_offset, offset);
+    __ydb_btree_link_set(node, YDB_v1_page_next_offset, *right);
+  }
+
+  char *target = pos < mid ? node : sibling;
+  size_t target_pos = pos < mid ? pos : pos - mid;
+  size_t target_count = __ydb_btree_count(target);
+  char *at = __ydb_btree_entry(tree, target, target_pos);
+  memmove(at + entry_size, at, (target_count - target_pos) * entry_size);
+  memcpy(at, entry, entry_size);
+  __ydb_btree_count_set(target, target_count + 1);
+
+  memcpy(separator, __ydb_btree_entry(tree, sibling, 0), __ydb_btree_leaf_entry_size(tree));
+
+  ydb_cache_mark_dirty(tree->cache, offset);
+  ydb_cache_unpin(tree->cache, offset);
+  ydb_cache_unpin(tree->cache, *right);
+
+  if (next) {
+    char *next_node;
+    err = ydb_cache_pin(tree->cache, next, &next_node);
+    if (err) return err;
+    __ydb_btree_link_set(next_node, YDB_v1_page_prev_offset, *right);
+    ydb_cache_mark_dirty(tree->cache, next);
+    ydb_cache_unpin(tree->cache, next);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Descends from the root to the leaf that could have the key and the location. The leaf comes pinned.
+// Inner nodes passed on the way and the entries followed are stored in `path` and `path_pos` (could be NULL).
+static YDB_Error __ydb_btree_descend(YDB_BTree *tree, const void *key, YDB_RowLocation location,
+                                     YDB_Offset *leaf, char **node, YDB_Offset *path, size_t *path_pos,
+                                     size_t *depth) {
+  YDB_Offset offset = tree->root;
+  size_t d = 0;
+  for (;;) {
+    YDB_Error err = ydb_cache_pin(tree->cache, offset, node);
+    if (err) return err;
+    if (__ydb_btree_is_leaf(*node)) break;
+
+    size_t count = __ydb_btree_count(*node);
+    if (count == 0 || d == YDB_INDEX_MAX_HEIGHT) {
+      ydb_cache_unpin(tree->cache, offset);
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    size_t i = key ? __ydb_btree_child_index(tree, *node, key, location) : 0;
+    YDB_Offset child = __ydb_btree_child(tree, __ydb_btree_entry(tree, *node, i));
+    if (path) {
+      path[d] = offset;
+      path_pos[d] = i;
+    }
+    d++;
+    ydb_cache_unpin(tree->cache, offset);
+    offset = child;
+  }
+  *leaf = offset;
+  if (depth) *depth = d;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_btree_insert(YDB_BTree *tree, const void *key, YDB_RowLocation location) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key, YDB_ERR_WRITE_TO_NULLPTR);
+  YDB_Error err = __ydb_btree_touch(tree);
+  if (err) return err;
+
+  YDB_Offset path[YDB_INDEX_MAX_HEIGHT];
+  size_t path_pos[YDB_INDEX_MAX_HEIGHT];
+  size_t depth;
+  YDB_Offset offset;
+  char *node;
+  err = __ydb_btree_descend(tree, key, location, &offset, &node, path, path_pos, &depth);
+  if (err) return err;
+
+  size_t pos = __ydb_btree_lower_bound(tree, node, key, location);
+  if (pos < __ydb_btree_count(node) &&
+      __ydb_btree_compare(tree, key, location, __ydb_btree_entry(tree, node, pos)) == 0) {
+    ydb_cache_unpin(tree->cache, offset);
+    return YDB_ERR_SUCCESS;
+  }
+
+  char entry[YDB_INDEX_KEY_MAX_SIZE + YDB_index_entry_page_size + YDB_index_entry_row_size +
+             YDB_index_entry_child_size];
+  char separator[sizeof(entry)];
+  __ydb_btree_entry_fill(tree, entry, key, location, 0);
+  YDB_Offset right;
+  err = __ydb_btree_node_insert(tree, offset, node, pos, entry, separator, &right);
+  if (err) return err;
+  tree->entry_count++;
+
+  // A split adds the new sibling to the parent, which could split in turn
+  while (right) {
+    YDB_Offset child_le = TO_LE(right);
+    memcpy(entry, separator, __ydb_btree_leaf_entry_size(tree));
+    memcpy(entry + __ydb_btree_leaf_entry_size(tree), &child_le, sizeof(child_le));
+
+    if (depth == 0) {
+      // The root has been split, the tree grows by a level
+      YDB_Offset root;
+      err = __ydb_btree_node_new(tree, YDB_INDEX_PAGE_FLAG_INNER, &root, &node);
+      if (err) return err;
+      char *first = __ydb_btree_entry(tree, node, 0);
+      YDB_Offset old_root_le = TO_LE(tree->root);
+      memcpy(first + __ydb_btree_leaf_entry_size(tree), &old_root_le, sizeof(old_root_le));
+      memcpy(__ydb_btree_entry(tree, node, 1), entry, __ydb_btree_inner_entry_size(tree));
+      __ydb_btree_count_set(node, 2);
+      ydb_cache_unpin(tree->cache, root);
+      tree->root = root;
+      break;
+    }
+
+    depth--;
+    offset = path[depth];
+    err = ydb_cache_pin(tree->cache, offset, &node);
+    if (err) return err;
+    err = __ydb_btree_node_insert(tree, offset, node, path_pos[depth] + 1, entry, separator, &right);
+    if (err) return err;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_btree_delete(YDB_BTree *tree, const void *key, YDB_RowLocation location) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key, YDB_ERR_WRITE_TO_NULLPTR);
+
+  YDB_Offset offset;
+  char *node;
+  YDB_Error err = __ydb_btree_descend(tree, key, location, &offset, &node, NULL, NULL, NULL);
+  if (err) return err;
+
+  size_t count = __ydb_btree_count(node);
+  size_t pos = __ydb_btree_lower_bound(tree, node, key, location);
+  if (pos == count || __ydb_btree_compare(tree, key, location, __ydb_btree_entry(tree, node, pos)) != 0) {
+    ydb_cache_unpin(tree->cache, offset);
+    return YDB_ERR_KEY_NOT_FOUND;
+  }
+
+  err = __ydb_btree_touch(tree);
+  if (!err) {
+    const size_t entry_size = __ydb_btree_leaf_entry_size(tree);
+    char *at = __ydb_btree_entry(tree, node, pos);
+    memmove(at, at + entry_size, (count - pos - 1) * entry_size);
+    __ydb_btree_count_set(node, count - 1);
+    ydb_cache_mark_dirty(tree->cache, offset);
+    tree->entry_count--;
+  }
+  ydb_cache_unpin(tree->cache, offset);
+  return err;
+}
+
+YDB_Error ydb_btree_find(YDB_BTree *tree, const void *key, YDB_RowLocation *location) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key && location, YDB_ERR_WRITE_TO_NULLPTR);
+
+  const YDB_RowLocation lowest = {0, 0};
+  YDB_Offset offset;
+  char *node;
+  YDB_Error err = __ydb_btree_descend(tree, key, lowest, &offset, &node, NULL, NULL, NULL);
+  if (err) return err;
+
+  // The first entry of the key could be in a later leaf, past empty ones
+  size_t pos = __ydb_btree_lower_bound(tree, node, key, lowest);
+  while (pos == __ydb_btree_count(node)) {
+    YDB_Offset next = __ydb_btree_link(node, YDB_v1_page_next_offset);
+    ydb_cache_unpin(tree->cache, offset);
+    if (!next) return YDB_ERR_KEY_NOT_FOUND;
+    offset = next;
+    pos = 0;
+    err = ydb_cache_pin(tree->cache, offset, &node);
+    if (err) return err;
+  }
+
+  const char *entry = __ydb_btree_entry(tree, node, pos);
+  err = memcmp(entry, key, tree->key_size) ? YDB_ERR_KEY_NOT_FOUND : YDB_ERR_SUCCESS;
+  if (!err) *location = __ydb_btree_location(tree, entry);
+  ydb_cache_unpin(tree->cache, offset);
+  return err;
+}
+
+YDB_Error ydb_btree_scan(YDB_BTree *tree, const void *from, const void *to, YDB_IndexVisitFn visit, void *ctx) {
+  THROW_IF_NULL(tree, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(visit, YDB_ERR_WRITE_TO_NULLPTR);
+
+  // Any entry of the key has a location past the lowest one
+  const YDB_RowLocation lowest = {0, 0};
+  YDB_Offset offset;
+  char *node;
+  YDB_Error err = __ydb_btree_descend(tree, from, lowest, &offset, &node, NULL, NULL, NULL);
+  if (err) return err;
+
+  size_t pos = from ? __ydb_btree_lower_bound(tree, node, from, lowest) : 0;
+  for (;;) {
+    size_t count = __ydb_btree_count(node);
+    for (; pos < count; pos++) {
+      const char *entry = __ydb_btree_entry(tree, node, pos);
+      if (to && memcmp(entry, to, tree->key_size) > 0) {
+        ydb_cache_unpin(tree->cache, offset);
+        return YDB_ERR_SUCCESS;
+      }
+      err = visit(ctx, entry, __ydb_btree_location(tree, entry));
+      if (err) {
+        ydb_cache_unpin(tree->cache, offset);
+        return err;
+      }
+    }
+
+    YDB_Offset next = __ydb_btree_link(node, YDB_v1_page_next_offset);
+    ydb_cache_unpin(tree->cache, offset);
+    if (!next) return YDB_ERR_SUCCESS;
+    offset = next;
+    pos = 0;
+    err = ydb_cache_pin(tree->cache, offset, &node);
+    if (err) return err;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
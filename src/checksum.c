@@ -0,0 +1,188 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <pthread.h>
+#include <string.h>
+#include <YeltsinDB/checksum.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define __YDB_CRC32C_SSE42
+#endif
+
+// CRC-32C (Castagnoli) polynomial, reflected
+#define __YDB_CRC32C_POLY UINT32_C(0x82F63B78)
+
+// Block sizes of the interleaved hardware loop
+#define __YDB_CRC32C_LONG_BLOCK (8192)
+#define __YDB_CRC32C_SHORT_BLOCK (256)
+
+static pthread_once_t __ydb_crc32c_once = PTHREAD_ONCE_INIT;
+
+// Slicing-by-8 tables: table[k][b] is CRC of byte b followed by k zero bytes
+static uint32_t __ydb_crc32c_table[8][256];
+
+// CRC states are raw (not inverted) below, ydb_crc32c() does the inversion
+static uint32_t (*__ydb_crc32c_impl)(uint32_t state, const unsigned char *p, size_t size);
+
+static uint32_t __ydb_crc32c_sw(uint32_t state, const unsigned char *p, size_t size) {
+  while (size >= 8) {
+    state ^= (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+    state = __ydb_crc32c_table[7][state & 0xFF] ^ __ydb_crc32c_table[6][(state >> 8) & 0xFF] ^
+            __ydb_crc32c_table[5][(state >> 16) & 0xFF] ^ __ydb_crc32c_table[4][state >> 24] ^
+            __ydb_crc32c_table[3][p[4]] ^ __ydb_crc32c_table[2][p[5]] ^
+            __ydb_crc32c_table[1][p[6]] ^ __ydb_crc32c_table[0][p[7]];
+    p += 8;
+    size -= 8;
+  }
+  while (size--) {
+    state = __ydb_crc32c_table[0][(state ^ *p++) & 0xFF] ^ (state >> 8);
+  }
+  return state;
+}
+
+#ifdef __YDB_CRC32C_SSE42
+
+// Shift tables: shift[k][b] is the state after a block of zeros starting with byte b in k-th byte of the state
+static uint32_t __ydb_crc32c_long_shift[4][256];
+static uint32_t __ydb_crc32c_short_shift[4][256];
+
+// Multiplies two polynomials modulo the CRC polynomial (bit 31 is x^0).
+static uint32_t __ydb_crc32c_mulmod(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t m = UINT32_C(1) << 31; m; m >>= 1) {
+    if (a & m) product ^= b;
+    b = b & 1 ? (b >> 1) ^ __YDB_CRC32C_POLY : b >> 1;
+  }
+  return product;
+}
+
+// Fills a shift table for a block of `size` zero bytes: the state is multiplied by x^(8 * size).
+static void __ydb_crc32c_shift_init(uint32_t shift[4][256], size_t size) {
+  uint32_t x8n = UINT32_C(1) << 31;
+  uint32_t square = UINT32_C(1) << 23; // x^8
+  for (size_t n = size; n; n >>= 1) {
+    if (n & 1) x8n = __ydb_crc32c_mulmod(x8n, square);
+    square = __ydb_crc32c_mulmod(square, square);
+  }
+  for (int k = 0; k < 4; k++) {
+    for (uint32_t b = 0; b < 256; b++) {
+      shift[k][b] = __ydb_crc32c_mulmod(x8n, b << (8 * k));
+    }
+  }
+}
+
+static uint32_t __ydb_crc32c_shift(uint32_t shift[4][256], uint32_t state) {
+  return shift[0][state & 0xFF] ^ shift[1][(state >> 8) & 0xFF] ^
+         shift[2][(state >> 16) & 0xFF] ^ shift[3][state >> 24];
+}
+
+static inline uint64_t __ydb_crc32c_load(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Processes 3 blocks in a row as independent streams, hiding `crc32` latency, then combines the states.
+__attribute__((target("sse4.2")))
+static const unsigned char *__ydb_crc32c_sse42_blocks(uint32_t *state, const unsigned char *p, size_t block,
+                                                      uint32_t shift[4][256]) {
+  uint64_t c0 = *state;
+  uint64_t c1 = 0;
+  uint64_t c2 = 0;
+  for (size_t i = 0; i < block; i += 8) {
+    c0 = _mm_crc32_u64(c0, __ydb_crc32c_load(p + i));
+    c1 = _mm_crc32_u64(c1, __ydb_crc32c_load(p + block + i));
+    c2 = _mm_crc32_u64(c2, __ydb_crc32c_load(p + 2 * block + i));
+  }
+  uint32_t s = __ydb_crc32c_shift(shift, (uint32_t) c0) ^ (uint32_t) c1;
+  *state = __ydb_crc32c_shift(shift, s) ^ (uint32_t) c2;
+  return p + 3 * block;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t __ydb_crc32c_sse42(uint32_t state, const unsigned char *p, size_t size) {
+  while (size >= 3 * __YDB_CRC32C_LONG_BLOCK) {
+    p = __ydb_crc32c_sse42_blocks(&state, p, __YDB_CRC32C_LONG_BLOCK, __ydb_crc32c_long_shift);
+    size -= 3 * __YDB_CRC32C_LONG_BLOCK;
+  }
+  while (size >= 3 * __YDB_CRC32C_SHORT_BLOCK) {
+    p = __ydb_crc32c_sse42_blocks(&state, p, __YDB_CRC32C_SHORT_BLOCK, __ydb_crc32c_short_shift);
+    size -= 3 * __YDB_CRC32C_SHORT_BLOCK;
+  }
+
+  uint64_t c = state;
+  for (; size >= 8; p += 8, size -= 8) {
+    c = _mm_crc32_u64(c, __ydb_crc32c_load(p));
+  }
+  state = (uint32_t) c;
+  while (size--) {
+    state = _mm_crc32_u8(state, *p++);
+  }
+  return state;
+}
+
+#endif
+
+static void __ydb_crc32c_init(void) {
+  for (uint32_t b = 0; b < 256; b++) {
+    uint32_t c = b;
+    for (int k = 0; k < 8; k++) {
+      c = c & 1 ? (c >> 1) ^ __YDB_CRC32C_POLY : c >> 1;
+    }
+    __ydb_crc32c_table[0][b] = c;
+  }
+  for (int k = 1; k < 8; k++) {
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t c = __ydb_crc32c_table[k - 1][b];
+      __ydb_crc32c_table[k][b] = __ydb_crc32c_table[0][c & 0xFF] ^ (c >> 8);
+    }
+  }
+  __ydb_crc32c_impl = __ydb_crc32c_sw;
+
+#ifdef __YDB_CRC32C_SSE42
+  if (__builtin_cpu_supports("sse4.2")) {
+    __ydb_crc32c_shift_init(__ydb_crc32c_long_shift, __YDB_CRC32C_LONG_BLOCK);
+    __ydb_crc32c_shift_init(__ydb_crc32c_short_shift, __YDB_CRC32C_SHORT_BLOCK);
+    __ydb_crc32c_impl = __ydb_crc32c_sse42;
+  }
+#endif
+}
+
+uint32_t ydb_crc32c(uint32_t crc, const void *data, size_t size) {
+  pthread_once(&__ydb_crc32c_once, __ydb_crc32c_init);
+  return ~__ydb_crc32c_impl(~crc, data, size);
+}
+
+uint32_t ydb_page_checksum(const char *page, size_t size) {
+  uint32_t crc = ydb_crc32c(0, page, YDB_v1_page_checksum_offset);
+  return ydb_crc32c(crc, page + YDB_v1_page_checksummed_data_offset, size - YDB_v1_page_checksummed_data_offset);
+}
+
+void ydb_page_checksum_set(char *page, size_t size) {
+  uint32_t crc_le = TO_LE(ydb_page_checksum(page, size));
+  memcpy(page + YDB_v1_page_checksum_offset, &crc_le, sizeof(crc_le));
+}
+
+YDB_Error ydb_page_checksum_verify(const YDB_PageLayout *layout, const char *page, size_t size) {
+#ifdef YDB_NO_CHECKSUM_VERIFICATION
+  (void) layout;
+  (void) page;
+  (void) size;
+  return YDB_ERR_SUCCESS;
+#else
+  if (!layout->checksums) return YDB_ERR_SUCCESS;
+
+  uint32_t crc;
+  memcpy(&crc, page + YDB_v1_page_checksum_offset, sizeof(crc));
+  REASSIGN_FROM_LE(crc);
+  return crc == ydb_page_checksum(page, size) ? YDB_ERR_SUCCESS : YDB_ERR_PAGE_CHECKSUM_MISMATCH;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
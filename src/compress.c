@@ -0,0 +1,236 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/compress.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+
+// LZ4 block format limits: a match is 4 bytes at least and 64 KiB back at most, the last match starts
+// 12 bytes before the end of data at least, and the last 5 bytes are always literals.
+#define __YDB_LZ_MIN_MATCH (4)
+#define __YDB_LZ_MAX_DISTANCE (65535)
+#define __YDB_LZ_MATCH_LIMIT (12)
+#define __YDB_LZ_LAST_LITERALS (5)
+#define __YDB_LZ_HASH_LOG (12)
+
+static uint32_t __ydb_lz_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t __ydb_lz_hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - __YDB_LZ_HASH_LOG);
+}
+
+// Writes the rest of a length that does not fit into the token.
+static uint8_t *__ydb_lz_put_length(uint8_t *out, size_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = (uint8_t) length;
+  return out;
+}
+
+// Writes a sequence: literals followed by a match. The last sequence has no match (`match_length` is 0).
+// Returns NULL if it does not fit.
+static uint8_t *__ydb_lz_put_sequence(uint8_t *out, const uint8_t *out_end, const uint8_t *literals,
+                                      size_t literal_length, size_t distance, size_t match_length) {
+  size_t worst = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+  if (worst > (size_t) (out_end - out)) return NULL;
+
+  uint8_t *token = out++;
+  *token = (uint8_t) ((literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15) out = __ydb_lz_put_length(out, literal_length - 15);
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (!match_length) return out;
+
+  *out++ = (uint8_t) (distance & 0xFF);
+  *out++ = (uint8_t) (distance >> 8);
+  size_t m = match_length - __YDB_LZ_MIN_MATCH;
+  *token |= (uint8_t) (m < 15 ? m : 15);
+  if (m >= 15) out = __ydb_lz_put_length(out, m - 15);
+  return out;
+}
+
+size_t ydb_lz_compress(const void *src, size_t size, void *dst, size_t capacity) {
+  const uint8_t *in = src;
+  uint8_t *out = dst;
+  const uint8_t *out_end = out + capacity;
+
+  // Positions of the last 4-byte sequences with the same hash, plus one (0 for none)
+  uint32_t table[1 << __YDB_LZ_HASH_LOG] = {0};
+  size_t anchor = 0;
+  size_t pos = 0;
+
+  if (size > __YDB_LZ_MATCH_LIMIT) {
+    const size_t limit = size - __YDB_LZ_MATCH_LIMIT;
+    while (pos < limit) {
+      uint32_t seq = __ydb_lz_read32(in + pos);
+      uint32_t h = __ydb_lz_hash(seq);
+      size_t candidate = table[h];
+      table[h] = (uint32_t) pos + 1;
+
+      if (!candidate || pos - (candidate - 1) > __YDB_LZ_MAX_DISTANCE ||
+          __ydb_lz_read32(in + candidate - 1) != seq) {
+        // Incompressible data is skipped faster the longer there is no match
+        pos += 1 + ((pos - anchor) >> 6);
+        continue;
+      }
+
+      size_t ref = candidate - 1;
+      while (pos > anchor && ref > 0 && in[pos - 1] == in[ref - 1]) {
+        pos--;
+        ref--;
+      }
+      size_t length = __YDB_LZ_MIN_MATCH;
+      const size_t max_length = size - __YDB_LZ_LAST_LITERALS - pos;
+      while (length < max_length && in[pos + length] == in[ref + length]) length++;
+
+      out = __ydb_lz_put_sequence(out, out_end, in + anchor, pos - anchor, pos - ref, length);
+      if (!out) return 0;
+      pos += length;
+      anchor = pos;
+    }
+  }
+
+  out = __ydb_lz_put_sequence(out, out_end, in + anchor, size - anchor, 0, 0);
+  if (!out) return 0;
+  return (size_t) (out - (uint8_t *) dst);
+}
+
+// Reads the rest of a length that does not fit into the token.
+static int __ydb_lz_get_length(const uint8_t **in, const uint8_t *in_end, size_t *length) {
+  uint8_t b;
+  do {
+    if (*in >= in_end) return 0;
+    b = *(*in)++;
+    *length += b;
+  } while (b == 255);
+  return 1;
+}
+
+YDB_Error ydb_lz_decompress(const void *src, size_t size, void *dst, size_t dst_size) {
+  THROW_IF_NULL(src && dst, YDB_ERR_WRITE_TO_NULLPTR);
+
+  const uint8_t *in = src;
+  const uint8_t *in_end = in + size;
+  uint8_t *out = dst;
+  uint8_t *out_end = out + dst_size;
+
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !__ydb_lz_get_length(&in, in_end, &literal_length)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    if (literal_length > (size_t) (in_end - in) || literal_length > (size_t) (out_end - out)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) break; // The last sequence
+
+    if (in_end - in < 2) return YDB_ERR_TABLE_DATA_CORRUPTED;
+    size_t distance = in[0] | (size_t) in[1] << 8;
+    in += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !__ydb_lz_get_length(&in, in_end, &match_length)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    match_length += __YDB_LZ_MIN_MATCH;
+    if (!distance || distance > (size_t) (out - (uint8_t *) dst) || match_length > (size_t) (out_end - out)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+
+    // A match could overlap the data it produces
+    const uint8_t *ref = out - distance;
+    if (distance >= match_length) {
+      memcpy(out, ref, match_length);
+      out += match_length;
+    } else {
+      while (match_length--) *out++ = *ref++;
+    }
+  }
+
+  return out == out_end ? YDB_ERR_SUCCESS : YDB_ERR_TABLE_DATA_CORRUPTED;
+}
+
+size_t ydb_page_pack(const YDB_PageLayout *layout, const char *page, char *image) {
+  const size_t data_size = layout->page_size - layout->data_offset;
+  const size_t packed_offset = layout->data_offset + YDB_v1_page_compressed_size_size;
+  const size_t capacity = layout->page_size - (layout->page_size >> YDB_COMPRESSED_PAGE_MIN_SAVING_SHIFT) -
+                          packed_offset;
+
+  size_t packed = ydb_lz_compress(page + layout->data_offset, data_size, image + packed_offset, capacity);
+  if (!packed) return 0;
+
+  memcpy(image, page, layout->data_offset);
+  image[YDB_v1_page_flags_offset] |= YDB_TABLE_PAGE_FLAG_COMPRESSED;
+  uint32_t packed_le = TO_LE((uint32_t) packed);
+  memcpy(image + layout->data_offset, &packed_le, sizeof(packed_le));
+  return packed_offset + packed;
+}
+
+// Gets compressed data size of a page image. Returns 0 if the size is broken.
+static size_t __ydb_page_packed_size(const YDB_PageLayout *layout, const char *page) {
+  uint32_t packed;
+  memcpy(&packed, page + layout->data_offset, sizeof(packed));
+  REASSIGN_FROM_LE(packed);
+  if (packed > layout->page_size - layout->data_offset - YDB_v1_page_compressed_size_size) return 0;
+  return packed;
+}
+
+size_t ydb_page_image_size(const YDB_PageLayout *layout, const char *page) {
+  if (!(page[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_COMPRESSED)) return layout->page_size;
+
+  size_t packed = __ydb_page_packed_size(layout, page);
+  return packed ? layout->data_offset + YDB_v1_page_compressed_size_size + packed : 0;
+}
+
+YDB_Error ydb_page_unpack(const YDB_PageLayout *layout, char *page) {
+  THROW_IF_NULL(page, YDB_ERR_WRITE_TO_NULLPTR);
+  if (!(page[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_COMPRESSED)) return YDB_ERR_SUCCESS;
+
+  size_t packed = __ydb_page_packed_size(layout, page);
+  THROW_IF_NULL(packed, YDB_ERR_TABLE_DATA_CORRUPTED);
+
+  // Compressed data overlaps page data it's decompressed to
+  char *copy = malloc(packed);
+  memcpy(copy, page + layout->data_offset + YDB_v1_page_compressed_size_size, packed);
+  YDB_Error err = ydb_lz_decompress(copy, packed, page + layout->data_offset,
+                                    layout->page_size - layout->data_offset);
+  free(copy);
+  if (err) return err;
+
+  page[YDB_v1_page_flags_offset] &= (char) ~YDB_TABLE_PAGE_FLAG_COMPRESSED;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_read_image(const YDB_PageLayout *layout, YDB_Storage *storage, YDB_Offset offset,
+                              char *page, size_t *size) {
+  THROW_IF_NULL(page, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(size, YDB_ERR_WRITE_TO_NULLPTR);
+
+  size_t probe = layout->data_offset + YDB_v1_page_compressed_size_size + YDB_COMPRESSED_PAGE_PROBE_SIZE;
+  if (probe > layout->page_size) probe = layout->page_size;
+  YDB_Error err = ydb_storage_read_at(storage, offset, page, probe);
+  if (err) return err;
+
+  *size = ydb_page_image_size(layout, page);
+  THROW_IF_NULL(*size, YDB_ERR_TABLE_DATA_CORRUPTED);
+  if (*size > probe) {
+    err = ydb_storage_read_at(storage, offset + probe, page + probe, *size - probe);
+  }
+  return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,596 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <pthread.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/filter.h>
+#include <YeltsinDB/macro.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define __YDB_FILTER_SIMD
+#endif
+
+static pthread_once_t __ydb_filter_once = PTHREAD_ONCE_INIT;
+static YDB_FilterIsa __ydb_filter_best = YDB_FILTER_SCALAR;
+
+static void __ydb_filter_init(void) {
+#ifdef __YDB_FILTER_SIMD
+  if (__builtin_cpu_supports("avx2")) {
+    __ydb_filter_best = YDB_FILTER_AVX2;
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    __ydb_filter_best = YDB_FILTER_SSE;
+  }
+#endif
+}
+
+YDB_FilterIsa ydb_filter_isa(void) {
+  pthread_once(&__ydb_filter_once, __ydb_filter_init);
+  return __ydb_filter_best;
+}
+
+YDB_Error ydb_predicate_check(const YDB_Schema *schema, const YDB_Predicate *predicate) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(predicate, YDB_ERR_PREDICATE_INVALID);
+  const YDB_Column *c = ydb_schema_column(schema, predicate->column);
+  THROW_IF_NULL(c, YDB_ERR_COLUMN_NOT_EXIST);
+  THROW_IF_NULL(c->type != YDB_COLUMN_VARBYTES, YDB_ERR_PREDICATE_INVALID);
+  THROW_IF_NULL(predicate->values, YDB_ERR_PREDICATE_INVALID);
+
+  switch (predicate->op) {
+    case YDB_CMP_EQ:
+    case YDB_CMP_LT:
+    case YDB_CMP_GT:
+      THROW_IF_NULL(predicate->value_count == 1, YDB_ERR_PREDICATE_INVALID);
+      break;
+    case YDB_CMP_BETWEEN:
+      THROW_IF_NULL(predicate->value_count == 2, YDB_ERR_PREDICATE_INVALID);
+      break;
+    case YDB_CMP_IN:
+      THROW_IF_NULL(predicate->value_count, YDB_ERR_PREDICATE_INVALID);
+      break;
+    default:
+      return YDB_ERR_PREDICATE_INVALID;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Loads a value of a column: little-endian from a minipage, or in architecture endian from a predicate.
+static YDB_ZoneValue __ydb_filter_load(const YDB_Column *c, const char *p, int little_endian) {
+  uint8_t v8;
+  uint16_t v16;
+  uint32_t v32;
+  uint64_t v64;
+  switch (c->width) {
+    case 1:
+      memcpy(&v8, p, sizeof(v8));
+      v64 = v8;
+      break;
+    case 2:
+      memcpy(&v16, p, sizeof(v16));
+      v64 = little_endian ? FROM_LE(v16) : v16;
+      break;
+    case 4:
+      memcpy(&v32, p, sizeof(v32));
+      v64 = little_endian ? FROM_LE(v32) : v32;
+      break;
+    default:
+      memcpy(&v64, p, sizeof(v64));
+      v64 = little_endian ? FROM_LE(v64) : v64;
+      break;
+  }
+
+  YDB_ZoneValue v;
+  switch (c->type) {
+    case YDB_COLUMN_INT8:
+      v.i = (int8_t) v64;
+      break;
+    case YDB_COLUMN_INT16:
+      v.i = (int16_t) v64;
+      break;
+    case YDB_COLUMN_INT32:
+      v.i = (int32_t) v64;
+      break;
+    case YDB_COLUMN_INT64:
+      v.i = (int64_t) v64;
+      break;
+    case YDB_COLUMN_FLOAT32:
+      v32 = (uint32_t) v64;
+      float f32;
+      memcpy(&f32, &v32, sizeof(f32));
+      v.f = f32;
+      break;
+    case YDB_COLUMN_FLOAT64:
+      memcpy(&v.f, &v64, sizeof(v.f));
+      break;
+    default:
+      v.u = v64;
+      break;
+  }
+  return v;
+}
+
+// Orders two loaded values: -1, 0 or 1, and 2 if they are unordered (NaN).
+static int __ydb_filter_order(const YDB_Column *c, YDB_ZoneValue a, YDB_ZoneValue b) {
+  switch (c->type) {
+    case YDB_COLUMN_INT8:
+    case YDB_COLUMN_INT16:
+    case YDB_COLUMN_INT32:
+    case YDB_COLUMN_INT64:
+      return (a.i > b.i) - (a.i < b.i);
+    case YDB_COLUMN_FLOAT32:
+    case YDB_COLUMN_FLOAT64:
+      if (a.f < b.f) return -1;
+      if (a.f > b.f) return 1;
+      return a.f == b.f ? 0 : 2;
+    default:
+      return (a.u > b.u) - (a.u < b.u);
+  }
+}
+
+// Compares a minipage value with a constant, see __ydb_filter_order().
+static int __ydb_filter_compare(const YDB_Column *c, const char *value, const char *constant) {
+  if (c->type == YDB_COLUMN_BYTES) {
+    const int r = memcmp(value, constant, c->width);
+    return (r > 0) - (r < 0);
+  }
+  return __ydb_filter_order(c, __ydb_filter_load(c, value, 1), __ydb_filter_load(c, constant, 0));
+}
+
+static int __ydb_filter_test(const YDB_Column *c, const YDB_Predicate *predicate, const char *value) {
+  const char *constants = predicate->values;
+  int lo, hi;
+  switch (predicate->op) {
+    case YDB_CMP_EQ:
+      return __ydb_filter_compare(c, value, constants) == 0;
+    case YDB_CMP_LT:
+      return __ydb_filter_compare(c, value, constants) == -1;
+    case YDB_CMP_GT:
+      return __ydb_filter_compare(c, value, constants) == 1;
+    case YDB_CMP_BETWEEN:
+      lo = __ydb_filter_compare(c, value, constants);
+      hi = __ydb_filter_compare(c, value, constants + c->width);
+      return (lo == 0 || lo == 1) && (hi == 0 || hi == -1);
+    default:
+      for (size_t k = 0; k < predicate->value_count; k++) {
+        if (!__ydb_filter_compare(c, value, constants + k * c->width)) return 1;
+      }
+      return 0;
+  }
+}
+
+// Sets bits of the rows from `start` that match, a value at a time.
+static void __ydb_filter_scalar(const YDB_Column *c, const YDB_Predicate *predicate, const char *values,
+                                size_t start, size_t count, uint8_t *selection) {
+  for (size_t r = start; r < count; r++) {
+    if (__ydb_filter_test(c, predicate, values + r * c->width)) {
+      selection[r / 8] |= (uint8_t) (1 << (r % 8));
+    }
+  }
+}
+
+#ifdef __YDB_FILTER_SIMD
+
+// Kernels below handle whole vectors of rows and return the amount of rows done, the rest is left to
+// __ydb_filter_scalar(). Minipage values are little-endian, just as x86 loads them. Unsigned integers are
+// compared as signed ones with their sign bits flipped.
+
+__attribute__((target("avx2")))
+static size_t __ydb_filter_avx2_i32(const YDB_Predicate *p, const char *values, size_t count, int is_unsigned,
+                                    uint8_t *selection) {
+  const __m256i bias = _mm256_set1_epi32(is_unsigned ? INT32_MIN : 0);
+  const __m256i ones = _mm256_set1_epi32(-1);
+  const int32_t *constants = p->values;
+  const __m256i c0 = _mm256_xor_si256(_mm256_set1_epi32(constants[0]), bias);
+  const __m256i c1 = p->op == YDB_CMP_BETWEEN ? _mm256_xor_si256(_mm256_set1_epi32(constants[1]), bias) : c0;
+
+  size_t r = 0;
+  for (; r + 8 <= count; r += 8) {
+    const __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (values + r * 4)), bias);
+    __m256i m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm256_cmpeq_epi32(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm256_cmpgt_epi32(c0, x);
+        break;
+      case YDB_CMP_GT:
+        m = _mm256_cmpgt_epi32(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(c0, x), _mm256_cmpgt_epi32(x, c1)), ones);
+        break;
+      default:
+        m = _mm256_setzero_si256();
+        for (size_t k = 0; k < p->value_count; k++) {
+          const __m256i ck = _mm256_xor_si256(_mm256_set1_epi32(constants[k]), bias);
+          m = _mm256_or_si256(m, _mm256_cmpeq_epi32(x, ck));
+        }
+        break;
+    }
+    selection[r / 8] = (uint8_t) _mm256_movemask_ps(_mm256_castsi256_ps(m));
+  }
+  return r;
+}
+
+__attribute__((target("avx2")))
+static size_t __ydb_filter_avx2_i64(const YDB_Predicate *p, const char *values, size_t count, int is_unsigned,
+                                    uint8_t *selection) {
+  const __m256i bias = _mm256_set1_epi64x(is_unsigned ? INT64_MIN : 0);
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  const int64_t *constants = p->values;
+  const __m256i c0 = _mm256_xor_si256(_mm256_set1_epi64x(constants[0]), bias);
+  const __m256i c1 = p->op == YDB_CMP_BETWEEN ? _mm256_xor_si256(_mm256_set1_epi64x(constants[1]), bias) : c0;
+
+  size_t r = 0;
+  for (; r + 4 <= count; r += 4) {
+    const __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (values + r * 8)), bias);
+    __m256i m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm256_cmpeq_epi64(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm256_cmpgt_epi64(c0, x);
+        break;
+      case YDB_CMP_GT:
+        m = _mm256_cmpgt_epi64(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi64(c0, x), _mm256_cmpgt_epi64(x, c1)), ones);
+        break;
+      default:
+        m = _mm256_setzero_si256();
+        for (size_t k = 0; k < p->value_count; k++) {
+          const __m256i ck = _mm256_xor_si256(_mm256_set1_epi64x(constants[k]), bias);
+          m = _mm256_or_si256(m, _mm256_cmpeq_epi64(x, ck));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm256_movemask_pd(_mm256_castsi256_pd(m)) << (r % 8));
+  }
+  return r;
+}
+
+__attribute__((target("avx2")))
+static size_t __ydb_filter_avx2_f32(const YDB_Predicate *p, const char *values, size_t count, uint8_t *selection) {
+  const float *constants = p->values;
+  const __m256 c0 = _mm256_set1_ps(constants[0]);
+  const __m256 c1 = _mm256_set1_ps(p->op == YDB_CMP_BETWEEN ? constants[1] : constants[0]);
+
+  size_t r = 0;
+  for (; r + 8 <= count; r += 8) {
+    const __m256 x = _mm256_loadu_ps((const float *) (values + r * 4));
+    __m256 m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm256_cmp_ps(x, c0, _CMP_EQ_OQ);
+        break;
+      case YDB_CMP_LT:
+        m = _mm256_cmp_ps(x, c0, _CMP_LT_OQ);
+        break;
+      case YDB_CMP_GT:
+        m = _mm256_cmp_ps(x, c0, _CMP_GT_OQ);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm256_and_ps(_mm256_cmp_ps(x, c0, _CMP_GE_OQ), _mm256_cmp_ps(x, c1, _CMP_LE_OQ));
+        break;
+      default:
+        m = _mm256_setzero_ps();
+        for (size_t k = 0; k < p->value_count; k++) {
+          m = _mm256_or_ps(m, _mm256_cmp_ps(x, _mm256_set1_ps(constants[k]), _CMP_EQ_OQ));
+        }
+        break;
+    }
+    selection[r / 8] = (uint8_t) _mm256_movemask_ps(m);
+  }
+  return r;
+}
+
+__attribute__((target("avx2")))
+static size_t __ydb_filter_avx2_f64(const YDB_Predicate *p, const char *values, size_t count, uint8_t *selection) {
+  const double *constants = p->values;
+  const __m256d c0 = _mm256_set1_pd(constants[0]);
+  const __m256d c1 = _mm256_set1_pd(p->op == YDB_CMP_BETWEEN ? constants[1] : constants[0]);
+
+  size_t r = 0;
+  for (; r + 4 <= count; r += 4) {
+    const __m256d x = _mm256_loadu_pd((const double *) (values + r * 8));
+    __m256d m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm256_cmp_pd(x, c0, _CMP_EQ_OQ);
+        break;
+      case YDB_CMP_LT:
+        m = _mm256_cmp_pd(x, c0, _CMP_LT_OQ);
+        break;
+      case YDB_CMP_GT:
+        m = _mm256_cmp_pd(x, c0, _CMP_GT_OQ);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm256_and_pd(_mm256_cmp_pd(x, c0, _CMP_GE_OQ), _mm256_cmp_pd(x, c1, _CMP_LE_OQ));
+        break;
+      default:
+        m = _mm256_setzero_pd();
+        for (size_t k = 0; k < p->value_count; k++) {
+          m = _mm256_or_pd(m, _mm256_cmp_pd(x, _mm256_set1_pd(constants[k]), _CMP_EQ_OQ));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm256_movemask_pd(m) << (r % 8));
+  }
+  return r;
+}
+
+__attribute__((target("sse4.2")))
+static size_t __ydb_filter_sse_i32(const YDB_Predicate *p, const char *values, size_t count, int is_unsigned,
+                                   uint8_t *selection) {
+  const __m128i bias = _mm_set1_epi32(is_unsigned ? INT32_MIN : 0);
+  const __m128i ones = _mm_set1_epi32(-1);
+  const int32_t *constants = p->values;
+  const __m128i c0 = _mm_xor_si128(_mm_set1_epi32(constants[0]), bias);
+  const __m128i c1 = p->op == YDB_CMP_BETWEEN ? _mm_xor_si128(_mm_set1_epi32(constants[1]), bias) : c0;
+
+  size_t r = 0;
+  for (; r + 4 <= count; r += 4) {
+    const __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (values + r * 4)), bias);
+    __m128i m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm_cmpeq_epi32(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm_cmpgt_epi32(c0, x);
+        break;
+      case YDB_CMP_GT:
+        m = _mm_cmpgt_epi32(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(c0, x), _mm_cmpgt_epi32(x, c1)), ones);
+        break;
+      default:
+        m = _mm_setzero_si128();
+        for (size_t k = 0; k < p->value_count; k++) {
+          const __m128i ck = _mm_xor_si128(_mm_set1_epi32(constants[k]), bias);
+          m = _mm_or_si128(m, _mm_cmpeq_epi32(x, ck));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm_movemask_ps(_mm_castsi128_ps(m)) << (r % 8));
+  }
+  return r;
+}
+
+__attribute__((target("sse4.2")))
+static size_t __ydb_filter_sse_i64(const YDB_Predicate *p, const char *values, size_t count, int is_unsigned,
+                                   uint8_t *selection) {
+  const __m128i bias = _mm_set1_epi64x(is_unsigned ? INT64_MIN : 0);
+  const __m128i ones = _mm_set1_epi64x(-1);
+  const int64_t *constants = p->values;
+  const __m128i c0 = _mm_xor_si128(_mm_set1_epi64x(constants[0]), bias);
+  const __m128i c1 = p->op == YDB_CMP_BETWEEN ? _mm_xor_si128(_mm_set1_epi64x(constants[1]), bias) : c0;
+
+  size_t r = 0;
+  for (; r + 2 <= count; r += 2) {
+    const __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) (values + r * 8)), bias);
+    __m128i m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm_cmpeq_epi64(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm_cmpgt_epi64(c0, x);
+        break;
+      case YDB_CMP_GT:
+        m = _mm_cmpgt_epi64(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi64(c0, x), _mm_cmpgt_epi64(x, c1)), ones);
+        break;
+      default:
+        m = _mm_setzero_si128();
+        for (size_t k = 0; k < p->value_count; k++) {
+          const __m128i ck = _mm_xor_si128(_mm_set1_epi64x(constants[k]), bias);
+          m = _mm_or_si128(m, _mm_cmpeq_epi64(x, ck));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm_movemask_pd(_mm_castsi128_pd(m)) << (r % 8));
+  }
+  return r;
+}
+
+__attribute__((target("sse4.2")))
+static size_t __ydb_filter_sse_f32(const YDB_Predicate *p, const char *values, size_t count, uint8_t *selection) {
+  const float *constants = p->values;
+  const __m128 c0 = _mm_set1_ps(constants[0]);
+  const __m128 c1 = _mm_set1_ps(p->op == YDB_CMP_BETWEEN ? constants[1] : constants[0]);
+
+  size_t r = 0;
+  for (; r + 4 <= count; r += 4) {
+    const __m128 x = _mm_loadu_ps((const float *) (values + r * 4));
+    __m128 m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm_cmpeq_ps(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm_cmplt_ps(x, c0);
+        break;
+      case YDB_CMP_GT:
+        m = _mm_cmpgt_ps(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm_and_ps(_mm_cmpge_ps(x, c0), _mm_cmple_ps(x, c1));
+        break;
+      default:
+        m = _mm_setzero_ps();
+        for (size_t k = 0; k < p->value_count; k++) {
+          m = _mm_or_ps(m, _mm_cmpeq_ps(x, _mm_set1_ps(constants[k])));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm_movemask_ps(m) << (r % 8));
+  }
+  return r;
+}
+
+__attribute__((target("sse4.2")))
+static size_t __ydb_filter_sse_f64(const YDB_Predicate *p, const char *values, size_t count, uint8_t *selection) {
+  const double *constants = p->values;
+  const __m128d c0 = _mm_set1_pd(constants[0]);
+  const __m128d c1 = _mm_set1_pd(p->op == YDB_CMP_BETWEEN ? constants[1] : constants[0]);
+
+  size_t r = 0;
+  for (; r + 2 <= count; r += 2) {
+    const __m128d x = _mm_loadu_pd((const double *) (values + r * 8));
+    __m128d m;
+    switch (p->op) {
+      case YDB_CMP_EQ:
+        m = _mm_cmpeq_pd(x, c0);
+        break;
+      case YDB_CMP_LT:
+        m = _mm_cmplt_pd(x, c0);
+        break;
+      case YDB_CMP_GT:
+        m = _mm_cmpgt_pd(x, c0);
+        break;
+      case YDB_CMP_BETWEEN:
+        m = _mm_and_pd(_mm_cmpge_pd(x, c0), _mm_cmple_pd(x, c1));
+        break;
+      default:
+        m = _mm_setzero_pd();
+        for (size_t k = 0; k < p->value_count; k++) {
+          m = _mm_or_pd(m, _mm_cmpeq_pd(x, _mm_set1_pd(constants[k])));
+        }
+        break;
+    }
+    selection[r / 8] |= (uint8_t) (_mm_movemask_pd(m) << (r % 8));
+  }
+  return r;
+}
+
+// Runs the kernel of the column type, if there is one.
+static size_t __ydb_filter_simd(const YDB_Column *c, const YDB_Predicate *p, const char *values, size_t count,
+                                YDB_FilterIsa isa, uint8_t *selection) {
+  const int avx2 = isa == YDB_FILTER_AVX2;
+  switch (c->type) {
+    case YDB_COLUMN_INT32:
+    case YDB_COLUMN_UINT32:
+      return avx2 ? __ydb_filter_avx2_i32(p, values, count, c->type == YDB_COLUMN_UINT32, selection)
+                  : __ydb_filter_sse_i32(p, values, count, c->type == YDB_COLUMN_UINT32, selection);
+    case YDB_COLUMN_INT64:
+    case YDB_COLUMN_UINT64:
+      return avx2 ? __ydb_filter_avx2_i64(p, values, count, c->type == YDB_COLUMN_UINT64, selection)
+                  : __ydb_filter_sse_i64(p, values, count, c->type == YDB_COLUMN_UINT64, selection);
+    case YDB_COLUMN_FLOAT32:
+      return avx2 ? __ydb_filter_avx2_f32(p, values, count, selection)
+                  : __ydb_filter_sse_f32(p, values, count, selection);
+    case YDB_COLUMN_FLOAT64:
+      return avx2 ? __ydb_filter_avx2_f64(p, values, count, selection)
+                  : __ydb_filter_sse_f64(p, values, count, selection);
+    default:
+      return 0;
+  }
+}
+
+#endif
+
+void ydb_filter_minipage(const YDB_Schema *schema, const YDB_Predicate *predicate, const YDB_PaxColumn *minipage,
+                         YDB_FilterIsa isa, uint8_t *selection) {
+  const YDB_Column *c = ydb_schema_column(schema, predicate->column);
+  const size_t count = minipage->count;
+  const size_t bytes = (count + 7) / 8;
+  memset(selection, 0, bytes);
+
+  const YDB_FilterIsa best = ydb_filter_isa();
+  if (isa > best) isa = best;
+  size_t done = 0;
+#ifdef __YDB_FILTER_SIMD
+  if (isa != YDB_FILTER_SCALAR) {
+    done = __ydb_filter_simd(c, predicate, minipage->values, count, isa, selection);
+  }
+#endif
+  __ydb_filter_scalar(c, predicate, minipage->values, done, count, selection);
+
+  // Null values are zero-filled and could have matched
+  if (minipage->nulls) {
+    for (size_t i = 0; i < bytes; i++) {
+      selection[i] &= (uint8_t) ~minipage->nulls[i];
+    }
+  }
+}
+
+void ydb_zone_map_init(YDB_ZoneMap *zone) {
+  memset(zone, 0, sizeof(YDB_ZoneMap));
+}
+
+void ydb_zone_map_add(const YDB_Column *column, YDB_ZoneMap *zone, const void *value) {
+  if (!value) {
+    zone->null_count++;
+    return;
+  }
+
+  const YDB_ZoneValue v = __ydb_filter_load(column, value, 1);
+  if (__ydb_filter_order(column, v, v)) return; // NaN
+  if (!zone->value_count || __ydb_filter_order(column, v, zone->min) < 0) zone->min = v;
+  if (!zone->value_count || __ydb_filter_order(column, v, zone->max) > 0) zone->max = v;
+  zone->value_count++;
+}
+
+// Whether `v` is within the range of a zone map.
+static int __ydb_zone_map_covers(const YDB_Column *column, const YDB_ZoneMap *zone, YDB_ZoneValue v) {
+  const int lo = __ydb_filter_order(column, zone->min, v);
+  const int hi = __ydb_filter_order(column, v, zone->max);
+  return (lo == -1 || lo == 0) && (hi == -1 || hi == 0);
+}
+
+int ydb_zone_map_may_match(const YDB_Column *column, const YDB_ZoneMap *zone, const YDB_Predicate *predicate) {
+  if (zone->unknown) return 1;
+  if (!zone->value_count) return 0;
+
+  const char *constants = predicate->values;
+  YDB_ZoneValue lo, hi;
+  int r;
+  switch (predicate->op) {
+    case YDB_CMP_EQ:
+      return __ydb_zone_map_covers(column, zone, __ydb_filter_load(column, constants, 0));
+    case YDB_CMP_LT:
+      return __ydb_filter_order(column, zone->min, __ydb_filter_load(column, constants, 0)) == -1;
+    case YDB_CMP_GT:
+      return __ydb_filter_order(column, zone->max, __ydb_filter_load(column, constants, 0)) == 1;
+    case YDB_CMP_BETWEEN:
+      lo = __ydb_filter_load(column, constants, 0);
+      hi = __ydb_filter_load(column, constants + column->width, 0);
+      r = __ydb_filter_order(column, zone->max, lo);
+      if (r != 0 && r != 1) return 0;
+      r = __ydb_filter_order(column, zone->min, hi);
+      return r == 0 || r == -1;
+    default:
+      for (size_t k = 0; k < predicate->value_count; k++) {
+        if (__ydb_zone_map_covers(column, zone, __ydb_filter_load(column, constants + k * column->width, 0))) {
+          return 1;
+        }
+      }
+      return 0;
+  }
+}
+
+size_t ydb_selection_count(const uint8_t *selection, YDB_PageSize row_count) {
+  size_t count = 0;
+  for (size_t i = 0; i < (row_count + 7) / 8; i++) {
+    uint8_t b = selection[i];
+    if (i == row_count / 8) b &= (uint8_t) ((1 << (row_count % 8)) - 1);
+    for (; b; b &= (uint8_t) (b - 1)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+#ifdef __cplusplus
+}
+#endif
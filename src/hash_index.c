@@ -0,0 +1,726 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/checksum.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/hash_index.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/page_cache.h>
+
+/**
+ * @struct __YDB_HashIndex
+ * @brief A struct that defines an extendible hash index file.
+ */
+struct __YDB_HashIndex {
+  YDB_Storage *storage; /**< Index storage. */
+  YDB_PageCache *cache; /**< Page cache of buckets and directory pages. */
+  YDB_PageSize page_size; /**< Page size. */
+  size_t key_size; /**< Key size. */
+  size_t bucket_capacity; /**< The most entries in a bucket page. */
+  size_t dir_page_capacity; /**< The most directory entries in a directory page. */
+  uint16_t depth; /**< Global depth: the amount of low hash bits that pick a directory entry. */
+  YDB_Offset *dir; /**< Directory: bucket offsets, 2^depth of them. */
+  YDB_Offset *dir_pages; /**< Offsets of the directory pages in the file. */
+  size_t dir_page_count; /**< The amount of directory pages. */
+  uint8_t dir_changed; /**< Whether the directory has changed since it was stored. */
+  YDB_Offset file_size; /**< Index file size including pages allocated in cache only. */
+  uint64_t entry_count; /**< The amount of entries. */
+  uint8_t dirty; /**< Whether the index file signature is `HSH?`. */
+  uint8_t stale; /**< Whether the index was found half-changed on open. */
+};
+
+// A bucket page has its local depth (the amount of low hash bits all its entries share), the hashes of its
+// entries and the entries: keys followed by row locations. Hashes are kept apart from entries, so a lookup
+// reads a few cache lines of hashes and touches only the entries whose hash matches. A bucket that can't be
+// split any more gets overflow pages, chained by next page offset.
+
+static size_t __ydb_hash_entry_size(const YDB_HashIndex *index) {
+  return index->key_size + YDB_index_entry_page_size + YDB_index_entry_row_size;
+}
+
+static uint32_t __ydb_hash_of(const YDB_HashIndex *index, const void *key) {
+  return ydb_crc32c(0, key, index->key_size);
+}
+
+static YDB_Offset __ydb_hash_bucket(const YDB_HashIndex *index, uint32_t hash) {
+  return index->dir[hash & (((uint32_t) 1 << index->depth) - 1)];
+}
+
+static size_t __ydb_hash_count(const char *page) {
+  uint16_t count;
+  memcpy(&count, page + YDB_v1_page_row_count_offset, sizeof(count));
+  return FROM_LE(count);
+}
+
+static void __ydb_hash_count_set(char *page, size_t count) {
+  uint16_t count_le = TO_LE((uint16_t) count);
+  memcpy(page + YDB_v1_page_row_count_offset, &count_le, sizeof(count_le));
+}
+
+static YDB_Offset __ydb_hash_next(const char *page) {
+  YDB_Offset next;
+  memcpy(&next, page + YDB_v1_page_next_offset, sizeof(next));
+  return FROM_LE(next);
+}
+
+static void __ydb_hash_next_set(char *page, YDB_Offset next) {
+  YDB_Offset next_le = TO_LE(next);
+  memcpy(page + YDB_v1_page_next_offset, &next_le, sizeof(next_le));
+}
+
+static uint32_t __ydb_hash_read_hash(const char *hashes, size_t i) {
+  uint32_t hash;
+  memcpy(&hash, hashes + i * YDB_hash_bucket_hash_size, sizeof(hash));
+  return FROM_LE(hash);
+}
+
+static char *__ydb_hash_hashes(char *page) {
+  return page + YDB_hash_bucket_hashes_offset;
+}
+
+static char *__ydb_hash_entries(const YDB_HashIndex *index, char *page) {
+  return page + YDB_hash_bucket_hashes_offset + index->bucket_capacity * YDB_hash_bucket_hash_size;
+}
+
+static YDB_RowLocation __ydb_hash_location(const YDB_HashIndex *index, const char *entry) {
+  YDB_Offset page;
+  uint16_t row;
+  memcpy(&page, entry + index->key_size, sizeof(page));
+  memcpy(&row, entry + index->key_size + YDB_index_entry_page_size, sizeof(row));
+  return (YDB_RowLocation) {FROM_LE(page), FROM_LE(row)};
+}
+
+static void __ydb_hash_entry_fill(const YDB_HashIndex *index, char *entry, const void *key,
+                                  YDB_RowLocation location) {
+  YDB_Offset page_le = TO_LE(location.page);
+  uint16_t row_le = TO_LE((uint16_t) location.row);
+  memcpy(entry, key, index->key_size);
+  memcpy(entry + index->key_size, &page_le, sizeof(page_le));
+  memcpy(entry + index->key_size + YDB_index_entry_page_size, &row_le, sizeof(row_le));
+}
+
+// Appends an entry to a pinned bucket page with room for it.
+static void __ydb_hash_append(const YDB_HashIndex *index, char *page, uint32_t hash, const char *entry) {
+  const size_t count = __ydb_hash_count(page);
+  const size_t entry_size = __ydb_hash_entry_size(index);
+  uint32_t hash_le = TO_LE(hash);
+  memcpy(__ydb_hash_hashes(page) + count * YDB_hash_bucket_hash_size, &hash_le, sizeof(hash_le));
+  memcpy(__ydb_hash_entries(index, page) + count * entry_size, entry, entry_size);
+  __ydb_hash_count_set(page, count + 1);
+}
+
+static YDB_Error __ydb_hash_read(void *ctx, YDB_Offset offset, void *dst, size_t size) {
+  YDB_HashIndex *index = ctx;
+  return ydb_storage_read_at(index->storage, offset, dst, size);
+}
+
+static YDB_Error __ydb_hash_write(void *ctx, YDB_Offset offset, const void *src, size_t size) {
+  YDB_HashIndex *index = ctx;
+  return ydb_storage_write_at(index->storage, offset, src, size);
+}
+
+static YDB_Error __ydb_hash_write_header(YDB_HashIndex *index, const char *sign) {
+  char header[YDB_hash_data_offset] = {0};
+  memcpy(header, sign, YDB_TABLE_FILE_SIGN_SIZE);
+  header[YDB_TABLE_FILE_SIGN_SIZE] = YDB_HASH_FILE_VER_MAJOR;
+  header[YDB_TABLE_FILE_SIGN_SIZE + YDB_TABLE_FILE_VER_MAJOR_SIZE] = YDB_HASH_FILE_VER_MINOR;
+  uint32_t page_size_le = TO_LE((uint32_t) index->page_size);
+  uint16_t key_size_le = TO_LE((uint16_t) index->key_size);
+  uint16_t depth_le = TO_LE(index->depth);
+  YDB_Offset dir_le = TO_LE(index->dir_page_count ? index->dir_pages[0] : (YDB_Offset) 0);
+  uint64_t count_le = TO_LE(index->entry_count);
+  memcpy(header + YDB_hash_page_size_offset, &page_size_le, sizeof(page_size_le));
+  memcpy(header + YDB_hash_key_size_offset, &key_size_le, sizeof(key_size_le));
+  memcpy(header + YDB_hash_depth_offset, &depth_le, sizeof(depth_le));
+  memcpy(header + YDB_hash_directory_offset, &dir_le, sizeof(dir_le));
+  memcpy(header + YDB_hash_entry_count_offset, &count_le, sizeof(count_le));
+  return ydb_storage_write_at(index->storage, 0, header, sizeof(header));
+}
+
+// Marks the file `HSH?` before the first change, so no changed page reaches the file while it's marked clean.
+static YDB_Error __ydb_hash_touch(YDB_HashIndex *index) {
+  if (index->dirty) return YDB_ERR_SUCCESS;
+  YDB_Error err = __ydb_hash_write_header(index, YDB_HASH_FILE_SIGN_DIRTY);
+  if (!err) err = ydb_storage_sync(index->storage);
+  if (!err) index->dirty = 1;
+  return err;
+}
+
+// Allocates a page past the end of the file. The page comes pinned and zero-filled.
+static YDB_Error __ydb_hash_page_new(YDB_HashIndex *index, YDB_Flags flags, YDB_Offset *offset, char **page) {
+  YDB_Error err = ydb_cache_pin_new(index->cache, index->file_size, page);
+  if (err) return err;
+  *offset = index->file_size;
+  index->file_size += index->page_size;
+  (*page)[YDB_v1_page_flags_offset] = (char) flags;
+  return YDB_ERR_SUCCESS;
+}
+
+// Drops everything and starts over with a single empty bucket right after the header.
+static YDB_Error __ydb_hash_reset(YDB_HashIndex *index) {
+  ydb_cache_discard(index->cache, 0);
+  index->file_size = YDB_hash_data_offset;
+  index->entry_count = 0;
+  index->depth = 0;
+  index->dir = realloc(index->dir, sizeof(YDB_Offset));
+  index->dir_page_count = 0;
+  index->dir_changed = 1;
+
+  char *page;
+  YDB_Error err = __ydb_hash_page_new(index, YDB_HASH_PAGE_FLAG_BUCKET, &index->dir[0], &page);
+  if (err) return err;
+  ydb_cache_unpin(index->cache, index->dir[0]);
+  return YDB_ERR_SUCCESS;
+}
+
+// Writes the directory to directory pages, adding pages as it grows.
+static YDB_Error __ydb_hash_dir_store(YDB_HashIndex *index) {
+  const size_t size = (size_t) 1 << index->depth;
+  const size_t cap = index->dir_page_capacity;
+  const size_t need = (size + cap - 1) / cap;
+  if (need > index->dir_page_count) {
+    index->dir_pages = realloc(index->dir_pages, need * sizeof(YDB_Offset));
+  }
+
+  for (size_t k = 0; k < need; k++) {
+    char *page;
+    YDB_Error err;
+    if (k == index->dir_page_count) {
+      err = __ydb_hash_page_new(index, YDB_HASH_PAGE_FLAG_DIRECTORY, &index->dir_pages[k], &page);
+      if (err) return err;
+      index->dir_page_count++;
+      if (k) {
+        // Chain the new page after the previous one
+        YDB_Offset prev_le = TO_LE(index->dir_pages[k - 1]);
+        memcpy(page + YDB_v1_page_prev_offset, &prev_le, sizeof(prev_le));
+        char *prev;
+        err = ydb_cache_pin(index->cache, index->dir_pages[k - 1], &prev);
+        if (err) {
+          ydb_cache_unpin(index->cache, index->dir_pages[k]);
+          return err;
+        }
+        __ydb_hash_next_set(prev, index->dir_pages[k]);
+        ydb_cache_mark_dirty(index->cache, index->dir_pages[k - 1]);
+        ydb_cache_unpin(index->cache, index->dir_pages[k - 1]);
+      }
+    } else {
+      err = ydb_cache_pin(index->cache, index->dir_pages[k], &page);
+      if (err) return err;
+    }
+
+    const size_t count = size - k * cap < cap ? size - k * cap : cap;
+    for (size_t i = 0; i < count; i++) {
+      YDB_Offset bucket_le = TO_LE(index->dir[k * cap + i]);
+      memcpy(page + YDB_v1_page_data_offset + i * YDB_hash_directory_entry_size, &bucket_le, sizeof(bucket_le));
+    }
+    __ydb_hash_count_set(page, count);
+    ydb_cache_mark_dirty(index->cache, index->dir_pages[k]);
+    ydb_cache_unpin(index->cache, index->dir_pages[k]);
+  }
+  index->dir_changed = 0;
+  return YDB_ERR_SUCCESS;
+}
+
+// Reads the directory from directory pages starting at `offset`.
+static YDB_Error __ydb_hash_dir_load(YDB_HashIndex *index, YDB_Offset offset) {
+  const size_t size = (size_t) 1 << index->depth;
+  const YDB_Offset page_size = index->page_size;
+  index->dir = malloc(size * sizeof(YDB_Offset));
+
+  size_t loaded = 0;
+  while (offset && loaded < size) {
+    if (offset < YDB_hash_data_offset || offset + page_size > index->file_size) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    char *page;
+    YDB_Error err = ydb_cache_pin(index->cache, offset, &page);
+    if (err) return err;
+    size_t count = __ydb_hash_count(page);
+    if (!(page[YDB_v1_page_flags_offset] & YDB_HASH_PAGE_FLAG_DIRECTORY) || count > size - loaded) {
+      ydb_cache_unpin(index->cache, offset);
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      YDB_Offset bucket;
+      memcpy(&bucket, page + YDB_v1_page_data_offset + i * YDB_hash_directory_entry_size, sizeof(bucket));
+      index->dir[loaded + i] = FROM_LE(bucket);
+    }
+    loaded += count;
+    index->dir_pages = realloc(index->dir_pages, (index->dir_page_count + 1) * sizeof(YDB_Offset));
+    index->dir_pages[index->dir_page_count++] = offset;
+    YDB_Offset next = __ydb_hash_next(page);
+    ydb_cache_unpin(index->cache, offset);
+    offset = next;
+  }
+  if (loaded != size) return YDB_ERR_TABLE_DATA_CORRUPTED;
+
+  for (size_t i = 0; i < size; i++) {
+    if (index->dir[i] < YDB_hash_data_offset || index->dir[i] + page_size > index->file_size ||
+        (index->dir[i] - YDB_hash_data_offset) % page_size) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_hash_init(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size,
+                                 size_t cache_capacity, YDB_HashIndex **index) {
+  THROW_IF_NULL(page_size >= YDB_TABLE_PAGE_SIZE_MIN && page_size <= YDB_TABLE_PAGE_SIZE_MAX &&
+                !(page_size & (page_size - 1)), YDB_ERR_PAGE_SIZE_INVALID);
+  THROW_IF_NULL(key_size > 0 && key_size <= YDB_INDEX_KEY_MAX_SIZE, YDB_ERR_KEY_SIZE_INVALID);
+
+  YDB_HashIndex *h = calloc(1, sizeof(YDB_HashIndex));
+  h->storage = storage;
+  h->page_size = page_size;
+  h->key_size = key_size;
+
+  // Entry count is stored in the row count field
+  h->bucket_capacity = (page_size - YDB_hash_bucket_hashes_offset) /
+                       (YDB_hash_bucket_hash_size + __ydb_hash_entry_size(h));
+  h->dir_page_capacity = (page_size - YDB_v1_page_data_offset) / YDB_hash_directory_entry_size;
+  if (h->bucket_capacity > YDB_TABLE_PAGE_MAX_ROW_COUNT) h->bucket_capacity = YDB_TABLE_PAGE_MAX_ROW_COUNT;
+  if (h->dir_page_capacity > YDB_TABLE_PAGE_MAX_ROW_COUNT) h->dir_page_capacity = YDB_TABLE_PAGE_MAX_ROW_COUNT;
+
+  h->cache = ydb_cache_alloc(cache_capacity, page_size, __ydb_hash_read, __ydb_hash_write, h);
+  *index = h;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_hash_create(YDB_Storage *storage, YDB_PageSize page_size, size_t key_size, size_t cache_capacity,
+                          YDB_HashIndex **index) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(index, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(ydb_storage_size(storage) == 0, YDB_ERR_TABLE_EXIST);
+
+  YDB_HashIndex *h;
+  YDB_Error err = __ydb_hash_init(storage, page_size, key_size, cache_capacity, &h);
+  if (err) return err;
+
+  // A new index is written clean right away
+  h->dirty = 1;
+  err = __ydb_hash_reset(h);
+  if (!err) err = ydb_hash_flush(h);
+  if (err) {
+    h->storage = NULL;
+    ydb_hash_close(h);
+    return err;
+  }
+  *index = h;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_hash_open(YDB_Storage *storage, size_t cache_capacity, YDB_HashIndex **index) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(index, YDB_ERR_WRITE_TO_NULLPTR);
+
+  char header[YDB_hash_data_offset];
+  YDB_Error err = ydb_storage_read_at(storage, 0, header, sizeof(header));
+  if (err) return YDB_ERR_TABLE_DATA_CORRUPTED;
+
+  int stale = !memcmp(header, YDB_HASH_FILE_SIGN_DIRTY, YDB_TABLE_FILE_SIGN_SIZE);
+  if (!stale && memcmp(header, YDB_HASH_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE)) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  if (header[YDB_TABLE_FILE_SIGN_SIZE] != YDB_HASH_FILE_VER_MAJOR) {
+    return YDB_ERR_TABLE_DATA_VERSION_MISMATCH;
+  }
+
+  uint32_t page_size;
+  uint16_t key_size;
+  uint16_t depth;
+  YDB_Offset dir_offset;
+  uint64_t count;
+  memcpy(&page_size, header + YDB_hash_page_size_offset, sizeof(page_size));
+  memcpy(&key_size, header + YDB_hash_key_size_offset, sizeof(key_size));
+  memcpy(&depth, header + YDB_hash_depth_offset, sizeof(depth));
+  memcpy(&dir_offset, header + YDB_hash_directory_offset, sizeof(dir_offset));
+  memcpy(&count, header + YDB_hash_entry_count_offset, sizeof(count));
+  REASSIGN_FROM_LE(page_size);
+  REASSIGN_FROM_LE(key_size);
+  REASSIGN_FROM_LE(depth);
+  REASSIGN_FROM_LE(dir_offset);
+  REASSIGN_FROM_LE(count);
+  if (depth > YDB_HASH_MAX_DEPTH) return YDB_ERR_TABLE_DATA_CORRUPTED;
+
+  YDB_HashIndex *h;
+  err = __ydb_hash_init(storage, page_size, key_size, cache_capacity, &h);
+  if (err) return YDB_ERR_TABLE_DATA_CORRUPTED;
+  h->depth = depth;
+  h->entry_count = count;
+  h->file_size = ydb_storage_size(storage);
+  h->dirty = (uint8_t) stale;
+  h->stale = (uint8_t) stale;
+
+  // Nothing but the header of a stale index is read
+  if (stale) {
+    err = ydb_storage_truncate(storage, YDB_hash_data_offset);
+    if (!err) err = __ydb_hash_reset(h);
+  } else {
+    err = __ydb_hash_dir_load(h, dir_offset);
+    if (err && err != YDB_ERR_CACHE_NO_FREE_FRAMES) err = YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  if (err) {
+    h->storage = NULL;
+    ydb_hash_close(h);
+    return err;
+  }
+  *index = h;
+  return YDB_ERR_SUCCESS;
+}
+
+void ydb_hash_close(YDB_HashIndex *index) {
+  if (!index) return;
+  ydb_cache_free(index->cache);
+  ydb_storage_close(index->storage);
+  free(index->dir);
+  free(index->dir_pages);
+  free(index);
+}
+
+YDB_Error ydb_hash_flush(YDB_HashIndex *index) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  if (!index->dirty) return YDB_ERR_SUCCESS;
+
+  // Pages go first, so that the file is marked clean only once they are durable
+  YDB_Error err = index->dir_changed ? __ydb_hash_dir_store(index) : YDB_ERR_SUCCESS;
+  if (!err) err = ydb_cache_flush(index->cache);
+  if (!err) err = ydb_storage_sync(index->storage);
+  if (!err) err = __ydb_hash_write_header(index, YDB_HASH_FILE_SIGN);
+  if (!err) err = ydb_storage_sync(index->storage);
+  if (!err) index->dirty = 0;
+  return err;
+}
+
+int ydb_hash_is_stale(const YDB_HashIndex *index) {
+  return index && index->stale;
+}
+
+size_t ydb_hash_key_size(const YDB_HashIndex *index) {
+  return index ? index->key_size : 0;
+}
+
+uint64_t ydb_hash_entry_count(const YDB_HashIndex *index) {
+  return index ? index->entry_count : 0;
+}
+
+YDB_Error ydb_hash_clear(YDB_HashIndex *index) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  YDB_Error err = __ydb_hash_touch(index);
+  if (err) return err;
+
+  ydb_cache_discard(index->cache, 0);
+  err = ydb_storage_truncate(index->storage, YDB_hash_data_offset);
+  if (err) return err;
+  err = __ydb_hash_reset(index);
+  if (err) return err;
+  index->stale = 0;
+  return YDB_ERR_SUCCESS;
+}
+
+// Finds an entry in the bucket of its hash. The page that has it comes pinned.
+static YDB_Error __ydb_hash_locate(YDB_HashIndex *index, uint32_t hash, const char *entry, YDB_Offset *offset,
+                                   char **page, size_t *pos) {
+  const size_t entry_size = __ydb_hash_entry_size(index);
+  YDB_Offset o = __ydb_hash_bucket(index, hash);
+  while (o) {
+    char *p;
+    YDB_Error err = ydb_cache_pin(index->cache, o, &p);
+    if (err) return err;
+
+    const size_t count = __ydb_hash_count(p);
+    const char *hashes = __ydb_hash_hashes(p);
+    for (size_t i = 0; i < count; i++) {
+      if (__ydb_hash_read_hash(hashes, i) == hash &&
+          !memcmp(__ydb_hash_entries(index, p) + i * entry_size, entry, entry_size)) {
+        *offset = o;
+        *page = p;
+        *pos = i;
+        return YDB_ERR_SUCCESS;
+      }
+    }
+    YDB_Offset next = __ydb_hash_next(p);
+    ydb_cache_unpin(index->cache, o);
+    o = next;
+  }
+  return YDB_ERR_KEY_NOT_FOUND;
+}
+
+// Checks if splitting a full bucket page could make room: not all of its entries share the low hash bits
+// with the new one.
+static int __ydb_hash_splittable(const YDB_HashIndex *index, char *page, uint32_t hash) {
+  const uint32_t mask = ((uint32_t) 1 << YDB_HASH_MAX_DEPTH) - 1;
+  const char *hashes = __ydb_hash_hashes(page);
+  for (size_t i = 0; i < index->bucket_capacity; i++) {
+    if ((__ydb_hash_read_hash(hashes, i) ^ hash) & mask) return 1;
+  }
+  return 0;
+}
+
+// Fills a chain of bucket pages with entries, every page as full as it gets.
+static YDB_Error __ydb_hash_chain_fill(YDB_HashIndex *index, const YDB_Offset *chain, size_t page_count,
+                                       const char *hashes, const char *entries, size_t count, uint8_t depth) {
+  const size_t entry_size = __ydb_hash_entry_size(index);
+  size_t done = 0;
+  for (size_t k = 0; k < page_count; k++) {
+    char *page;
+    YDB_Error err = ydb_cache_pin(index->cache, chain[k], &page);
+    if (err) return err;
+
+    const size_t n = count - done < index->bucket_capacity ? count - done : index->bucket_capacity;
+    memcpy(__ydb_hash_hashes(page), hashes + done * YDB_hash_bucket_hash_size, n * YDB_hash_bucket_hash_size);
+    memcpy(__ydb_hash_entries(index, page), entries + done * entry_size, n * entry_size);
+    page[YDB_v1_page_flags_offset] = YDB_HASH_PAGE_FLAG_BUCKET;
+    page[YDB_hash_bucket_depth_offset] = (char) depth;
+    __ydb_hash_next_set(page, k + 1 < page_count ? chain[k + 1] : 0);
+    __ydb_hash_count_set(page, n);
+    ydb_cache_mark_dirty(index->cache, chain[k]);
+    ydb_cache_unpin(index->cache, chain[k]);
+    done += n;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Splits the bucket of a hash by hash bit `depth`, its local depth: entries with the bit set move to a new
+// bucket. Pages of the old chain are reused by both halves, so at most one page is added.
+static YDB_Error __ydb_hash_split(YDB_HashIndex *index, uint32_t hash, unsigned depth) {
+  const size_t entry_size = __ydb_hash_entry_size(index);
+  const size_t cap = index->bucket_capacity;
+  const YDB_Offset bucket = __ydb_hash_bucket(index, hash);
+
+  // Read all the entries of the chain
+  YDB_Offset *chain = NULL;
+  char *hashes = NULL, *entries = NULL;
+  size_t page_count = 0, count = 0;
+  YDB_Error err = YDB_ERR_SUCCESS;
+  for (YDB_Offset o = bucket; o && !err;) {
+    char *page;
+    err = ydb_cache_pin(index->cache, o, &page);
+    if (err) break;
+    chain = realloc(chain, (page_count + 2) * sizeof(YDB_Offset));
+    hashes = realloc(hashes, (page_count + 1) * cap * YDB_hash_bucket_hash_size);
+    entries = realloc(entries, (page_count + 1) * cap * entry_size);
+    chain[page_count++] = o;
+
+    const size_t n = __ydb_hash_count(page);
+    memcpy(hashes + count * YDB_hash_bucket_hash_size, __ydb_hash_hashes(page), n * YDB_hash_bucket_hash_size);
+    memcpy(entries + count * entry_size, __ydb_hash_entries(index, page), n * entry_size);
+    count += n;
+    YDB_Offset next = __ydb_hash_next(page);
+    ydb_cache_unpin(index->cache, o);
+    o = next;
+  }
+
+  // Entries that stay are packed in place, the rest go to the end of the buffers
+  char *moved_hashes = malloc(count * YDB_hash_bucket_hash_size + 1);
+  char *moved_entries = malloc(count * entry_size + 1);
+  size_t stay = 0, moved = 0;
+  for (size_t i = 0; i < count && !err; i++) {
+    const char *h = hashes + i * YDB_hash_bucket_hash_size;
+    const char *e = entries + i * entry_size;
+    if ((__ydb_hash_read_hash(hashes, i) >> depth) & 1) {
+      memcpy(moved_hashes + moved * YDB_hash_bucket_hash_size, h, YDB_hash_bucket_hash_size);
+      memcpy(moved_entries + moved * entry_size, e, entry_size);
+      moved++;
+    } else {
+      memmove(hashes + stay * YDB_hash_bucket_hash_size, h, YDB_hash_bucket_hash_size);
+      memmove(entries + stay * entry_size, e, entry_size);
+      stay++;
+    }
+  }
+
+  // The old bucket keeps the first pages of the chain, the new one takes the rest and a new page if needed
+  const size_t stay_pages = stay > cap ? (stay + cap - 1) / cap : 1;
+  const size_t moved_pages = moved > cap ? (moved + cap - 1) / cap : 1;
+  if (!err && stay_pages + moved_pages > page_count) {
+    char *page;
+    err = __ydb_hash_page_new(index, YDB_HASH_PAGE_FLAG_BUCKET, &chain[page_count], &page);
+    if (!err) {
+      ydb_cache_unpin(index->cache, chain[page_count]);
+      page_count++;
+    }
+  }
+  if (!err) err = __ydb_hash_chain_fill(index, chain, stay_pages, hashes, entries, stay, (uint8_t) (depth + 1));
+  if (!err) {
+    err = __ydb_hash_chain_fill(index, chain + stay_pages, page_count - stay_pages, moved_hashes, moved_entries,
+                                moved, (uint8_t) (depth + 1));
+  }
+
+  if (!err) {
+    // The directory doubles if the bucket is picked by all the bits it has
+    if (depth == index->depth) {
+      const size_t size = (size_t) 1 << index->depth;
+      index->dir = realloc(index->dir, 2 * size * sizeof(YDB_Offset));
+      memcpy(index->dir + size, index->dir, size * sizeof(YDB_Offset));
+      index->depth++;
+    }
+
+    // Directory entries of the old bucket with the bit set go to the new one
+    const size_t size = (size_t) 1 << index->depth;
+    const size_t step = (size_t) 1 << (depth + 1);
+    for (size_t i = (hash & (((uint32_t) 1 << depth) - 1)) | ((size_t) 1 << depth); i < size; i += step) {
+      index->dir[i] = chain[stay_pages];
+    }
+    index->dir_changed = 1;
+  }
+
+  free(moved_entries);
+  free(moved_hashes);
+  free(entries);
+  free(hashes);
+  free(chain);
+  return err;
+}
+
+YDB_Error ydb_hash_insert(YDB_HashIndex *index, const void *key, YDB_RowLocation location) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key, YDB_ERR_WRITE_TO_NULLPTR);
+
+  char entry[YDB_INDEX_KEY_MAX_SIZE + YDB_index_entry_page_size + YDB_index_entry_row_size];
+  __ydb_hash_entry_fill(index, entry, key, location);
+  const uint32_t hash = __ydb_hash_of(index, key);
+
+  YDB_Offset offset;
+  char *page;
+  size_t pos;
+  YDB_Error err = __ydb_hash_locate(index, hash, entry, &offset, &page, &pos);
+  if (!err) {
+    ydb_cache_unpin(index->cache, offset);
+    return YDB_ERR_SUCCESS;
+  }
+  if (err != YDB_ERR_KEY_NOT_FOUND) return err;
+  err = __ydb_hash_touch(index);
+  if (err) return err;
+
+  // A full bucket is split until the entry fits
+  for (;;) {
+    offset = __ydb_hash_bucket(index, hash);
+    err = ydb_cache_pin(index->cache, offset, &page);
+    if (err) return err;
+    const unsigned depth = (uint8_t) page[YDB_hash_bucket_depth_offset];
+    if (__ydb_hash_count(page) < index->bucket_capacity || depth >= YDB_HASH_MAX_DEPTH ||
+        !__ydb_hash_splittable(index, page, hash)) {
+      break;
+    }
+    ydb_cache_unpin(index->cache, offset);
+    err = __ydb_hash_split(index, hash, depth);
+    if (err) return err;
+  }
+
+  // A bucket that can't be split takes the entry in the first overflow page with room
+  while (__ydb_hash_count(page) == index->bucket_capacity) {
+    YDB_Offset next = __ydb_hash_next(page);
+    char *next_page;
+    if (next) {
+      err = ydb_cache_pin(index->cache, next, &next_page);
+    } else {
+      err = __ydb_hash_page_new(index, YDB_HASH_PAGE_FLAG_BUCKET, &next, &next_page);
+      if (!err) {
+        next_page[YDB_hash_bucket_depth_offset] = page[YDB_hash_bucket_depth_offset];
+        __ydb_hash_next_set(page, next);
+        ydb_cache_mark_dirty(index->cache, offset);
+      }
+    }
+    ydb_cache_unpin(index->cache, offset);
+    if (err) return err;
+    offset = next;
+    page = next_page;
+  }
+
+  __ydb_hash_append(index, page, hash, entry);
+  ydb_cache_mark_dirty(index->cache, offset);
+  ydb_cache_unpin(index->cache, offset);
+  index->entry_count++;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_hash_delete(YDB_HashIndex *index, const void *key, YDB_RowLocation location) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key, YDB_ERR_WRITE_TO_NULLPTR);
+
+  char entry[YDB_INDEX_KEY_MAX_SIZE + YDB_index_entry_page_size + YDB_index_entry_row_size];
+  __ydb_hash_entry_fill(index, entry, key, location);
+
+  YDB_Offset offset;
+  char *page;
+  size_t pos;
+  YDB_Error err = __ydb_hash_locate(index, __ydb_hash_of(index, key), entry, &offset, &page, &pos);
+  if (err) return err;
+
+  err = __ydb_hash_touch(index);
+  if (!err) {
+    // Entries are not ordered, the last one takes the place
+    const size_t entry_size = __ydb_hash_entry_size(index);
+    const size_t last = __ydb_hash_count(page) - 1;
+    char *hashes = __ydb_hash_hashes(page);
+    char *entries = __ydb_hash_entries(index, page);
+    memcpy(hashes + pos * YDB_hash_bucket_hash_size, hashes + last * YDB_hash_bucket_hash_size,
+           YDB_hash_bucket_hash_size);
+    memcpy(entries + pos * entry_size, entries + last * entry_size, entry_size);
+    __ydb_hash_count_set(page, last);
+    ydb_cache_mark_dirty(index->cache, offset);
+    index->entry_count--;
+  }
+  ydb_cache_unpin(index->cache, offset);
+  return err;
+}
+
+// Calls `visit` for every entry of a key, or finds the lowest location if `visit` is NULL.
+static YDB_Error __ydb_hash_lookup(YDB_HashIndex *index, const void *key, YDB_IndexVisitFn visit, void *ctx,
+                                   YDB_RowLocation *lowest) {
+  const size_t entry_size = __ydb_hash_entry_size(index);
+  const uint32_t hash = __ydb_hash_of(index, key);
+  YDB_Error result = YDB_ERR_KEY_NOT_FOUND;
+
+  YDB_Offset o = __ydb_hash_bucket(index, hash);
+  while (o) {
+    char *page;
+    YDB_Error err = ydb_cache_pin(index->cache, o, &page);
+    if (err) return err;
+
+    const size_t count = __ydb_hash_count(page);
+    const char *hashes = __ydb_hash_hashes(page);
+    const char *entries = __ydb_hash_entries(index, page);
+    for (size_t i = 0; i < count; i++) {
+      const char *entry = entries + i * entry_size;
+      if (__ydb_hash_read_hash(hashes, i) != hash || memcmp(entry, key, index->key_size)) continue;
+
+      YDB_RowLocation location = __ydb_hash_location(index, entry);
+      if (visit) {
+        err = visit(ctx, entry, location);
+        if (err) {
+          ydb_cache_unpin(index->cache, o);
+          return err;
+        }
+      } else if (result || location.page < lowest->page ||
+                 (location.page == lowest->page && location.row < lowest->row)) {
+        *lowest = location;
+      }
+      result = YDB_ERR_SUCCESS;
+    }
+    YDB_Offset next = __ydb_hash_next(page);
+    ydb_cache_unpin(index->cache, o);
+    o = next;
+  }
+  return visit ? YDB_ERR_SUCCESS : result;
+}
+
+YDB_Error ydb_hash_find(YDB_HashIndex *index, const void *key, YDB_RowLocation *location) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key && location, YDB_ERR_WRITE_TO_NULLPTR);
+  return __ydb_hash_lookup(index, key, NULL, NULL, location);
+}
+
+YDB_Error ydb_hash_find_all(YDB_HashIndex *index, const void *key, YDB_IndexVisitFn visit, void *ctx) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key && visit, YDB_ERR_WRITE_TO_NULLPTR);
+  return __ydb_hash_lookup(index, key, visit, ctx, NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,369 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/page_cache.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+
+/**
+ * @struct __YDB_CacheFrame
+ * @brief A cache frame holding one page.
+ */
+typedef struct __YDB_CacheFrame {
+  YDB_Offset offset; /**< Page offset of cached data. */
+  char *data; /**< Page data. */
+  uint32_t pin_count; /**< The amount of active pins. Pinned frames are never evicted. */
+  int32_t hash_next; /**< Next frame index in the hash chain, -1 if none. */
+  uint8_t valid; /**< Whether the frame holds a page. */
+  uint8_t dirty; /**< Whether the frame differs from the backing storage. */
+  uint8_t referenced; /**< CLOCK reference bit. */
+  uint8_t held; /**< Whether the frame is dirty and not released yet (no-steal mode only). */
+  uint8_t io; /**< Whether the frame is being read or written back without the cache lock. */
+} __YDB_CacheFrame;
+
+/**
+ * @struct __YDB_PageCache
+ * @brief A struct that defines a page cache.
+ */
+struct __YDB_PageCache {
+  __YDB_CacheFrame *frames; /**< Frame descriptors. */
+  char *data; /**< Memory for all the frames. */
+  size_t capacity; /**< The amount of frames. */
+  size_t frame_size; /**< The size of a frame. */
+  size_t clock_hand; /**< Current CLOCK position. */
+  uint8_t no_steal; /**< Whether dirty frames are held until ydb_cache_release_held(). */
+
+  int32_t *buckets; /**< Hash table buckets (heads of frame chains). */
+  size_t bucket_mask; /**< Bucket count minus one (bucket count is a power of 2). */
+
+  YDB_CacheReadFn read; /**< Read callback. */
+  YDB_CacheWriteFn write; /**< Write callback. */
+  void *ctx; /**< Callback context. */
+
+  YDB_CacheStats stats; /**< Cache counters. */
+
+  pthread_mutex_t lock; /**< Protects everything above except the constants. Frame data is not protected. */
+  pthread_cond_t io_done; /**< Signaled when a frame is done with I/O. */
+};
+
+static size_t __ydb_cache_bucket(const YDB_PageCache *cache, YDB_Offset offset) {
+  // Fibonacci hashing: page offsets differ in high bits only, so mix them down.
+  return (size_t) ((offset * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & cache->bucket_mask;
+}
+
+static int32_t __ydb_cache_find(const YDB_PageCache *cache, YDB_Offset offset) {
+  int32_t i = cache->buckets[__ydb_cache_bucket(cache, offset)];
+  while (i != -1 && cache->frames[i].offset != offset) {
+    i = cache->frames[i].hash_next;
+  }
+  return i;
+}
+
+static void __ydb_cache_hash_insert(YDB_PageCache *cache, int32_t idx) {
+  size_t b = __ydb_cache_bucket(cache, cache->frames[idx].offset);
+  cache->frames[idx].hash_next = cache->buckets[b];
+  cache->buckets[b] = idx;
+}
+
+static void __ydb_cache_hash_remove(YDB_PageCache *cache, int32_t idx) {
+  int32_t *link = &cache->buckets[__ydb_cache_bucket(cache, cache->frames[idx].offset)];
+  while (*link != idx) {
+    link = &cache->frames[*link].hash_next;
+  }
+  *link = cache->frames[idx].hash_next;
+  cache->frames[idx].hash_next = -1;
+}
+
+// Waits until a frame is done with I/O. The cache lock is dropped while waiting.
+static void __ydb_cache_wait_io(YDB_PageCache *cache, const __YDB_CacheFrame *f) {
+  while (f->io) {
+    pthread_cond_wait(&cache->io_done, &cache->lock);
+  }
+}
+
+// Finds an unpinned frame with CLOCK and makes it free (writes it back if needed).
+// Returns frame index or -1 if all the frames are pinned.
+// A dirty frame is written back without the cache lock, so the cache could change in the meantime.
+static int32_t __ydb_cache_victim(YDB_PageCache *cache, YDB_Error *err) {
+  *err = YDB_ERR_SUCCESS;
+  // Two full turns are enough: the first one clears reference bits.
+  for (size_t step = 0; step < 2 * cache->capacity; step++) {
+    size_t i = cache->clock_hand;
+    cache->clock_hand = (cache->clock_hand + 1) % cache->capacity;
+
+    __YDB_CacheFrame *f = &cache->frames[i];
+    if (f->pin_count || f->held || f->io) continue;
+    if (!f->valid) return (int32_t) i;
+    if (f->referenced) {
+      f->referenced = 0;
+      continue;
+    }
+
+    if (f->dirty) {
+      // Pinners of the page wait for the write, the frame is evicted right after it anyway
+      f->io = 1;
+      pthread_mutex_unlock(&cache->lock);
+      *err = cache->write(cache->ctx, f->offset, f->data, cache->frame_size);
+      pthread_mutex_lock(&cache->lock);
+      f->io = 0;
+      pthread_cond_broadcast(&cache->io_done);
+      if (*err) return -1;
+      f->dirty = 0;
+      cache->stats.writebacks++;
+    }
+    __ydb_cache_hash_remove(cache, (int32_t) i);
+    f->valid = 0;
+    cache->stats.evictions++;
+    return (int32_t) i;
+  }
+  *err = YDB_ERR_CACHE_NO_FREE_FRAMES;
+  return -1;
+}
+
+YDB_PageCache *ydb_cache_alloc(size_t capacity, size_t frame_size,
+                               YDB_CacheReadFn read, YDB_CacheWriteFn write, void *ctx) {
+  if (!capacity || !frame_size) return NULL;
+
+  YDB_PageCache *cache = calloc(1, sizeof(YDB_PageCache));
+  cache->capacity = capacity;
+  cache->frame_size = frame_size;
+  cache->read = read;
+  cache->write = write;
+  cache->ctx = ctx;
+  pthread_mutex_init(&cache->lock, NULL);
+  pthread_cond_init(&cache->io_done, NULL);
+
+  size_t bucket_count = 1;
+  while (bucket_count < 2 * capacity) bucket_count <<= 1;
+  cache->bucket_mask = bucket_count - 1;
+  cache->buckets = malloc(bucket_count * sizeof(int32_t));
+  memset(cache->buckets, 0xFF, bucket_count * sizeof(int32_t)); // All -1
+
+  cache->frames = calloc(capacity, sizeof(__YDB_CacheFrame));
+  // Frames are cache-line aligned as long as the frame size is a multiple of cache line.
+  size_t data_size = (capacity * frame_size + YDB_CACHE_LINE_SIZE - 1) / YDB_CACHE_LINE_SIZE * YDB_CACHE_LINE_SIZE;
+  cache->data = aligned_alloc(YDB_CACHE_LINE_SIZE, data_size);
+  for (size_t i = 0; i < capacity; i++) {
+    cache->frames[i].data = cache->data + i * frame_size;
+    cache->frames[i].hash_next = -1;
+  }
+  return cache;
+}
+
+void ydb_cache_free(YDB_PageCache *cache) {
+  if (!cache) return;
+  pthread_mutex_destroy(&cache->lock);
+  pthread_cond_destroy(&cache->io_done);
+  free(cache->data);
+  free(cache->frames);
+  free(cache->buckets);
+  free(cache);
+}
+
+// Pins a frame for `offset`. If `load` is zero, the frame is zero-filled instead of being read.
+// The page is read without the cache lock: the frame is in the hash already, marked with `io`,
+// so other threads pinning the same page wait for the read instead of reading it again.
+static YDB_Error __ydb_cache_pin(YDB_PageCache *cache, YDB_Offset offset, int load, char **frame) {
+  THROW_IF_NULL(cache, YDB_ERR_CACHE_NOT_INITIALIZED);
+  THROW_IF_NULL(frame, YDB_ERR_WRITE_TO_NULLPTR);
+
+  int32_t idx;
+  for (;;) {
+    idx = __ydb_cache_find(cache, offset);
+    if (idx != -1) {
+      __YDB_CacheFrame *f = &cache->frames[idx];
+      if (f->io) {
+        // The read could fail, or the frame could be evicted after the write-back, so look it up again
+        __ydb_cache_wait_io(cache, f);
+        continue;
+      }
+      cache->stats.hits++;
+      f->pin_count++;
+      f->referenced = 1;
+      if (!load) {
+        memset(f->data, 0, cache->frame_size);
+        f->dirty = 1;
+        f->held = cache->no_steal;
+      }
+      *frame = f->data;
+      return YDB_ERR_SUCCESS;
+    }
+
+    YDB_Error err;
+    idx = __ydb_cache_victim(cache, &err);
+    if (idx == -1) return err;
+    // Another thread could have pinned the page while a victim was written back
+    if (__ydb_cache_find(cache, offset) == -1) break;
+  }
+
+  cache->stats.misses++;
+  __YDB_CacheFrame *f = &cache->frames[idx];
+  f->offset = offset;
+  f->valid = 1;
+  f->dirty = !load;
+  f->held = !load && cache->no_steal;
+  f->referenced = 1;
+  f->pin_count = 1;
+  __ydb_cache_hash_insert(cache, idx);
+
+  if (!load) {
+    memset(f->data, 0, cache->frame_size);
+  } else {
+    f->io = 1;
+    pthread_mutex_unlock(&cache->lock);
+    YDB_Error err = cache->read(cache->ctx, offset, f->data, cache->frame_size);
+    pthread_mutex_lock(&cache->lock);
+    f->io = 0;
+    pthread_cond_broadcast(&cache->io_done);
+    if (err) {
+      __ydb_cache_hash_remove(cache, idx);
+      f->valid = 0;
+      f->pin_count = 0;
+      return err;
+    }
+  }
+
+  *frame = f->data;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_cache_pin(YDB_PageCache *cache, YDB_Offset offset, char **frame) {
+  THROW_IF_NULL(cache, YDB_ERR_CACHE_NOT_INITIALIZED);
+  pthread_mutex_lock(&cache->lock);
+  YDB_Error err = __ydb_cache_pin(cache, offset, 1, frame);
+  pthread_mutex_unlock(&cache->lock);
+  return err;
+}
+
+YDB_Error ydb_cache_pin_new(YDB_PageCache *cache, YDB_Offset offset, char **frame) {
+  THROW_IF_NULL(cache, YDB_ERR_CACHE_NOT_INITIALIZED);
+  pthread_mutex_lock(&cache->lock);
+  YDB_Error err = __ydb_cache_pin(cache, offset, 0, frame);
+  pthread_mutex_unlock(&cache->lock);
+  return err;
+}
+
+void ydb_cache_unpin(YDB_PageCache *cache, YDB_Offset offset) {
+  if (!cache) return;
+  pthread_mutex_lock(&cache->lock);
+  int32_t idx = __ydb_cache_find(cache, offset);
+  if (idx != -1 && cache->frames[idx].pin_count) {
+    cache->frames[idx].pin_count--;
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void ydb_cache_mark_dirty(YDB_PageCache *cache, YDB_Offset offset) {
+  if (!cache) return;
+  pthread_mutex_lock(&cache->lock);
+  int32_t idx = __ydb_cache_find(cache, offset);
+  if (idx != -1) {
+    cache->frames[idx].dirty = 1;
+    cache->frames[idx].held = cache->no_steal;
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void ydb_cache_set_no_steal(YDB_PageCache *cache, int enabled) {
+  if (!cache) return;
+  pthread_mutex_lock(&cache->lock);
+  cache->no_steal = enabled != 0;
+  pthread_mutex_unlock(&cache->lock);
+}
+
+// Calls `visit` for every held frame, releasing it if `release` is set.
+static YDB_Error __ydb_cache_held_visit(YDB_PageCache *cache, YDB_CacheVisitFn visit, void *ctx, int release) {
+  THROW_IF_NULL(cache, YDB_ERR_CACHE_NOT_INITIALIZED);
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  pthread_mutex_lock(&cache->lock);
+  for (size_t i = 0; i < cache->capacity; i++) {
+    __YDB_CacheFrame *f = &cache->frames[i];
+    if (!f->held) continue;
+
+    if (visit) {
+      err = visit(ctx, f->offset, f->data, cache->frame_size);
+      if (err) break;
+    }
+    if (release) f->held = 0;
+  }
+  pthread_mutex_unlock(&cache->lock);
+  return err;
+}
+
+YDB_Error ydb_cache_visit_held(YDB_PageCache *cache, YDB_CacheVisitFn visit, void *ctx) {
+  return __ydb_cache_held_visit(cache, visit, ctx, 0);
+}
+
+YDB_Error ydb_cache_release_held(YDB_PageCache *cache, YDB_CacheVisitFn visit, void *ctx) {
+  return __ydb_cache_held_visit(cache, visit, ctx, 1);
+}
+
+YDB_Error ydb_cache_flush(YDB_PageCache *cache) {
+  THROW_IF_NULL(cache, YDB_ERR_CACHE_NOT_INITIALIZED);
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  pthread_mutex_lock(&cache->lock);
+  for (size_t i = 0; i < cache->capacity; i++) {
+    __YDB_CacheFrame *f = &cache->frames[i];
+    __ydb_cache_wait_io(cache, f);
+    if (!f->valid || !f->dirty) continue;
+
+    err = cache->write(cache->ctx, f->offset, f->data, cache->frame_size);
+    if (err) break;
+    f->dirty = 0;
+    f->held = 0;
+    cache->stats.writebacks++;
+  }
+  pthread_mutex_unlock(&cache->lock);
+  return err;
+}
+
+void ydb_cache_discard_held(YDB_PageCache *cache) {
+  if (!cache) return;
+  pthread_mutex_lock(&cache->lock);
+  for (size_t i = 0; i < cache->capacity; i++) {
+    __YDB_CacheFrame *f = &cache->frames[i];
+    if (!f->held) continue;
+
+    f->held = 0;
+    if (f->pin_count) continue;
+    __ydb_cache_hash_remove(cache, (int32_t) i);
+    f->valid = 0;
+    f->dirty = 0;
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void ydb_cache_discard(YDB_PageCache *cache, YDB_Offset offset) {
+  if (!cache) return;
+  pthread_mutex_lock(&cache->lock);
+  for (size_t i = 0; i < cache->capacity; i++) {
+    __YDB_CacheFrame *f = &cache->frames[i];
+    __ydb_cache_wait_io(cache, f);
+    if (!f->valid || f->offset < offset || f->pin_count) continue;
+
+    __ydb_cache_hash_remove(cache, (int32_t) i);
+    f->valid = 0;
+    f->dirty = 0;
+    f->held = 0;
+  }
+  pthread_mutex_unlock(&cache->lock);
+}
+
+void ydb_cache_stats_get(const YDB_PageCache *cache, YDB_CacheStats *stats) {
+  if (!cache || !stats) return;
+  // The lock is not a part of the cache state
+  pthread_mutex_t *lock = (pthread_mutex_t *) &cache->lock;
+  pthread_mutex_lock(lock);
+  *stats = cache->stats;
+  pthread_mutex_unlock(lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,261 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/pax.h>
+
+static uint64_t __ydb_pax_align(uint64_t offset) {
+  return (offset + YDB_PAX_MINIPAGE_ALIGN - 1) / YDB_PAX_MINIPAGE_ALIGN * YDB_PAX_MINIPAGE_ALIGN;
+}
+
+static uint32_t __ydb_pax_load32(const void *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return FROM_LE(v);
+}
+
+static void __ydb_pax_store32(void *p, uint64_t value) {
+  uint32_t v = TO_LE((uint32_t) value);
+  memcpy(p, &v, sizeof(v));
+}
+
+// Lays out minipages of `count` rows. `var_sizes` holds the total value size of every variable-width column.
+// Offsets of values and null bitmaps go to `values` and `nulls` if they are not NULL. Returns image size.
+static uint64_t __ydb_pax_layout(const YDB_Schema *schema, uint64_t count, const uint64_t *var_sizes,
+                                 uint64_t *values, uint64_t *nulls) {
+  const size_t column_count = ydb_schema_column_count(schema);
+  uint64_t size = YDB_pax_directory_offset + (uint64_t) column_count * YDB_pax_entry_size;
+  for (size_t i = 0; i < column_count; i++) {
+    const YDB_Column *c = ydb_schema_column(schema, i);
+    if (c->flags & YDB_COLUMN_FLAG_NULLABLE) {
+      size = __ydb_pax_align(size);
+      if (nulls) nulls[i] = size;
+      size += (count + 7) / 8;
+    } else if (nulls) {
+      nulls[i] = 0;
+    }
+
+    size = __ydb_pax_align(size);
+    if (values) values[i] = size;
+    if (c->type == YDB_COLUMN_VARBYTES) {
+      size += count * YDB_SCHEMA_END_OFFSET_SIZE + var_sizes[i];
+    } else {
+      size += count * c->width;
+    }
+  }
+  return size;
+}
+
+// Adds variable-width value sizes of a row to `var_sizes`, or subtracts them if `sign` is negative.
+static void __ydb_pax_add_row(const YDB_Schema *schema, const void *row, YDB_PageSize size, uint64_t *var_sizes,
+                              int sign) {
+  const size_t column_count = ydb_schema_column_count(schema);
+  for (size_t i = 0; i < column_count; i++) {
+    if (ydb_schema_column(schema, i)->type != YDB_COLUMN_VARBYTES) continue;
+    const void *data;
+    YDB_PageSize data_size = 0;
+    if (ydb_row_field(schema, row, size, i, &data, &data_size)) continue;
+    if (sign < 0) {
+      var_sizes[i] -= data_size;
+    } else {
+      var_sizes[i] += data_size;
+    }
+  }
+}
+
+size_t ydb_pax_size(const YDB_Schema *schema, const void *const *rows, const YDB_PageSize *sizes, size_t count) {
+  if (!schema) return 0;
+  uint64_t *var_sizes = calloc(ydb_schema_column_count(schema) + 1, sizeof(uint64_t));
+  for (size_t r = 0; r < count; r++) {
+    __ydb_pax_add_row(schema, rows[r], sizes[r], var_sizes, 1);
+  }
+  const uint64_t size = __ydb_pax_layout(schema, count, var_sizes, NULL, NULL);
+  free(var_sizes);
+  return (size_t) size;
+}
+
+YDB_Error ydb_pax_write(const YDB_Schema *schema, const void *const *rows, const YDB_PageSize *sizes, size_t count,
+                        void *dst, YDB_PageSize capacity, size_t *written) {
+  THROW_IF_NULL(schema && ydb_schema_column_count(schema), YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(rows || !count, YDB_ERR_ROW_SCHEMA_MISMATCH);
+  THROW_IF_NULL(sizes || !count, YDB_ERR_ROW_SCHEMA_MISMATCH);
+  THROW_IF_NULL(dst && written, YDB_ERR_WRITE_TO_NULLPTR);
+
+  const size_t column_count = ydb_schema_column_count(schema);
+  uint64_t *var_sizes = calloc(column_count * 3, sizeof(uint64_t));
+  uint64_t *values = var_sizes + column_count;
+  uint64_t *nulls = values + column_count;
+
+  // Rows are taken one by one while the image still fits
+  size_t n = 0;
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (__ydb_pax_layout(schema, 0, var_sizes, NULL, NULL) > capacity) {
+    err = YDB_ERR_PAGE_NO_MORE_MEM;
+  }
+  for (; n < count && n < YDB_TABLE_PAGE_MAX_ROW_COUNT && !err; n++) {
+    err = ydb_row_check(schema, rows[n], sizes[n]);
+    if (err) break;
+    __ydb_pax_add_row(schema, rows[n], sizes[n], var_sizes, 1);
+    if (__ydb_pax_layout(schema, n + 1, var_sizes, NULL, NULL) > capacity) {
+      __ydb_pax_add_row(schema, rows[n], sizes[n], var_sizes, -1);
+      break;
+    }
+  }
+  if (!err && count && !n) err = YDB_ERR_PAGE_NO_MORE_MEM;
+  if (err) {
+    free(var_sizes);
+    return err;
+  }
+
+  const uint64_t size = __ydb_pax_layout(schema, n, var_sizes, values, nulls);
+  char *p = dst;
+  memset(p, 0, size);
+  uint16_t column_count_le = TO_LE((uint16_t) column_count);
+  memcpy(p + YDB_pax_column_count_offset, &column_count_le, sizeof(column_count_le));
+
+  for (size_t i = 0; i < column_count; i++) {
+    const YDB_Column *c = ydb_schema_column(schema, i);
+    char *entry = p + YDB_pax_directory_offset + i * YDB_pax_entry_size;
+    __ydb_pax_store32(entry + YDB_pax_values_offset_offset, values[i]);
+    __ydb_pax_store32(entry + YDB_pax_nulls_offset_offset, nulls[i]);
+
+    const int variable = c->type == YDB_COLUMN_VARBYTES;
+    char *ends = p + values[i];
+    char *out = variable ? ends + n * YDB_SCHEMA_END_OFFSET_SIZE : p + values[i];
+    uint64_t end = 0;
+    for (size_t r = 0; r < n; r++) {
+      if (nulls[i] && ydb_row_is_null(schema, rows[r], i)) {
+        p[nulls[i] + r / 8] |= (char) (1 << (r % 8));
+      }
+      if (variable) {
+        const void *data;
+        YDB_PageSize data_size;
+        ydb_row_field(schema, rows[r], sizes[r], i, &data, &data_size);
+        if (data) memcpy(out + end, data, data_size);
+        end += data_size;
+        __ydb_pax_store32(ends + r * YDB_SCHEMA_END_OFFSET_SIZE, end);
+      } else {
+        // Fields are little-endian already, and zero-filled if null
+        memcpy(out + r * c->width, (const char *) rows[r] + c->offset, c->width);
+      }
+    }
+  }
+
+  free(var_sizes);
+  *written = n;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_pax_build(YDB_TablePage *page, const YDB_Schema *schema, const void *const *rows,
+                             const YDB_PageSize *sizes, size_t count, size_t *written) {
+  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(!ydb_page_is_view(page), YDB_ERR_PAGE_READ_ONLY);
+  THROW_IF_NULL(written, YDB_ERR_WRITE_TO_NULLPTR);
+
+  // Built aside, so the page is left as it was on failure
+  const YDB_PageSize size = ydb_page_size_get(page);
+  char *image = calloc(1, size);
+  size_t n;
+  YDB_Error err = ydb_pax_write(schema, rows, sizes, count, image, size, &n);
+  if (!err) {
+    ydb_page_data_seek(page, 0);
+    err = ydb_page_data_write(page, image, size);
+  }
+  free(image);
+  if (err) return err;
+
+  ydb_page_data_seek(page, 0);
+  ydb_page_flags_set(page, YDB_TABLE_PAGE_FLAG_PAX);
+  ydb_page_row_count_set(page, (YDB_PageSize) n);
+  *written = n;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_pax_column(const void *data, YDB_PageSize size, YDB_PageSize row_count, const YDB_Schema *schema,
+                         size_t column, YDB_PaxColumn *minipage) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(minipage, YDB_ERR_WRITE_TO_NULLPTR);
+  const YDB_Column *c = ydb_schema_column(schema, column);
+  THROW_IF_NULL(c, YDB_ERR_COLUMN_NOT_EXIST);
+
+  const size_t column_count = ydb_schema_column_count(schema);
+  const char *p = data;
+  THROW_IF_NULL(p && size >= YDB_pax_directory_offset + column_count * YDB_pax_entry_size,
+                YDB_ERR_ROW_SCHEMA_MISMATCH);
+  uint16_t stored_count;
+  memcpy(&stored_count, p + YDB_pax_column_count_offset, sizeof(stored_count));
+  REASSIGN_FROM_LE(stored_count);
+  THROW_IF_NULL(stored_count == column_count, YDB_ERR_ROW_SCHEMA_MISMATCH);
+
+  const char *entry = p + YDB_pax_directory_offset + column * YDB_pax_entry_size;
+  const uint64_t values = __ydb_pax_load32(entry + YDB_pax_values_offset_offset);
+  const uint64_t nulls = __ydb_pax_load32(entry + YDB_pax_nulls_offset_offset);
+
+  memset(minipage, 0, sizeof(YDB_PaxColumn));
+  minipage->count = row_count;
+  if (c->flags & YDB_COLUMN_FLAG_NULLABLE) {
+    THROW_IF_NULL(nulls && nulls + (row_count + 7) / 8 <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    minipage->nulls = (const uint8_t *) p + nulls;
+  }
+
+  if (c->type != YDB_COLUMN_VARBYTES) {
+    THROW_IF_NULL(values + (uint64_t) row_count * c->width <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    minipage->values = p + values;
+    minipage->width = c->width;
+    return YDB_ERR_SUCCESS;
+  }
+
+  // End offsets are checked once here, so values are read without bound checks later
+  const uint64_t start = values + (uint64_t) row_count * YDB_SCHEMA_END_OFFSET_SIZE;
+  THROW_IF_NULL(start <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+  uint64_t prev = 0;
+  for (YDB_PageSize r = 0; r < row_count; r++) {
+    const uint64_t end = __ydb_pax_load32(p + values + (uint64_t) r * YDB_SCHEMA_END_OFFSET_SIZE);
+    THROW_IF_NULL(end >= prev && start + end <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    prev = end;
+  }
+  minipage->ends = p + values;
+  minipage->values = p + start;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_pax_column(YDB_TablePage *page, const YDB_Schema *schema, size_t column, YDB_PaxColumn *minipage) {
+  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(ydb_page_flags_get(page) & YDB_TABLE_PAGE_FLAG_PAX, YDB_ERR_PAGE_NOT_PAX);
+  return ydb_pax_column(ydb_page_data_ptr(page), ydb_page_size_get(page), ydb_page_row_count_get(page), schema,
+                        column, minipage);
+}
+
+int ydb_pax_is_null(const YDB_PaxColumn *minipage, YDB_PageSize row) {
+  if (!minipage->nulls) return 0;
+  return (minipage->nulls[row / 8] >> (row % 8)) & 1;
+}
+
+void ydb_pax_value(const YDB_PaxColumn *minipage, YDB_PageSize row, const void **data, YDB_PageSize *size) {
+  if (ydb_pax_is_null(minipage, row)) {
+    *data = NULL;
+    if (size) *size = 0;
+    return;
+  }
+
+  const char *values = minipage->values;
+  if (!minipage->ends) {
+    *data = values + (size_t) row * minipage->width;
+    if (size) *size = minipage->width;
+    return;
+  }
+
+  const char *ends = minipage->ends;
+  const uint32_t start = row ? __ydb_pax_load32(ends + (size_t) (row - 1) * YDB_SCHEMA_END_OFFSET_SIZE) : 0;
+  const uint32_t end = __ydb_pax_load32(ends + (size_t) row * YDB_SCHEMA_END_OFFSET_SIZE);
+  *data = values + start;
+  if (size) *size = end - start;
+}
+
+#ifdef __cplusplus
+}
+#endif
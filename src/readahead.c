@@ -0,0 +1,210 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/readahead.h>
+
+/**
+ * @struct __YDB_ReadAheadSlot
+ * @brief A staging slot for one page.
+ */
+typedef struct __YDB_ReadAheadSlot {
+  YDB_Offset offset; /**< Page offset. */
+  char *data; /**< Page data. */
+  uint8_t ready; /**< Whether the page is read. */
+  uint8_t discard; /**< Whether the page must not be used (stale or not needed anymore). */
+} __YDB_ReadAheadSlot;
+
+/**
+ * @struct __YDB_ReadAhead
+ * @brief A struct that defines read-ahead.
+ *
+ * Slots form a FIFO ring in chain order. Only the read-ahead thread adds slots and it reads one page at a time,
+ * so the only slot not ready is always the last one.
+ */
+struct __YDB_ReadAhead {
+  YDB_Storage *storage; /**< Storage to read from. */
+  size_t page_size; /**< Page size. */
+  YDB_ReadAheadNextFn next; /**< Next page offset callback. */
+  void *ctx; /**< Callback context. */
+
+  __YDB_ReadAheadSlot *slots; /**< Staging slots. */
+  char *data; /**< Memory for all the slots. */
+  size_t depth; /**< The amount of slots. */
+  size_t head; /**< The first slot in FIFO. */
+  size_t count; /**< The amount of slots in FIFO. */
+  YDB_Offset cursor; /**< The page to be read next, 0 if none. */
+
+  pthread_t thread; /**< Read-ahead thread. */
+  pthread_mutex_t lock; /**< Protects everything above except the constants. */
+  pthread_cond_t cond; /**< Signalled on any FIFO or cursor change. */
+  uint8_t stop; /**< Whether the thread should exit. */
+};
+
+static __YDB_ReadAheadSlot *__ydb_ra_slot(YDB_ReadAhead *ra, size_t i) {
+  return &ra->slots[(ra->head + i) % ra->depth];
+}
+
+// Drops `n` slots from FIFO head.
+static void __ydb_ra_drop(YDB_ReadAhead *ra, size_t n) {
+  ra->head = (ra->head + n) % ra->depth;
+  ra->count -= n;
+}
+
+// Returns FIFO position of a usable slot with the page, or -1.
+static ptrdiff_t __ydb_ra_find(YDB_ReadAhead *ra, YDB_Offset offset) {
+  for (size_t i = 0; i < ra->count; i++) {
+    __YDB_ReadAheadSlot *slot = __ydb_ra_slot(ra, i);
+    if (slot->offset == offset && !slot->discard) return (ptrdiff_t) i;
+  }
+  return -1;
+}
+
+static void *__ydb_ra_thread(void *arg) {
+  YDB_ReadAhead *ra = arg;
+
+  pthread_mutex_lock(&ra->lock);
+  while (!ra->stop) {
+    if (ra->count == ra->depth || !ra->cursor) {
+      pthread_cond_wait(&ra->cond, &ra->lock);
+      continue;
+    }
+
+    __YDB_ReadAheadSlot *slot = __ydb_ra_slot(ra, ra->count++);
+    slot->offset = ra->cursor;
+    slot->ready = 0;
+    slot->discard = 0;
+
+    pthread_mutex_unlock(&ra->lock);
+    YDB_Error err = ydb_storage_read_at(ra->storage, slot->offset, slot->data, ra->page_size);
+    pthread_mutex_lock(&ra->lock);
+
+    if (err || slot->discard) {
+      // The slot is the last one, so it's just cut off. The cursor was moved by whoever discarded it.
+      ra->count--;
+      if (err && !slot->discard) ra->cursor = 0;
+    } else {
+      slot->ready = 1;
+      ra->cursor = ra->next(ra->ctx, slot->data);
+    }
+    pthread_cond_broadcast(&ra->cond);
+  }
+  pthread_mutex_unlock(&ra->lock);
+  return NULL;
+}
+
+YDB_ReadAhead *ydb_readahead_start(YDB_Storage *storage, size_t page_size, size_t depth,
+                                   YDB_ReadAheadNextFn next, void *ctx) {
+  THROW_IF_NULL(storage && next, NULL);
+  THROW_IF_NULL(page_size && depth, NULL);
+
+  YDB_ReadAhead *ra = calloc(1, sizeof(YDB_ReadAhead));
+  ra->storage = storage;
+  ra->page_size = page_size;
+  ra->next = next;
+  ra->ctx = ctx;
+  ra->depth = depth;
+
+  ra->slots = calloc(depth, sizeof(__YDB_ReadAheadSlot));
+  size_t data_size = (depth * page_size + YDB_CACHE_LINE_SIZE - 1) / YDB_CACHE_LINE_SIZE * YDB_CACHE_LINE_SIZE;
+  ra->data = aligned_alloc(YDB_CACHE_LINE_SIZE, data_size);
+  for (size_t i = 0; i < depth; i++) {
+    ra->slots[i].data = ra->data + i * page_size;
+  }
+
+  pthread_mutex_init(&ra->lock, NULL);
+  pthread_cond_init(&ra->cond, NULL);
+  if (pthread_create(&ra->thread, NULL, __ydb_ra_thread, ra)) {
+    pthread_cond_destroy(&ra->cond);
+    pthread_mutex_destroy(&ra->lock);
+    free(ra->data);
+    free(ra->slots);
+    free(ra);
+    return NULL;
+  }
+  return ra;
+}
+
+void ydb_readahead_stop(YDB_ReadAhead *ra) {
+  if (!ra) return;
+
+  pthread_mutex_lock(&ra->lock);
+  ra->stop = 1;
+  pthread_cond_broadcast(&ra->cond);
+  pthread_mutex_unlock(&ra->lock);
+  pthread_join(ra->thread, NULL);
+
+  pthread_cond_destroy(&ra->cond);
+  pthread_mutex_destroy(&ra->lock);
+  free(ra->data);
+  free(ra->slots);
+  free(ra);
+}
+
+void ydb_readahead_hint(YDB_ReadAhead *ra, YDB_Offset offset) {
+  if (!ra) return;
+
+  pthread_mutex_lock(&ra->lock);
+  ptrdiff_t pos = offset ? __ydb_ra_find(ra, offset) : -1;
+  if (pos != -1) {
+    // The scan goes as expected
+    __ydb_ra_drop(ra, (size_t) pos);
+  } else {
+    // The scan has jumped: drop everything ready and restart from the new position
+    size_t ready = 0;
+    while (ready < ra->count && __ydb_ra_slot(ra, ready)->ready) ready++;
+    __ydb_ra_drop(ra, ready);
+    if (ra->count) __ydb_ra_slot(ra, 0)->discard = 1;
+    ra->cursor = offset;
+  }
+  pthread_cond_broadcast(&ra->cond);
+  pthread_mutex_unlock(&ra->lock);
+}
+
+int ydb_readahead_take(YDB_ReadAhead *ra, YDB_Offset offset, void *dst) {
+  THROW_IF_NULL(ra, 0);
+
+  pthread_mutex_lock(&ra->lock);
+  for (;;) {
+    ptrdiff_t pos = __ydb_ra_find(ra, offset);
+    if (pos == -1) {
+      pthread_mutex_unlock(&ra->lock);
+      return 0;
+    }
+
+    __YDB_ReadAheadSlot *slot = __ydb_ra_slot(ra, (size_t) pos);
+    if (!slot->ready) {
+      // Waiting for the read in progress is still cheaper than issuing another one
+      pthread_cond_wait(&ra->cond, &ra->lock);
+      continue;
+    }
+
+    memcpy(dst, slot->data, ra->page_size);
+    __ydb_ra_drop(ra, (size_t) pos + 1);
+    pthread_cond_broadcast(&ra->cond);
+    pthread_mutex_unlock(&ra->lock);
+    return 1;
+  }
+}
+
+void ydb_readahead_invalidate(YDB_ReadAhead *ra, YDB_Offset offset, size_t size) {
+  if (!ra) return;
+
+  pthread_mutex_lock(&ra->lock);
+  for (size_t i = 0; i < ra->count; i++) {
+    __YDB_ReadAheadSlot *slot = __ydb_ra_slot(ra, i);
+    if (slot->offset < offset + size && offset < slot->offset + ra->page_size) {
+      slot->discard = 1;
+    }
+  }
+  pthread_mutex_unlock(&ra->lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,240 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <YeltsinDB/checksum.h>
+#include <YeltsinDB/compress.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/scan.h>
+
+/**
+ * @struct __YDB_ScanRange
+ * @brief A range of page indices owned by a worker.
+ *
+ * The owner takes pages from the front, thieves take the back half.
+ */
+typedef struct __YDB_ScanRange {
+  pthread_mutex_t lock; /**< Protects the bounds. */
+  size_t begin; /**< The first page left. */
+  size_t end; /**< Past the last page left. */
+} __YDB_ScanRange;
+
+/**
+ * @struct __YDB_Scan
+ * @brief A struct that defines a parallel scan shared by its workers.
+ */
+typedef struct __YDB_Scan {
+  YDB_Storage *storage; /**< Storage to read from. */
+  YDB_PageLayout layout; /**< Page layout of the table. */
+  const YDB_Offset *pages; /**< Page offsets. */
+  YDB_ScanFn fn; /**< Callback. */
+  void *ctx; /**< Callback context. */
+
+  __YDB_ScanRange *ranges; /**< Ranges of the workers. */
+  size_t nthreads; /**< The amount of workers. */
+
+  pthread_mutex_t lock; /**< Protects `err`. */
+  YDB_Error err; /**< The first error met, the scan stops on it. */
+} __YDB_Scan;
+
+/**
+ * @struct __YDB_ScanWorker
+ * @brief Worker thread state.
+ */
+typedef struct __YDB_ScanWorker {
+  __YDB_Scan *scan; /**< The scan. */
+  size_t id; /**< Worker index. */
+  pthread_t thread; /**< Worker thread. Unused for worker 0. */
+} __YDB_ScanWorker;
+
+static YDB_Error __ydb_scan_error(__YDB_Scan *scan) {
+  pthread_mutex_lock(&scan->lock);
+  YDB_Error err = scan->err;
+  pthread_mutex_unlock(&scan->lock);
+  return err;
+}
+
+static void __ydb_scan_fail(__YDB_Scan *scan, YDB_Error err) {
+  pthread_mutex_lock(&scan->lock);
+  if (!scan->err) scan->err = err;
+  pthread_mutex_unlock(&scan->lock);
+}
+
+// Takes a page from the front of the range. Returns 0 if the range is empty.
+static int __ydb_scan_take(__YDB_ScanRange *r, size_t *index, size_t *next) {
+  pthread_mutex_lock(&r->lock);
+  int ok = r->begin < r->end;
+  if (ok) {
+    *index = r->begin++;
+    *next = r->begin < r->end ? r->begin : (size_t) -1;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return ok;
+}
+
+// Moves the back half of the largest other range to the worker's range. Returns 0 if there is nothing left.
+static int __ydb_scan_steal(__YDB_Scan *scan, size_t id) {
+  for (;;) {
+    size_t victim = id;
+    size_t most = 0;
+    for (size_t k = 1; k < scan->nthreads; k++) {
+      size_t i = (id + k) % scan->nthreads;
+      __YDB_ScanRange *r = &scan->ranges[i];
+      pthread_mutex_lock(&r->lock);
+      size_t left = r->end - r->begin;
+      pthread_mutex_unlock(&r->lock);
+      if (left > most) {
+        most = left;
+        victim = i;
+      }
+    }
+    if (victim == id) return 0;
+
+    // The range could have shrunk meanwhile, so check it again
+    __YDB_ScanRange *r = &scan->ranges[victim];
+    pthread_mutex_lock(&r->lock);
+    size_t left = r->end - r->begin;
+    size_t end = r->end;
+    r->end -= (left + 1) / 2;
+    size_t begin = r->end;
+    pthread_mutex_unlock(&r->lock);
+    if (begin == end) continue;
+
+    __YDB_ScanRange *own = &scan->ranges[id];
+    pthread_mutex_lock(&own->lock);
+    own->begin = begin;
+    own->end = end;
+    pthread_mutex_unlock(&own->lock);
+    return 1;
+  }
+}
+
+static void *__ydb_scan_thread(void *arg) {
+  __YDB_ScanWorker *w = arg;
+  __YDB_Scan *scan = w->scan;
+  __YDB_ScanRange *own = &scan->ranges[w->id];
+
+  // Mappable storage is read in place, everything else is read to worker's own buffer
+  int mapped = ydb_storage_can_map(scan->storage);
+  const size_t page_size = scan->layout.page_size;
+  char *buf = mapped ? NULL : aligned_alloc(YDB_CACHE_LINE_SIZE, page_size);
+  YDB_TablePage *view = ydb_page_view_alloc();
+
+  for (;;) {
+    size_t index;
+    size_t next;
+    if (!__ydb_scan_take(own, &index, &next)) {
+      if (__ydb_scan_steal(scan, w->id)) continue;
+      break;
+    }
+    if (__ydb_scan_error(scan)) break;
+
+    YDB_Offset offset = scan->pages[index];
+    const char *p_data = buf;
+    YDB_Error err = YDB_ERR_SUCCESS;
+    if (mapped) {
+      p_data = ydb_storage_map(scan->storage, offset, page_size);
+      if (!p_data) err = YDB_ERR_TABLE_DATA_CORRUPTED;
+    } else {
+      if (next != (size_t) -1) {
+        ydb_storage_prefetch(scan->storage, scan->pages[next], page_size);
+      }
+      err = ydb_storage_read_at(scan->storage, offset, buf, page_size);
+    }
+    if (!err) {
+      size_t size = ydb_page_image_size(&scan->layout, p_data);
+      err = size ? ydb_page_checksum_verify(&scan->layout, p_data, size) : YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    if (!err && (p_data[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_COMPRESSED)) {
+      // Compressed pages are unpacked to the buffer, even mapped ones
+      if (!buf) buf = aligned_alloc(YDB_CACHE_LINE_SIZE, page_size);
+      if (p_data != buf) memcpy(buf, p_data, page_size);
+      p_data = buf;
+      err = ydb_page_unpack(&scan->layout, buf);
+    }
+    if (err) {
+      __ydb_scan_fail(scan, err);
+      break;
+    }
+
+    uint16_t row_count;
+    memcpy(&row_count, p_data + YDB_v1_page_row_count_offset, sizeof(row_count));
+    REASSIGN_FROM_LE(row_count);
+    ydb_page_view_set(view, p_data + scan->layout.data_offset, page_size - scan->layout.data_offset,
+                      (YDB_Flags) p_data[YDB_v1_page_flags_offset], row_count, NULL, NULL);
+
+    err = scan->fn(scan->ctx, w->id, index, view);
+    ydb_page_view_reset(view);
+    if (err) {
+      __ydb_scan_fail(scan, err);
+      break;
+    }
+  }
+
+  ydb_page_free(view);
+  free(buf);
+  return NULL;
+}
+
+YDB_Error ydb_scan_pages(YDB_Storage *storage, const YDB_PageLayout *layout, const YDB_Offset *pages, size_t count,
+                         size_t nthreads, YDB_ScanFn fn, void *ctx) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(layout, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(fn, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(pages || !count, YDB_ERR_WRITE_TO_NULLPTR);
+  if (!count) return YDB_ERR_SUCCESS;
+
+  if (!nthreads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = cpus > 0 ? (size_t) cpus : 1;
+  }
+  if (nthreads > count) nthreads = count;
+
+  __YDB_Scan scan = {
+      .storage = storage,
+      .layout = *layout,
+      .pages = pages,
+      .fn = fn,
+      .ctx = ctx,
+      .nthreads = nthreads,
+      .err = YDB_ERR_SUCCESS,
+  };
+  pthread_mutex_init(&scan.lock, NULL);
+  scan.ranges = calloc(nthreads, sizeof(__YDB_ScanRange));
+  __YDB_ScanWorker *workers = calloc(nthreads, sizeof(__YDB_ScanWorker));
+
+  for (size_t i = 0; i < nthreads; i++) {
+    pthread_mutex_init(&scan.ranges[i].lock, NULL);
+    scan.ranges[i].begin = count * i / nthreads;
+    scan.ranges[i].end = count * (i + 1) / nthreads;
+    workers[i].scan = &scan;
+    workers[i].id = i;
+  }
+
+  // If a thread can't be created, its range is left to be stolen by the others
+  size_t started = 1;
+  for (; started < nthreads; started++) {
+    if (pthread_create(&workers[started].thread, NULL, __ydb_scan_thread, &workers[started])) break;
+  }
+  __ydb_scan_thread(&workers[0]);
+  for (size_t i = 1; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < nthreads; i++) {
+    pthread_mutex_destroy(&scan.ranges[i].lock);
+  }
+  pthread_mutex_destroy(&scan.lock);
+  free(workers);
+  free(scan.ranges);
+  return scan.err;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,427 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/schema.h>
+
+// A variable-width field that starts right after the fixed part of a row
+#define __YDB_SCHEMA_FIRST (UINT32_MAX)
+
+/**
+ * @struct __YDB_Schema
+ * @brief A struct that defines a row schema and its row layout.
+ */
+struct __YDB_Schema {
+  YDB_Column *columns; /**< Columns, with names owned by the schema. */
+  YDB_PageSize *starts; /**< Offsets of the previous end offset for variable-width columns,
+                             #__YDB_SCHEMA_FIRST for the first one. */
+  size_t count; /**< The amount of columns. */
+  size_t capacity; /**< Capacity of `columns` and `starts`. */
+  YDB_PageSize bitmap_size; /**< Null bitmap size. */
+  YDB_PageSize fixed_size; /**< Null bitmap and fixed-width fields size. */
+};
+
+// Value width of a column type, 0 for byte columns.
+static YDB_PageSize __ydb_column_type_width(YDB_ColumnType type) {
+  switch (type) {
+    case YDB_COLUMN_INT8:
+    case YDB_COLUMN_UINT8:
+      return 1;
+    case YDB_COLUMN_INT16:
+    case YDB_COLUMN_UINT16:
+      return 2;
+    case YDB_COLUMN_INT32:
+    case YDB_COLUMN_UINT32:
+    case YDB_COLUMN_FLOAT32:
+      return 4;
+    case YDB_COLUMN_INT64:
+    case YDB_COLUMN_UINT64:
+    case YDB_COLUMN_FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+static int __ydb_column_is_variable(const YDB_Column *column) {
+  return column->type == YDB_COLUMN_VARBYTES;
+}
+
+// The size a column takes in the fixed part of a row.
+static YDB_PageSize __ydb_column_fixed_width(const YDB_Column *column) {
+  return __ydb_column_is_variable(column) ? YDB_SCHEMA_END_OFFSET_SIZE : column->width;
+}
+
+// Computes field offsets. Every nullable column adds a bit to the bitmap, so all the offsets could change.
+static void __ydb_schema_layout(YDB_Schema *schema) {
+  size_t nullable = 0;
+  for (size_t i = 0; i < schema->count; i++) {
+    if (schema->columns[i].flags & YDB_COLUMN_FLAG_NULLABLE) {
+      schema->columns[i].null_bit = (YDB_PageSize) nullable++;
+    }
+  }
+  schema->bitmap_size = (YDB_PageSize) ((nullable + 7) / 8);
+
+  YDB_PageSize offset = schema->bitmap_size;
+  YDB_PageSize prev_end = __YDB_SCHEMA_FIRST;
+  for (size_t i = 0; i < schema->count; i++) {
+    YDB_Column *column = &schema->columns[i];
+    column->offset = offset;
+    if (__ydb_column_is_variable(column)) {
+      schema->starts[i] = prev_end;
+      prev_end = offset;
+    }
+    offset += __ydb_column_fixed_width(column);
+  }
+  schema->fixed_size = offset;
+}
+
+// Reads a little-endian unsigned value of `width` bytes.
+static uint64_t __ydb_schema_load(const char *p, YDB_PageSize width) {
+  uint8_t v8;
+  uint16_t v16;
+  uint32_t v32;
+  uint64_t v64;
+  switch (width) {
+    case 1:
+      memcpy(&v8, p, sizeof(v8));
+      return v8;
+    case 2:
+      memcpy(&v16, p, sizeof(v16));
+      return FROM_LE(v16);
+    case 4:
+      memcpy(&v32, p, sizeof(v32));
+      return FROM_LE(v32);
+    default:
+      memcpy(&v64, p, sizeof(v64));
+      return FROM_LE(v64);
+  }
+}
+
+// Writes a value in architecture endian as a little-endian one.
+static void __ydb_schema_store(char *p, const void *value, YDB_PageSize width) {
+  uint16_t v16;
+  uint32_t v32;
+  uint64_t v64;
+  switch (width) {
+    case 2:
+      memcpy(&v16, value, sizeof(v16));
+      v16 = TO_LE(v16);
+      memcpy(p, &v16, sizeof(v16));
+      break;
+    case 4:
+      memcpy(&v32, value, sizeof(v32));
+      v32 = TO_LE(v32);
+      memcpy(p, &v32, sizeof(v32));
+      break;
+    case 8:
+      memcpy(&v64, value, sizeof(v64));
+      v64 = TO_LE(v64);
+      memcpy(p, &v64, sizeof(v64));
+      break;
+    default:
+      memcpy(p, value, width);
+      break;
+  }
+}
+
+// The end offset of a variable-width field.
+static YDB_PageSize __ydb_row_end(const void *row, YDB_PageSize offset) {
+  return (YDB_PageSize) __ydb_schema_load((const char *) row + offset, YDB_SCHEMA_END_OFFSET_SIZE);
+}
+
+// The start offset of a variable-width field: the end of the previous one.
+static YDB_PageSize __ydb_row_start(const YDB_Schema *schema, const void *row, size_t column) {
+  const YDB_PageSize prev_end = schema->starts[column];
+  return prev_end == __YDB_SCHEMA_FIRST ? schema->fixed_size : __ydb_row_end(row, prev_end);
+}
+
+YDB_Schema *ydb_schema_new(void) {
+  return calloc(1, sizeof(YDB_Schema));
+}
+
+void ydb_schema_free(YDB_Schema *schema) {
+  if (!schema) return;
+  for (size_t i = 0; i < schema->count; i++) {
+    free((char *) schema->columns[i].name);
+  }
+  free(schema->columns);
+  free(schema->starts);
+  free(schema);
+}
+
+YDB_Schema *ydb_schema_clone(const YDB_Schema *schema) {
+  YDB_Schema *clone = ydb_schema_new();
+  for (size_t i = 0; i < schema->count; i++) {
+    const YDB_Column *c = &schema->columns[i];
+    ydb_schema_add_column(clone, c->name, c->type, c->width, c->flags);
+  }
+  return clone;
+}
+
+YDB_Error ydb_schema_add_column(YDB_Schema *schema, const char *name, YDB_ColumnType type, YDB_PageSize width,
+                                YDB_Flags flags) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(name, YDB_ERR_SCHEMA_INVALID);
+  const size_t name_size = strlen(name);
+  THROW_IF_NULL(name_size && name_size <= YDB_SCHEMA_NAME_MAX_SIZE, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(schema->count < YDB_SCHEMA_MAX_COLUMNS, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(!(flags & ~(YDB_COLUMN_FLAG_NULLABLE | YDB_COLUMN_FLAG_ZONE_MAP)), YDB_ERR_SCHEMA_INVALID);
+  size_t index;
+  THROW_IF_NULL(ydb_schema_column_find(schema, name, &index) == YDB_ERR_COLUMN_NOT_EXIST, YDB_ERR_SCHEMA_INVALID);
+
+  switch (type) {
+    case YDB_COLUMN_BYTES:
+      THROW_IF_NULL(width, YDB_ERR_SCHEMA_INVALID);
+      THROW_IF_NULL(!(flags & YDB_COLUMN_FLAG_ZONE_MAP), YDB_ERR_SCHEMA_INVALID);
+      break;
+    case YDB_COLUMN_VARBYTES:
+      THROW_IF_NULL(!(flags & YDB_COLUMN_FLAG_ZONE_MAP), YDB_ERR_SCHEMA_INVALID);
+      break;
+    default:
+      width = __ydb_column_type_width(type);
+      THROW_IF_NULL(width, YDB_ERR_SCHEMA_INVALID);
+      break;
+  }
+
+  // The fixed part of a row has to fit the largest page
+  YDB_Column column = {NULL, type, flags, width, 0, 0};
+  const uint64_t fixed_size = (uint64_t) schema->fixed_size + 1 + __ydb_column_fixed_width(&column);
+  THROW_IF_NULL(fixed_size <= YDB_TABLE_PAGE_SIZE_MAX, YDB_ERR_SCHEMA_INVALID);
+
+  if (schema->count == schema->capacity) {
+    schema->capacity = schema->capacity ? schema->capacity * 2 : 8;
+    schema->columns = realloc(schema->columns, schema->capacity * sizeof(YDB_Column));
+    schema->starts = realloc(schema->starts, schema->capacity * sizeof(YDB_PageSize));
+  }
+  column.name = strdup(name);
+  schema->columns[schema->count] = column;
+  schema->count++;
+  __ydb_schema_layout(schema);
+  return YDB_ERR_SUCCESS;
+}
+
+size_t ydb_schema_column_count(const YDB_Schema *schema) {
+  return schema ? schema->count : 0;
+}
+
+const YDB_Column *ydb_schema_column(const YDB_Schema *schema, size_t index) {
+  if (!schema || index >= schema->count) return NULL;
+  return &schema->columns[index];
+}
+
+YDB_Error ydb_schema_column_find(const YDB_Schema *schema, const char *name, size_t *index) {
+  THROW_IF_NULL(schema && name, YDB_ERR_COLUMN_NOT_EXIST);
+  for (size_t i = 0; i < schema->count; i++) {
+    if (strcmp(schema->columns[i].name, name) == 0) {
+      if (index) *index = i;
+      return YDB_ERR_SUCCESS;
+    }
+  }
+  return YDB_ERR_COLUMN_NOT_EXIST;
+}
+
+YDB_PageSize ydb_schema_fixed_size(const YDB_Schema *schema) {
+  return schema ? schema->fixed_size : 0;
+}
+
+YDB_Error ydb_row_encode(const YDB_Schema *schema, const YDB_Value *values, void *row, YDB_PageSize capacity,
+                         YDB_PageSize *size) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(values || !schema->count, YDB_ERR_ROW_SCHEMA_MISMATCH);
+  THROW_IF_NULL(size, YDB_ERR_WRITE_TO_NULLPTR);
+
+  // Values are checked and measured before anything is written
+  uint64_t total = schema->fixed_size;
+  for (size_t i = 0; i < schema->count; i++) {
+    const YDB_Column *column = &schema->columns[i];
+    if (!values[i].data) {
+      THROW_IF_NULL(column->flags & YDB_COLUMN_FLAG_NULLABLE, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    } else if (__ydb_column_is_variable(column)) {
+      THROW_IF_NULL(!column->width || values[i].size <= column->width, YDB_ERR_ROW_SCHEMA_MISMATCH);
+      total += values[i].size;
+    } else {
+      THROW_IF_NULL(values[i].size == column->width, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    }
+  }
+  THROW_IF_NULL(total <= UINT32_MAX, YDB_ERR_ROW_SCHEMA_MISMATCH);
+  *size = (YDB_PageSize) total;
+  THROW_IF_NULL(row && total <= capacity, YDB_ERR_PAGE_NO_MORE_MEM);
+
+  char *p = row;
+  memset(p, 0, schema->bitmap_size);
+  YDB_PageSize end = schema->fixed_size;
+  for (size_t i = 0; i < schema->count; i++) {
+    const YDB_Column *column = &schema->columns[i];
+    const YDB_Value *value = &values[i];
+    if (!value->data) {
+      p[column->null_bit / 8] |= (char) (1 << (column->null_bit % 8));
+    }
+    if (__ydb_column_is_variable(column)) {
+      if (value->data) {
+        memcpy(p + end, value->data, value->size);
+        end += value->size;
+      }
+      __ydb_schema_store(p + column->offset, &end, YDB_SCHEMA_END_OFFSET_SIZE);
+    } else if (value->data) {
+      __ydb_schema_store(p + column->offset, value->data, column->width);
+    } else {
+      memset(p + column->offset, 0, column->width);
+    }
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_row_check(const YDB_Schema *schema, const void *row, YDB_PageSize size) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(row && size >= schema->fixed_size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+
+  YDB_PageSize start = schema->fixed_size;
+  for (size_t i = 0; i < schema->count; i++) {
+    if (!__ydb_column_is_variable(&schema->columns[i])) continue;
+    YDB_PageSize end = __ydb_row_end(row, schema->columns[i].offset);
+    THROW_IF_NULL(end >= start && end <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    start = end;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_row_field(const YDB_Schema *schema, const void *row, YDB_PageSize size, size_t column,
+                        const void **data, YDB_PageSize *data_size) {
+  THROW_IF_NULL(schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(column < schema->count, YDB_ERR_COLUMN_NOT_EXIST);
+  THROW_IF_NULL(data, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(row && size >= schema->fixed_size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+
+  const YDB_Column *c = &schema->columns[column];
+  const char *p = row;
+  YDB_PageSize offset = c->offset;
+  YDB_PageSize width = c->width;
+  if (__ydb_column_is_variable(c)) {
+    offset = __ydb_row_start(schema, row, column);
+    const YDB_PageSize end = __ydb_row_end(row, c->offset);
+    THROW_IF_NULL(offset <= end && end <= size, YDB_ERR_ROW_SCHEMA_MISMATCH);
+    width = end - offset;
+  }
+
+  if (ydb_row_is_null(schema, row, column)) {
+    *data = NULL;
+    width = 0;
+  } else {
+    *data = p + offset;
+  }
+  if (data_size) *data_size = width;
+  return YDB_ERR_SUCCESS;
+}
+
+int ydb_row_is_null(const YDB_Schema *schema, const void *row, size_t column) {
+  const YDB_Column *c = &schema->columns[column];
+  if (!(c->flags & YDB_COLUMN_FLAG_NULLABLE)) return 0;
+  return (((const uint8_t *) row)[c->null_bit / 8] >> (c->null_bit % 8)) & 1;
+}
+
+int64_t ydb_row_get_int(const YDB_Schema *schema, const void *row, size_t column) {
+  if (column >= schema->count) return 0;
+  const YDB_Column *c = &schema->columns[column];
+  const uint64_t v = __ydb_schema_load((const char *) row + c->offset, c->width);
+  switch (c->type) {
+    case YDB_COLUMN_INT8:
+      return (int8_t) v;
+    case YDB_COLUMN_INT16:
+      return (int16_t) v;
+    case YDB_COLUMN_INT32:
+      return (int32_t) v;
+    case YDB_COLUMN_INT64:
+    case YDB_COLUMN_UINT8:
+    case YDB_COLUMN_UINT16:
+    case YDB_COLUMN_UINT32:
+    case YDB_COLUMN_UINT64:
+      return (int64_t) v;
+    default:
+      return 0;
+  }
+}
+
+double ydb_row_get_float(const YDB_Schema *schema, const void *row, size_t column) {
+  if (column >= schema->count) return 0;
+  const YDB_Column *c = &schema->columns[column];
+  const uint64_t v = __ydb_schema_load((const char *) row + c->offset, c->width);
+  if (c->type == YDB_COLUMN_FLOAT32) {
+    uint32_t v32 = (uint32_t) v;
+    float f;
+    memcpy(&f, &v32, sizeof(f));
+    return f;
+  }
+  if (c->type == YDB_COLUMN_FLOAT64) {
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+  }
+  return 0;
+}
+
+size_t ydb_schema_write(const YDB_Schema *schema, void *dst, size_t capacity) {
+  size_t size = 0;
+  for (size_t i = 0; i < schema->count; i++) {
+    size += YDB_schema_column_name_offset + strlen(schema->columns[i].name);
+  }
+  if (!dst || size > capacity) return 0;
+
+  char *p = dst;
+  for (size_t i = 0; i < schema->count; i++) {
+    const YDB_Column *c = &schema->columns[i];
+    const size_t name_size = strlen(c->name);
+    uint32_t width_le = TO_LE((uint32_t) c->width);
+    p[YDB_schema_column_type_offset] = (char) c->type;
+    p[YDB_schema_column_flags_offset] = (char) c->flags;
+    memcpy(p + YDB_schema_column_width_offset, &width_le, sizeof(width_le));
+    p[YDB_schema_column_name_size_offset] = (char) name_size;
+    memcpy(p + YDB_schema_column_name_offset, c->name, name_size);
+    p += YDB_schema_column_name_offset + name_size;
+  }
+  return size;
+}
+
+YDB_Error ydb_schema_read(const void *src, size_t size, size_t column_count, YDB_Schema **schema) {
+  THROW_IF_NULL(schema, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(src || !column_count, YDB_ERR_SCHEMA_INVALID);
+
+  YDB_Schema *result = ydb_schema_new();
+  const uint8_t *p = src;
+  const uint8_t *end = p + size;
+  YDB_Error err = YDB_ERR_SUCCESS;
+  char name[YDB_SCHEMA_NAME_MAX_SIZE + 1];
+  for (size_t i = 0; i < column_count && !err; i++) {
+    if ((size_t) (end - p) < YDB_schema_column_name_offset) {
+      err = YDB_ERR_SCHEMA_INVALID;
+      break;
+    }
+    const size_t name_size = p[YDB_schema_column_name_size_offset];
+    if (name_size > YDB_SCHEMA_NAME_MAX_SIZE || (size_t) (end - p) < YDB_schema_column_name_offset + name_size) {
+      err = YDB_ERR_SCHEMA_INVALID;
+      break;
+    }
+    uint32_t width;
+    memcpy(&width, p + YDB_schema_column_width_offset, sizeof(width));
+    REASSIGN_FROM_LE(width);
+    memcpy(name, p + YDB_schema_column_name_offset, name_size);
+    name[name_size] = '\0';
+    err = ydb_schema_add_column(result, name, (YDB_ColumnType) p[YDB_schema_column_type_offset], width,
+                                p[YDB_schema_column_flags_offset]);
+    p += YDB_schema_column_name_offset + name_size;
+  }
+  if (err) {
+    ydb_schema_free(result);
+    return err;
+  }
+  *schema = result;
+  return YDB_ERR_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+#include <YeltsinDB/stats.h>
+
+uint64_t ydb_stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void ydb_histogram_record(YDB_LatencyHistogram *histogram, uint64_t ns) {
+  // Bucket of the highest set bit
+  size_t bucket = 0;
+  for (uint64_t v = ns >> 1; v && bucket < YDB_STATS_LATENCY_BUCKETS - 1; v >>= 1) {
+    bucket++;
+  }
+  histogram->buckets[bucket]++;
+  histogram->count++;
+  histogram->total_ns += ns;
+  if (ns > histogram->max_ns) histogram->max_ns = ns;
+}
+
+uint64_t ydb_histogram_percentile(const YDB_LatencyHistogram *histogram, double p) {
+  if (!histogram->count) return 0;
+  if (p < 0) p = 0;
+  if (p > 1) p = 1;
+
+  const uint64_t rank = (uint64_t) (p * (double) (histogram->count - 1)) + 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < YDB_STATS_LATENCY_BUCKETS - 1; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      const uint64_t bound = ((uint64_t) 2 << i) - 1;
+      return bound < histogram->max_ns ? bound : histogram->max_ns;
+    }
+  }
+  return histogram->max_ns;
+}
+
+void ydb_stats_add(YDB_Stats *stats, YDB_TraceEvent event, size_t size, uint64_t ns) {
+  stats->events[event]++;
+  switch (event) {
+    case YDB_TRACE_PAGE_READ:
+      stats->bytes_read += size;
+      ydb_histogram_record(&stats->read_latency, ns);
+      break;
+    case YDB_TRACE_PAGE_WRITE:
+      stats->bytes_written += size;
+      ydb_histogram_record(&stats->write_latency, ns);
+      break;
+    case YDB_TRACE_HEADER_WRITE:
+      stats->bytes_written += size;
+      break;
+    case YDB_TRACE_SYNC:
+      ydb_histogram_record(&stats->sync_latency, ns);
+      break;
+    case YDB_TRACE_FLUSH:
+      ydb_histogram_record(&stats->flush_latency, ns);
+      break;
+    case YDB_TRACE_PAGE_SWITCH:
+      ydb_histogram_record(&stats->switch_latency, ns);
+      break;
+    case YDB_TRACE_APPEND:
+      ydb_histogram_record(&stats->append_latency, ns);
+      break;
+    case YDB_TRACE_REPLACE:
+      ydb_histogram_record(&stats->replace_latency, ns);
+      break;
+    case YDB_TRACE_DELETE:
+      ydb_histogram_record(&stats->delete_latency, ns);
+      break;
+    default:
+      break;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/storage.h>
+
+YDB_Error ydb_storage_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(dst, YDB_ERR_WRITE_TO_NULLPTR);
+  return storage->ops->read_at(storage, offset, dst, size);
+}
+
+YDB_Error ydb_storage_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(src, YDB_ERR_WRITE_TO_NULLPTR);
+  return storage->ops->write_at(storage, offset, src, size);
+}
+
+YDB_Error ydb_storage_writev_at(YDB_Storage *storage, YDB_Offset offset, const YDB_IOVec *iov, size_t count) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(iov || !count, YDB_ERR_WRITE_TO_NULLPTR);
+  if (storage->ops->writev_at) {
+    return storage->ops->writev_at(storage, offset, iov, count);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    YDB_Error err = storage->ops->write_at(storage, offset, iov[i].base, iov[i].size);
+    if (err) return err;
+    offset += iov[i].size;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_storage_sync(YDB_Storage *storage) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  return storage->ops->sync(storage);
+}
+
+YDB_Offset ydb_storage_size(YDB_Storage *storage) {
+  THROW_IF_NULL(storage, 0);
+  return storage->ops->size(storage);
+}
+
+YDB_Error ydb_storage_truncate(YDB_Storage *storage, YDB_Offset size) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  return storage->ops->truncate(storage, size);
+}
+
+char *ydb_storage_map(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  THROW_IF_NULL(storage, NULL);
+  THROW_IF_NULL(storage->ops->map, NULL);
+  return storage->ops->map(storage, offset, size);
+}
+
+int ydb_storage_can_map(const YDB_Storage *storage) {
+  THROW_IF_NULL(storage, 0);
+  return storage->ops->map != NULL;
+}
+
+void ydb_storage_prefetch(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  if (!storage || !storage->ops->prefetch) return;
+  storage->ops->prefetch(storage, offset, size);
+}
+
+void ydb_storage_close(YDB_Storage *storage) {
+  if (!storage) return;
+  storage->ops->close(storage);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/storage.h>
+
+/**
+ * @struct __YDB_MemoryStorage
+ * @brief In-memory storage backend.
+ */
+typedef struct __YDB_MemoryStorage {
+  YDB_Storage base; /**< Storage base. */
+  char *data; /**< Storage data. */
+  size_t capacity; /**< Allocated memory size. */
+  YDB_Offset size; /**< Storage size. */
+} __YDB_MemoryStorage;
+
+static YDB_Error __ydb_memory_truncate(YDB_Storage *storage, YDB_Offset size) {
+  __YDB_MemoryStorage *s = (__YDB_MemoryStorage *) storage;
+  if (size > s->capacity) {
+    size_t capacity = s->capacity ? s->capacity : 4096;
+    while (capacity < size) capacity <<= 1;
+
+    char *data = realloc(s->data, capacity);
+    if (!data) return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+    s->data = data;
+    s->capacity = capacity;
+  }
+  if (size > s->size) {
+    memset(s->data + s->size, 0, size - s->size);
+  }
+  s->size = size;
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_memory_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size) {
+  __YDB_MemoryStorage *s = (__YDB_MemoryStorage *) storage;
+  if (offset + size > s->size) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  memcpy(dst, s->data + offset, size);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_memory_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size) {
+  __YDB_MemoryStorage *s = (__YDB_MemoryStorage *) storage;
+  if (offset + size > s->size) {
+    YDB_Error err = __ydb_memory_truncate(storage, offset + size);
+    if (err) return err;
+  }
+  memcpy(s->data + offset, src, size);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_memory_sync(YDB_Storage *storage) {
+  (void) storage;
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Offset __ydb_memory_size(YDB_Storage *storage) {
+  return ((__YDB_MemoryStorage *) storage)->size;
+}
+
+static char *__ydb_memory_map(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  __YDB_MemoryStorage *s = (__YDB_MemoryStorage *) storage;
+  if (offset + size > s->size) return NULL;
+  return s->data + offset;
+}
+
+static void __ydb_memory_close(YDB_Storage *storage) {
+  __YDB_MemoryStorage *s = (__YDB_MemoryStorage *) storage;
+  free(s->data);
+  free(s);
+}
+
+static const YDB_StorageOps __ydb_memory_ops = {
+    .name = "memory",
+    .read_at = __ydb_memory_read_at,
+    .write_at = __ydb_memory_write_at,
+    .writev_at = NULL,
+    .sync = __ydb_memory_sync,
+    .size = __ydb_memory_size,
+    .truncate = __ydb_memory_truncate,
+    .map = __ydb_memory_map,
+    .prefetch = NULL,
+    .close = __ydb_memory_close,
+};
+
+YDB_Storage *ydb_storage_memory_open() {
+  __YDB_MemoryStorage *s = calloc(1, sizeof(__YDB_MemoryStorage));
+  if (!s) return NULL;
+  s->base.ops = &__ydb_memory_ops;
+  return &s->base;
+}
+
+#ifdef __cplusplus
+}
+#endif
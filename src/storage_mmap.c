@@ -0,0 +1,158 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/storage.h>
+
+/**
+ * @struct __YDB_MmapStorage
+ * @brief Memory-mapped file storage backend.
+ */
+typedef struct __YDB_MmapStorage {
+  YDB_Storage base; /**< Storage base. */
+  int fd; /**< File descriptor. */
+  char *data; /**< Mapping start. */
+  size_t map_size; /**< The size of the mapping (reserved address space). */
+  YDB_Offset size; /**< File size. */
+} __YDB_MmapStorage;
+
+// Maps at least `min_size` bytes, reserving some extra address space for growth.
+static YDB_Error __ydb_mmap_remap(__YDB_MmapStorage *s, YDB_Offset min_size) {
+  size_t map_size = s->map_size ? s->map_size : YDB_MMAP_MIN_RESERVE;
+  while (map_size < min_size) map_size <<= 1;
+
+  if (s->data) {
+    munmap(s->data, s->map_size);
+    s->data = NULL;
+    s->map_size = 0;
+  }
+
+  // Mapping beyond EOF is fine as long as it is not touched before the file grows.
+  void *data = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+  if (data == MAP_FAILED) {
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  s->data = data;
+  s->map_size = map_size;
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_mmap_truncate(YDB_Storage *storage, YDB_Offset size) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (ftruncate(s->fd, (off_t) size) == -1) {
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  s->size = size;
+
+  if (size > s->map_size) {
+    return __ydb_mmap_remap(s, size);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_mmap_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (offset + size > s->size) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  memcpy(dst, s->data + offset, size);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_mmap_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (offset + size > s->size) {
+    YDB_Error err = __ydb_mmap_truncate(storage, offset + size);
+    if (err) return err;
+  }
+  memcpy(s->data + offset, src, size);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_mmap_sync(YDB_Storage *storage) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (s->size && msync(s->data, s->size, MS_SYNC) == -1) {
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Offset __ydb_mmap_size(YDB_Storage *storage) {
+  return ((__YDB_MmapStorage *) storage)->size;
+}
+
+static char *__ydb_mmap_map(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (offset + size > s->size) return NULL;
+  return s->data + offset;
+}
+
+static void __ydb_mmap_prefetch(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (offset >= s->size) return;
+  if (offset + size > s->size) size = s->size - offset;
+
+  // Advice range must start at a memory page boundary
+  size_t align = (size_t) sysconf(_SC_PAGESIZE);
+  size_t skew = offset % align;
+  posix_madvise(s->data + offset - skew, size + skew, POSIX_MADV_WILLNEED);
+}
+
+static void __ydb_mmap_close(YDB_Storage *storage) {
+  __YDB_MmapStorage *s = (__YDB_MmapStorage *) storage;
+  if (s->data) munmap(s->data, s->map_size);
+  close(s->fd);
+  free(s);
+}
+
+static const YDB_StorageOps __ydb_mmap_ops = {
+    .name = "mmap",
+    .read_at = __ydb_mmap_read_at,
+    .write_at = __ydb_mmap_write_at,
+    .writev_at = NULL,
+    .sync = __ydb_mmap_sync,
+    .size = __ydb_mmap_size,
+    .truncate = __ydb_mmap_truncate,
+    .map = __ydb_mmap_map,
+    .prefetch = __ydb_mmap_prefetch,
+    .close = __ydb_mmap_close,
+};
+
+YDB_Storage *ydb_storage_mmap_open(const char *path, int create) {
+  int flags = O_RDWR;
+  if (create) flags |= O_CREAT | O_EXCL;
+
+  int fd = open(path, flags, 0644);
+  if (fd == -1) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return NULL;
+  }
+
+  __YDB_MmapStorage *s = calloc(1, sizeof(__YDB_MmapStorage));
+  if (!s) {
+    close(fd);
+    return NULL;
+  }
+  s->base.ops = &__ydb_mmap_ops;
+  s->fd = fd;
+  s->size = st.st_size;
+  if (__ydb_mmap_remap(s, s->size)) {
+    __ydb_mmap_close(&s->base);
+    return NULL;
+  }
+  return &s->base;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/storage.h>
+
+// IOV_MAX is not exposed without XSI extensions, 1024 is the Linux and BSD value
+#ifdef IOV_MAX
+#define __YDB_IOV_MAX IOV_MAX
+#else
+#define __YDB_IOV_MAX 1024
+#endif
+
+/**
+ * @struct __YDB_PioStorage
+ * @brief Positional I/O storage backend.
+ */
+typedef struct __YDB_PioStorage {
+  YDB_Storage base; /**< Storage base. */
+  int fd; /**< File descriptor. */
+} __YDB_PioStorage;
+
+static YDB_Error __ydb_pio_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  char *p = dst;
+  while (size) {
+    ssize_t n = pread(s->fd, p, size, (off_t) offset);
+    if (n == -1 && errno == EINTR) continue;
+    // Short read means the data is out of file bounds
+    if (n <= 0) return YDB_ERR_TABLE_DATA_CORRUPTED;
+    p += n;
+    offset += n;
+    size -= n;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_pio_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  const char *p = src;
+  while (size) {
+    ssize_t n = pwrite(s->fd, p, size, (off_t) offset);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+    p += n;
+    offset += n;
+    size -= n;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_pio_writev_at(YDB_Storage *storage, YDB_Offset offset, const YDB_IOVec *iov, size_t count) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+
+  struct iovec *vec = malloc(sizeof(struct iovec) * (count ? count : 1));
+  if (!vec) return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  for (size_t i = 0; i < count; i++) {
+    vec[i].iov_base = (void *) iov[i].base;
+    vec[i].iov_len = iov[i].size;
+  }
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  struct iovec *v = vec;
+  while (count) {
+    ssize_t n = pwritev(s->fd, v, count < __YDB_IOV_MAX ? (int) count : __YDB_IOV_MAX, (off_t) offset);
+    if (n == -1 && errno == EINTR) continue;
+    if (n <= 0) {
+      err = YDB_ERR_TABLE_DATA_WRITE_FAILED;
+      break;
+    }
+    offset += n;
+
+    // Skip fully written buffers and cut the partially written one
+    while (count && (size_t) n >= v->iov_len) {
+      n -= v->iov_len;
+      v++;
+      count--;
+    }
+    if (count) {
+      v->iov_base = (char *) v->iov_base + n;
+      v->iov_len -= n;
+    }
+  }
+  free(vec);
+  return err;
+}
+
+static YDB_Error __ydb_pio_sync(YDB_Storage *storage) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  if (fsync(s->fd) == -1) {
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Offset __ydb_pio_size(YDB_Storage *storage) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  struct stat st;
+  if (fstat(s->fd, &st) == -1) return 0;
+  return st.st_size;
+}
+
+static YDB_Error __ydb_pio_truncate(YDB_Storage *storage, YDB_Offset size) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  if (ftruncate(s->fd, (off_t) size) == -1) {
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static void __ydb_pio_prefetch(YDB_Storage *storage, YDB_Offset offset, size_t size) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  posix_fadvise(s->fd, (off_t) offset, (off_t) size, POSIX_FADV_WILLNEED);
+}
+
+static void __ydb_pio_close(YDB_Storage *storage) {
+  __YDB_PioStorage *s = (__YDB_PioStorage *) storage;
+  close(s->fd);
+  free(s);
+}
+
+static const YDB_StorageOps __ydb_pio_ops = {
+    .name = "pio",
+    .read_at = __ydb_pio_read_at,
+    .write_at = __ydb_pio_write_at,
+    .writev_at = __ydb_pio_writev_at,
+    .sync = __ydb_pio_sync,
+    .size = __ydb_pio_size,
+    .truncate = __ydb_pio_truncate,
+    .map = NULL,
+    .prefetch = __ydb_pio_prefetch,
+    .close = __ydb_pio_close,
+};
+
+YDB_Storage *ydb_storage_pio_open(const char *path, int create) {
+  int flags = O_RDWR;
+  if (create) flags |= O_CREAT | O_EXCL;
+
+  int fd = open(path, flags, 0644);
+  if (fd == -1) return NULL;
+
+  __YDB_PioStorage *s = calloc(1, sizeof(__YDB_PioStorage));
+  if (!s) {
+    close(fd);
+    return NULL;
+  }
+  s->base.ops = &__ydb_pio_ops;
+  s->fd = fd;
+  return &s->base;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,31 +14,206 @@ extern "C" {
  */
 
 struct __YDB_TablePage {
-  char* data; /**< Raw page data. */
+  char* data; /**< Raw page data. Borrowed if the page is a view. */
   YDB_PageSize size; /**< The amount of memory in a page. */
   YDB_PageSize pos; /**< The current position of page data I/O stream. TODO: rewrite it */
   YDB_PageSize row_count; /**< Row count in a page. */
   YDB_Flags flags; /**< The flags of a page. */
+  uint8_t is_view; /**< Whether the page is a read-only view of memory it does not own. */
+  YDB_PageReleaseFn release; /**< A callback to release viewed memory. */
+  void* release_ctx; /**< Release callback context. */
+  YDB_PageAllocator* allocator; /**< The allocator the page belongs to, NULL if allocated with ydb_page_alloc(). */
+  YDB_TablePage* next_free; /**< Next page in the allocator free list. */
+  int32_t free_bytes; /**< Free bytes of a slotted page, valid if `free_valid` is set. */
+  YDB_PageSize free_slot; /**< No slot below it is free, valid if `free_valid` is set. */
+  uint8_t free_valid; /**< Whether `free_bytes` and `free_slot` are counted from the current page data. */
 };
 
+/**
+ * @struct __YDB_PageAllocator
+ * @brief A struct that defines a page allocator.
+ */
+struct __YDB_PageAllocator {
+  YDB_PageSize page_size; /**< Data size of allocated pages. */
+  size_t max_free; /**< Maximum length of the free list. */
+  YDB_TablePage* free_list; /**< Released pages ready for reuse. */
+  uint8_t closing; /**< Set by ydb_page_allocator_free() while some pages are still in use. */
+  YDB_PageAllocatorStats stats; /**< Allocation counters. */
+};
+
+// Page struct size rounded up, so page data starting right after it is cache-line aligned.
+#define YDB_PAGE_HEADER_SIZE \
+  ((sizeof(YDB_TablePage) + YDB_CACHE_LINE_SIZE - 1) / YDB_CACHE_LINE_SIZE * YDB_CACHE_LINE_SIZE)
+
+// Allocates page struct and page data in a single cache-line aligned block.
+static YDB_TablePage* __ydb_page_block_alloc(YDB_PageSize size, int zero) {
+  size_t block_size = YDB_PAGE_HEADER_SIZE + size;
+  block_size = (block_size + YDB_CACHE_LINE_SIZE - 1) / YDB_CACHE_LINE_SIZE * YDB_CACHE_LINE_SIZE;
+
+  char* block = aligned_alloc(YDB_CACHE_LINE_SIZE, block_size);
+  THROW_IF_NULL(block, NULL);
+
+  YDB_TablePage* page = (YDB_TablePage*) block;
+  memset(page, 0, sizeof(YDB_TablePage));
+  page->size = size;
+  page->data = block + YDB_PAGE_HEADER_SIZE;
+  if (zero) {
+    memset(page->data, 0, size);
+  }
+  return page;
+}
+
+// Frees an allocator once it is closed and all its pages are back.
+static void __ydb_page_allocator_destroy_if_done(YDB_PageAllocator* allocator) {
+  if (!allocator->closing || allocator->stats.in_use) return;
+
+  while (allocator->free_list) {
+    YDB_TablePage* next = allocator->free_list->next_free;
+    free(allocator->free_list);
+    allocator->free_list = next;
+  }
+  free(allocator);
+}
+
 YDB_TablePage* ydb_page_alloc(YDB_PageSize size) {
-  YDB_TablePage* new_page = malloc(sizeof(YDB_TablePage));
+  YDB_TablePage* new_page = __ydb_page_block_alloc(size, 1);
   new_page->pos = 0;
   new_page->flags = 0; // No flags set
-  new_page->size = size;
-  new_page->data = calloc(1, new_page->size);
   return new_page;
 }
 
 void ydb_page_free(YDB_TablePage* page) {
-  free(page->data);
-  free(page);
+  if (!page) return;
+  if (page->is_view) {
+    ydb_page_view_reset(page);
+    free(page);
+    return;
+  }
+
+  YDB_PageAllocator* allocator = page->allocator;
+  if (!allocator) {
+    free(page); // Data is in the same block
+    return;
+  }
+
+  allocator->stats.releases++;
+  allocator->stats.in_use--;
+  if (!allocator->closing && allocator->stats.cached < allocator->max_free) {
+    page->next_free = allocator->free_list;
+    allocator->free_list = page;
+    allocator->stats.cached++;
+  } else {
+    free(page);
+  }
+  __ydb_page_allocator_destroy_if_done(allocator);
+}
+
+YDB_PageAllocator* ydb_page_allocator_new(YDB_PageSize page_size, size_t max_free) {
+  YDB_PageAllocator* allocator = calloc(1, sizeof(YDB_PageAllocator));
+  allocator->page_size = page_size;
+  allocator->max_free = max_free;
+  return allocator;
+}
+
+void ydb_page_allocator_free(YDB_PageAllocator* allocator) {
+  if (!allocator) return;
+  allocator->closing = 1;
+  __ydb_page_allocator_destroy_if_done(allocator);
+}
+
+YDB_TablePage* ydb_page_alloc_from(YDB_PageAllocator* allocator, YDB_Flags alloc_flags) {
+  THROW_IF_NULL(allocator, NULL);
+  THROW_IF_NULL(!allocator->closing, NULL);
+
+  int zero = !(alloc_flags & YDB_PAGE_ALLOC_NO_ZERO);
+  YDB_TablePage* page = allocator->free_list;
+  if (page) {
+    allocator->free_list = page->next_free;
+    allocator->stats.cached--;
+    allocator->stats.reused++;
+
+    char* data = page->data;
+    memset(page, 0, sizeof(YDB_TablePage));
+    page->size = allocator->page_size;
+    page->data = data;
+    if (zero) {
+      memset(page->data, 0, page->size);
+    }
+  } else {
+    page = __ydb_page_block_alloc(allocator->page_size, zero);
+    THROW_IF_NULL(page, NULL);
+  }
+
+  if (zero) allocator->stats.zeroed++;
+  allocator->stats.allocations++;
+  allocator->stats.in_use++;
+  page->allocator = allocator;
+  return page;
+}
+
+void ydb_page_allocator_stats_get(const YDB_PageAllocator* allocator, YDB_PageAllocatorStats* stats) {
+  if (!allocator || !stats) return;
+  *stats = allocator->stats;
+}
+
+YDB_TablePage* ydb_page_view_alloc() {
+  YDB_TablePage* view = calloc(1, sizeof(YDB_TablePage));
+  view->is_view = 1;
+  return view;
+}
+
+void ydb_page_view_set(YDB_TablePage* view, const char* data, YDB_PageSize size, YDB_Flags flags,
+                       YDB_PageSize row_count, YDB_PageReleaseFn release, void* ctx) {
+  if (!view || !view->is_view) return;
+  ydb_page_view_reset(view);
+
+  view->data = (char*) data; // Never written through a view
+  view->size = size;
+  view->pos = 0;
+  view->flags = flags;
+  view->row_count = row_count;
+  view->release = release;
+  view->release_ctx = ctx;
+  view->free_valid = 0;
+}
+
+void ydb_page_view_reset(YDB_TablePage* view) {
+  if (!view || !view->is_view) return;
+
+  YDB_PageReleaseFn release = view->release;
+  void* ctx = view->release_ctx;
+
+  view->data = NULL;
+  view->size = 0;
+  view->pos = 0;
+  view->flags = 0;
+  view->row_count = 0;
+  view->release = NULL;
+  view->release_ctx = NULL;
+  view->free_valid = 0;
+
+  if (release) release(ctx);
+}
+
+int ydb_page_is_view(const YDB_TablePage* page) {
+  THROW_IF_NULL(page, 0);
+  return page->is_view;
+}
+
+const void* ydb_page_data_ptr(const YDB_TablePage* page) {
+  THROW_IF_NULL(page, NULL);
+  return page->data;
+}
+
+YDB_PageSize ydb_page_size_get(const YDB_TablePage *page) {
+  THROW_IF_NULL(page, 0);
+  return page->size;
 }
 
 YDB_Error ydb_page_data_seek(YDB_TablePage *page, YDB_PageSize pos) {
   THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
 
-  if ((pos < 0) || (pos >= page->size)) {
+  if (pos >= page->size) {
     return YDB_ERR_PAGE_INDEX_OUT_OF_RANGE;
   }
   page->pos = pos;
@@ -77,6 +252,7 @@ YDB_Error ydb_page_data_write(YDB_TablePage *dst, const void *src, YDB_PageSize
   THROW_IF_NULL(src, YDB_ERR_WRITE_TO_NULLPTR);
   THROW_IF_NULL(dst, YDB_ERR_PAGE_NOT_INITIALIZED);
   THROW_IF_NULL(n, YDB_ERR_ZERO_SIZE_RW);
+  THROW_IF_NULL(!dst->is_view, YDB_ERR_PAGE_READ_ONLY);
 
   if (dst->pos == dst->size) {
     return YDB_ERR_PAGE_NO_MORE_MEM;
@@ -91,6 +267,7 @@ YDB_Error ydb_page_data_write(YDB_TablePage *dst, const void *src, YDB_PageSize
   void* data_start = dst->data + dst->pos;
   memcpy(data_start, src, n);
   dst->pos += n;
+  dst->free_valid = 0;
 
   return YDB_ERR_SUCCESS;
 }
@@ -101,8 +278,9 @@ YDB_Flags ydb_page_flags_get(YDB_TablePage *page) {
 }
 
 void ydb_page_flags_set(YDB_TablePage *page, YDB_Flags flags) {
-  if (!page) return;
+  if (!page || page->is_view) return;
   page->flags = flags;
+  page->free_valid = 0;
 }
 
 YDB_PageSize ydb_page_row_count_get(YDB_TablePage *page) {
@@ -111,18 +289,346 @@ YDB_PageSize ydb_page_row_count_get(YDB_TablePage *page) {
 }
 
 void ydb_page_row_count_set(YDB_TablePage *page, YDB_PageSize row_count) {
-  if (!page) return;
+  if (!page || page->is_view) return;
   page->row_count = row_count;
+  page->free_valid = 0;
 }
 
 YDB_TablePage *ydb_page_clone(const YDB_TablePage *page) {
-  YDB_TablePage* result = malloc(sizeof(YDB_TablePage));
-  memcpy(result, page, sizeof(YDB_TablePage));
-  result->data = malloc(result->size);
+  THROW_IF_NULL(page, NULL);
+
+  // Data is fully overwritten, no need to zero it
+  YDB_TablePage* result;
+  if (page->allocator && page->allocator->page_size == page->size) {
+    result = ydb_page_alloc_from(page->allocator, YDB_PAGE_ALLOC_NO_ZERO);
+  } else {
+    result = __ydb_page_block_alloc(page->size, 0);
+  }
+  THROW_IF_NULL(result, NULL);
+
+  // A clone of a view owns its data
+  result->pos = page->pos;
+  result->row_count = page->row_count;
+  result->flags = page->flags;
+  result->free_bytes = page->free_bytes;
+  result->free_slot = page->free_slot;
+  result->free_valid = page->free_valid;
   memcpy(result->data, page->data, result->size);
   return result;
 }
 
+// Slotted page layout helpers. All the values are little-endian 16-bit integers, or 32-bit ones if the page
+// has wide slots: 16 bits could not address data of pages larger than 64 KiB.
+static int __ydb_page_wide(const YDB_TablePage *page) {
+  return (page->flags & YDB_TABLE_PAGE_FLAG_WIDE_SLOTS) != 0;
+}
+
+static YDB_PageSize __ydb_page_field_get(const YDB_TablePage *page, YDB_PageSize pos) {
+  if (__ydb_page_wide(page)) {
+    uint32_t v;
+    memcpy(&v, page->data + pos, sizeof(v));
+    return FROM_LE(v);
+  }
+  uint16_t v;
+  memcpy(&v, page->data + pos, sizeof(v));
+  return FROM_LE(v);
+}
+
+static void __ydb_page_field_set(YDB_TablePage *page, YDB_PageSize pos, YDB_PageSize value) {
+  if (__ydb_page_wide(page)) {
+    uint32_t v = TO_LE((uint32_t) value);
+    memcpy(page->data + pos, &v, sizeof(v));
+    return;
+  }
+  uint16_t v = TO_LE((uint16_t) value);
+  memcpy(page->data + pos, &v, sizeof(v));
+}
+
+static YDB_PageSize __ydb_slot_size(const YDB_TablePage *page) {
+  return __ydb_page_wide(page) ? YDB_WIDE_SLOT_SIZE : YDB_SLOT_SIZE;
+}
+
+static YDB_PageSize __ydb_slot_pos(const YDB_TablePage *page, YDB_PageSize row_id) {
+  YDB_PageSize header_size = __ydb_page_wide(page) ? YDB_SLOTTED_WIDE_HEADER_SIZE : YDB_SLOTTED_HEADER_SIZE;
+  return header_size + row_id * __ydb_slot_size(page);
+}
+
+static YDB_PageSize __ydb_slot_offset(const YDB_TablePage *page, YDB_PageSize row_id) {
+  return __ydb_page_field_get(page, __ydb_slot_pos(page, row_id));
+}
+
+static YDB_PageSize __ydb_slot_length(const YDB_TablePage *page, YDB_PageSize row_id) {
+  return __ydb_page_field_get(page, __ydb_slot_pos(page, row_id) + __ydb_slot_size(page) / 2);
+}
+
+static void __ydb_slot_set(YDB_TablePage *page, YDB_PageSize row_id, YDB_PageSize offset, YDB_PageSize length) {
+  __ydb_page_field_set(page, __ydb_slot_pos(page, row_id), offset);
+  __ydb_page_field_set(page, __ydb_slot_pos(page, row_id) + __ydb_slot_size(page) / 2, length);
+}
+
+static YDB_PageSize __ydb_heap_start(const YDB_TablePage *page) {
+  return __ydb_page_field_get(page, 0);
+}
+
+// End of the row heap. Without wide slots only the first 64 KiB of a larger page are used.
+static YDB_PageSize __ydb_heap_end(const YDB_TablePage *page) {
+  return __ydb_page_wide(page) || page->size <= UINT16_MAX ? page->size : UINT16_MAX;
+}
+
+// Contiguous free space between slot directory and row heap.
+static int32_t __ydb_contiguous_free(const YDB_TablePage *page, YDB_PageSize slot_count) {
+  return (int32_t) __ydb_heap_start(page) - (int32_t) __ydb_slot_pos(page, slot_count);
+}
+
+static YDB_Error __ydb_page_check_slotted(const YDB_TablePage *page) {
+  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  if (!(page->flags & YDB_TABLE_PAGE_FLAG_SLOTTED)) {
+    return YDB_ERR_PAGE_NOT_SLOTTED;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Slot reference used to sort rows by their location.
+typedef struct {
+  YDB_PageSize offset;
+  YDB_PageSize row_id;
+} __YDB_SlotRef;
+
+static int __ydb_slot_ref_cmp_desc(const void *a, const void *b) {
+  YDB_PageSize oa = ((const __YDB_SlotRef *) a)->offset;
+  YDB_PageSize ob = ((const __YDB_SlotRef *) b)->offset;
+  return (oa < ob) - (oa > ob);
+}
+
+// Moves all live rows to the end of the page, so free space becomes contiguous.
+static void __ydb_page_compact(YDB_TablePage *page) {
+  YDB_PageSize slot_count = page->row_count;
+  __YDB_SlotRef *live = malloc(sizeof(__YDB_SlotRef) * (slot_count ? slot_count : 1));
+  YDB_PageSize live_count = 0;
+  for (YDB_PageSize i = 0; i < slot_count; i++) {
+    YDB_PageSize offset = __ydb_slot_offset(page, i);
+    if (!offset) continue;
+    live[live_count].offset = offset;
+    live[live_count].row_id = i;
+    live_count++;
+  }
+
+  // Rows closer to the end go first, so a row is never moved over another one not moved yet.
+  qsort(live, live_count, sizeof(__YDB_SlotRef), __ydb_slot_ref_cmp_desc);
+
+  YDB_PageSize heap_start = __ydb_heap_end(page);
+  for (YDB_PageSize i = 0; i < live_count; i++) {
+    YDB_PageSize length = __ydb_slot_length(page, live[i].row_id);
+    heap_start -= length;
+    memmove(page->data + heap_start, page->data + live[i].offset, length);
+    __ydb_slot_set(page, live[i].row_id, heap_start, length);
+  }
+  __ydb_page_field_set(page, 0, heap_start);
+  free(live);
+}
+
+// Counts free bytes and finds the first free slot of a page the row operations have not seen yet.
+// From then on they keep both up to date, so neither is counted again until page data is replaced.
+static void __ydb_page_free_load(const YDB_TablePage *page) {
+  if (page->free_valid) return;
+
+  int32_t free_space = __ydb_contiguous_free(page, page->row_count);
+  free_space += __ydb_heap_end(page) - __ydb_heap_start(page);
+  YDB_PageSize free_slot = page->row_count;
+  for (YDB_PageSize i = 0; i < page->row_count; i++) {
+    if (!__ydb_slot_offset(page, i)) {
+      if (free_slot == page->row_count) free_slot = i;
+      continue;
+    }
+    free_space -= (int32_t) __ydb_slot_length(page, i);
+  }
+
+  YDB_TablePage *counted = (YDB_TablePage *) page; // Only the counters change
+  counted->free_bytes = free_space;
+  counted->free_slot = free_slot;
+  counted->free_valid = 1;
+}
+
+// Free bytes in the page: the gap between slot directory and row heap plus holes left in the heap.
+static int32_t __ydb_page_total_free(const YDB_TablePage *page) {
+  __ydb_page_free_load(page);
+  return page->free_bytes;
+}
+
+// Places a row record (flags + data) for `row_id` into the heap. Slot must be allocated.
+static YDB_Error __ydb_page_row_place(YDB_TablePage *page, YDB_PageSize row_id, const void *row, YDB_PageSize size) {
+  YDB_PageSize length = size + YDB_ROW_FLAGS_SIZE;
+  void *tmp = NULL;
+  if (__ydb_contiguous_free(page, page->row_count) < (int32_t) length) {
+    // The row could point into the page itself (e.g. from ydb_page_row_get()), which is moved on compaction
+    const char *src = row;
+    if (src >= page->data && src < page->data + page->size) {
+      tmp = malloc(size);
+      memcpy(tmp, row, size);
+      row = tmp;
+    }
+    __ydb_page_compact(page);
+  }
+
+  YDB_PageSize offset = __ydb_heap_start(page) - length;
+  page->data[offset] = 0; // Row flags
+  if (size) {
+    memmove(page->data + offset + YDB_ROW_FLAGS_SIZE, row, size);
+  }
+  __ydb_page_field_set(page, 0, offset);
+  __ydb_slot_set(page, row_id, offset, length);
+  free(tmp);
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_slotted_init(YDB_TablePage *page) {
+  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(!page->is_view, YDB_ERR_PAGE_READ_ONLY);
+  if (page->size < YDB_SLOTTED_HEADER_SIZE) {
+    return YDB_ERR_PAGE_NO_MORE_MEM;
+  }
+
+  page->flags |= YDB_TABLE_PAGE_FLAG_SLOTTED;
+  if (page->size > UINT16_MAX) {
+    page->flags |= YDB_TABLE_PAGE_FLAG_WIDE_SLOTS;
+  } else {
+    page->flags &= (YDB_Flags) ~YDB_TABLE_PAGE_FLAG_WIDE_SLOTS;
+  }
+  page->row_count = 0;
+  __ydb_page_field_set(page, 0, __ydb_heap_end(page));
+  page->free_bytes = (int32_t) __ydb_contiguous_free(page, 0);
+  page->free_slot = 0;
+  page->free_valid = 1;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_PageSize ydb_page_free_space(const YDB_TablePage *page) {
+  if (__ydb_page_check_slotted(page)) return 0;
+
+  // A new row needs a slot and row flags
+  int32_t free_space = __ydb_page_total_free(page) - (int32_t) __ydb_slot_size(page) - YDB_ROW_FLAGS_SIZE;
+  return free_space > 0 ? (YDB_PageSize) free_space : 0;
+}
+
+YDB_Error ydb_page_row_insert(YDB_TablePage *page, const void *row, YDB_PageSize size, YDB_PageSize *row_id) {
+  YDB_Error err = __ydb_page_check_slotted(page);
+  if (err) return err;
+  THROW_IF_NULL(!page->is_view, YDB_ERR_PAGE_READ_ONLY);
+  THROW_IF_NULL(row || !size, YDB_ERR_WRITE_TO_NULLPTR);
+
+  // Reuse a slot of a deleted row if there is one
+  __ydb_page_free_load(page);
+  YDB_PageSize id = page->free_slot;
+  while (id < page->row_count && __ydb_slot_offset(page, id)) id++;
+  int new_slot = id == page->row_count;
+  if (new_slot && page->row_count == YDB_TABLE_PAGE_MAX_ROW_COUNT) {
+    return YDB_ERR_PAGE_NO_MORE_MEM;
+  }
+
+  int64_t needed = (int64_t) size + YDB_ROW_FLAGS_SIZE + (new_slot ? __ydb_slot_size(page) : 0);
+  if (__ydb_page_total_free(page) < needed) {
+    return YDB_ERR_PAGE_NO_MORE_MEM;
+  }
+
+  if (new_slot) {
+    // Directory grows first, so compaction sees it
+    if (__ydb_contiguous_free(page, page->row_count + 1) < 0) {
+      __ydb_page_compact(page);
+    }
+    page->row_count++;
+    __ydb_slot_set(page, id, 0, 0);
+  }
+
+  err = __ydb_page_row_place(page, id, row, size);
+  if (err) return err;
+  page->free_bytes -= (int32_t) needed;
+  page->free_slot = id + 1;
+
+  if (row_id) *row_id = id;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_row_get(const YDB_TablePage *page, YDB_PageSize row_id, const void **row, YDB_PageSize *size) {
+  YDB_Error err = __ydb_page_check_slotted(page);
+  if (err) return err;
+  THROW_IF_NULL(row, YDB_ERR_WRITE_TO_NULLPTR);
+
+  if (row_id >= page->row_count) {
+    return YDB_ERR_ROW_NOT_EXIST;
+  }
+  YDB_PageSize offset = __ydb_slot_offset(page, row_id);
+  THROW_IF_NULL(offset, YDB_ERR_ROW_NOT_EXIST);
+
+  *row = page->data + offset + YDB_ROW_FLAGS_SIZE;
+  if (size) *size = __ydb_slot_length(page, row_id) - YDB_ROW_FLAGS_SIZE;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_row_update(YDB_TablePage *page, YDB_PageSize row_id, const void *row, YDB_PageSize size) {
+  YDB_Error err = __ydb_page_check_slotted(page);
+  if (err) return err;
+  THROW_IF_NULL(!page->is_view, YDB_ERR_PAGE_READ_ONLY);
+  THROW_IF_NULL(row || !size, YDB_ERR_WRITE_TO_NULLPTR);
+
+  if (row_id >= page->row_count) {
+    return YDB_ERR_ROW_NOT_EXIST;
+  }
+  YDB_PageSize offset = __ydb_slot_offset(page, row_id);
+  THROW_IF_NULL(offset, YDB_ERR_ROW_NOT_EXIST);
+  YDB_PageSize length = __ydb_slot_length(page, row_id);
+
+  // Shrinking row is updated in place
+  __ydb_page_free_load(page);
+  if ((int64_t) size + YDB_ROW_FLAGS_SIZE <= length) {
+    memmove(page->data + offset + YDB_ROW_FLAGS_SIZE, row, size);
+    __ydb_slot_set(page, row_id, offset, size + YDB_ROW_FLAGS_SIZE);
+    page->free_bytes += (int32_t) (length - size - YDB_ROW_FLAGS_SIZE);
+    return YDB_ERR_SUCCESS;
+  }
+
+  // Old row space is reusable
+  if ((int64_t) __ydb_page_total_free(page) + length < (int64_t) size + YDB_ROW_FLAGS_SIZE) {
+    return YDB_ERR_PAGE_NO_MORE_MEM;
+  }
+
+  __ydb_slot_set(page, row_id, 0, 0);
+  err = __ydb_page_row_place(page, row_id, row, size);
+  if (err) return err;
+  page->free_bytes -= (int32_t) (size + YDB_ROW_FLAGS_SIZE - length);
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_page_row_delete(YDB_TablePage *page, YDB_PageSize row_id) {
+  YDB_Error err = __ydb_page_check_slotted(page);
+  if (err) return err;
+  THROW_IF_NULL(!page->is_view, YDB_ERR_PAGE_READ_ONLY);
+
+  if (row_id >= page->row_count) {
+    return YDB_ERR_ROW_NOT_EXIST;
+  }
+  YDB_PageSize offset = __ydb_slot_offset(page, row_id);
+  THROW_IF_NULL(offset, YDB_ERR_ROW_NOT_EXIST);
+
+  YDB_PageSize length = __ydb_slot_length(page, row_id);
+  __ydb_page_free_load(page);
+  page->data[offset] |= YDB_ROW_FLAG_DELETED;
+  __ydb_slot_set(page, row_id, 0, 0);
+  page->free_bytes += (int32_t) length;
+  if (row_id < page->free_slot) page->free_slot = row_id;
+
+  // Trailing free slots are cut off
+  while (page->row_count && !__ydb_slot_offset(page, page->row_count - 1)) {
+    page->row_count--;
+    page->free_bytes += (int32_t) __ydb_slot_size(page);
+  }
+  if (page->free_slot > page->row_count) page->free_slot = page->row_count;
+  // If the deleted row was the first in the heap, the heap just shrinks
+  if (offset == __ydb_heap_start(page)) {
+    __ydb_page_field_set(page, 0, offset + length);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
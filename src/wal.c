@@ -0,0 +1,297 @@
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/checksum.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/macro.h>
+#include <YeltsinDB/wal.h>
+
+/**
+ * @struct __YDB_WalRecord
+ * @brief A data record of the current transaction.
+ */
+typedef struct __YDB_WalRecord {
+  YDB_Offset target; /**< Data offset in the table. */
+  uint32_t length; /**< Data size. */
+  size_t iov_first; /**< The first data buffer in `iov`. */
+  size_t iov_count; /**< The amount of data buffers. */
+} __YDB_WalRecord;
+
+/**
+ * @struct __YDB_Wal
+ * @brief A struct that defines a write-ahead log.
+ */
+struct __YDB_Wal {
+  YDB_Storage *storage; /**< Log storage. */
+  YDB_Offset size; /**< Log size, new records are written here. */
+  uint64_t txn_id; /**< Id of the next transaction. */
+
+  size_t group_commit; /**< The amount of commits per sync. */
+  size_t unsynced; /**< The amount of commits since the last sync. */
+
+  __YDB_WalRecord *records; /**< Records of the current transaction. */
+  size_t record_count; /**< The amount of records. */
+  size_t record_capacity; /**< Capacity of `records`. */
+
+  YDB_IOVec *iov; /**< Data buffers of the current transaction. */
+  size_t iov_count; /**< The amount of buffers. */
+  size_t iov_capacity; /**< Capacity of `iov`. */
+};
+
+// Fills a record header. Checksum covers the header (with zero checksum) and record data.
+static void __ydb_wal_header_fill(char *h, uint8_t type, uint32_t length, YDB_Offset target,
+                                  const YDB_IOVec *iov, size_t count) {
+  memset(h, 0, YDB_wal_record_data_offset);
+  h[YDB_wal_record_type_offset] = (char) type;
+  uint32_t length_le = TO_LE(length);
+  memcpy(h + YDB_wal_record_length_offset, &length_le, sizeof(length_le));
+  YDB_Offset target_le = TO_LE(target);
+  memcpy(h + YDB_wal_record_target_offset, &target_le, sizeof(target_le));
+
+  uint32_t crc = ydb_crc32c(0, h, YDB_wal_record_data_offset);
+  for (size_t i = 0; i < count; i++) {
+    crc = ydb_crc32c(crc, iov[i].base, iov[i].size);
+  }
+  uint32_t crc_le = TO_LE(crc);
+  memcpy(h + YDB_wal_record_checksum_offset, &crc_le, sizeof(crc_le));
+}
+
+YDB_Wal *ydb_wal_open(YDB_Storage *storage) {
+  THROW_IF_NULL(storage, NULL);
+
+  YDB_Wal *wal = calloc(1, sizeof(YDB_Wal));
+  wal->storage = storage;
+  wal->size = ydb_storage_size(storage);
+  wal->group_commit = YDB_WAL_DEFAULT_GROUP_COMMIT;
+  return wal;
+}
+
+void ydb_wal_close(YDB_Wal *wal) {
+  if (!wal) return;
+  ydb_storage_close(wal->storage);
+  free(wal->records);
+  free(wal->iov);
+  free(wal);
+}
+
+void ydb_wal_set_group_commit(YDB_Wal *wal, size_t commits) {
+  if (!wal) return;
+  wal->group_commit = commits;
+}
+
+YDB_Error ydb_wal_append(YDB_Wal *wal, YDB_Offset offset, const YDB_IOVec *iov, size_t count) {
+  THROW_IF_NULL(wal, YDB_ERR_WAL_NOT_INITIALIZED);
+  THROW_IF_NULL(iov || !count, YDB_ERR_WRITE_TO_NULLPTR);
+
+  if (wal->record_count == wal->record_capacity) {
+    wal->record_capacity = wal->record_capacity ? wal->record_capacity * 2 : 8;
+    wal->records = realloc(wal->records, wal->record_capacity * sizeof(__YDB_WalRecord));
+  }
+  if (wal->iov_count + count > wal->iov_capacity) {
+    while (wal->iov_count + count > wal->iov_capacity) {
+      wal->iov_capacity = wal->iov_capacity ? wal->iov_capacity * 2 : 16;
+    }
+    wal->iov = realloc(wal->iov, wal->iov_capacity * sizeof(YDB_IOVec));
+  }
+
+  __YDB_WalRecord *r = &wal->records[wal->record_count++];
+  r->target = offset;
+  r->length = 0;
+  r->iov_first = wal->iov_count;
+  r->iov_count = count;
+  for (size_t i = 0; i < count; i++) {
+    wal->iov[wal->iov_count++] = iov[i];
+    r->length += (uint32_t) iov[i].size;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_wal_commit(YDB_Wal *wal) {
+  THROW_IF_NULL(wal, YDB_ERR_WAL_NOT_INITIALIZED);
+
+  // Every record is its header followed by its data buffers, then goes the commit record
+  size_t header_count = wal->record_count + 1;
+  char *headers = malloc(header_count * YDB_wal_record_data_offset);
+  YDB_IOVec *out = malloc((header_count + wal->iov_count) * sizeof(YDB_IOVec));
+  size_t out_count = 0;
+  YDB_Offset total = 0;
+
+  for (size_t i = 0; i < wal->record_count; i++) {
+    __YDB_WalRecord *r = &wal->records[i];
+    char *h = headers + i * YDB_wal_record_data_offset;
+    __ydb_wal_header_fill(h, YDB_WAL_RECORD_DATA, r->length, r->target, wal->iov + r->iov_first, r->iov_count);
+    out[out_count++] = (YDB_IOVec) {h, YDB_wal_record_data_offset};
+    for (size_t k = 0; k < r->iov_count; k++) {
+      out[out_count++] = wal->iov[r->iov_first + k];
+    }
+    total += YDB_wal_record_data_offset + r->length;
+  }
+
+  char *commit = headers + wal->record_count * YDB_wal_record_data_offset;
+  __ydb_wal_header_fill(commit, YDB_WAL_RECORD_COMMIT, 0, wal->txn_id, NULL, 0);
+  out[out_count++] = (YDB_IOVec) {commit, YDB_wal_record_data_offset};
+  total += YDB_wal_record_data_offset;
+
+  YDB_Error err = ydb_storage_writev_at(wal->storage, wal->size, out, out_count);
+  free(out);
+  free(headers);
+
+  // The id is used even if the write failed, so a leftover of that write could never pass for a later commit
+  wal->txn_id++;
+  wal->record_count = 0;
+  wal->iov_count = 0;
+  if (err) return err;
+
+  wal->size += total;
+  wal->unsynced++;
+  if (wal->group_commit && wal->unsynced >= wal->group_commit) {
+    return ydb_wal_sync(wal);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+void ydb_wal_abort(YDB_Wal *wal) {
+  if (!wal) return;
+  wal->record_count = 0;
+  wal->iov_count = 0;
+}
+
+YDB_Error ydb_wal_sync(YDB_Wal *wal) {
+  THROW_IF_NULL(wal, YDB_ERR_WAL_NOT_INITIALIZED);
+  if (!wal->unsynced) return YDB_ERR_SUCCESS;
+
+  YDB_Error err = ydb_storage_sync(wal->storage);
+  if (err) return err;
+  wal->unsynced = 0;
+  return YDB_ERR_SUCCESS;
+}
+
+int ydb_wal_needs_sync(const YDB_Wal *wal) {
+  THROW_IF_NULL(wal, 0);
+  return wal->unsynced != 0;
+}
+
+YDB_Offset ydb_wal_size(const YDB_Wal *wal) {
+  THROW_IF_NULL(wal, 0);
+  return wal->size;
+}
+
+/**
+ * @struct __YDB_WalPending
+ * @brief A data record read on replay, waiting for its commit record.
+ */
+typedef struct __YDB_WalPending {
+  YDB_Offset target; /**< Data offset in the table. */
+  uint32_t length; /**< Data size. */
+  char *data; /**< Data. */
+} __YDB_WalPending;
+
+static void __ydb_wal_pending_free(__YDB_WalPending *pending, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    free(pending[i].data);
+  }
+}
+
+YDB_Error ydb_wal_replay(YDB_Wal *wal, YDB_WalApplyFn apply, void *ctx, size_t *applied) {
+  THROW_IF_NULL(wal, YDB_ERR_WAL_NOT_INITIALIZED);
+  THROW_IF_NULL(apply, YDB_ERR_WRITE_TO_NULLPTR);
+
+  YDB_Offset end = ydb_storage_size(wal->storage);
+  YDB_Offset pos = 0;
+  YDB_Offset committed_end = 0;
+  size_t txn_count = 0;
+  uint64_t last_txn = 0;
+
+  __YDB_WalPending *pending = NULL;
+  size_t pending_count = 0;
+  size_t pending_capacity = 0;
+  YDB_Error err = YDB_ERR_SUCCESS;
+
+  while (pos + YDB_wal_record_data_offset <= end) {
+    char h[YDB_wal_record_data_offset];
+    err = ydb_storage_read_at(wal->storage, pos, h, sizeof(h));
+    if (err) break;
+
+    uint8_t type = (uint8_t) h[YDB_wal_record_type_offset];
+    uint32_t length;
+    memcpy(&length, h + YDB_wal_record_length_offset, sizeof(length));
+    REASSIGN_FROM_LE(length);
+    YDB_Offset target;
+    memcpy(&target, h + YDB_wal_record_target_offset, sizeof(target));
+    REASSIGN_FROM_LE(target);
+    uint32_t crc;
+    memcpy(&crc, h + YDB_wal_record_checksum_offset, sizeof(crc));
+    REASSIGN_FROM_LE(crc);
+
+    if (type != YDB_WAL_RECORD_DATA && type != YDB_WAL_RECORD_COMMIT) break;
+    if (pos + YDB_wal_record_data_offset + length > end) break;
+
+    char *data = NULL;
+    if (length) {
+      data = malloc(length);
+      err = ydb_storage_read_at(wal->storage, pos + YDB_wal_record_data_offset, data, length);
+      if (err) {
+        free(data);
+        break;
+      }
+    }
+
+    memset(h + YDB_wal_record_checksum_offset, 0, YDB_wal_record_checksum_size);
+    uint32_t actual = ydb_crc32c(ydb_crc32c(0, h, sizeof(h)), data, length);
+    if (actual != crc) {
+      free(data);
+      break;
+    }
+    pos += YDB_wal_record_data_offset + length;
+
+    if (type == YDB_WAL_RECORD_DATA) {
+      if (pending_count == pending_capacity) {
+        pending_capacity = pending_capacity ? pending_capacity * 2 : 8;
+        pending = realloc(pending, pending_capacity * sizeof(__YDB_WalPending));
+      }
+      pending[pending_count++] = (__YDB_WalPending) {target, length, data};
+      continue;
+    }
+
+    // Commit record: transaction ids go one after another, anything else is a leftover of a failed write
+    if (txn_count && target != last_txn + 1) break;
+    for (size_t i = 0; i < pending_count && !err; i++) {
+      err = apply(ctx, pending[i].target, pending[i].data, pending[i].length);
+    }
+    __ydb_wal_pending_free(pending, pending_count);
+    pending_count = 0;
+    if (err) break;
+
+    last_txn = target;
+    txn_count++;
+    committed_end = pos;
+  }
+
+  __ydb_wal_pending_free(pending, pending_count);
+  free(pending);
+
+  // New records overwrite the broken tail
+  wal->size = committed_end;
+  if (txn_count) wal->txn_id = last_txn + 1;
+  if (applied) *applied = txn_count;
+  return err;
+}
+
+YDB_Error ydb_wal_reset(YDB_Wal *wal) {
+  THROW_IF_NULL(wal, YDB_ERR_WAL_NOT_INITIALIZED);
+
+  YDB_Error err = ydb_storage_truncate(wal->storage, 0);
+  if (err) return err;
+  wal->size = 0;
+  wal->record_count = 0;
+  wal->iov_count = 0;
+  wal->unsynced = 1; // Truncation must be durable too
+  return ydb_wal_sync(wal);
+}
+
+#ifdef __cplusplus
+}
+#endif
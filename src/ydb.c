@@ -2,15 +2,28 @@
 extern "C" {
 #endif
 
-#include <stdio.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <YeltsinDB/btree.h>
+#include <YeltsinDB/checksum.h>
+#include <YeltsinDB/compress.h>
 #include <YeltsinDB/error_code.h>
 #include <YeltsinDB/constants.h>
+#include <YeltsinDB/filter.h>
+#include <YeltsinDB/hash_index.h>
 #include <YeltsinDB/macro.h>
+#include <YeltsinDB/page_cache.h>
+#include <YeltsinDB/pax.h>
+#include <YeltsinDB/readahead.h>
+#include <YeltsinDB/scan.h>
+#include <YeltsinDB/schema.h>
+#include <YeltsinDB/stats.h>
+#include <YeltsinDB/storage.h>
 #include <YeltsinDB/table_page.h>
+#include <YeltsinDB/wal.h>
 #include <YeltsinDB/ydb.h>
 
 struct __YDB_Engine {
@@ -24,411 +37,3538 @@ struct __YDB_Engine {
   YDB_Offset curr_page_offset; /**< A location of current page in file. */
   YDB_Offset next_page_offset; /**< A location of next page in file. */
 
-  YDB_TablePage *curr_page; /**< A pointer to the current page. */
+  YDB_TablePage *curr_page; /**< A pointer to the current page. Either `view` or a page passed by user. */
+  YDB_TablePage *view; /**< A view of current page data in cache or mapped file. */
+  YDB_Offset view_offset; /**< A location of the page pinned by `view`. */
+  YDB_PageAllocator *allocator; /**< Allocator of table-sized pages. */
+  YDB_PageSize allocator_page_size; /**< Page size of `allocator`. */
+
+  YDB_PageCache *cache; /**< Page cache. NULL if the storage is mapped. */
+  size_t cache_capacity; /**< Page cache capacity in pages. */
+  YDB_Offset file_size; /**< Table file size including pages allocated in cache only. */
+  YDB_Offset synced_file_size; /**< `file_size` as of the last operation written. */
+
+  YDB_IOMode io_mode; /**< Storage backend used to load tables by path. */
+  YDB_Storage *storage; /**< Table data storage. */
+  uint8_t mapped; /**< Whether pages are accessed in place with ydb_storage_map(). */
+  YDB_Offset data_offset; /**< A location of the first page slot, right after the file header. */
+  YDB_Offset table_flags; /**< Table flags (since v1.4). */
+  YDB_PageLayout layout; /**< Page layout of the table. */
+  uint8_t compression; /**< Whether pages of tables loaded or created are compressed. */
+  uint8_t checksums; /**< Whether tables created have page checksums. */
+  YDB_PageSize create_page_size; /**< Page size of tables created. */
+
+  YDB_Wal *wal; /**< Write-ahead log. NULL if the table is loaded without it. */
+  YDB_Storage *wal_storage; /**< Log storage for the next table load. */
+  size_t group_commit; /**< The amount of operations per log sync. */
+  uint8_t wal_enabled; /**< Whether tables loaded by path use write-ahead log. */
+  uint8_t sign_dirty; /**< Whether the table file signature is `TBL?`. */
+
+  YDB_Offset *dir; /**< Page directory: offsets of all the pages in table order. */
+  size_t dir_count; /**< The amount of pages in the directory. */
+  size_t dir_capacity; /**< Capacity of `dir`. */
+  YDB_Offset *dir_pages; /**< Offsets of the directory pages in the file. */
+  size_t dir_page_count; /**< The amount of directory pages. */
+  size_t dir_page_capacity; /**< Capacity of `dir_pages`. */
+  YDB_Offset dir_offset; /**< A location of the first directory page in file. */
+  uint8_t dir_valid; /**< Whether the directory is loaded (or built). */
+  uint8_t dir_persistent; /**< Whether the directory is stored in the file (since v1.2). */
+  size_t curr_index; /**< Index of current page. Valid only if the directory is. */
+  size_t *dir_slots; /**< Directory index + 1 of the table page in every page slot of the file, 0 for other
+                          pages. Built by compaction, so that a moved page is found without a search. */
+  size_t dir_slot_count; /**< The amount of entries in `dir_slots`. */
+  size_t dir_slot_capacity; /**< Capacity of `dir_slots`. */
+  uint8_t dir_slots_valid; /**< Whether `dir_slots` is built. Removing a page from the directory drops it. */
+  size_t compact_begin; /**< The amount of first pages of the directory known to be in place. Valid with
+                             `dir_slots`. */
+
+  uint8_t *fsm; /**< Free space map: an entry for every page in file, in file order. */
+  size_t fsm_count; /**< The amount of entries in the map. */
+  size_t fsm_capacity; /**< Capacity of `fsm`. */
+  size_t fsm_free_count; /**< The amount of free pages in the map. */
+  size_t fsm_dirty_begin; /**< The first entry changed since the map was stored. */
+  size_t fsm_dirty_end; /**< Past the last entry changed since the map was stored. */
+  YDB_Offset *fsm_pages; /**< Offsets of the map pages in the file. */
+  size_t fsm_page_count; /**< The amount of map pages. */
+  size_t fsm_page_capacity; /**< Capacity of `fsm_pages`. */
+  YDB_Offset fsm_offset; /**< A location of the first map page in file. */
+  uint8_t fsm_persistent; /**< Whether free pages are tracked by the map (since v1.3) instead of the list. */
+
+  YDB_Schema *schema; /**< Row schema of the table. NULL if it has none. */
+  YDB_Offset schema_offset; /**< A location of the schema page in file (since v1.7), 0 if there is none. */
+
+  YDB_ZoneMap *zones; /**< Zone maps of all the directory pages, an entry for every zone-mapped column. */
+  size_t zone_count; /**< The amount of pages in `zones`. */
+  size_t zone_capacity; /**< Capacity of `zones` in pages. */
+  size_t *zone_columns; /**< Indexes of zone-mapped columns of the schema. */
+  size_t zone_column_count; /**< The amount of zone-mapped columns. */
+  uint8_t zones_valid; /**< Whether zone maps are built. */
+
+  YDB_ReadAhead *readahead; /**< Background page read-ahead. NULL if disabled or not supported by storage. */
+  size_t readahead_depth; /**< The amount of pages to read ahead. */
+
+  pthread_rwlock_t latch; /**< Table latch. Shared by cursors reading pages, exclusive to change the page chain,
+                               the header offsets, the directory or to move mapped storage. */
+  size_t latch_depth; /**< How many times the owner thread holds `latch` exclusive. */
+  pthread_rwlock_t page_latches[YDB_PAGE_LATCH_COUNT]; /**< Page content latches, picked by page offset. */
+  pthread_mutex_t io_lock; /**< Serializes table file writes, log syncs and read-ahead changes. */
+  size_t cursor_count; /**< The amount of open cursors. */
+  YDB_Index *indexes; /**< Open indexes, changed along with the table. */
+
+  YDB_Stats stats; /**< Instance counters. Cache counters are filled on request. */
+  pthread_mutex_t stats_lock; /**< Protects `stats`, `trace` and `trace_ctx`. */
+  YDB_TraceFn trace; /**< Trace callback, NULL if none. */
+  void *trace_ctx; /**< A context passed to `trace`. */
 
   uint8_t in_use; /**< "In use" flag. */
-  char *filename; /**< Current table data file name. */
-  FILE *fd; /**< Current table data file descriptor. */
+  char *filename; /**< Current table data file name. NULL if the table was not loaded by path. */
 };
 
 YDB_Engine *ydb_init_instance() {
   YDB_Engine *new_instance = calloc(1, sizeof(YDB_Engine));
+  new_instance->cache_capacity = YDB_CACHE_DEFAULT_CAPACITY;
+  new_instance->group_commit = YDB_WAL_DEFAULT_GROUP_COMMIT;
+  new_instance->view = ydb_page_view_alloc();
+  new_instance->create_page_size = YDB_TABLE_PAGE_SIZE;
+  new_instance->layout.page_size = YDB_TABLE_PAGE_SIZE;
+  new_instance->layout.data_offset = YDB_v1_page_data_offset;
+  new_instance->allocator_page_size = YDB_TABLE_PAGE_SIZE - YDB_v1_page_data_offset;
+  new_instance->allocator = ydb_page_allocator_new(new_instance->allocator_page_size,
+                                                   YDB_PAGE_ALLOCATOR_DEFAULT_MAX_FREE);
+
+  // Cursors read all the time, so the owner would starve on latches preferring readers (glibc default)
+  pthread_rwlockattr_t latch_attr;
+  pthread_rwlockattr_init(&latch_attr);
+  pthread_rwlockattr_setkind_np(&latch_attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&new_instance->latch, &latch_attr);
+  for (size_t i = 0; i < YDB_PAGE_LATCH_COUNT; i++) {
+    pthread_rwlock_init(&new_instance->page_latches[i], &latch_attr);
+  }
+  pthread_rwlockattr_destroy(&latch_attr);
+  pthread_mutex_init(&new_instance->io_lock, NULL);
+  pthread_mutex_init(&new_instance->stats_lock, NULL);
   return new_instance;
 }
 
-void ydb_terminate_instance(YDB_Engine *instance) {
-  ydb_unload_table(instance);
+void ydb_terminate_instance(YDB_Engine *instance) {
+  ydb_unload_table(instance);
+  ydb_storage_close(instance->wal_storage);
+
+  // And after all that, the instance could be freed
+  ydb_page_free(instance->view);
+  ydb_page_allocator_free(instance->allocator);
+  pthread_rwlock_destroy(&instance->latch);
+  for (size_t i = 0; i < YDB_PAGE_LATCH_COUNT; i++) {
+    pthread_rwlock_destroy(&instance->page_latches[i]);
+  }
+  pthread_mutex_destroy(&instance->io_lock);
+  pthread_mutex_destroy(&instance->stats_lock);
+  free(instance);
+}
+
+static void __ydb_view_release(void *ctx);
+
+// Statistics.
+// Cursors read and write back pages too, so counters are changed under a lock of their own, and the trace
+// callback is called outside of it. With YDB_NO_STATS both helpers are empty and calls to them are optimized out.
+
+static uint64_t __ydb_stats_start(void) {
+#ifdef YDB_NO_STATS
+  return 0;
+#else
+  return ydb_stats_now();
+#endif
+}
+
+// Counts an event that started at `start`.
+static void __ydb_stats_record(YDB_Engine *inst, YDB_TraceEvent event, YDB_Offset offset, size_t size,
+                               uint64_t start) {
+#ifdef YDB_NO_STATS
+  (void) inst;
+  (void) event;
+  (void) offset;
+  (void) size;
+  (void) start;
+#else
+  const uint64_t ns = ydb_stats_now() - start;
+  pthread_mutex_lock(&inst->stats_lock);
+  ydb_stats_add(&inst->stats, event, size, ns);
+  YDB_TraceFn trace = inst->trace;
+  void *trace_ctx = inst->trace_ctx;
+  pthread_mutex_unlock(&inst->stats_lock);
+  if (trace) trace(trace_ctx, event, offset, size, ns);
+#endif
+}
+
+// The page size of the table.
+static YDB_PageSize __ydb_page_size(const YDB_Engine *inst) {
+  return (YDB_PageSize) inst->layout.page_size;
+}
+
+// The size of page data in the table.
+static YDB_PageSize __ydb_data_size(const YDB_Engine *inst) {
+  return (YDB_PageSize) (inst->layout.page_size - inst->layout.data_offset);
+}
+
+// Whether tables could have pages of that size.
+static int __ydb_page_size_valid(uint64_t size) {
+  return size >= YDB_TABLE_PAGE_SIZE_MIN && size <= YDB_TABLE_PAGE_SIZE_MAX && !(size & (size - 1));
+}
+
+// The amount of entries in a directory or map page: as many as fit page data and the row count field.
+static size_t __ydb_entries_per_page(const YDB_Engine *inst, size_t entry_size) {
+  size_t count = __ydb_data_size(inst) / entry_size;
+  return count < YDB_TABLE_PAGE_MAX_ROW_COUNT ? count : YDB_TABLE_PAGE_MAX_ROW_COUNT;
+}
+
+// Latches.
+// The instance is changed by its owner thread only, while cursors read pages from other threads.
+// Cursors hold the table latch shared for a page switch and the page latch shared while copying the page.
+// The owner takes the page latch exclusive to change page contents, and the table latch exclusive to change
+// anything cursors follow to find pages. Page latch is never held while waiting for the table latch.
+
+// Takes the table latch exclusive. Only the owner does it, so the latch could be taken again while held.
+static void __ydb_latch_exclusive(YDB_Engine *inst) {
+  if (!inst->latch_depth++) {
+    pthread_rwlock_wrlock(&inst->latch);
+  }
+}
+
+static void __ydb_unlatch_exclusive(YDB_Engine *inst) {
+  if (!--inst->latch_depth) {
+    pthread_rwlock_unlock(&inst->latch);
+  }
+}
+
+static pthread_rwlock_t *__ydb_page_latch(YDB_Engine *inst, YDB_Offset offset) {
+  return &inst->page_latches[(offset / __ydb_page_size(inst)) % YDB_PAGE_LATCH_COUNT];
+}
+
+// Re-points current page view if the storage mapping has moved.
+static void __ydb_view_remap(YDB_Engine *inst, const char *old_base) {
+  if (old_base == ydb_storage_map(inst->storage, 0, 0) || !ydb_page_data_ptr(inst->view)) {
+    return;
+  }
+  const YDB_PageSize data_size = __ydb_data_size(inst);
+  ydb_page_view_set(inst->view,
+                    ydb_storage_map(inst->storage, inst->view_offset + inst->layout.data_offset, data_size),
+                    data_size,
+                    ydb_page_flags_get(inst->view),
+                    ydb_page_row_count_get(inst->view),
+                    __ydb_view_release, inst);
+}
+
+// Page cache read callback. Also used to read the file header.
+static YDB_Error __ydb_file_read(void *ctx, YDB_Offset offset, void *dst, size_t size) {
+  YDB_Engine *inst = ctx;
+  const uint64_t start = __ydb_stats_start();
+  // Cursors read pages too, while the owner could restart read-ahead
+  pthread_mutex_lock(&inst->io_lock);
+  const int is_page = size == __ydb_page_size(inst);
+  int staged = inst->readahead && is_page && ydb_readahead_take(inst->readahead, offset, dst);
+  pthread_mutex_unlock(&inst->io_lock);
+  if (!is_page) {
+    return ydb_storage_read_at(inst->storage, offset, dst, size);
+  }
+
+  // Pages are checked, and pages of a table with compression are unpacked, on the way to the cache
+  const int packed = (inst->table_flags & YDB_TABLE_FLAG_COMPRESSED) != 0;
+  size_t image_size = size;
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (staged) {
+    if (packed) image_size = ydb_page_image_size(&inst->layout, dst);
+    if (!image_size) err = YDB_ERR_TABLE_DATA_CORRUPTED;
+  } else if (packed) {
+    err = ydb_page_read_image(&inst->layout, inst->storage, offset, dst, &image_size);
+  } else {
+    err = ydb_storage_read_at(inst->storage, offset, dst, size);
+  }
+  if (!err) {
+    __ydb_stats_record(inst, staged ? YDB_TRACE_READAHEAD_HIT : YDB_TRACE_PAGE_READ, offset, image_size, start);
+  }
+  if (!err) err = ydb_page_checksum_verify(&inst->layout, dst, image_size);
+  if (!err && packed) err = ydb_page_unpack(&inst->layout, dst);
+  return err;
+}
+
+// Fills the checksum of a cache frame leaving the cache. Nobody reads the field of a cached page,
+// so it could be filled while cursors are reading the page.
+static void __ydb_page_seal(YDB_Engine *inst, const void *page) {
+  if (inst->layout.checksums) {
+    ydb_page_checksum_set((char *) page, __ydb_page_size(inst));
+  }
+}
+
+// Prepares the table file to be changed when write-ahead log is used.
+// Changes must be durable in the log before they get to the table, and the table is marked as dirty:
+// it's consistent again only after the next checkpoint.
+static YDB_Error __ydb_wal_before_write(YDB_Engine *inst) {
+  YDB_Error err = ydb_wal_sync(inst->wal);
+  if (err) return err;
+
+  if (!inst->sign_dirty) {
+    err = ydb_storage_write_at(inst->storage, 0, YDB_TABLE_FILE_SIGN_DIRTY, YDB_TABLE_FILE_SIGN_SIZE);
+    if (err) return err;
+    inst->sign_dirty = 1;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Page cache write callback. Also used to write the file header.
+// Pages could be written back by cursors too, on eviction.
+static YDB_Error __ydb_file_write(void *ctx, YDB_Offset offset, const void *src, size_t size) {
+  YDB_Engine *inst = ctx;
+  const uint64_t start = __ydb_stats_start();
+
+  // Only compressed bytes of a page are written, unless it's not worth it. The page keeps its slot.
+  char *image = NULL;
+  size_t slot_size = size;
+  const int is_page = size == __ydb_page_size(inst);
+  if (is_page && inst->compression && (inst->table_flags & YDB_TABLE_FLAG_COMPRESSED)) {
+    image = malloc(size);
+    THROW_IF_NULL(image, YDB_ERR_TABLE_DATA_WRITE_FAILED);
+    size_t packed = ydb_page_pack(&inst->layout, src, image);
+    if (packed) {
+      src = image;
+      size = packed;
+      if (inst->layout.checksums) ydb_page_checksum_set(image, size);
+    }
+  }
+  if (is_page && src != image) {
+    __ydb_page_seal(inst, src);
+  }
+
+  // Writing past the end may grow mapped storage and move the mapping. Only the owner writes mapped storage.
+  const int grow = inst->mapped && offset + size > ydb_storage_size(inst->storage);
+  if (grow) __ydb_latch_exclusive(inst);
+  pthread_mutex_lock(&inst->io_lock);
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (inst->wal) {
+    err = __ydb_wal_before_write(inst);
+  }
+  if (!err && offset + slot_size > ydb_storage_size(inst->storage) && size < slot_size) {
+    // A page at the end of the file still takes its whole slot
+    err = ydb_storage_truncate(inst->storage, offset + slot_size);
+  }
+  if (!err) {
+    ydb_readahead_invalidate(inst->readahead, offset, slot_size);
+    const char *base = ydb_storage_map(inst->storage, 0, 0);
+    err = ydb_storage_write_at(inst->storage, offset, src, size);
+    if (inst->mapped) {
+      __ydb_view_remap(inst, base);
+    }
+  }
+
+  pthread_mutex_unlock(&inst->io_lock);
+  if (grow) __ydb_unlatch_exclusive(inst);
+  free(image);
+  if (!err) __ydb_stats_record(inst, is_page ? YDB_TRACE_PAGE_WRITE : YDB_TRACE_HEADER_WRITE, offset, size, start);
+  return err;
+}
+
+// Vectored variant of __ydb_file_write(). Used by the owner only, to write past the end of the table.
+static YDB_Error __ydb_file_writev(YDB_Engine *inst, YDB_Offset offset, const YDB_IOVec *iov, size_t count) {
+  const uint64_t start = __ydb_stats_start();
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++) size += iov[i].size;
+
+  // Growth could move storage memory under cursors reading it
+  __ydb_latch_exclusive(inst);
+  pthread_mutex_lock(&inst->io_lock);
+  ydb_readahead_invalidate(inst->readahead, offset, size);
+
+  const char *base = ydb_storage_map(inst->storage, 0, 0);
+  YDB_Error err = ydb_storage_writev_at(inst->storage, offset, iov, count);
+  if (inst->mapped) {
+    __ydb_view_remap(inst, base);
+  }
+  pthread_mutex_unlock(&inst->io_lock);
+  __ydb_unlatch_exclusive(inst);
+  if (!err) __ydb_stats_record(inst, YDB_TRACE_PAGE_WRITE, offset, size, start);
+  return err;
+}
+
+// Syncs the table storage.
+static YDB_Error __ydb_storage_sync(YDB_Engine *inst) {
+  const uint64_t start = __ydb_stats_start();
+  YDB_Error err = ydb_storage_sync(inst->storage);
+  if (!err) __ydb_stats_record(inst, YDB_TRACE_SYNC, 0, 0, start);
+  return err;
+}
+
+// Pins a page: returns a pointer to page bytes in the cache or right in the mapped storage.
+static YDB_Error __ydb_page_pin(YDB_Engine *inst, YDB_Offset offset, char **frame) {
+  if (inst->mapped) {
+    *frame = ydb_storage_map(inst->storage, offset, __ydb_page_size(inst));
+    THROW_IF_NULL(*frame, YDB_ERR_TABLE_DATA_CORRUPTED);
+    return YDB_ERR_SUCCESS;
+  }
+  return ydb_cache_pin(inst->cache, offset, frame);
+}
+
+// Pins a page past the end of the file. Mapped storage is grown by a page.
+static YDB_Error __ydb_page_pin_new(YDB_Engine *inst, YDB_Offset offset, char **frame) {
+  if (inst->mapped) {
+    __ydb_latch_exclusive(inst);
+    const char *base = ydb_storage_map(inst->storage, 0, 0);
+    YDB_Error err = ydb_storage_truncate(inst->storage, offset + __ydb_page_size(inst));
+    __ydb_view_remap(inst, base);
+    __ydb_unlatch_exclusive(inst);
+    if (err) return err;
+    return __ydb_page_pin(inst, offset, frame);
+  }
+  return ydb_cache_pin_new(inst->cache, offset, frame);
+}
+
+// Pins a page that is going to be overwritten as a whole, without reading it. The frame is zero-filled and dirty.
+static YDB_Error __ydb_page_pin_blank(YDB_Engine *inst, YDB_Offset offset, char **frame) {
+  // A cursor that stood on the page before it was freed could still read it
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, offset);
+  pthread_rwlock_wrlock(latch);
+  YDB_Error err;
+  if (inst->mapped) {
+    err = __ydb_page_pin(inst, offset, frame);
+    if (!err) memset(*frame, 0, __ydb_page_size(inst));
+  } else {
+    err = ydb_cache_pin_new(inst->cache, offset, frame);
+  }
+  pthread_rwlock_unlock(latch);
+  return err;
+}
+
+static void __ydb_page_unpin(YDB_Engine *inst, YDB_Offset offset) {
+  ydb_cache_unpin(inst->cache, offset);
+}
+
+static void __ydb_page_mark_dirty(YDB_Engine *inst, YDB_Offset offset) {
+  ydb_cache_mark_dirty(inst->cache, offset);
+}
+
+// The size of the changeable part of the file header.
+#define __YDB_HEADER_SIZE (YDB_v1_7_data_offset - YDB_v1_first_page_offset)
+
+// Fills the fields stored in the file header (starting with first page offset). Returns their size in bytes.
+static size_t __ydb_header_fill(YDB_Engine *inst, char header[__YDB_HEADER_SIZE]) {
+  YDB_Offset fields[] = {
+      TO_LE(inst->first_page_offset),
+      TO_LE(inst->last_page_offset),
+      TO_LE(inst->last_free_page_offset),
+      TO_LE(inst->dir_offset),
+      TO_LE(inst->fsm_offset),
+      TO_LE(inst->table_flags),
+  };
+  size_t n = 3;
+  if (inst->dir_persistent) n++;
+  if (inst->fsm_persistent) n++;
+  if (inst->ver_minor >= YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS) n++;
+  memcpy(header, fields, n * sizeof(YDB_Offset));
+  if (inst->ver_minor < YDB_TABLE_FILE_VER_MINOR_SCHEMA) {
+    return n * sizeof(YDB_Offset);
+  }
+
+  // Page size never changes, it's written only to keep the rest of the header in one piece
+  uint32_t page_size_le = TO_LE((uint32_t) __ydb_page_size(inst));
+  YDB_Offset schema_le = TO_LE(inst->schema_offset);
+  memcpy(header + (YDB_v1_page_size_offset - YDB_v1_first_page_offset), &page_size_le, sizeof(page_size_le));
+  memcpy(header + (YDB_v1_schema_offset - YDB_v1_first_page_offset), &schema_le, sizeof(schema_le));
+  return __YDB_HEADER_SIZE;
+}
+
+// Reads back the fields filled by __ydb_header_fill().
+static void __ydb_header_parse(YDB_Engine *inst, const char header[__YDB_HEADER_SIZE]) {
+  YDB_Offset fields[6] = {0};
+  size_t n = 3;
+  if (inst->dir_persistent) n++;
+  if (inst->fsm_persistent) n++;
+  if (inst->ver_minor >= YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS) n++;
+  memcpy(fields, header, n * sizeof(YDB_Offset));
+
+  size_t k = 0;
+  inst->first_page_offset = FROM_LE(fields[k++]);
+  inst->last_page_offset = FROM_LE(fields[k++]);
+  inst->last_free_page_offset = FROM_LE(fields[k++]);
+  if (inst->dir_persistent) inst->dir_offset = FROM_LE(fields[k++]);
+  if (inst->fsm_persistent) inst->fsm_offset = FROM_LE(fields[k++]);
+  if (inst->ver_minor >= YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS) inst->table_flags = FROM_LE(fields[k++]);
+  if (inst->ver_minor >= YDB_TABLE_FILE_VER_MINOR_SCHEMA) {
+    memcpy(&inst->schema_offset, header + (YDB_v1_schema_offset - YDB_v1_first_page_offset), sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(inst->schema_offset);
+  }
+}
+
+// Writes first, last and last free page offsets (and the rest of header fields) to the file header.
+static YDB_Error __ydb_write_header(YDB_Engine *inst) {
+  char header[__YDB_HEADER_SIZE];
+  size_t size = __ydb_header_fill(inst, header);
+  return __ydb_file_write(inst, YDB_v1_first_page_offset, header, size);
+}
+
+// Write-ahead log: writes pages changed by an operation to the table, then the header.
+// The log is emptied after that.
+// Cursors could write pages back on eviction meanwhile, so the log and the signature are changed under I/O lock.
+static YDB_Error __ydb_checkpoint(YDB_Engine *inst) {
+  pthread_mutex_lock(&inst->io_lock);
+  YDB_Error err = ydb_wal_sync(inst->wal);
+  pthread_mutex_unlock(&inst->io_lock);
+  if (err) return err;
+  err = ydb_cache_flush(inst->cache);
+  if (err) return err;
+  err = __ydb_write_header(inst);
+  if (err) return err;
+  err = __ydb_storage_sync(inst);
+  if (err) return err;
+
+  // The table is consistent on its own now. Nothing is dirty, so nothing is written back until the log is reset.
+  pthread_mutex_lock(&inst->io_lock);
+  if (inst->sign_dirty) {
+    err = ydb_storage_write_at(inst->storage, 0, YDB_TABLE_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE);
+    if (!err) err = __ydb_storage_sync(inst);
+    if (!err) inst->sign_dirty = 0;
+  }
+  if (!err) err = ydb_wal_reset(inst->wal);
+  pthread_mutex_unlock(&inst->io_lock);
+  return err;
+}
+
+// Page cache visitor that logs a page image.
+static YDB_Error __ydb_wal_log_page(void *ctx, YDB_Offset offset, const void *data, size_t size) {
+  YDB_Engine *inst = ctx;
+  // Page images are replayed to the table as they are
+  __ydb_page_seal(inst, data);
+  YDB_IOVec iov = {data, size};
+  return ydb_wal_append(inst->wal, offset, &iov, 1);
+}
+
+// Commits an operation to write-ahead log: images of the pages changed by it and the file header.
+// The pages get to the table later, on eviction or checkpoint.
+static YDB_Error __ydb_wal_commit(YDB_Engine *inst) {
+  // The log refers to the frames until the commit is written, so they are not evicted till then
+  YDB_Error err = ydb_cache_visit_held(inst->cache, __ydb_wal_log_page, inst);
+
+  char header[__YDB_HEADER_SIZE];
+  YDB_IOVec iov = {header, __ydb_header_fill(inst, header)};
+  pthread_mutex_lock(&inst->io_lock);
+  if (!err) err = ydb_wal_append(inst->wal, YDB_v1_first_page_offset, &iov, 1);
+  if (!err) err = ydb_wal_commit(inst->wal);
+  pthread_mutex_unlock(&inst->io_lock);
+  // Frames of an operation that failed to commit stay held until it's rolled back
+  if (err) return err;
+  err = ydb_cache_release_held(inst->cache, NULL, NULL);
+  if (err) return err;
+
+  if (ydb_wal_size(inst->wal) >= YDB_WAL_CHECKPOINT_SIZE) {
+    return __ydb_checkpoint(inst);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_fsm_store(YDB_Engine *inst);
+
+// Writes all the changes made by an operation: dirty pages first, then the header.
+static YDB_Error __ydb_sync(YDB_Engine *inst) {
+  const uint64_t start = __ydb_stats_start();
+  YDB_Error err = __ydb_fsm_store(inst);
+  if (err) return err;
+
+  if (inst->wal) {
+    err = __ydb_wal_commit(inst);
+  } else {
+    // Mapped pages are modified in place, only the header is left.
+    // Notice that storage is not synced, the data is only handed to the OS.
+    if (inst->cache) {
+      err = ydb_cache_flush(inst->cache);
+    }
+    if (!err) err = __ydb_write_header(inst);
+  }
+  if (err) return err;
+
+  inst->synced_file_size = inst->file_size;
+  __ydb_stats_record(inst, YDB_TRACE_FLUSH, 0, 0, start);
+  return YDB_ERR_SUCCESS;
+}
+
+// Patches an offset field in the page header of a page at `page_offset`.
+static YDB_Error __ydb_page_set_link(YDB_Engine *inst, YDB_Offset page_offset,
+                                     enum YDB_v1_page_offsets field, YDB_Offset value) {
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, page_offset, &frame);
+  if (err) return err;
+
+  YDB_Offset value_le = TO_LE(value);
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, page_offset);
+  pthread_rwlock_wrlock(latch);
+  memcpy(frame + field, &value_le, sizeof(value_le));
+  pthread_rwlock_unlock(latch);
+
+  __ydb_page_mark_dirty(inst, page_offset);
+  __ydb_page_unpin(inst, page_offset);
+  return YDB_ERR_SUCCESS;
+}
+
+// Unpins the page borrowed by current page view.
+static void __ydb_view_release(void *ctx) {
+  YDB_Engine *inst = ctx;
+  __ydb_page_unpin(inst, inst->view_offset);
+}
+
+// Internal usage only!
+// Its only purpose to read current page data and set next_page and prev_page offsets.
+static YDB_Error __ydb_read_page(YDB_Engine *inst) {
+  THROW_IF_NULL(inst, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  const uint64_t start = __ydb_stats_start();
+
+  // Get current page from cache (reads it on miss) or mapped file
+  char *p_data;
+  YDB_Error err = __ydb_page_pin(inst, inst->curr_page_offset, &p_data);
+  if (err) return err;
+
+  // Read page flags, next and prev page offset and row count
+  YDB_Flags page_flags = p_data[0];
+  YDB_Offset next;
+  YDB_Offset prev;
+  uint16_t row_count;
+  memcpy(&next, p_data + YDB_v1_page_next_offset, sizeof(next));
+  REASSIGN_FROM_LE(next);
+  memcpy(&prev, p_data + YDB_v1_page_prev_offset, sizeof(prev));
+  REASSIGN_FROM_LE(prev);
+  memcpy(&row_count, p_data + YDB_v1_page_row_count_offset, sizeof(row_count));
+  REASSIGN_FROM_LE(row_count);
+
+  const YDB_PageSize meta_size = (YDB_PageSize) inst->layout.data_offset;
+  const YDB_PageSize data_size = __ydb_data_size(inst);
+
+  // Drop the page passed to ydb_replace_current_page()
+  if (inst->curr_page != inst->view) {
+    ydb_page_free(inst->curr_page);
+  }
+
+  // Borrow page data instead of copying it. The page stays pinned until the view is re-pointed.
+  ydb_page_view_reset(inst->view);
+  inst->view_offset = inst->curr_page_offset;
+  ydb_page_view_set(inst->view, p_data + meta_size, data_size, page_flags, row_count,
+                    __ydb_view_release, inst);
+  inst->curr_page = inst->view;
+
+  inst->prev_page_offset = prev;
+  inst->next_page_offset = next;
+
+  // Let the next page be read while this one is processed
+  if (inst->readahead) {
+    ydb_readahead_hint(inst->readahead, next);
+  } else if (inst->readahead_depth && next) {
+    ydb_storage_prefetch(inst->storage, next, __ydb_page_size(inst));
+  }
+
+  __ydb_stats_record(inst, YDB_TRACE_PAGE_SWITCH, inst->curr_page_offset, __ydb_page_size(inst), start);
+  return YDB_ERR_SUCCESS;
+}
+
+// Read-ahead callback: gets next page offset from a page header.
+static YDB_Offset __ydb_readahead_next(void *ctx, const char *page) {
+  (void) ctx;
+  YDB_Offset next;
+  memcpy(&next, page + YDB_v1_page_next_offset, sizeof(next));
+  REASSIGN_FROM_LE(next);
+  return next;
+}
+
+// (Re)starts background read-ahead according to instance settings.
+// The read-ahead thread reads storage concurrently, so it's used only with the cache and unmappable storage:
+// mapped storage could be moved by growth at any time. Mapped pages are prefetched by OS instead.
+static void __ydb_readahead_restart(YDB_Engine *inst) {
+  pthread_mutex_lock(&inst->io_lock);
+  ydb_readahead_stop(inst->readahead);
+  inst->readahead = NULL;
+
+  if (inst->readahead_depth && inst->cache && !ydb_storage_can_map(inst->storage)) {
+    inst->readahead = ydb_readahead_start(inst->storage, __ydb_page_size(inst), inst->readahead_depth,
+                                          __ydb_readahead_next, inst);
+  }
+  pthread_mutex_unlock(&inst->io_lock);
+}
+
+// Free space map.
+// Since v1.3 every page in the file has a byte in the map: #YDB_FSM_FREE for a free page, otherwise free space
+// of the page in units of 1/#YDB_FSM_CATEGORY_COUNT of the page size. The map is kept in memory and stored in a chain of map pages
+// referenced from the file header, and replaces the free page list. Older tables keep using the list.
+
+static size_t __ydb_fsm_index(const YDB_Engine *inst, YDB_Offset offset) {
+  return (size_t) ((offset - inst->data_offset) / __ydb_page_size(inst));
+}
+
+static YDB_Offset __ydb_fsm_page_offset(const YDB_Engine *inst, size_t index) {
+  return inst->data_offset + (YDB_Offset) index * __ydb_page_size(inst);
+}
+
+// Free space of a map category in bytes.
+static size_t __ydb_fsm_category_size(const YDB_Engine *inst) {
+  return __ydb_page_size(inst) / YDB_FSM_CATEGORY_COUNT;
+}
+
+// Map entry of a table page.
+static uint8_t __ydb_fsm_category(const YDB_Engine *inst, const YDB_TablePage *page) {
+  return (uint8_t) (ydb_page_free_space(page) / __ydb_fsm_category_size(inst));
+}
+
+static void __ydb_fsm_clear(YDB_Engine *inst) {
+  free(inst->fsm);
+  free(inst->fsm_pages);
+  inst->fsm = NULL;
+  inst->fsm_pages = NULL;
+  inst->fsm_count = inst->fsm_capacity = inst->fsm_free_count = 0;
+  inst->fsm_dirty_begin = inst->fsm_dirty_end = 0;
+  inst->fsm_page_count = inst->fsm_page_capacity = 0;
+  inst->fsm_offset = 0;
+  inst->fsm_persistent = 0;
+}
+
+// Sets map entry of a page. The map grows with the file, pages past its end are in use.
+static void __ydb_fsm_set(YDB_Engine *inst, YDB_Offset offset, uint8_t value) {
+  size_t index = __ydb_fsm_index(inst, offset);
+  if (index >= inst->fsm_count) {
+    if (index >= inst->fsm_capacity) {
+      size_t capacity = inst->fsm_capacity ? inst->fsm_capacity : 64;
+      while (capacity <= index) capacity *= 2;
+      inst->fsm = realloc(inst->fsm, capacity);
+      inst->fsm_capacity = capacity;
+    }
+    memset(inst->fsm + inst->fsm_count, 0, index + 1 - inst->fsm_count);
+    if (inst->fsm_dirty_begin == inst->fsm_dirty_end || inst->fsm_count < inst->fsm_dirty_begin) {
+      inst->fsm_dirty_begin = inst->fsm_count;
+    }
+    inst->fsm_count = index + 1;
+  }
+
+  if (inst->fsm[index] == YDB_FSM_FREE) inst->fsm_free_count--;
+  if (value == YDB_FSM_FREE) inst->fsm_free_count++;
+  inst->fsm[index] = value;
+
+  if (inst->fsm_dirty_begin == inst->fsm_dirty_end || index < inst->fsm_dirty_begin) {
+    inst->fsm_dirty_begin = index;
+  }
+  if (index + 1 > inst->fsm_dirty_end) {
+    inst->fsm_dirty_end = index + 1;
+  }
+}
+
+// Finds `n` free pages in a row. A run starting at `hint` is preferred, so that related pages are physically
+// contiguous, then the first run in the file. Returns the amount of map entries if there is none.
+static size_t __ydb_fsm_find(const YDB_Engine *inst, size_t n, size_t hint) {
+  if (inst->fsm_free_count < n) return inst->fsm_count;
+
+  if (hint + n <= inst->fsm_count) {
+    size_t i = 0;
+    while (i < n && inst->fsm[hint + i] == YDB_FSM_FREE) i++;
+    if (i == n) return hint;
+  }
+
+  if (n == 1) {
+    const uint8_t *p = memchr(inst->fsm, YDB_FSM_FREE, inst->fsm_count);
+    return p ? (size_t) (p - inst->fsm) : inst->fsm_count;
+  }
+  size_t run = 0;
+  for (size_t i = 0; i < inst->fsm_count; i++) {
+    run = inst->fsm[i] == YDB_FSM_FREE ? run + 1 : 0;
+    if (run == n) return i + 1 - n;
+  }
+  return inst->fsm_count;
+}
+
+// Updates map entry of a table page after it was written.
+static void __ydb_fsm_update(YDB_Engine *inst, YDB_Offset offset, const YDB_TablePage *page) {
+  if (inst->fsm_persistent) {
+    __ydb_fsm_set(inst, offset, __ydb_fsm_category(inst, page));
+  }
+}
+
+static YDB_Error __ydb_allocate_raw_page(YDB_Engine *inst, YDB_Offset *offset, char **frame);
+static void __ydb_dir_reserve(YDB_Offset **array, size_t *capacity, size_t count);
+
+// Writes map entries changed since the last call to map pages.
+// Map pages are allocated to fit the map, which could grow the map itself. The map never shrinks.
+static YDB_Error __ydb_fsm_store(YDB_Engine *inst) {
+  if (!inst->fsm_persistent) return YDB_ERR_SUCCESS;
+
+  const size_t per_page = __ydb_entries_per_page(inst, 1);
+  YDB_Error err;
+
+  while (inst->fsm_page_count * per_page < inst->fsm_count) {
+    YDB_Offset offset;
+    char *frame;
+    err = __ydb_allocate_raw_page(inst, &offset, &frame);
+    if (err) return err;
+
+    YDB_Offset prev = inst->fsm_pages[inst->fsm_page_count - 1];
+    YDB_Offset prev_le = TO_LE(prev);
+    frame[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP;
+    memcpy(frame + YDB_v1_page_prev_offset, &prev_le, sizeof(prev_le));
+    __ydb_page_unpin(inst, offset);
+
+    err = __ydb_page_set_link(inst, prev, YDB_v1_page_next_offset, offset);
+    if (err) return err;
+    __ydb_dir_reserve(&inst->fsm_pages, &inst->fsm_page_capacity, inst->fsm_page_count + 1);
+    inst->fsm_pages[inst->fsm_page_count++] = offset;
+  }
+
+  if (inst->fsm_dirty_begin == inst->fsm_dirty_end) return YDB_ERR_SUCCESS;
+
+  for (size_t k = inst->fsm_dirty_begin / per_page; k < inst->fsm_page_count && k * per_page < inst->fsm_dirty_end;
+       k++) {
+    YDB_Offset offset = inst->fsm_pages[k];
+    char *frame;
+    err = __ydb_page_pin(inst, offset, &frame);
+    if (err) return err;
+
+    size_t begin = k * per_page;
+    size_t end = begin + per_page < inst->fsm_count ? begin + per_page : inst->fsm_count;
+    if (end < begin) end = begin; // Map pages past the end of the map are left empty by compaction
+    size_t from = inst->fsm_dirty_begin > begin ? inst->fsm_dirty_begin : begin;
+    size_t to = inst->fsm_dirty_end < end ? inst->fsm_dirty_end : end;
+    if (from < to) {
+      memcpy(frame + inst->layout.data_offset + (from - begin), inst->fsm + from, to - from);
+    }
+    uint16_t count_le = TO_LE((uint16_t) (end - begin));
+    memcpy(frame + YDB_v1_page_row_count_offset, &count_le, sizeof(count_le));
+
+    __ydb_page_mark_dirty(inst, offset);
+    __ydb_page_unpin(inst, offset);
+  }
+  inst->fsm_dirty_begin = inst->fsm_dirty_end = 0;
+  return YDB_ERR_SUCCESS;
+}
+
+// Reads the map from map pages.
+static YDB_Error __ydb_fsm_load(YDB_Engine *inst) {
+  YDB_Offset offset = inst->fsm_offset;
+  while (offset) {
+    char *frame;
+    YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+    if (err) return err;
+    if (!(frame[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP)) {
+      __ydb_page_unpin(inst, offset);
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+
+    uint16_t count;
+    memcpy(&count, frame + YDB_v1_page_row_count_offset, sizeof(count));
+    REASSIGN_FROM_LE(count);
+    const size_t per_page = __ydb_entries_per_page(inst, 1);
+    if (count > per_page) count = (uint16_t) per_page;
+
+    if (inst->fsm_count + count > inst->fsm_capacity) {
+      inst->fsm_capacity = inst->fsm_count + count;
+      inst->fsm = realloc(inst->fsm, inst->fsm_capacity);
+    }
+    memcpy(inst->fsm + inst->fsm_count, frame + inst->layout.data_offset, count);
+    for (size_t i = 0; i < count; i++) {
+      if (inst->fsm[inst->fsm_count + i] == YDB_FSM_FREE) inst->fsm_free_count++;
+    }
+    inst->fsm_count += count;
+    __ydb_dir_reserve(&inst->fsm_pages, &inst->fsm_page_capacity, inst->fsm_page_count + 1);
+    inst->fsm_pages[inst->fsm_page_count++] = offset;
+
+    YDB_Offset next;
+    memcpy(&next, frame + YDB_v1_page_next_offset, sizeof(next));
+    REASSIGN_FROM_LE(next);
+    __ydb_page_unpin(inst, offset);
+    offset = next;
+  }
+  if (!inst->fsm_page_count) return YDB_ERR_TABLE_DATA_CORRUPTED;
+  return YDB_ERR_SUCCESS;
+}
+
+// Allocates a page, either by popping the free page list (taking a free page from the map since v1.3)
+// or by growing the file. The new page frame is returned pinned and dirty, with clear header.
+static YDB_Error __ydb_allocate_raw_page(YDB_Engine *inst, YDB_Offset *offset, char **frame) {
+  const uint64_t start = __ydb_stats_start();
+  YDB_Offset result;
+  YDB_Error err;
+
+  if (inst->fsm_persistent) {
+    // A page right after the last one keeps the page chain physically sequential
+    size_t index = __ydb_fsm_find(inst, 1, __ydb_fsm_index(inst, inst->last_page_offset) + 1);
+    const int reused = index < inst->fsm_count;
+    if (reused) {
+      // Nothing is left in a free page, so it is not read
+      result = __ydb_fsm_page_offset(inst, index);
+      err = __ydb_page_pin_blank(inst, result, frame);
+      if (err) return err;
+    } else {
+      result = inst->file_size;
+      err = __ydb_page_pin_new(inst, result, frame);
+      if (err) return err;
+      inst->file_size += __ydb_page_size(inst);
+    }
+    __ydb_fsm_set(inst, result, 0);
+    *offset = result;
+    __ydb_stats_record(inst, reused ? YDB_TRACE_PAGE_REUSE : YDB_TRACE_PAGE_ALLOC, result, __ydb_page_size(inst),
+                       start);
+    return YDB_ERR_SUCCESS;
+  }
+
+  // If no free pages in the table, then...
+  const int reused = inst->last_free_page_offset != 0;
+  if (!reused) {
+    // Allocate a page at the end of the file
+    result = inst->file_size;
+    err = __ydb_page_pin_new(inst, result, frame);
+    if (err) return err;
+    inst->file_size += __ydb_page_size(inst);
+  } else {
+    // Pop last free page
+    result = inst->last_free_page_offset;
+    err = __ydb_page_pin(inst, result, frame);
+    if (err) return err;
+
+    // Read last free page offset after allocation
+    memcpy(&inst->last_free_page_offset, *frame + YDB_v1_page_next_offset, sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(inst->last_free_page_offset);
+
+    // Clear page header. A cursor that stood on the page before it was freed could still read it.
+    pthread_rwlock_t *latch = __ydb_page_latch(inst, result);
+    pthread_rwlock_wrlock(latch);
+    memset(*frame, 0, YDB_v1_page_data_offset);
+    pthread_rwlock_unlock(latch);
+    __ydb_page_mark_dirty(inst, result);
+  }
+
+  *offset = result;
+  __ydb_stats_record(inst, reused ? YDB_TRACE_PAGE_REUSE : YDB_TRACE_PAGE_ALLOC, result, __ydb_page_size(inst),
+                     start);
+  return YDB_ERR_SUCCESS;
+}
+
+// Frees a page that is not linked anywhere, pushing it to the free page list (marking it free in the map).
+static YDB_Error __ydb_free_raw_page(YDB_Engine *inst, YDB_Offset offset) {
+  const uint64_t start = __ydb_stats_start();
+  if (inst->fsm_persistent) {
+    __ydb_fsm_set(inst, offset, YDB_FSM_FREE);
+    __ydb_stats_record(inst, YDB_TRACE_PAGE_FREE, offset, __ydb_page_size(inst), start);
+    return YDB_ERR_SUCCESS;
+  }
+
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+  if (err) return err;
+
+  YDB_Offset lfp_le = TO_LE(inst->last_free_page_offset);
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, offset);
+  pthread_rwlock_wrlock(latch);
+  frame[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_DELETED;
+  memcpy(frame + YDB_v1_page_next_offset, &lfp_le, sizeof(YDB_Offset));
+  memset(frame + YDB_v1_page_prev_offset, 0, sizeof(YDB_Offset));
+  pthread_rwlock_unlock(latch);
+
+  __ydb_page_mark_dirty(inst, offset);
+  __ydb_page_unpin(inst, offset);
+  inst->last_free_page_offset = offset;
+  __ydb_stats_record(inst, YDB_TRACE_PAGE_FREE, offset, __ydb_page_size(inst), start);
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_dir_push(YDB_Engine *inst, YDB_Offset first, size_t n);
+
+// Links `n` contiguous pages, already linked with each other, after the last page and adds them to
+// the directory. Changes last_page_offset. Pages must be written before: cursors could reach them right away.
+static YDB_Error __ydb_link_pages(YDB_Engine *inst, YDB_Offset first, size_t n) {
+  __ydb_latch_exclusive(inst);
+  YDB_Error err = __ydb_page_set_link(inst, inst->last_page_offset, YDB_v1_page_next_offset, first);
+  if (!err) {
+    inst->last_page_offset = first + (n - 1) * __ydb_page_size(inst);
+    err = __ydb_dir_push(inst, first, n);
+  }
+  __ydb_unlatch_exclusive(inst);
+  return err;
+}
+
+static YDB_Error __ydb_dir_store_entry(YDB_Engine *inst, size_t index);
+static size_t __ydb_dir_entry_zones(const YDB_Engine *inst);
+
+// Zone maps.
+// Summaries of zone-mapped columns are kept in memory for every page of the directory, in the same order.
+// Since v1.8 they are also stored in directory entries and loaded with the directory, older tables get them
+// built by the first filtered scan. They follow page changes, computed from the same pages the indexes are
+// updated from. Anything that could leave them behind drops them to be built again.
+
+static void __ydb_zone_clear(YDB_Engine *inst) {
+  free(inst->zones);
+  free(inst->zone_columns);
+  inst->zones = NULL;
+  inst->zone_columns = NULL;
+  inst->zone_count = inst->zone_capacity = inst->zone_column_count = 0;
+  inst->zones_valid = 0;
+}
+
+// The amount of zone-mapped columns of a schema (NULL for none).
+static size_t __ydb_zone_column_count(const YDB_Schema *schema) {
+  if (!schema) return 0;
+  size_t n = 0;
+  const size_t count = ydb_schema_column_count(schema);
+  for (size_t i = 0; i < count; i++) {
+    if (ydb_schema_column(schema, i)->flags & YDB_COLUMN_FLAG_ZONE_MAP) n++;
+  }
+  return n;
+}
+
+// Drops zone maps and starts new ones for zone-mapped columns of the schema, with no pages summarized.
+static void __ydb_zone_init(YDB_Engine *inst) {
+  __ydb_zone_clear(inst);
+  const size_t count = inst->schema ? ydb_schema_column_count(inst->schema) : 0;
+  inst->zone_columns = malloc((count + 1) * sizeof(size_t));
+  for (size_t i = 0; i < count; i++) {
+    if (ydb_schema_column(inst->schema, i)->flags & YDB_COLUMN_FLAG_ZONE_MAP) {
+      inst->zone_columns[inst->zone_column_count++] = i;
+    }
+  }
+  inst->zones_valid = 1;
+}
+
+// Writes a zone map as it is stored in a directory entry.
+static void __ydb_zone_write(const YDB_ZoneMap *zone, char *dst) {
+  uint64_t min_le = TO_LE(zone->min.u);
+  uint64_t max_le = TO_LE(zone->max.u);
+  uint16_t value_count_le = TO_LE((uint16_t) zone->value_count);
+  uint16_t null_count_le = TO_LE((uint16_t) zone->null_count);
+  memcpy(dst + YDB_zone_map_min_offset, &min_le, sizeof(min_le));
+  memcpy(dst + YDB_zone_map_max_offset, &max_le, sizeof(max_le));
+  memcpy(dst + YDB_zone_map_value_count_offset, &value_count_le, sizeof(value_count_le));
+  memcpy(dst + YDB_zone_map_null_count_offset, &null_count_le, sizeof(null_count_le));
+  dst[YDB_zone_map_flags_offset] = (char) (zone->unknown ? YDB_ZONE_MAP_FLAG_UNKNOWN : 0);
+  memset(dst + YDB_zone_map_reserved_offset, 0, YDB_zone_map_reserved_size);
+}
+
+// Reads a zone map stored in a directory entry.
+static void __ydb_zone_read(const char *src, YDB_ZoneMap *zone) {
+  uint64_t min, max;
+  uint16_t value_count, null_count;
+  memcpy(&min, src + YDB_zone_map_min_offset, sizeof(min));
+  memcpy(&max, src + YDB_zone_map_max_offset, sizeof(max));
+  memcpy(&value_count, src + YDB_zone_map_value_count_offset, sizeof(value_count));
+  memcpy(&null_count, src + YDB_zone_map_null_count_offset, sizeof(null_count));
+  ydb_zone_map_init(zone);
+  zone->min.u = FROM_LE(min);
+  zone->max.u = FROM_LE(max);
+  zone->value_count = FROM_LE(value_count);
+  zone->null_count = FROM_LE(null_count);
+  zone->unknown = (uint8_t) (src[YDB_zone_map_flags_offset] & YDB_ZONE_MAP_FLAG_UNKNOWN);
+}
+
+// Summarizes zone-mapped columns of a page (NULL for none). Pages other than row pages have no values.
+static void __ydb_zone_compute(const YDB_Engine *inst, YDB_TablePage *page, YDB_ZoneMap *zones) {
+  const size_t n = inst->zone_column_count;
+  for (size_t k = 0; k < n; k++) {
+    ydb_zone_map_init(&zones[k]);
+  }
+  if (!page) return;
+
+  const YDB_Flags flags = ydb_page_flags_get(page);
+  if (flags & YDB_TABLE_PAGE_FLAG_PAX) {
+    for (size_t k = 0; k < n; k++) {
+      const YDB_Column *c = ydb_schema_column(inst->schema, inst->zone_columns[k]);
+      YDB_PaxColumn minipage;
+      if (ydb_page_pax_column(page, inst->schema, inst->zone_columns[k], &minipage)) {
+        zones[k].unknown = 1;
+        continue;
+      }
+      for (YDB_PageSize r = 0; r < minipage.count; r++) {
+        const void *value = ydb_pax_is_null(&minipage, r) ? NULL : (const char *) minipage.values + r * c->width;
+        ydb_zone_map_add(c, &zones[k], value);
+      }
+    }
+  } else if (flags & YDB_TABLE_PAGE_FLAG_SLOTTED) {
+    const YDB_PageSize count = ydb_page_row_count_get(page);
+    for (YDB_PageSize r = 0; r < count; r++) {
+      const void *row;
+      YDB_PageSize size;
+      if (ydb_page_row_get(page, r, &row, &size)) continue;
+      if (ydb_row_check(inst->schema, row, size)) {
+        for (size_t k = 0; k < n; k++) {
+          zones[k].unknown = 1;
+        }
+        return;
+      }
+      for (size_t k = 0; k < n; k++) {
+        const YDB_Column *c = ydb_schema_column(inst->schema, inst->zone_columns[k]);
+        const void *value = ydb_row_is_null(inst->schema, row, inst->zone_columns[k]) ? NULL
+                            : (const char *) row + c->offset;
+        ydb_zone_map_add(c, &zones[k], value);
+      }
+    }
+  }
+}
+
+static void __ydb_zone_reserve(YDB_Engine *inst, size_t count) {
+  if (count <= inst->zone_capacity) return;
+  size_t new_capacity = inst->zone_capacity ? inst->zone_capacity : 64;
+  while (new_capacity < count) new_capacity *= 2;
+  inst->zones = realloc(inst->zones, (new_capacity * inst->zone_column_count + 1) * sizeof(YDB_ZoneMap));
+  inst->zone_capacity = new_capacity;
+}
+
+// Summarizes the page at `index` of the directory, which is either summarized already or the next one.
+static void __ydb_zone_update(YDB_Engine *inst, size_t index, YDB_TablePage *page) {
+  if (!inst->zones_valid) return;
+  if (index > inst->zone_count) {
+    __ydb_zone_clear(inst);
+    return;
+  }
+
+  if (index == inst->zone_count) {
+    __ydb_zone_reserve(inst, inst->zone_count + 1);
+    inst->zone_count++;
+  }
+  __ydb_zone_compute(inst, page, inst->zones + index * inst->zone_column_count);
+}
+
+// Summarizes a changed page and stores its directory entry. Without zone maps in memory the stored
+// ones are marked unknown. Entries without zone maps hold nothing that could change here.
+static YDB_Error __ydb_zone_set(YDB_Engine *inst, size_t index, YDB_TablePage *page) {
+  __ydb_zone_update(inst, index, page);
+  if (!__ydb_dir_entry_zones(inst)) return YDB_ERR_SUCCESS;
+  return __ydb_dir_store_entry(inst, index);
+}
+
+// Drops the summary of a page removed from the directory.
+static void __ydb_zone_remove(YDB_Engine *inst, size_t index) {
+  if (!inst->zones_valid) return;
+  if (index >= inst->zone_count) {
+    __ydb_zone_clear(inst);
+    return;
+  }
+
+  const size_t n = inst->zone_column_count;
+  memmove(inst->zones + index * n, inst->zones + (index + 1) * n,
+          (inst->zone_count - index - 1) * n * sizeof(YDB_ZoneMap));
+  inst->zone_count--;
+}
+
+// Whether a page could have rows matching all the predicates.
+static int __ydb_zone_may_match(const YDB_Engine *inst, size_t index, const YDB_Predicate *predicates,
+                                size_t predicate_count) {
+  if (!inst->zones_valid || inst->zone_count != inst->dir_count) return 1;
+
+  for (size_t i = 0; i < predicate_count; i++) {
+    for (size_t k = 0; k < inst->zone_column_count; k++) {
+      if (inst->zone_columns[k] != predicates[i].column) continue;
+      const YDB_Column *c = ydb_schema_column(inst->schema, predicates[i].column);
+      if (!ydb_zone_map_may_match(c, &inst->zones[index * inst->zone_column_count + k], &predicates[i])) return 0;
+    }
+  }
+  return 1;
+}
+
+// Page directory.
+// All the page offsets are kept in memory. Since v1.2 they are also stored in a chain of directory pages
+// (page data is an array of entries, row count is the amount of them), referenced from the file header.
+// An entry is a page offset, since v1.8 followed by zone maps of the page for zone-mapped columns.
+// Older tables get the directory built on demand by walking the page chain, and it is never stored.
+
+static void __ydb_dir_reserve(YDB_Offset **array, size_t *capacity, size_t count) {
+  if (count <= *capacity) return;
+  size_t new_capacity = *capacity ? *capacity : 16;
+  while (new_capacity < count) new_capacity *= 2;
+  *array = realloc(*array, new_capacity * sizeof(YDB_Offset));
+  *capacity = new_capacity;
+}
+
+// Drops the page slots of the directory.
+static void __ydb_dir_slots_clear(YDB_Engine *inst) {
+  free(inst->dir_slots);
+  inst->dir_slots = NULL;
+  inst->dir_slot_count = inst->dir_slot_capacity = 0;
+  inst->dir_slots_valid = 0;
+  inst->compact_begin = 0;
+}
+
+// Records the directory index of the page at `offset`, `index` is 0 for no page.
+static void __ydb_dir_slot_set(YDB_Engine *inst, YDB_Offset offset, size_t index) {
+  if (!inst->dir_slots_valid) return;
+  const size_t slot = __ydb_fsm_index(inst, offset);
+  if (slot >= inst->dir_slot_count) {
+    if (slot >= inst->dir_slot_capacity) {
+      size_t new_capacity = inst->dir_slot_capacity ? inst->dir_slot_capacity : 16;
+      while (new_capacity <= slot) new_capacity *= 2;
+      inst->dir_slots = realloc(inst->dir_slots, new_capacity * sizeof(size_t));
+      inst->dir_slot_capacity = new_capacity;
+    }
+    memset(inst->dir_slots + inst->dir_slot_count, 0, (slot + 1 - inst->dir_slot_count) * sizeof(size_t));
+    inst->dir_slot_count = slot + 1;
+  }
+  inst->dir_slots[slot] = index;
+}
+
+// Builds the page slots of the directory.
+static void __ydb_dir_slots_build(YDB_Engine *inst) {
+  if (inst->dir_slots_valid) return;
+  __ydb_dir_slots_clear(inst);
+  inst->dir_slots_valid = 1;
+  for (size_t i = 0; i < inst->dir_count; i++) {
+    __ydb_dir_slot_set(inst, inst->dir[i], i + 1);
+  }
+}
+
+static void __ydb_dir_clear(YDB_Engine *inst) {
+  __ydb_dir_slots_clear(inst);
+  free(inst->dir);
+  free(inst->dir_pages);
+  inst->dir = NULL;
+  inst->dir_pages = NULL;
+  inst->dir_count = inst->dir_capacity = 0;
+  inst->dir_page_count = inst->dir_page_capacity = 0;
+  inst->dir_offset = 0;
+  inst->dir_valid = 0;
+  inst->dir_persistent = 0;
+  inst->curr_index = 0;
+  __ydb_zone_clear(inst);
+}
+
+// The amount of zone maps in a directory entry.
+static size_t __ydb_dir_entry_zones(const YDB_Engine *inst) {
+  if (inst->ver_minor < YDB_TABLE_FILE_VER_MINOR_ZONE_MAPS) return 0;
+  return __ydb_zone_column_count(inst->schema);
+}
+
+// Writes directory entry `i`, with `n` zone maps. Zone maps of pages not summarized in memory are unknown.
+static void __ydb_dir_entry_write(const YDB_Engine *inst, size_t i, size_t n, char *dst) {
+  YDB_Offset entry_le = TO_LE(inst->dir[i]);
+  memcpy(dst, &entry_le, sizeof(entry_le));
+
+  const int known = inst->zones_valid && inst->zone_column_count == n && i < inst->zone_count;
+  for (size_t k = 0; k < n; k++) {
+    YDB_ZoneMap zone;
+    if (known) {
+      zone = inst->zones[i * n + k];
+    } else {
+      ydb_zone_map_init(&zone);
+      zone.unknown = 1;
+    }
+    __ydb_zone_write(&zone, dst + sizeof(YDB_Offset) + k * YDB_zone_map_entry_size);
+  }
+}
+
+// Writes directory entries starting with `index` to directory pages.
+// Directory pages are allocated or freed to fit the directory. There is always at least one.
+static YDB_Error __ydb_dir_store(YDB_Engine *inst, size_t index) {
+  if (!inst->dir_persistent) return YDB_ERR_SUCCESS;
+
+  const size_t zone_n = __ydb_dir_entry_zones(inst);
+  const size_t entry_size = sizeof(YDB_Offset) + zone_n * YDB_zone_map_entry_size;
+  const size_t per_page = __ydb_entries_per_page(inst, entry_size);
+  if (!per_page) return YDB_ERR_TABLE_DATA_CORRUPTED;
+  size_t needed = (inst->dir_count + per_page - 1) / per_page;
+  if (!needed) needed = 1;
+  YDB_Error err;
+
+  while (inst->dir_page_count < needed) {
+    YDB_Offset offset;
+    char *frame;
+    err = __ydb_allocate_raw_page(inst, &offset, &frame);
+    if (err) return err;
+
+    YDB_Offset prev = inst->dir_page_count ? inst->dir_pages[inst->dir_page_count - 1] : 0;
+    YDB_Offset prev_le = TO_LE(prev);
+    frame[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_DIRECTORY;
+    memcpy(frame + YDB_v1_page_prev_offset, &prev_le, sizeof(prev_le));
+    __ydb_page_unpin(inst, offset);
+
+    if (prev) {
+      err = __ydb_page_set_link(inst, prev, YDB_v1_page_next_offset, offset);
+      if (err) return err;
+    } else {
+      inst->dir_offset = offset;
+    }
+    __ydb_dir_reserve(&inst->dir_pages, &inst->dir_page_capacity, inst->dir_page_count + 1);
+    inst->dir_pages[inst->dir_page_count++] = offset;
+  }
+
+  while (inst->dir_page_count > needed) {
+    err = __ydb_free_raw_page(inst, inst->dir_pages[--inst->dir_page_count]);
+    if (err) return err;
+    err = __ydb_page_set_link(inst, inst->dir_pages[inst->dir_page_count - 1], YDB_v1_page_next_offset, 0);
+    if (err) return err;
+  }
+
+  for (size_t k = index / per_page; k < needed; k++) {
+    YDB_Offset offset = inst->dir_pages[k];
+    char *frame;
+    err = __ydb_page_pin(inst, offset, &frame);
+    if (err) return err;
+
+    size_t begin = k * per_page;
+    size_t end = begin + per_page < inst->dir_count ? begin + per_page : inst->dir_count;
+    size_t from = index > begin ? index : begin;
+    for (size_t i = from; i < end; i++) {
+      __ydb_dir_entry_write(inst, i, zone_n, frame + inst->layout.data_offset + (i - begin) * entry_size);
+    }
+    uint16_t count_le = TO_LE((uint16_t) (end > begin ? end - begin : 0));
+    memcpy(frame + YDB_v1_page_row_count_offset, &count_le, sizeof(count_le));
+
+    __ydb_page_mark_dirty(inst, offset);
+    __ydb_page_unpin(inst, offset);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Writes a single directory entry, which is in a directory page already.
+static YDB_Error __ydb_dir_store_entry(YDB_Engine *inst, size_t index) {
+  if (!inst->dir_persistent || index >= inst->dir_count) return YDB_ERR_SUCCESS;
+
+  const size_t zone_n = __ydb_dir_entry_zones(inst);
+  const size_t entry_size = sizeof(YDB_Offset) + zone_n * YDB_zone_map_entry_size;
+  const size_t per_page = __ydb_entries_per_page(inst, entry_size);
+  if (!per_page || index / per_page >= inst->dir_page_count) return YDB_ERR_TABLE_DATA_CORRUPTED;
+
+  YDB_Offset offset = inst->dir_pages[index / per_page];
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+  if (err) return err;
+  __ydb_dir_entry_write(inst, index, zone_n, frame + inst->layout.data_offset + (index % per_page) * entry_size);
+  __ydb_page_mark_dirty(inst, offset);
+  __ydb_page_unpin(inst, offset);
+  return YDB_ERR_SUCCESS;
+}
+
+// Adds pages to the end of the directory.
+static YDB_Error __ydb_dir_push(YDB_Engine *inst, YDB_Offset first, size_t n) {
+  if (!inst->dir_valid) return YDB_ERR_SUCCESS;
+
+  size_t index = inst->dir_count;
+  __ydb_dir_reserve(&inst->dir, &inst->dir_capacity, inst->dir_count + n);
+  for (size_t i = 0; i < n; i++) {
+    __ydb_dir_slot_set(inst, first + i * __ydb_page_size(inst), inst->dir_count + 1);
+    inst->dir[inst->dir_count++] = first + i * __ydb_page_size(inst);
+  }
+  return __ydb_dir_store(inst, index);
+}
+
+// Removes a page from the directory.
+static YDB_Error __ydb_dir_remove(YDB_Engine *inst, size_t index) {
+  if (!inst->dir_valid) return YDB_ERR_SUCCESS;
+
+  memmove(inst->dir + index, inst->dir + index + 1, (inst->dir_count - index - 1) * sizeof(YDB_Offset));
+  inst->dir_count--;
+  __ydb_dir_slots_clear(inst);
+  __ydb_zone_remove(inst, index);
+  return __ydb_dir_store(inst, index);
+}
+
+// Reads the directory from directory pages. Zone maps of v1.8 tables are read too: the schema is loaded before.
+static YDB_Error __ydb_dir_load(YDB_Engine *inst) {
+  const size_t zone_n = __ydb_dir_entry_zones(inst);
+  const size_t entry_size = sizeof(YDB_Offset) + zone_n * YDB_zone_map_entry_size;
+  if (zone_n) __ydb_zone_init(inst);
+
+  YDB_Offset offset = inst->dir_offset;
+  while (offset) {
+    char *frame;
+    YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+    if (err) return err;
+    if (!(frame[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_DIRECTORY)) {
+      __ydb_page_unpin(inst, offset);
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+
+    uint16_t count;
+    memcpy(&count, frame + YDB_v1_page_row_count_offset, sizeof(count));
+    REASSIGN_FROM_LE(count);
+    const size_t per_page = __ydb_entries_per_page(inst, entry_size);
+    if (!per_page) {
+      __ydb_page_unpin(inst, offset);
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    if (count > per_page) count = (uint16_t) per_page;
+
+    __ydb_dir_reserve(&inst->dir, &inst->dir_capacity, inst->dir_count + count);
+    if (zone_n) __ydb_zone_reserve(inst, inst->zone_count + count);
+    for (size_t i = 0; i < count; i++) {
+      const char *entry_data = frame + inst->layout.data_offset + i * entry_size;
+      YDB_Offset entry;
+      memcpy(&entry, entry_data, sizeof(entry));
+      inst->dir[inst->dir_count++] = FROM_LE(entry);
+      for (size_t k = 0; k < zone_n; k++) {
+        __ydb_zone_read(entry_data + sizeof(YDB_Offset) + k * YDB_zone_map_entry_size,
+                        &inst->zones[inst->zone_count * zone_n + k]);
+      }
+      if (zone_n) inst->zone_count++;
+    }
+    __ydb_dir_reserve(&inst->dir_pages, &inst->dir_page_capacity, inst->dir_page_count + 1);
+    inst->dir_pages[inst->dir_page_count++] = offset;
+
+    YDB_Offset next;
+    memcpy(&next, frame + YDB_v1_page_next_offset, sizeof(next));
+    REASSIGN_FROM_LE(next);
+    __ydb_page_unpin(inst, offset);
+    offset = next;
+  }
+  inst->dir_valid = 1;
+  return YDB_ERR_SUCCESS;
+}
+
+// Builds the directory of a table without stored one by walking the page chain.
+static YDB_Error __ydb_dir_build(YDB_Engine *inst) {
+  YDB_Offset offset = inst->first_page_offset;
+  while (offset) {
+    if (offset == inst->curr_page_offset) {
+      inst->curr_index = inst->dir_count;
+    }
+    __ydb_dir_reserve(&inst->dir, &inst->dir_capacity, inst->dir_count + 1);
+    inst->dir[inst->dir_count++] = offset;
+
+    char *frame;
+    YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+    if (err) return err;
+    YDB_Offset next;
+    memcpy(&next, frame + YDB_v1_page_next_offset, sizeof(next));
+    REASSIGN_FROM_LE(next);
+    __ydb_page_unpin(inst, offset);
+    offset = next;
+  }
+  inst->dir_valid = 1;
+  return YDB_ERR_SUCCESS;
+}
+
+// Builds the directory if there is none yet.
+static YDB_Error __ydb_dir_ensure(YDB_Engine *inst) {
+  if (inst->dir_valid) return YDB_ERR_SUCCESS;
+
+  __ydb_latch_exclusive(inst);
+  YDB_Error err = __ydb_dir_build(inst);
+  if (err) {
+    __ydb_dir_clear(inst);
+  }
+  __ydb_unlatch_exclusive(inst);
+  return err;
+}
+
+// Reads the schema page.
+static YDB_Error __ydb_schema_load(YDB_Engine *inst) {
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, inst->schema_offset, &frame);
+  if (err) return err;
+
+  uint16_t count;
+  memcpy(&count, frame + YDB_v1_page_row_count_offset, sizeof(count));
+  REASSIGN_FROM_LE(count);
+  if (!(frame[YDB_v1_page_flags_offset] & YDB_TABLE_PAGE_FLAG_SCHEMA) || !count ||
+      ydb_schema_read(frame + inst->layout.data_offset, __ydb_data_size(inst), count, &inst->schema)) {
+    err = YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+  __ydb_page_unpin(inst, inst->schema_offset);
+  return err;
+}
+
+// Reads and checks the file header.
+static YDB_Error __ydb_load_header(YDB_Engine *instance) {
+  // Read file header. v1.0 and v1.1 headers are shorter, so the rest is read after the version is known.
+  char header[YDB_v1_7_data_offset];
+  if (__ydb_file_read(instance, 0, header, YDB_v1_data_offset)) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+
+  // Check file signature
+  char signature[YDB_TABLE_FILE_SIGN_SIZE];
+  memcpy(signature, header, YDB_TABLE_FILE_SIGN_SIZE);
+  int signature_match = memcmp(signature, YDB_TABLE_FILE_SIGN, 3) == 0;
+  if (!signature_match) {
+    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+
+  instance->ver_major = header[YDB_TABLE_FILE_SIGN_SIZE];
+  instance->ver_minor = header[YDB_TABLE_FILE_SIGN_SIZE + YDB_TABLE_FILE_VER_MAJOR_SIZE];
+
+  if (instance->ver_major != 1) { // TODO proper version check!
+    return YDB_ERR_TABLE_DATA_VERSION_MISMATCH;
+  }
+
+  // Check consistency of a page
+  switch (signature[3]) {
+    case '!':
+      break;
+    case '?':
+      // Write-ahead log is replayed before the header is read, so the change is lost
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    default:
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+  }
+
+  memcpy(&instance->first_page_offset, header + YDB_v1_first_page_offset, sizeof(YDB_Offset));
+  REASSIGN_FROM_LE(instance->first_page_offset);
+  memcpy(&instance->last_page_offset, header + YDB_v1_last_page_offset, sizeof(YDB_Offset));
+  REASSIGN_FROM_LE(instance->last_page_offset);
+  memcpy(&instance->last_free_page_offset, header + YDB_v1_last_free_page_offset, sizeof(YDB_Offset));
+  REASSIGN_FROM_LE(instance->last_free_page_offset);
+
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_DIRECTORY) {
+    if (__ydb_file_read(instance, YDB_v1_directory_offset, header + YDB_v1_directory_offset,
+                        YDB_v1_directory_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    memcpy(&instance->dir_offset, header + YDB_v1_directory_offset, sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(instance->dir_offset);
+    instance->dir_persistent = 1;
+  }
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_FREE_SPACE_MAP) {
+    if (__ydb_file_read(instance, YDB_v1_free_space_map_offset, header + YDB_v1_free_space_map_offset,
+                        YDB_v1_free_space_map_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    memcpy(&instance->fsm_offset, header + YDB_v1_free_space_map_offset, sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(instance->fsm_offset);
+    instance->fsm_persistent = 1;
+  }
+  instance->data_offset = YDB_v1_3_data_offset;
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS) {
+    if (__ydb_file_read(instance, YDB_v1_table_flags_offset, header + YDB_v1_table_flags_offset,
+                        YDB_v1_table_flags_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    memcpy(&instance->table_flags, header + YDB_v1_table_flags_offset, sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(instance->table_flags);
+    instance->data_offset = YDB_v1_4_data_offset;
+  }
+  instance->layout.page_size = YDB_TABLE_PAGE_SIZE;
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_PAGE_SIZE) {
+    if (__ydb_file_read(instance, YDB_v1_page_size_offset, header + YDB_v1_page_size_offset,
+                        YDB_v1_page_size_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    uint32_t page_size;
+    memcpy(&page_size, header + YDB_v1_page_size_offset, sizeof(page_size));
+    REASSIGN_FROM_LE(page_size);
+    if (!__ydb_page_size_valid(page_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    instance->layout.page_size = page_size;
+    instance->data_offset = YDB_v1_6_data_offset;
+  }
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_SCHEMA) {
+    if (__ydb_file_read(instance, YDB_v1_schema_offset, header + YDB_v1_schema_offset, YDB_v1_schema_size)) {
+      return YDB_ERR_TABLE_DATA_CORRUPTED;
+    }
+    memcpy(&instance->schema_offset, header + YDB_v1_schema_offset, sizeof(YDB_Offset));
+    REASSIGN_FROM_LE(instance->schema_offset);
+    instance->data_offset = YDB_v1_7_data_offset;
+  }
+  instance->layout.checksums = instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_CHECKSUMS &&
+                               (instance->table_flags & YDB_TABLE_FLAG_CHECKSUMS);
+  instance->layout.data_offset = instance->layout.checksums ? YDB_v1_page_checksummed_data_offset
+                                                            : YDB_v1_page_data_offset;
+  // TODO check offsets
+
+  return YDB_ERR_SUCCESS;
+}
+
+// Write-ahead log replay callback.
+static YDB_Error __ydb_wal_apply(void *ctx, YDB_Offset offset, const void *data, size_t size) {
+  YDB_Engine *inst = ctx;
+  return ydb_storage_write_at(inst->storage, offset, data, size);
+}
+
+// Brings the table to the state of the last committed operation in write-ahead log and empties the log.
+static YDB_Error __ydb_wal_recover(YDB_Engine *inst) {
+  size_t applied;
+  YDB_Error err = ydb_wal_replay(inst->wal, __ydb_wal_apply, inst, &applied);
+  if (err) return err;
+
+  if (applied) {
+    err = __ydb_storage_sync(inst);
+    if (err) return err;
+    err = ydb_storage_write_at(inst->storage, 0, YDB_TABLE_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE);
+    if (err) return err;
+    err = __ydb_storage_sync(inst);
+    if (err) return err;
+  }
+  return ydb_wal_reset(inst->wal);
+}
+
+// Capacity of the page cache of a loaded table. With the log, an operation keeps the frames it changes
+// until it's committed, so the cache is never smaller than an operation needs.
+static size_t __ydb_cache_capacity(const YDB_Engine *inst) {
+  if (inst->wal && inst->cache_capacity < YDB_WAL_CACHE_MIN_CAPACITY) {
+    return YDB_WAL_CACHE_MIN_CAPACITY;
+  }
+  return inst->cache_capacity;
+}
+
+// Opens write-ahead log of a table loaded by path, creating it if needed.
+static YDB_Storage *__ydb_wal_storage_open(const char *path) {
+  char *wal_path = malloc(strlen(path) + sizeof(YDB_WAL_FILE_SUFFIX));
+  strcpy(wal_path, path);
+  strcat(wal_path, YDB_WAL_FILE_SUFFIX);
+
+  YDB_Storage *storage = ydb_storage_pio_open(wal_path, 0);
+  if (!storage) {
+    storage = ydb_storage_pio_open(wal_path, 1);
+  }
+  free(wal_path);
+  return storage;
+}
+
+// Opens table storage by path with the backend selected by ydb_set_io_mode().
+static YDB_Storage *__ydb_storage_open(YDB_Engine *inst, const char *path, int create) {
+  switch (inst->io_mode) {
+    case YDB_IO_MMAP:
+      return ydb_storage_mmap_open(path, create);
+    case YDB_IO_PIO:
+    default:
+      return ydb_storage_pio_open(path, create);
+  }
+}
+
+YDB_Error ydb_load_table(YDB_Engine *instance, const char *path) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+
+  if (access(path, F_OK) == -1) {
+    // TODO: Windows does not check W_OK correctly, use other methods.
+    // TODO: if can't read/write, throw other error
+    return YDB_ERR_TABLE_NOT_EXIST;
+  }
+  YDB_Storage *storage = __ydb_storage_open(instance, path, 0);
+  THROW_IF_NULL(storage, YDB_ERR_UNKNOWN); // TODO file open error
+
+  if (instance->wal_enabled && !instance->wal_storage) {
+    instance->wal_storage = __ydb_wal_storage_open(path);
+    if (!instance->wal_storage) {
+      ydb_storage_close(storage);
+      return YDB_ERR_WAL_OPEN_FAILED;
+    }
+  }
+
+  YDB_Error err = ydb_load_table_from(instance, storage);
+  if (err) {
+    ydb_storage_close(storage);
+    return err;
+  }
+  instance->filename = strdup(path);
+  return YDB_ERR_SUCCESS;
+}
+
+// Drops everything a load has set up past the header, the storage is left to the caller.
+static void __ydb_load_abort(YDB_Engine *inst) {
+  ydb_readahead_stop(inst->readahead);
+  inst->readahead = NULL;
+  ydb_page_view_reset(inst->view);
+  inst->curr_page = NULL;
+  inst->curr_page_offset = 0;
+  ydb_schema_free(inst->schema);
+  inst->schema = NULL;
+  __ydb_dir_clear(inst);
+  __ydb_fsm_clear(inst);
+  inst->schema_offset = 0;
+  ydb_cache_free(inst->cache);
+  inst->cache = NULL;
+  ydb_wal_close(inst->wal);
+  inst->wal = NULL;
+  inst->storage = NULL;
+}
+
+YDB_Error ydb_load_table_from(YDB_Engine *instance, YDB_Storage *storage) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+
+  instance->storage = storage;
+
+  // The log owns its storage from now on
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (instance->wal_storage) {
+    instance->wal = ydb_wal_open(instance->wal_storage);
+    instance->wal_storage = NULL;
+    ydb_wal_set_group_commit(instance->wal, instance->group_commit);
+    err = __ydb_wal_recover(instance);
+  }
+
+  if (!err) err = __ydb_load_header(instance);
+  if (err) {
+    __ydb_dir_clear(instance);
+    __ydb_fsm_clear(instance);
+    ydb_wal_close(instance->wal);
+    instance->wal = NULL;
+    instance->storage = NULL;
+    return err;
+  }
+
+  // Once a table gets compressed pages, it always has to be read through the cache
+  if (instance->compression && instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_TABLE_FLAGS) {
+    instance->table_flags |= YDB_TABLE_FLAG_COMPRESSED;
+  }
+
+  // Mapped pages could be written back by OS at any time, so with the log they are accessed through the cache.
+  // So are pages of tables with checksums: checksums are filled and checked on the way to the storage and back.
+  instance->mapped = ydb_storage_can_map(storage) && !instance->wal &&
+                     !(instance->table_flags & (YDB_TABLE_FLAG_COMPRESSED | YDB_TABLE_FLAG_CHECKSUMS));
+
+  // Pages of tables with checksums or another page size have another data size.
+  // Pages left from the old allocator keep it alive.
+  if (instance->allocator_page_size != __ydb_data_size(instance)) {
+    ydb_page_allocator_free(instance->allocator);
+    instance->allocator_page_size = __ydb_data_size(instance);
+    instance->allocator = ydb_page_allocator_new(instance->allocator_page_size, YDB_PAGE_ALLOCATOR_DEFAULT_MAX_FREE);
+  }
+
+  instance->file_size = ydb_storage_size(storage);
+  instance->synced_file_size = instance->file_size;
+  if (!instance->mapped) {
+    instance->cache = ydb_cache_alloc(__ydb_cache_capacity(instance), __ydb_page_size(instance),
+                                      __ydb_file_read, __ydb_file_write, instance);
+    // With the log, pages changed by an operation reach the table only after the operation is logged
+    ydb_cache_set_no_steal(instance->cache, instance->wal != NULL);
+  }
+
+  // Directory entries of v1.8 tables depend on the schema
+  if (instance->schema_offset) {
+    err = __ydb_schema_load(instance);
+  }
+  if (!err && instance->dir_persistent) {
+    err = __ydb_dir_load(instance);
+  }
+  if (!err && instance->fsm_persistent) {
+    err = __ydb_fsm_load(instance);
+  }
+
+  // The instance is not in use until the first page is read, so a failed load leaves it free
+  if (!err) {
+    instance->curr_page_offset = instance->first_page_offset;
+    instance->curr_index = 0;
+    err = __ydb_read_page(instance);
+  }
+  if (err) {
+    __ydb_load_abort(instance);
+    return err;
+  }
+
+  instance->in_use = -1; // unsigned value overflow to fill all the bits
+  __ydb_readahead_restart(instance);
+  ydb_readahead_hint(instance->readahead, instance->next_page_offset);
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_unload_table(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->curr_page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->cursor_count, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(!instance->indexes, YDB_ERR_INSTANCE_IN_USE);
+
+  YDB_Engine *i = instance;
+
+  ydb_readahead_stop(i->readahead);
+  i->readahead = NULL;
+
+  if (i->wal) {
+    __ydb_checkpoint(i);
+    ydb_wal_close(i->wal);
+    i->wal = NULL;
+    i->sign_dirty = 0;
+  }
+
+  __ydb_dir_clear(i);
+  __ydb_fsm_clear(i);
+  ydb_schema_free(i->schema);
+  i->schema = NULL;
+  i->schema_offset = 0;
+
+  i->ver_major = 0;
+  i->ver_minor = 0;
+  i->data_offset = 0;
+  i->table_flags = 0;
+  i->layout.page_size = YDB_TABLE_PAGE_SIZE;
+  i->layout.data_offset = YDB_v1_page_data_offset;
+  i->layout.checksums = 0;
+  i->first_page_offset = 0;
+  i->last_page_offset = 0;
+  i->last_free_page_offset = 0;
+  i->prev_page_offset = 0;
+  i->curr_page_offset = 0;
+  i->next_page_offset = 0;
+  if (i->curr_page != i->view) {
+    ydb_page_free(i->curr_page);
+  }
+  ydb_page_view_reset(i->view);
+  i->curr_page = NULL;
+  ydb_cache_flush(i->cache);
+  ydb_cache_free(i->cache);
+  i->cache = NULL;
+  i->file_size = 0;
+  free(i->filename);
+  i->filename = NULL;
+  __ydb_storage_sync(i);
+  ydb_storage_close(i->storage);
+  i->storage = NULL;
+  i->mapped = 0;
+
+  // Unset "in use" flag
+  instance->in_use = 0;
+
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_create_table(YDB_Engine *instance, const char *path) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+
+  if (access(path, F_OK) != -1) {
+    // TODO: Windows does not check W_OK correctly, use other methods.
+    // TODO: if can't read/write, throw other error
+    return YDB_ERR_TABLE_EXIST;
+  }
+
+  YDB_Storage *storage = __ydb_storage_open(instance, path, 1);
+  THROW_IF_NULL(storage, YDB_ERR_UNKNOWN); // TODO file open error
+
+  if (instance->wal_enabled && !instance->wal_storage) {
+    instance->wal_storage = __ydb_wal_storage_open(path);
+    if (!instance->wal_storage) {
+      ydb_storage_close(storage);
+      return YDB_ERR_WAL_OPEN_FAILED;
+    }
+  }
+
+  YDB_Error err = ydb_create_table_in(instance, storage);
+  if (err) {
+    // The log is left unused if the table was not created
+    ydb_storage_close(instance->wal_storage);
+    instance->wal_storage = NULL;
+    ydb_storage_close(storage);
+    return err;
+  }
+  instance->filename = strdup(path);
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_create_table_in(YDB_Engine *instance, YDB_Storage *storage) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+
+  if (ydb_storage_size(storage) != 0) {
+    return YDB_ERR_TABLE_EXIST;
+  }
+
+  // A log left from another table must not be replayed
+  if (instance->wal_storage) {
+    YDB_Error err = ydb_storage_truncate(instance->wal_storage, 0);
+    if (err) return err;
+  }
+
+  // The first page is empty, the directory page refers to it. The free space map has an entry for every page.
+  const size_t page_size = instance->create_page_size;
+  const YDB_Offset first_page = YDB_v1_7_data_offset;
+  const YDB_Offset dir_page = first_page + page_size;
+  const YDB_Offset fsm_page = dir_page + page_size;
+
+  char header[YDB_v1_7_data_offset] = {0};
+  memcpy(header, YDB_TABLE_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE);
+  header[YDB_TABLE_FILE_SIGN_SIZE] = YDB_TABLE_FILE_VER_MAJOR;
+  header[YDB_TABLE_FILE_SIGN_SIZE + YDB_TABLE_FILE_VER_MAJOR_SIZE] = YDB_TABLE_FILE_VER_MINOR;
+  YDB_Offset first_page_le = TO_LE(first_page);
+  YDB_Offset dir_page_le = TO_LE(dir_page);
+  memcpy(header + YDB_v1_first_page_offset, &first_page_le, sizeof(YDB_Offset));
+  memcpy(header + YDB_v1_last_page_offset, &first_page_le, sizeof(YDB_Offset));
+  YDB_Offset fsm_page_le = TO_LE(fsm_page);
+  memcpy(header + YDB_v1_directory_offset, &dir_page_le, sizeof(YDB_Offset));
+  memcpy(header + YDB_v1_free_space_map_offset, &fsm_page_le, sizeof(YDB_Offset));
+  YDB_Offset table_flags = (instance->compression ? YDB_TABLE_FLAG_COMPRESSED : 0) |
+                           (instance->checksums ? YDB_TABLE_FLAG_CHECKSUMS : 0);
+  YDB_Offset table_flags_le = TO_LE(table_flags);
+  memcpy(header + YDB_v1_table_flags_offset, &table_flags_le, sizeof(YDB_Offset));
+  uint32_t page_size_le = TO_LE((uint32_t) page_size);
+  memcpy(header + YDB_v1_page_size_offset, &page_size_le, sizeof(page_size_le));
+  const size_t data_offset = instance->checksums ? YDB_v1_page_checksummed_data_offset : YDB_v1_page_data_offset;
+
+  char *pages = calloc(3, page_size);
+  char *dir = pages + (dir_page - first_page);
+  uint16_t dir_count_le = TO_LE((uint16_t) 1);
+  dir[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_DIRECTORY;
+  memcpy(dir + YDB_v1_page_row_count_offset, &dir_count_le, sizeof(dir_count_le));
+  memcpy(dir + data_offset, &first_page_le, sizeof(YDB_Offset));
+
+  // All three pages are in use, with no free space
+  char *fsm = pages + (fsm_page - first_page);
+  uint16_t fsm_count_le = TO_LE((uint16_t) 3);
+  fsm[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP;
+  memcpy(fsm + YDB_v1_page_row_count_offset, &fsm_count_le, sizeof(fsm_count_le));
+
+  if (instance->checksums) {
+    for (size_t i = 0; i < 3; i++) {
+      ydb_page_checksum_set(pages + i * page_size, page_size);
+    }
+  }
+
+  YDB_Error err = ydb_storage_write_at(storage, 0, header, sizeof(header));
+  if (!err) err = ydb_storage_write_at(storage, first_page, pages, 3 * page_size);
+  free(pages);
+  if (err) return err;
+
+  return ydb_load_table_from(instance, storage);
+}
+
+YDB_Error ydb_prev_page(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->prev_page_offset, YDB_ERR_NO_MORE_PAGES);
+
+  instance->curr_page_offset = instance->prev_page_offset;
+  instance->curr_index--;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_next_page(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->next_page_offset, YDB_ERR_NO_MORE_PAGES);
+
+  instance->curr_page_offset = instance->next_page_offset;
+  instance->curr_index++;
+  return __ydb_read_page(instance);
+}
+
+YDB_TablePage* ydb_get_current_page(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, NULL);
+  THROW_IF_NULL(instance->in_use, NULL);
+
+  return instance->curr_page;
+}
+
+// Checks that a page passed by user fits a page of the table: its data and its row count.
+// Smaller pages fit too, they are padded with zeros.
+static YDB_Error __ydb_page_check_fits(const YDB_Engine *inst, YDB_TablePage *page) {
+  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
+  THROW_IF_NULL(ydb_page_size_get(page) <= __ydb_data_size(inst), YDB_ERR_PAGE_TOO_LARGE);
+  THROW_IF_NULL(ydb_page_row_count_get(page) <= YDB_TABLE_PAGE_MAX_ROW_COUNT, YDB_ERR_PAGE_TOO_LARGE);
+  return YDB_ERR_SUCCESS;
+}
+
+// Copies data of a page passed by user to a frame, padding it with zeros up to table page data size.
+static void __ydb_page_copy_data(const YDB_Engine *inst, YDB_TablePage *page, char *frame) {
+  char *data = frame + inst->layout.data_offset;
+  const YDB_PageSize size = ydb_page_size_get(page);
+  if (size) memcpy(data, ydb_page_data_ptr(page), size);
+  memset(data + size, 0, __ydb_data_size(inst) - size);
+}
+
+/**
+ * @struct __YDB_Index
+ * @brief A struct that defines a secondary index of a loaded table.
+ */
+struct __YDB_Index {
+  YDB_Engine *instance; /**< The table. */
+  YDB_BTree *tree; /**< Index entries of a B+-tree index. */
+  YDB_HashIndex *hash; /**< Index entries of a hash index. */
+  YDB_IndexKeyFn key_fn; /**< A callback that makes the key of a row. */
+  void *ctx; /**< A context passed to `key_fn`. */
+  char *keys; /**< Room for an old and a new key of a row. */
+  YDB_Index *next; /**< The next index of the table. */
+};
+
+// Indexes.
+// Every row of a slotted page has an entry at its location in every open index, unless the key callback leaves
+// it out. Entries are changed by the same operation that changes the rows, and only for rows that change.
+
+// Both kinds of indexes keep the same entries, a hash index just can't visit them in key order.
+
+static size_t __ydb_index_key_size(const YDB_Index *index) {
+  return index->tree ? ydb_btree_key_size(index->tree) : ydb_hash_key_size(index->hash);
+}
+
+static YDB_Error __ydb_index_insert(YDB_Index *index, const void *key, YDB_RowLocation location) {
+  return index->tree ? ydb_btree_insert(index->tree, key, location) : ydb_hash_insert(index->hash, key, location);
+}
+
+static YDB_Error __ydb_index_delete(YDB_Index *index, const void *key, YDB_RowLocation location) {
+  return index->tree ? ydb_btree_delete(index->tree, key, location) : ydb_hash_delete(index->hash, key, location);
+}
+
+static YDB_Error __ydb_index_flush(YDB_Index *index) {
+  return index->tree ? ydb_btree_flush(index->tree) : ydb_hash_flush(index->hash);
+}
+
+// Gets the amount of rows a page has for indexes.
+static YDB_PageSize __ydb_index_row_count(YDB_TablePage *page) {
+  if (!page || !(ydb_page_flags_get(page) & YDB_TABLE_PAGE_FLAG_SLOTTED)) return 0;
+  return ydb_page_row_count_get(page);
+}
+
+// Makes the key of a row. Returns 0 if there is no such row or it's left out of the index.
+static int __ydb_index_key(const YDB_Index *index, YDB_TablePage *page, YDB_PageSize row_id, void *key) {
+  const void *row;
+  YDB_PageSize size;
+  if (ydb_page_row_get(page, row_id, &row, &size)) return 0;
+  return index->key_fn(index->ctx, row, size, key);
+}
+
+// Updates entries of a page at `offset` that changes from `old_page` to `new_page`. Either could be NULL
+// for a page that is added or removed. Rows that keep their keys keep their entries.
+static YDB_Error __ydb_index_update_one(YDB_Index *index, YDB_Offset offset, YDB_TablePage *old_page,
+                                        YDB_TablePage *new_page) {
+  const YDB_PageSize old_count = __ydb_index_row_count(old_page);
+  const YDB_PageSize new_count = __ydb_index_row_count(new_page);
+  const YDB_PageSize count = old_count > new_count ? old_count : new_count;
+  const size_t key_size = __ydb_index_key_size(index);
+  char *old_key = index->keys;
+  char *new_key = index->keys + key_size;
+
+  for (YDB_PageSize i = 0; i < count; i++) {
+    int has_old = i < old_count && __ydb_index_key(index, old_page, i, old_key);
+    int has_new = i < new_count && __ydb_index_key(index, new_page, i, new_key);
+    if (has_old && has_new && !memcmp(old_key, new_key, key_size)) continue;
+
+    YDB_RowLocation location = {offset, i};
+    if (has_old) {
+      YDB_Error err = __ydb_index_delete(index, old_key, location);
+      if (err && err != YDB_ERR_KEY_NOT_FOUND) return err;
+    }
+    if (has_new) {
+      YDB_Error err = __ydb_index_insert(index, new_key, location);
+      if (err) return err;
+    }
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Updates entries of a page in all the open indexes.
+static YDB_Error __ydb_index_update(YDB_Engine *inst, YDB_Offset offset, YDB_TablePage *old_page,
+                                    YDB_TablePage *new_page) {
+  for (YDB_Index *index = inst->indexes; index; index = index->next) {
+    YDB_Error err = __ydb_index_update_one(index, offset, old_page, new_page);
+    if (err) return err;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Wraps a page frame in a view. The caller frees it with ydb_page_free() while the frame is pinned.
+static YDB_TablePage *__ydb_index_frame_view(const YDB_Engine *inst, char *frame) {
+  uint16_t row_count;
+  memcpy(&row_count, frame + YDB_v1_page_row_count_offset, sizeof(row_count));
+  REASSIGN_FROM_LE(row_count);
+
+  YDB_TablePage *page = ydb_page_view_alloc();
+  ydb_page_view_set(page, frame + inst->layout.data_offset, __ydb_data_size(inst),
+                    frame[YDB_v1_page_flags_offset], row_count, NULL, NULL);
+  return page;
+}
+
+// Fills an empty index with rows of all the table pages.
+static YDB_Error __ydb_index_build(YDB_Index *index) {
+  YDB_Engine *inst = index->instance;
+  YDB_Error err = __ydb_dir_ensure(inst);
+  for (size_t i = 0; i < inst->dir_count && !err; i++) {
+    char *frame;
+    err = __ydb_page_pin(inst, inst->dir[i], &frame);
+    if (err) break;
+    YDB_TablePage *page = __ydb_index_frame_view(inst, frame);
+    err = __ydb_index_update_one(index, inst->dir[i], NULL, page);
+    ydb_page_free(page);
+    __ydb_page_unpin(inst, inst->dir[i]);
+  }
+  return err;
+}
+
+// Writes changes of all the open indexes.
+static YDB_Error __ydb_index_flush_all(YDB_Engine *inst) {
+  YDB_Error err = YDB_ERR_SUCCESS;
+  for (YDB_Index *index = inst->indexes; index; index = index->next) {
+    YDB_Error flush_err = __ydb_index_flush(index);
+    if (!err) err = flush_err;
+  }
+  return err;
+}
+
+// Rolls back an operation that failed with write-ahead log. Its changes are dropped from the cache and the log,
+// the table is brought to the last committed operation (dropped frames could have had committed changes that
+// did not reach the table yet) and everything kept in memory is read from the table again.
+static YDB_Error __ydb_rollback(YDB_Engine *inst) {
+  const YDB_Offset curr = inst->curr_page_offset;
+  const uint8_t dir_persistent = inst->dir_persistent;
+  const uint8_t fsm_persistent = inst->fsm_persistent;
+
+  // Cursors don't pin frames while the table latch is exclusive, and the view lets its frame go
+  __ydb_latch_exclusive(inst);
+  ydb_page_view_reset(inst->view);
+  ydb_cache_discard_held(inst->cache);
+
+  pthread_mutex_lock(&inst->io_lock);
+  ydb_wal_abort(inst->wal);
+  YDB_Error err = __ydb_wal_before_write(inst);
+  if (!err) err = ydb_wal_replay(inst->wal, __ydb_wal_apply, inst, NULL);
+
+  // Pages past the end of the table as of the last commit were written by the operation itself
+  YDB_Offset size = ydb_storage_size(inst->storage);
+  ydb_readahead_invalidate(inst->readahead, 0, (size_t) (size > inst->file_size ? size : inst->file_size));
+  if (!err && size > inst->synced_file_size) {
+    err = ydb_storage_truncate(inst->storage, inst->synced_file_size);
+  }
+  pthread_mutex_unlock(&inst->io_lock);
+  inst->file_size = inst->synced_file_size;
+  ydb_cache_discard(inst->cache, inst->file_size);
+
+  char header[__YDB_HEADER_SIZE];
+  if (!err) err = __ydb_file_read(inst, YDB_v1_first_page_offset, header, __ydb_header_fill(inst, header));
+  __ydb_dir_clear(inst);
+  __ydb_fsm_clear(inst);
+  inst->dir_persistent = dir_persistent;
+  inst->fsm_persistent = fsm_persistent;
+  ydb_schema_free(inst->schema);
+  inst->schema = NULL;
+  if (!err) __ydb_header_parse(inst, header);
+  if (!err && inst->schema_offset) err = __ydb_schema_load(inst);
+  if (!err && dir_persistent) err = __ydb_dir_load(inst);
+  if (!err && fsm_persistent) err = __ydb_fsm_load(inst);
+  if (!err) err = __ydb_dir_ensure(inst);
+  __ydb_unlatch_exclusive(inst);
+
+  for (YDB_Index *index = inst->indexes; index && !err; index = index->next) {
+    err = ydb_index_rebuild(index);
+  }
+  if (err) return err;
+
+  // Current page stays if it's still there
+  inst->curr_index = 0;
+  while (inst->curr_index < inst->dir_count && inst->dir[inst->curr_index] != curr) inst->curr_index++;
+  if (inst->curr_index == inst->dir_count) inst->curr_index = 0;
+  inst->curr_page_offset = inst->dir[inst->curr_index];
+  return __ydb_read_page(inst);
+}
+
+// Ends an operation. With write-ahead log, an operation that failed is rolled back, so that neither the table
+// nor the instance keeps a part of it.
+static YDB_Error __ydb_finish(YDB_Engine *inst, YDB_Error err) {
+  if (err && inst->wal) {
+    __ydb_rollback(inst);
+  }
+  return err;
+}
+
+static YDB_Error __ydb_append_page(YDB_Engine *instance, YDB_TablePage *page) {
+  const uint64_t start = __ydb_stats_start();
+  YDB_Offset new_page_offset;
+  char *frame;
+  YDB_Error err = __ydb_allocate_raw_page(instance, &new_page_offset, &frame);
+  if (err) return err;
+
+  uint16_t rc_le = TO_LE((uint16_t) ydb_page_row_count_get(page));
+  YDB_Flags f = ydb_page_flags_get(page);
+  YDB_Offset prev_le = TO_LE(instance->last_page_offset);
+
+  // Copy page data right into the cache frame or mapped file. The page is linked only after that,
+  // so cursors never see it half-written.
+  pthread_rwlock_t *latch = __ydb_page_latch(instance, new_page_offset);
+  pthread_rwlock_wrlock(latch);
+  __ydb_page_copy_data(instance, page, frame);
+  frame[YDB_v1_page_flags_offset] = f;
+  memcpy(frame + YDB_v1_page_prev_offset, &prev_le, sizeof(prev_le));
+  memcpy(frame + YDB_v1_page_row_count_offset, &rc_le, sizeof(rc_le));
+  pthread_rwlock_unlock(latch);
+  __ydb_page_unpin(instance, new_page_offset);
+  __ydb_fsm_update(instance, new_page_offset, page);
+
+  err = __ydb_link_pages(instance, new_page_offset, 1);
+  if (!err) err = __ydb_zone_set(instance, instance->dir_count - 1, page);
+  if (!err) err = __ydb_index_update(instance, new_page_offset, NULL, page);
+
+  if (!err) err = __ydb_sync(instance);
+  if (err) return err;
+
+  err = __ydb_read_page(instance);
+  if (!err) __ydb_stats_record(instance, YDB_TRACE_APPEND, new_page_offset, __ydb_page_size(instance), start);
+  return err;
+}
+
+YDB_Error ydb_append_page(YDB_Engine* instance, YDB_TablePage* page) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  YDB_Error err = __ydb_page_check_fits(instance, page);
+  if (err) return err;
+
+  return __ydb_finish(instance, __ydb_append_page(instance, page));
+}
+
+// Appends the first `*count` pages as a single operation and sets `*count` to the amount appended.
+// With the log, pages going through the cache stay there until the operation is committed, so there are
+// never more of them than the cache could hold.
+static YDB_Error __ydb_append_batch(YDB_Engine *instance, YDB_TablePage **pages, size_t *count) {
+  const uint64_t start = __ydb_stats_start();
+  const YDB_PageSize meta_size = (YDB_PageSize) instance->layout.data_offset;
+  const YDB_PageSize data_size = __ydb_data_size(instance);
+  const YDB_PageSize page_size = __ydb_page_size(instance);
+  size_t n = *count;
+  size_t cached_n = n;
+  if (instance->wal && cached_n > __ydb_cache_capacity(instance) - YDB_WAL_OPERATION_FRAMES) {
+    cached_n = __ydb_cache_capacity(instance) - YDB_WAL_OPERATION_FRAMES;
+  }
+
+  // The batch takes a run of free pages if the map has one, else it goes to the end of the file
+  // (free pages in the list are scattered over the file)
+  YDB_Offset first = instance->file_size;
+  int reuse = 0;
+  // Pages of a compressed table are compressed on their way from the cache, so the batch goes through it
+  const int through_cache = instance->compression && (instance->table_flags & YDB_TABLE_FLAG_COMPRESSED);
+  if (instance->fsm_persistent) {
+    size_t run = __ydb_fsm_find(instance, cached_n, __ydb_fsm_index(instance, instance->last_page_offset) + 1);
+    if (run < instance->fsm_count) {
+      first = __ydb_fsm_page_offset(instance, run);
+      reuse = 1;
+    }
+  }
+  if (reuse || through_cache) n = cached_n;
+  *count = n;
+
+  // Every page is written as its header followed by its data (and zero padding for smaller pages)
+  char *headers = malloc((size_t) n * meta_size);
+  YDB_IOVec *iov = malloc(sizeof(YDB_IOVec) * 3 * n);
+  char *zeros = NULL;
+  size_t iov_count = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    YDB_Offset offset = first + i * page_size;
+    YDB_Offset prev = i ? offset - page_size : instance->last_page_offset;
+    YDB_Offset next = i + 1 < n ? offset + page_size : 0;
+
+    char *h = headers + i * meta_size;
+    YDB_Offset prev_le = TO_LE(prev);
+    YDB_Offset next_le = TO_LE(next);
+    uint16_t rc_le = TO_LE((uint16_t) ydb_page_row_count_get(pages[i]));
+    h[YDB_v1_page_flags_offset] = ydb_page_flags_get(pages[i]);
+    memcpy(h + YDB_v1_page_next_offset, &next_le, sizeof(next_le));
+    memcpy(h + YDB_v1_page_prev_offset, &prev_le, sizeof(prev_le));
+    memcpy(h + YDB_v1_page_row_count_offset, &rc_le, sizeof(rc_le));
+    iov[iov_count++] = (YDB_IOVec) {h, meta_size};
+
+    // Page data is written right from the page, without copying
+    size_t size = ydb_page_size_get(pages[i]);
+    iov[iov_count++] = (YDB_IOVec) {ydb_page_data_ptr(pages[i]), size};
+    if (size < data_size) {
+      if (!zeros) zeros = calloc(1, data_size);
+      iov[iov_count++] = (YDB_IOVec) {zeros, data_size - size};
+    }
+
+    // The checksum covers the header, the data and the padding
+    if (instance->layout.checksums) {
+      uint32_t crc = ydb_crc32c(0, h, YDB_v1_page_checksum_offset);
+      crc = ydb_crc32c(crc, ydb_page_data_ptr(pages[i]), size);
+      if (size < data_size) crc = ydb_crc32c(crc, zeros, data_size - size);
+      uint32_t crc_le = TO_LE(crc);
+      memcpy(h + YDB_v1_page_checksum_offset, &crc_le, sizeof(crc_le));
+    }
+  }
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (reuse || through_cache) {
+    // Free pages go through the cache like any other page change, without being read
+    for (size_t i = 0, v = 0; i < n && !err; i++) {
+      YDB_Offset offset = first + i * page_size;
+      char *frame;
+      err = __ydb_page_pin_blank(instance, offset, &frame);
+      if (err) break;
+
+      pthread_rwlock_t *latch = __ydb_page_latch(instance, offset);
+      pthread_rwlock_wrlock(latch);
+      memcpy(frame, iov[v].base, iov[v].size);
+      memcpy(frame + meta_size, iov[v + 1].base, iov[v + 1].size);
+      pthread_rwlock_unlock(latch);
+      __ydb_page_unpin(instance, offset);
+      v += iov[v + 1].size < data_size ? 3 : 2;
+    }
+    if (!err && !reuse) instance->file_size += (YDB_Offset) n * page_size;
+  } else {
+    // Pages past the end of the table could be written before the operation is logged
+    err = __ydb_file_writev(instance, first, iov, iov_count);
+    if (!err && instance->wal) {
+      pthread_mutex_lock(&instance->io_lock);
+      err = ydb_wal_append(instance->wal, first, iov, iov_count);
+      pthread_mutex_unlock(&instance->io_lock);
+    }
+    if (!err) instance->file_size += (YDB_Offset) n * page_size;
+  }
+  if (!err) {
+    for (size_t i = 0; i < n; i++) {
+      __ydb_fsm_update(instance, first + i * page_size, pages[i]);
+      __ydb_stats_record(instance, reuse ? YDB_TRACE_PAGE_REUSE : YDB_TRACE_PAGE_ALLOC, first + i * page_size,
+                         page_size, start);
+    }
+
+    // Link the batch after the last page
+    err = __ydb_link_pages(instance, first, n);
+  }
+  for (size_t i = 0; i < n && !err; i++) {
+    err = __ydb_zone_set(instance, instance->dir_count - n + i, pages[i]);
+    if (!err) err = __ydb_index_update(instance, first + i * page_size, NULL, pages[i]);
+  }
+  if (!err) {
+    err = __ydb_sync(instance);
+  }
+
+  // The log refers to the buffers until the operation is committed
+  free(zeros);
+  free(iov);
+  free(headers);
+  if (err) return err;
+
+  err = __ydb_read_page(instance);
+  if (!err) __ydb_stats_record(instance, YDB_TRACE_APPEND, first, (size_t) n * page_size, start);
+  return err;
+}
+
+YDB_Error ydb_append_pages(YDB_Engine *instance, YDB_TablePage **pages, size_t n) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(pages || !n, YDB_ERR_PAGE_NOT_INITIALIZED);
+  for (size_t i = 0; i < n; i++) {
+    YDB_Error err = __ydb_page_check_fits(instance, pages[i]);
+    if (err) return err;
+  }
+
+  for (size_t done = 0; done < n;) {
+    size_t count = n - done;
+    YDB_Error err = __ydb_finish(instance, __ydb_append_batch(instance, pages + done, &count));
+    if (err) return err;
+    done += count;
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_replace_current_page(YDB_Engine *instance, YDB_TablePage *page) {
+  const uint64_t start = __ydb_stats_start();
+  YDB_Error err;
+
+  // Index entries are updated from the old rows, and the view is about to see the new ones
+  YDB_TablePage *old_page = instance->curr_page;
+  if (instance->indexes && old_page == instance->view) {
+    old_page = ydb_page_clone(instance->view);
+  }
+
+  char *frame;
+  err = __ydb_page_pin(instance, instance->curr_page_offset, &frame);
+  if (err) {
+    if (old_page != instance->curr_page) ydb_page_free(old_page);
+    return err;
+  }
+
+  // Cursors could be reading the page right now
+  pthread_rwlock_t *latch = __ydb_page_latch(instance, instance->curr_page_offset);
+  pthread_rwlock_wrlock(latch);
+
+  // Write data
+  __ydb_page_copy_data(instance, page, frame);
+
+  // Write flags and row count, next and prev page offsets are kept
+  frame[YDB_v1_page_flags_offset] = ydb_page_flags_get(page);
+  uint16_t row_cnt_le = TO_LE((uint16_t) ydb_page_row_count_get(page));
+  memcpy(frame + YDB_v1_page_row_count_offset, &row_cnt_le, sizeof(row_cnt_le));
+  pthread_rwlock_unlock(latch);
+
+  __ydb_page_mark_dirty(instance, instance->curr_page_offset);
+  __ydb_page_unpin(instance, instance->curr_page_offset);
+  __ydb_fsm_update(instance, instance->curr_page_offset, page);
+
+  // Index entries go with the page, so a failed update is not committed either
+  err = instance->dir_valid ? __ydb_zone_set(instance, instance->curr_index, page) : YDB_ERR_SUCCESS;
+  if (!err) err = __ydb_index_update(instance, instance->curr_page_offset, old_page, page);
+  if (old_page != instance->curr_page) ydb_page_free(old_page);
+
+  if (!err) err = __ydb_sync(instance);
+  if (err) return err;
+
+  if (instance->curr_page == instance->view) {
+    ydb_page_view_reset(instance->view);
+  } else {
+    ydb_page_free(instance->curr_page);
+  }
+  instance->curr_page = page;
+
+  __ydb_stats_record(instance, YDB_TRACE_REPLACE, instance->curr_page_offset, __ydb_page_size(instance), start);
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_replace_current_page(YDB_Engine *instance, YDB_TablePage *page) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  YDB_Error err = __ydb_page_check_fits(instance, page);
+  if (err) return err;
+  THROW_IF_NULL(instance->curr_page != page, YDB_ERR_SAME_PAGE_ADDRESS);
+
+  return __ydb_finish(instance, __ydb_replace_current_page(instance, page));
+}
+
+// Marks current page as deleted, unlinks it from the page chain and the directory and frees it.
+// The frame comes pinned.
+static YDB_Error __ydb_unlink_current_page(YDB_Engine *instance, char *frame) {
+  // Mark page as deleted and write last_free_page_offset as the next page for current one
+  // (null since v1.3: the page is marked free in the map instead)
+  YDB_Offset lfp_le = TO_LE(instance->last_free_page_offset);
+  pthread_rwlock_t *latch = __ydb_page_latch(instance, instance->curr_page_offset);
+  pthread_rwlock_wrlock(latch);
+  frame[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_DELETED;
+  memcpy(frame + YDB_v1_page_next_offset, &lfp_le, sizeof(YDB_Offset));
+  pthread_rwlock_unlock(latch);
+
+  __ydb_page_mark_dirty(instance, instance->curr_page_offset);
+  __ydb_page_unpin(instance, instance->curr_page_offset);
+
+  // Link the previous page with next one (could be null ptr)
+  YDB_Error err;
+  if (instance->prev_page_offset != 0) {
+    err = __ydb_page_set_link(instance, instance->prev_page_offset, YDB_v1_page_next_offset,
+                              instance->next_page_offset);
+    if (err) return err;
+  } else {
+    // If it was the first page, rewrite first_page_offset with next_page_offset
+    instance->first_page_offset = instance->next_page_offset;
+  }
+
+  // Link the next page with previous one (could be null ptr)
+  if (instance->next_page_offset != 0) {
+    err = __ydb_page_set_link(instance, instance->next_page_offset, YDB_v1_page_prev_offset,
+                              instance->prev_page_offset);
+    if (err) return err;
+  } else {
+    // If it was the last page, rewrite last_page_offset with prev_page_offset
+    instance->last_page_offset = instance->prev_page_offset;
+  }
+
+  // Rewrite last_free_page_offset with current offset
+  if (instance->fsm_persistent) {
+    __ydb_fsm_set(instance, instance->curr_page_offset, YDB_FSM_FREE);
+  } else {
+    instance->last_free_page_offset = instance->curr_page_offset;
+  }
+  __ydb_stats_record(instance, YDB_TRACE_PAGE_FREE, instance->curr_page_offset, __ydb_page_size(instance),
+                     __ydb_stats_start());
+
+  return __ydb_dir_remove(instance, instance->curr_index);
+}
+
+static YDB_Error __ydb_delete_current_page(YDB_Engine *instance) {
+  const uint64_t start = __ydb_stats_start();
+  const YDB_Offset deleted = instance->curr_page_offset;
+
+  // Rows of the page are gone either way
+  YDB_Error err = __ydb_index_update(instance, instance->curr_page_offset, instance->curr_page, NULL);
+  if (err) return err;
+
+  char *frame;
+  err = __ydb_page_pin(instance, instance->curr_page_offset, &frame);
+  if (err) return err;
+
+  if (instance->prev_page_offset == 0 && instance->next_page_offset == 0) {
+    // Just clear page header. That's all.
+    pthread_rwlock_t *latch = __ydb_page_latch(instance, instance->curr_page_offset);
+    pthread_rwlock_wrlock(latch);
+    memset(frame, 0, YDB_v1_page_data_offset);
+    pthread_rwlock_unlock(latch);
+    __ydb_page_mark_dirty(instance, instance->curr_page_offset);
+    __ydb_page_unpin(instance, instance->curr_page_offset);
+    __ydb_fsm_update(instance, instance->curr_page_offset, NULL);
+    if (instance->dir_valid) err = __ydb_zone_set(instance, instance->curr_index, NULL);
+    if (!err) err = __ydb_sync(instance);
+    if (!err) err = __ydb_read_page(instance);
+    if (!err) __ydb_stats_record(instance, YDB_TRACE_DELETE, deleted, __ydb_page_size(instance), start);
+    return err;
+  }
+
+  // Cursors must not follow the page chain while it's broken
+  __ydb_latch_exclusive(instance);
+  err = __ydb_unlink_current_page(instance, frame);
+  __ydb_unlatch_exclusive(instance);
+  if (err) return err;
+
+  err = __ydb_sync(instance);
+  if (err) return err;
+
+  // Seek to the next page if it's not the last, else seek to the previous one
+  if (instance->next_page_offset != 0) {
+    instance->curr_page_offset = instance->next_page_offset;
+  } else {
+    instance->curr_page_offset = instance->prev_page_offset;
+    instance->curr_index--;
+  }
+  err = __ydb_read_page(instance);
+  if (!err) __ydb_stats_record(instance, YDB_TRACE_DELETE, deleted, __ydb_page_size(instance), start);
+  return err;
+}
+
+YDB_Error ydb_delete_current_page(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  return __ydb_finish(instance, __ydb_delete_current_page(instance));
+}
+
+// Compaction.
+// Table pages are moved one by one to the start of the file in page chain order, then the rest of the pages in
+// use (directory, map and schema pages) are packed right after them, and the free tail of the file is cut off.
+// Every move is an operation of its own, so the table could be changed between the moves. The progress is
+// not kept anywhere: every step finds the first page out of place again.
+
+// Finds an offset in an array of page offsets. Returns `count` if there is none.
+static size_t __ydb_compact_find(const YDB_Offset *array, size_t count, YDB_Offset offset) {
+  size_t i = 0;
+  while (i < count && array[i] != offset) i++;
+  return i;
+}
+
+// Moves a page in use to a free page (or right past the end of the file), patching everything that refers to
+// it: neighbours, the file header, the directory and the map. The old copy is left deleted, so cursors
+// standing on it get #YDB_ERR_PAGE_DELETED, like with a deleted page.
+static YDB_Error __ydb_compact_move(YDB_Engine *inst, YDB_Offset from, YDB_Offset to) {
+  __ydb_latch_exclusive(inst);
+
+  // Growth could move mapped storage, so the destination is pinned first
+  char *dst, *src;
+  int grow = to >= inst->file_size;
+  YDB_Error err = grow ? __ydb_page_pin_new(inst, to, &dst) : __ydb_page_pin_blank(inst, to, &dst);
+  if (err) goto unlatch;
+  if (grow) inst->file_size += __ydb_page_size(inst);
+  err = __ydb_page_pin(inst, from, &src);
+  if (err) {
+    __ydb_page_unpin(inst, to);
+    goto unlatch;
+  }
+
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, to);
+  pthread_rwlock_wrlock(latch);
+  memcpy(dst, src, __ydb_page_size(inst));
+  pthread_rwlock_unlock(latch);
+  __ydb_page_mark_dirty(inst, to);
+  __ydb_page_unpin(inst, to);
+
+  YDB_Flags flags = src[YDB_v1_page_flags_offset];
+  YDB_Offset next, prev;
+  memcpy(&next, src + YDB_v1_page_next_offset, sizeof(next));
+  REASSIGN_FROM_LE(next);
+  memcpy(&prev, src + YDB_v1_page_prev_offset, sizeof(prev));
+  REASSIGN_FROM_LE(prev);
+
+  // Index entries follow rows of a table page
+  const YDB_Flags service_flags = YDB_TABLE_PAGE_FLAG_DIRECTORY | YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP |
+                                  YDB_TABLE_PAGE_FLAG_SCHEMA;
+  if (inst->indexes && !(flags & service_flags)) {
+    YDB_TablePage *page = __ydb_index_frame_view(inst, src);
+    err = __ydb_index_update(inst, from, page, NULL);
+    if (!err) err = __ydb_index_update(inst, to, NULL, page);
+    ydb_page_free(page);
+    if (err) {
+      __ydb_page_unpin(inst, from);
+      goto unlatch;
+    }
+  }
+
+  latch = __ydb_page_latch(inst, from);
+  pthread_rwlock_wrlock(latch);
+  src[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_DELETED;
+  pthread_rwlock_unlock(latch);
+  __ydb_page_mark_dirty(inst, from);
+  __ydb_page_unpin(inst, from);
+
+  __ydb_fsm_set(inst, to, inst->fsm[__ydb_fsm_index(inst, from)]);
+  __ydb_fsm_set(inst, from, YDB_FSM_FREE);
+
+  // Directory and map pages are chained the same way table pages are
+  if (prev) {
+    err = __ydb_page_set_link(inst, prev, YDB_v1_page_next_offset, to);
+    if (err) goto unlatch;
+  }
+  if (next) {
+    err = __ydb_page_set_link(inst, next, YDB_v1_page_prev_offset, to);
+    if (err) goto unlatch;
+  }
+
+  if (flags & YDB_TABLE_PAGE_FLAG_DIRECTORY) {
+    size_t k = __ydb_compact_find(inst->dir_pages, inst->dir_page_count, from);
+    if (k < inst->dir_page_count) inst->dir_pages[k] = to;
+    if (!prev) inst->dir_offset = to;
+  } else if (flags & YDB_TABLE_PAGE_FLAG_FREE_SPACE_MAP) {
+    size_t k = __ydb_compact_find(inst->fsm_pages, inst->fsm_page_count, from);
+    if (k < inst->fsm_page_count) inst->fsm_pages[k] = to;
+    if (!prev) inst->fsm_offset = to;
+  } else if (flags & YDB_TABLE_PAGE_FLAG_SCHEMA) {
+    inst->schema_offset = to;
+  } else {
+    if (!prev) inst->first_page_offset = to;
+    if (!next) inst->last_page_offset = to;
+    const size_t slot = __ydb_fsm_index(inst, from);
+    const size_t i = slot < inst->dir_slot_count ? inst->dir_slots[slot] : 0;
+    if (i) {
+      inst->dir[i - 1] = to;
+      __ydb_dir_slot_set(inst, from, 0);
+      __ydb_dir_slot_set(inst, to, i);
+      err = __ydb_dir_store_entry(inst, i - 1);
+      if (err) goto unlatch;
+    }
+
+    // The view must not borrow the old copy, it could be reused by the next move
+    if (inst->curr_page_offset == from) {
+      inst->curr_page_offset = to;
+      err = __ydb_read_page(inst);
+    }
+  }
+
+unlatch:
+  __ydb_unlatch_exclusive(inst);
+  if (err) return err;
+  return __ydb_sync(inst);
+}
+
+// Finds a free page to move a page out of the way to, past the place of table pages if possible.
+static YDB_Offset __ydb_compact_spare(const YDB_Engine *inst) {
+  size_t begin = inst->dir_count < inst->fsm_count ? inst->dir_count : inst->fsm_count;
+  const uint8_t *p = memchr(inst->fsm + begin, YDB_FSM_FREE, inst->fsm_count - begin);
+  if (!p) p = memchr(inst->fsm, YDB_FSM_FREE, inst->fsm_count);
+  return p ? __ydb_fsm_page_offset(inst, (size_t) (p - inst->fsm)) : inst->file_size;
+}
+
+// Cuts off free pages at the end of the file.
+static YDB_Error __ydb_compact_truncate(YDB_Engine *inst, size_t count) {
+  // The map and the header go first, so that a crash leaves no reference past the end of the file
+  inst->fsm_free_count -= inst->fsm_count - count;
+  inst->fsm_count = count;
+  if (inst->fsm_dirty_begin == inst->fsm_dirty_end || count < inst->fsm_dirty_begin) {
+    inst->fsm_dirty_begin = count ? count - 1 : 0;
+  }
+  inst->fsm_dirty_end = inst->fsm_page_count * __ydb_entries_per_page(inst, 1);
+  const YDB_Offset old_size = inst->file_size;
+  inst->file_size = __ydb_fsm_page_offset(inst, count);
+
+  YDB_Error err = __ydb_sync(inst);
+  if (err) return err;
+  if (inst->wal) {
+    // Nothing in the log could refer to the tail after a checkpoint
+    err = __ydb_checkpoint(inst);
+    if (err) return err;
+  }
+
+  // Copies of the cut pages must not be written back past the new end, nor be found by pages appended there
+  ydb_cache_discard(inst->cache, inst->file_size);
+  pthread_mutex_lock(&inst->io_lock);
+  ydb_readahead_invalidate(inst->readahead, inst->file_size, old_size - inst->file_size);
+  pthread_mutex_unlock(&inst->io_lock);
+
+  __ydb_latch_exclusive(inst);
+  const char *base = ydb_storage_map(inst->storage, 0, 0);
+  err = ydb_storage_truncate(inst->storage, inst->file_size);
+  if (inst->mapped) {
+    __ydb_view_remap(inst, base);
+  }
+  __ydb_unlatch_exclusive(inst);
+  return err;
+}
+
+// Makes a single compaction step. Sets `done` if there is nothing left to do.
+static YDB_Error __ydb_compact_step(YDB_Engine *inst, int *done) {
+  *done = 0;
+
+  // Table pages go first, in chain order. Pages in place stay there until one is removed from the directory.
+  size_t i = inst->compact_begin;
+  while (i < inst->dir_count && inst->dir[i] == __ydb_fsm_page_offset(inst, i)) i++;
+  inst->compact_begin = i;
+  if (i < inst->dir_count) {
+    YDB_Offset target = __ydb_fsm_page_offset(inst, i);
+    if (inst->fsm[i] != YDB_FSM_FREE) {
+      YDB_Error err = __ydb_compact_move(inst, target, __ydb_compact_spare(inst));
+      if (err) return err;
+    }
+    return __ydb_compact_move(inst, inst->dir[i], target);
+  }
+
+  // Then the rest of pages in use fill the gaps
+  size_t last = inst->fsm_count;
+  while (last > 0 && inst->fsm[last - 1] == YDB_FSM_FREE) last--;
+  const uint8_t *gap = memchr(inst->fsm + i, YDB_FSM_FREE, last - i);
+  if (gap) {
+    return __ydb_compact_move(inst, __ydb_fsm_page_offset(inst, last - 1),
+                              __ydb_fsm_page_offset(inst, (size_t) (gap - inst->fsm)));
+  }
+
+  *done = 1;
+  if (last < inst->fsm_count) {
+    return __ydb_compact_truncate(inst, last);
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __ydb_compact(YDB_Engine *instance, size_t max_steps, int *done) {
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  __ydb_dir_slots_build(instance);
+
+  int finished = 0;
+  for (size_t steps = 0; !finished && (!max_steps || steps < max_steps); steps++) {
+    err = __ydb_compact_step(instance, &finished);
+    if (err) break;
+  }
+  if (done) *done = finished;
+
+  // Neighbours of current page could have been moved
+  YDB_Error read_err = __ydb_read_page(instance);
+  return err ? err : read_err;
+}
+
+YDB_Error ydb_compact(YDB_Engine *instance, size_t max_steps, int *done) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->fsm_persistent, YDB_ERR_TABLE_DATA_VERSION_MISMATCH);
+  return __ydb_finish(instance, __ydb_compact(instance, max_steps, done));
+}
+
+YDB_Error ydb_seek_to_begin(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+
+  if (instance->prev_page_offset == 0)
+    return YDB_ERR_SUCCESS;
+
+  instance->curr_page_offset = instance->first_page_offset;
+  instance->curr_index = 0;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_seek_to_end(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+
+  if (instance->next_page_offset == 0)
+    return YDB_ERR_SUCCESS;
+
+  instance->curr_page_offset = instance->last_page_offset;
+  instance->curr_index = instance->dir_count ? instance->dir_count - 1 : 0;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_seek_to_page(YDB_Engine *instance, size_t index) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  if (index >= instance->dir_count) {
+    return YDB_ERR_PAGE_INDEX_OUT_OF_RANGE;
+  }
+
+  instance->curr_page_offset = instance->dir[index];
+  instance->curr_index = index;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_seek_to_offset(YDB_Engine *instance, YDB_Offset offset) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  size_t i = __ydb_compact_find(instance->dir, instance->dir_count, offset);
+  THROW_IF_NULL(i < instance->dir_count, YDB_ERR_PAGE_INDEX_OUT_OF_RANGE);
+
+  instance->curr_page_offset = offset;
+  instance->curr_index = i;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_seek_to_free_space(YDB_Engine *instance, YDB_PageSize size) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->fsm_persistent, YDB_ERR_TABLE_DATA_VERSION_MISMATCH);
+
+  // Any page of the category has at least that much free space
+  const size_t category_size = __ydb_fsm_category_size(instance);
+  size_t category = ((size_t) size + category_size - 1) / category_size;
+  if (category == 0) category = 1;
+
+  size_t index = 0;
+  while (index < instance->fsm_count &&
+         (instance->fsm[index] == YDB_FSM_FREE || instance->fsm[index] < category)) {
+    index++;
+  }
+  THROW_IF_NULL(index < instance->fsm_count, YDB_ERR_NO_MORE_PAGES);
+  YDB_Offset offset = __ydb_fsm_page_offset(instance, index);
+
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  size_t i = 0;
+  while (i < instance->dir_count && instance->dir[i] != offset) i++;
+  THROW_IF_NULL(i < instance->dir_count, YDB_ERR_TABLE_DATA_CORRUPTED);
+
+  instance->curr_page_offset = offset;
+  instance->curr_index = i;
+  return __ydb_read_page(instance);
+}
+
+YDB_Error ydb_get_page_count(YDB_Engine *instance, size_t *count) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(count, YDB_ERR_WRITE_TO_NULLPTR);
+
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  *count = instance->dir_count;
+  return YDB_ERR_SUCCESS;
+}
+
+YDB_Error ydb_parallel_scan(YDB_Engine *instance, size_t nthreads, YDB_ScanFn callback, void *ctx) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(callback, YDB_ERR_WRITE_TO_NULLPTR);
+
+  // Workers read the storage directly, so pages left dirty in the cache are written first
+  if (instance->cache) {
+    YDB_Error err = ydb_cache_flush(instance->cache);
+    if (err) return err;
+  }
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+  return ydb_scan_pages(instance->storage, &instance->layout, instance->dir, instance->dir_count, nthreads,
+                        callback, ctx);
+}
+
+/**
+ * @struct __YDB_Cursor
+ * @brief A struct that defines a cursor over a loaded table.
+ */
+struct __YDB_Cursor {
+  YDB_Engine *instance; /**< The table. */
+  YDB_Offset curr_page_offset; /**< A location of current page in file. */
+  YDB_TablePage *page; /**< A copy of current page. */
+};
+
+// Copies a page to the cursor. The caller holds the table latch shared.
+static YDB_Error __ydb_cursor_read(YDB_Cursor *cursor, YDB_Offset offset) {
+  YDB_Engine *inst = cursor->instance;
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, offset, &frame);
+  if (err) return err;
+
+  const YDB_PageSize data_size = __ydb_data_size(inst);
+  uint16_t row_count;
+
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, offset);
+  pthread_rwlock_rdlock(latch);
+  YDB_Flags flags = frame[YDB_v1_page_flags_offset];
+  memcpy(&row_count, frame + YDB_v1_page_row_count_offset, sizeof(row_count));
+  ydb_page_data_seek(cursor->page, 0);
+  ydb_page_data_write(cursor->page, frame + inst->layout.data_offset, data_size);
+  pthread_rwlock_unlock(latch);
+  __ydb_page_unpin(inst, offset);
+
+  REASSIGN_FROM_LE(row_count);
+  ydb_page_data_seek(cursor->page, 0);
+  ydb_page_flags_set(cursor->page, flags);
+  ydb_page_row_count_set(cursor->page, row_count);
+  cursor->curr_page_offset = offset;
+  return YDB_ERR_SUCCESS;
+}
+
+// Moves the cursor by a link of its current page, as the link is in the table now rather than in the copy.
+static YDB_Error __ydb_cursor_step(YDB_Cursor *cursor, enum YDB_v1_page_offsets field) {
+  YDB_Engine *inst = cursor->instance;
+  pthread_rwlock_rdlock(&inst->latch);
+
+  char *frame;
+  YDB_Error err = __ydb_page_pin(inst, cursor->curr_page_offset, &frame);
+  if (err) {
+    pthread_rwlock_unlock(&inst->latch);
+    return err;
+  }
+
+  YDB_Offset offset;
+  pthread_rwlock_t *latch = __ydb_page_latch(inst, cursor->curr_page_offset);
+  pthread_rwlock_rdlock(latch);
+  YDB_Flags flags = frame[YDB_v1_page_flags_offset];
+  memcpy(&offset, frame + field, sizeof(offset));
+  pthread_rwlock_unlock(latch);
+  __ydb_page_unpin(inst, cursor->curr_page_offset);
+  REASSIGN_FROM_LE(offset);
+
+  if (flags & YDB_TABLE_PAGE_FLAG_DELETED) {
+    err = YDB_ERR_PAGE_DELETED;
+  } else if (!offset) {
+    err = YDB_ERR_NO_MORE_PAGES;
+  } else {
+    err = __ydb_cursor_read(cursor, offset);
+  }
+  pthread_rwlock_unlock(&inst->latch);
+  return err;
+}
+
+YDB_Cursor *ydb_cursor_open(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, NULL);
+  THROW_IF_NULL(instance->in_use, NULL);
+
+  // Cursors seek pages with the directory and never change the instance, so it's built here
+  if (__ydb_dir_ensure(instance)) return NULL;
+
+  YDB_Cursor *cursor = calloc(1, sizeof(YDB_Cursor));
+  cursor->instance = instance;
+  cursor->page = ydb_page_alloc(__ydb_data_size(instance));
+  if (ydb_cursor_seek_to_begin(cursor)) {
+    ydb_page_free(cursor->page);
+    free(cursor);
+    return NULL;
+  }
+
+  instance->cursor_count++;
+  return cursor;
+}
+
+void ydb_cursor_close(YDB_Cursor *cursor) {
+  if (!cursor) return;
+  cursor->instance->cursor_count--;
+  ydb_page_free(cursor->page);
+  free(cursor);
+}
 
-  // And after all that, the instance could be freed
-  free(instance);
+YDB_Error ydb_cursor_next(YDB_Cursor *cursor) {
+  THROW_IF_NULL(cursor, YDB_ERR_CURSOR_NOT_INITIALIZED);
+  return __ydb_cursor_step(cursor, YDB_v1_page_next_offset);
 }
 
-// Internal usage only!
-// Its only purpose to read current page data and set next_page and prev_page offsets.
-static YDB_Error __ydb_read_page(YDB_Engine *inst) {
-  THROW_IF_NULL(inst, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+YDB_Error ydb_cursor_prev(YDB_Cursor *cursor) {
+  THROW_IF_NULL(cursor, YDB_ERR_CURSOR_NOT_INITIALIZED);
+  return __ydb_cursor_step(cursor, YDB_v1_page_prev_offset);
+}
 
-  // Seek to current page
-  fseek(inst->fd, inst->curr_page_offset, SEEK_SET);
+YDB_Error ydb_cursor_seek_to_begin(YDB_Cursor *cursor) {
+  THROW_IF_NULL(cursor, YDB_ERR_CURSOR_NOT_INITIALIZED);
 
-  // Read page data
-  char p_data[YDB_TABLE_PAGE_SIZE];
-  size_t bytes_read = fread(p_data, 1, YDB_TABLE_PAGE_SIZE, inst->fd);
-  // Throw error if failed to read exactly a page size.
-  if (bytes_read != YDB_TABLE_PAGE_SIZE) {
-    return YDB_ERR_TABLE_DATA_CORRUPTED;
+  pthread_rwlock_rdlock(&cursor->instance->latch);
+  YDB_Error err = __ydb_cursor_read(cursor, cursor->instance->first_page_offset);
+  pthread_rwlock_unlock(&cursor->instance->latch);
+  return err;
+}
+
+YDB_Error ydb_cursor_seek_to_end(YDB_Cursor *cursor) {
+  THROW_IF_NULL(cursor, YDB_ERR_CURSOR_NOT_INITIALIZED);
+
+  pthread_rwlock_rdlock(&cursor->instance->latch);
+  YDB_Error err = __ydb_cursor_read(cursor, cursor->instance->last_page_offset);
+  pthread_rwlock_unlock(&cursor->instance->latch);
+  return err;
+}
+
+YDB_Error ydb_cursor_seek_to_page(YDB_Cursor *cursor, size_t index) {
+  THROW_IF_NULL(cursor, YDB_ERR_CURSOR_NOT_INITIALIZED);
+  YDB_Engine *inst = cursor->instance;
+
+  pthread_rwlock_rdlock(&inst->latch);
+  YDB_Error err = YDB_ERR_PAGE_INDEX_OUT_OF_RANGE;
+  if (index < inst->dir_count) {
+    err = __ydb_cursor_read(cursor, inst->dir[index]);
   }
+  pthread_rwlock_unlock(&inst->latch);
+  return err;
+}
 
-  // Read page flags, next and prev page offset and row count
-  YDB_Flags page_flags = p_data[0];
-  YDB_Offset next;
-  YDB_Offset prev;
-  YDB_PageSize row_count;
-  memcpy(&next, p_data + YDB_v1_page_next_offset, sizeof(next));
-  REASSIGN_FROM_LE(next);
-  memcpy(&prev, p_data + YDB_v1_page_prev_offset, sizeof(prev));
-  REASSIGN_FROM_LE(prev);
-  memcpy(&row_count, p_data + YDB_v1_page_row_count_offset, sizeof(row_count));
-  REASSIGN_FROM_LE(row_count);
+YDB_TablePage *ydb_cursor_get_page(YDB_Cursor *cursor) {
+  THROW_IF_NULL(cursor, NULL);
+  return cursor->page;
+}
 
-  const YDB_PageSize meta_size = YDB_v1_page_data_offset;
-  const YDB_PageSize data_size = YDB_TABLE_PAGE_SIZE - meta_size;
+// Links a tree or a hash index to the table as an index.
+static YDB_Index *__ydb_index_attach(YDB_Engine *instance, YDB_BTree *tree, YDB_HashIndex *hash,
+                                     YDB_IndexKeyFn key_fn, void *ctx) {
+  YDB_Index *index = calloc(1, sizeof(YDB_Index));
+  index->instance = instance;
+  index->tree = tree;
+  index->hash = hash;
+  index->key_fn = key_fn;
+  index->ctx = ctx;
+  index->keys = malloc(2 * __ydb_index_key_size(index));
+  index->next = instance->indexes;
+  instance->indexes = index;
+  return index;
+}
 
-  YDB_TablePage *p = ydb_page_alloc(data_size);
+// Unlinks an index from the table and frees it along with its entries.
+static void __ydb_index_detach(YDB_Index *index) {
+  YDB_Index **p = &index->instance->indexes;
+  while (*p != index) p = &(*p)->next;
+  *p = index->next;
+  ydb_btree_close(index->tree);
+  ydb_hash_close(index->hash);
+  free(index->keys);
+  free(index);
+}
 
-  ydb_page_flags_set(p, page_flags);
-  ydb_page_row_count_set(p, row_count);
+YDB_Error ydb_index_create(YDB_Engine *instance, const char *path, size_t key_size, YDB_IndexKeyFn key_fn,
+                           void *ctx, YDB_Index **index) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(path, YDB_ERR_WRITE_TO_NULLPTR);
 
-  YDB_Error write_status = ydb_page_data_write(p, p_data + meta_size, data_size);
-  if (write_status) return write_status;
+  if (access(path, F_OK) != -1) {
+    return YDB_ERR_TABLE_EXIST;
+  }
+  YDB_Storage *storage = ydb_storage_pio_open(path, 1);
+  THROW_IF_NULL(storage, YDB_ERR_TABLE_DATA_WRITE_FAILED);
+  return ydb_index_create_in(instance, storage, key_size, key_fn, ctx, index);
+}
 
-  inst->curr_page = p;
-  inst->prev_page_offset = prev;
-  inst->next_page_offset = next;
+// Creates an index of either kind in given storage and fills it.
+static YDB_Error __ydb_index_create_in(YDB_Engine *instance, YDB_Storage *storage, int hashed, size_t key_size,
+                                       YDB_IndexKeyFn key_fn, void *ctx, YDB_Index **index) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (!instance) err = YDB_ERR_INSTANCE_NOT_INITIALIZED;
+  else if (!instance->in_use) err = YDB_ERR_INSTANCE_NOT_IN_USE;
+  else if (!key_fn || !index) err = YDB_ERR_WRITE_TO_NULLPTR;
+
+  // Index pages are as large as table pages
+  YDB_BTree *tree = NULL;
+  YDB_HashIndex *hash = NULL;
+  if (!err && hashed) {
+    err = ydb_hash_create(storage, __ydb_page_size(instance), key_size, instance->cache_capacity, &hash);
+  } else if (!err) {
+    err = ydb_btree_create(storage, __ydb_page_size(instance), key_size, instance->cache_capacity, &tree);
+  }
+  if (err) {
+    ydb_storage_close(storage);
+    return err;
+  }
 
+  YDB_Index *new_index = __ydb_index_attach(instance, tree, hash, key_fn, ctx);
+  err = __ydb_index_build(new_index);
+  if (!err) err = __ydb_index_flush(new_index);
+  if (err) {
+    __ydb_index_detach(new_index);
+    return err;
+  }
+  *index = new_index;
   return YDB_ERR_SUCCESS;
 }
-// Moves file position to allocated block.
-// Also changes last_free_page_offset.
-static YDB_Offset __ydb_allocate_page_and_seek(YDB_Engine *inst) {
-  // TODO change signature of the function. It should return an error code, I think.
-  YDB_Offset result = 0;
-  // If no free pages in the table, then...
-  if (inst->last_free_page_offset == 0) {
-    // Return the end of the file where a new page will be allocated
-    fseek(inst->fd, 0, SEEK_END);
-    result = ftell(inst->fd);
-    YDB_Offset allocated_page_offset_le = TO_LE(result);
-
-    // Allocate an empty chunk
-    char* new_page_data = calloc(1, YDB_TABLE_PAGE_SIZE);
-    // Write last page offset as prev page offset in this page
-    YDB_Offset last_page_offset_le = TO_LE(inst->last_page_offset);
-    memcpy(new_page_data + YDB_v1_page_prev_offset, &last_page_offset_le, sizeof(YDB_Offset));
-    // Write it to file
-    fwrite(new_page_data, YDB_TABLE_PAGE_SIZE, 1, inst->fd);
-    free(new_page_data);
-    // TODO throw error on fail
-
-    // Write next page offset in the previous (last) page
-    fseek(inst->fd, inst->last_page_offset + YDB_v1_page_next_offset, SEEK_SET);
-    fwrite(&allocated_page_offset_le, sizeof(YDB_Offset), 1, inst->fd);
-
-    // Write last page offset
-    inst->last_page_offset = result;
-    fseek(inst->fd, YDB_v1_last_page_offset, SEEK_SET);
-    fwrite(&allocated_page_offset_le, sizeof(YDB_Offset), 1, inst->fd);
-    fflush(inst->fd);
-  } else {
-    // Return last free page offset
-    result = inst->last_free_page_offset;
-
-    // Read last free page offset after allocation
-    fseek(inst->fd, result + YDB_v1_page_next_offset, SEEK_SET); // Skip flag
-    fread(&inst->last_free_page_offset, sizeof(YDB_Offset), 1, inst->fd);
-    REASSIGN_FROM_LE(inst->last_free_page_offset);
 
-    // Go back to our almost allocated page
-    fseek(inst->fd, result, SEEK_SET);
+YDB_Error ydb_index_create_in(YDB_Engine *instance, YDB_Storage *storage, size_t key_size, YDB_IndexKeyFn key_fn,
+                              void *ctx, YDB_Index **index) {
+  return __ydb_index_create_in(instance, storage, 0, key_size, key_fn, ctx, index);
+}
 
-    // Rewrite page header with last page offset as previous page
-    char* page_header = calloc(1, YDB_v1_data_offset);
-    YDB_Offset last_page_offset_le = TO_LE(inst->last_page_offset);
-    memcpy(page_header + YDB_v1_page_prev_offset, &last_page_offset_le, sizeof(YDB_Offset));
-    fwrite(page_header, YDB_v1_data_offset, 1, inst->fd);
-    free(page_header);
+YDB_Error ydb_hash_index_create(YDB_Engine *instance, const char *path, size_t key_size, YDB_IndexKeyFn key_fn,
+                                void *ctx, YDB_Index **index) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(path, YDB_ERR_WRITE_TO_NULLPTR);
 
-    // Write last free page offset after allocation in file
-    fseek(inst->fd, YDB_v1_last_free_page_offset, SEEK_SET);
-    YDB_Offset lfp_offset_le = TO_LE(inst->last_free_page_offset);
-    fwrite(&lfp_offset_le, sizeof(YDB_Offset), 1, inst->fd);
+  if (access(path, F_OK) != -1) {
+    return YDB_ERR_TABLE_EXIST;
   }
-  fflush(inst->fd);
-  fseek(inst->fd, result, SEEK_SET);
-  return result;
+  YDB_Storage *storage = ydb_storage_pio_open(path, 1);
+  THROW_IF_NULL(storage, YDB_ERR_TABLE_DATA_WRITE_FAILED);
+  return ydb_hash_index_create_in(instance, storage, key_size, key_fn, ctx, index);
 }
 
-YDB_Error ydb_load_table(YDB_Engine *instance, const char *path) {
+YDB_Error ydb_hash_index_create_in(YDB_Engine *instance, YDB_Storage *storage, size_t key_size,
+                                   YDB_IndexKeyFn key_fn, void *ctx, YDB_Index **index) {
+  return __ydb_index_create_in(instance, storage, 1, key_size, key_fn, ctx, index);
+}
+
+YDB_Error ydb_index_open(YDB_Engine *instance, const char *path, YDB_IndexKeyFn key_fn, void *ctx,
+                         YDB_Index **index) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(path, YDB_ERR_WRITE_TO_NULLPTR);
 
   if (access(path, F_OK) == -1) {
-    // TODO: Windows does not check W_OK correctly, use other methods.
-    // TODO: if can't read/write, throw other error
     return YDB_ERR_TABLE_NOT_EXIST;
   }
-  instance->fd = fopen(path, "rb+");
-  THROW_IF_NULL(instance->fd, YDB_ERR_UNKNOWN); // TODO file open error
+  YDB_Storage *storage = ydb_storage_pio_open(path, 0);
+  THROW_IF_NULL(storage, YDB_ERR_TABLE_NOT_EXIST);
+  return ydb_index_open_from(instance, storage, key_fn, ctx, index);
+}
 
-  // Check file signature
-  char signature[YDB_TABLE_FILE_SIGN_SIZE];
-  fread(signature, 1, YDB_TABLE_FILE_SIGN_SIZE, instance->fd);
-  int signature_match = memcmp(signature, YDB_TABLE_FILE_SIGN, 3) == 0;
-  if (!signature_match) {
-    return YDB_ERR_TABLE_DATA_CORRUPTED;
+YDB_Error ydb_index_open_from(YDB_Engine *instance, YDB_Storage *storage, YDB_IndexKeyFn key_fn, void *ctx,
+                              YDB_Index **index) {
+  THROW_IF_NULL(storage, YDB_ERR_STORAGE_NOT_INITIALIZED);
+  YDB_Error err = YDB_ERR_SUCCESS;
+  if (!instance) err = YDB_ERR_INSTANCE_NOT_INITIALIZED;
+  else if (!instance->in_use) err = YDB_ERR_INSTANCE_NOT_IN_USE;
+  else if (!key_fn || !index) err = YDB_ERR_WRITE_TO_NULLPTR;
+
+  // The kind of an index is told by its file signature
+  char sign[YDB_TABLE_FILE_SIGN_SIZE] = {0};
+  if (!err) ydb_storage_read_at(storage, 0, sign, sizeof(sign));
+  int hashed = !memcmp(sign, YDB_HASH_FILE_SIGN, YDB_TABLE_FILE_SIGN_SIZE) ||
+               !memcmp(sign, YDB_HASH_FILE_SIGN_DIRTY, YDB_TABLE_FILE_SIGN_SIZE);
+
+  YDB_BTree *tree = NULL;
+  YDB_HashIndex *hash = NULL;
+  if (!err && hashed) err = ydb_hash_open(storage, instance->cache_capacity, &hash);
+  else if (!err) err = ydb_btree_open(storage, instance->cache_capacity, &tree);
+  if (err) {
+    ydb_storage_close(storage);
+    return err;
   }
 
-  fread(&(instance->ver_major), sizeof(instance->ver_major), 1, instance->fd);
-  fread(&(instance->ver_minor), sizeof(instance->ver_minor), 1, instance->fd);
-
-  if (instance->ver_major != 1) { // TODO proper version check!
-    return YDB_ERR_TABLE_DATA_VERSION_MISMATCH;
+  YDB_Index *new_index = __ydb_index_attach(instance, tree, hash, key_fn, ctx);
+  if (hashed ? ydb_hash_is_stale(hash) : ydb_btree_is_stale(tree)) {
+    err = ydb_index_rebuild(new_index);
+    if (err) {
+      __ydb_index_detach(new_index);
+      return err;
+    }
   }
+  *index = new_index;
+  return YDB_ERR_SUCCESS;
+}
 
-  // Check consistency of a page
-  switch (signature[3]) {
-    case '!':
-      break;
-    case '?':
-      // TODO mark table as possibly corrupted and start rollback from journal
-      // FIXME
-      return YDB_ERR_TABLE_DATA_CORRUPTED;
-      break;
-    default:
-      return YDB_ERR_TABLE_DATA_CORRUPTED;
-  }
+YDB_Error ydb_index_close(YDB_Index *index) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
 
-  fread(&instance->first_page_offset, sizeof(YDB_Offset), 1, instance->fd);
-  REASSIGN_FROM_LE(instance->first_page_offset);
-  fread(&instance->last_page_offset, sizeof(YDB_Offset), 1, instance->fd);
-  REASSIGN_FROM_LE(instance->last_page_offset);
-  fread(&instance->last_free_page_offset, sizeof(YDB_Offset), 1, instance->fd);
-  REASSIGN_FROM_LE(instance->last_free_page_offset);
-  // TODO check offsets
+  YDB_Error err = __ydb_index_flush(index);
+  __ydb_index_detach(index);
+  return err;
+}
 
-  instance->in_use = -1; // unsigned value overflow to fill all the bits
-  instance->filename = strdup(path);
+YDB_Error ydb_index_rebuild(YDB_Index *index) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
 
-  instance->curr_page_offset = instance->first_page_offset;
-  return __ydb_read_page(instance);
+  YDB_Error err = index->tree ? ydb_btree_clear(index->tree) : ydb_hash_clear(index->hash);
+  if (!err) err = __ydb_index_build(index);
+  if (!err) err = __ydb_index_flush(index);
+  return err;
 }
 
-YDB_Error ydb_unload_table(YDB_Engine *instance) {
-  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
-  THROW_IF_NULL(instance->curr_page, YDB_ERR_PAGE_NOT_INITIALIZED);
+YDB_Error ydb_index_find(YDB_Index *index, const void *key, YDB_RowLocation *location) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  if (index->hash) return ydb_hash_find(index->hash, key, location);
+  return ydb_btree_find(index->tree, key, location);
+}
 
-  YDB_Engine *i = instance;
+YDB_Error ydb_index_scan(YDB_Index *index, const void *from, const void *to, YDB_IndexVisitFn visit, void *ctx) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(index->tree, YDB_ERR_INDEX_NOT_ORDERED);
+  return ydb_btree_scan(index->tree, from, to, visit, ctx);
+}
 
-  i->ver_major = 0;
-  i->ver_minor = 0;
-  i->first_page_offset = 0;
-  i->last_page_offset = 0;
-  i->last_free_page_offset = 0;
-  i->prev_page_offset = 0;
-  i->curr_page_offset = 0;
-  i->next_page_offset = 0;
-  ydb_page_free(i->curr_page);
-  i->curr_page = NULL;
-  free(i->filename);
-  fclose(i->fd);
+YDB_Error ydb_index_find_all(YDB_Index *index, const void *key, YDB_IndexVisitFn visit, void *ctx) {
+  THROW_IF_NULL(index, YDB_ERR_INDEX_NOT_INITIALIZED);
+  THROW_IF_NULL(key, YDB_ERR_WRITE_TO_NULLPTR);
+  if (index->hash) return ydb_hash_find_all(index->hash, key, visit, ctx);
+  return ydb_btree_scan(index->tree, key, key, visit, ctx);
+}
 
-  // Unset "in use" flag
-  instance->in_use = 0;
+static YDB_Error __ydb_zone_ensure(YDB_Engine *inst);
+
+static YDB_Error __ydb_set_schema(YDB_Engine *instance, const YDB_Schema *schema) {
+  const YDB_PageSize data_size = __ydb_data_size(instance);
+  YDB_Error err;
+  YDB_Offset offset = 0;
+  if (schema) {
+    char *frame;
+    err = __ydb_allocate_raw_page(instance, &offset, &frame);
+    if (err) return err;
+    uint16_t count_le = TO_LE((uint16_t) ydb_schema_column_count(schema));
+    frame[YDB_v1_page_flags_offset] = YDB_TABLE_PAGE_FLAG_SCHEMA;
+    memcpy(frame + YDB_v1_page_row_count_offset, &count_le, sizeof(count_le));
+    memset(frame + instance->layout.data_offset, 0, data_size);
+    ydb_schema_write(schema, frame + instance->layout.data_offset, data_size);
+    __ydb_page_unpin(instance, offset);
+  }
+  if (instance->schema_offset) {
+    err = __ydb_free_raw_page(instance, instance->schema_offset);
+    if (err) return err;
+  }
 
-  return YDB_ERR_SUCCESS;
+  instance->schema_offset = offset;
+  __ydb_zone_clear(instance);
+  ydb_schema_free(instance->schema);
+  instance->schema = schema ? ydb_schema_clone(schema) : NULL;
+  if (instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_ZONE_MAPS) {
+    // Directory entries are laid out for the new zone-mapped columns, with zone maps of all the pages
+    err = __ydb_zone_ensure(instance);
+    if (!err) err = __ydb_dir_store(instance, 0);
+    if (err) return err;
+  }
+  return __ydb_sync(instance);
 }
 
-YDB_Error ydb_create_table(YDB_Engine *instance, const char *path) {
+YDB_Error ydb_set_schema(YDB_Engine *instance, const YDB_Schema *schema) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->ver_minor >= YDB_TABLE_FILE_VER_MINOR_SCHEMA, YDB_ERR_TABLE_DATA_VERSION_MISMATCH);
+  THROW_IF_NULL(!schema || ydb_schema_column_count(schema), YDB_ERR_SCHEMA_INVALID);
+  // A directory entry with zone maps of all zone-mapped columns has to fit a page
+  THROW_IF_NULL(!schema || instance->ver_minor < YDB_TABLE_FILE_VER_MINOR_ZONE_MAPS ||
+                sizeof(YDB_Offset) + __ydb_zone_column_count(schema) * YDB_zone_map_entry_size <=
+                __ydb_data_size(instance), YDB_ERR_SCHEMA_INVALID);
+
+  // The whole schema is a single page
+  if (schema && ydb_schema_write(schema, NULL, 0) > __ydb_data_size(instance)) {
+    return YDB_ERR_SCHEMA_INVALID;
+  }
+  return __ydb_finish(instance, __ydb_set_schema(instance, schema));
+}
 
-  if (access(path, F_OK) != -1) {
-    // TODO: Windows does not check W_OK correctly, use other methods.
-    // TODO: if can't read/write, throw other error
-    return YDB_ERR_TABLE_EXIST;
+const YDB_Schema *ydb_get_schema(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, NULL);
+  THROW_IF_NULL(instance->in_use, NULL);
+  return instance->schema;
+}
+
+// Puts live rows of a slotted page into PAX layout in `*image`, growing it as needed.
+static YDB_Error __ydb_scan_transpose(const YDB_Engine *inst, char *frame, char **image, size_t *image_size,
+                                      YDB_PageSize *row_count) {
+  YDB_TablePage *page = __ydb_index_frame_view(inst, frame);
+  const YDB_PageSize count = ydb_page_row_count_get(page);
+  const void **rows = malloc((count + 1) * sizeof(void *));
+  YDB_PageSize *sizes = malloc((count + 1) * sizeof(YDB_PageSize));
+
+  YDB_Error err = YDB_ERR_SUCCESS;
+  size_t live = 0;
+  for (YDB_PageSize i = 0; i < count && !err; i++) {
+    if (ydb_page_row_get(page, i, &rows[live], &sizes[live])) continue;
+    err = ydb_row_check(inst->schema, rows[live], sizes[live]);
+    live++;
+  }
+
+  if (!err) {
+    const size_t size = ydb_pax_size(inst->schema, rows, sizes, live);
+    if (size > *image_size) {
+      free(*image);
+      *image = malloc(size);
+      *image_size = size;
+    }
+    size_t written;
+    err = ydb_pax_write(inst->schema, rows, sizes, live, *image, (YDB_PageSize) *image_size, &written);
+    *row_count = (YDB_PageSize) written;
   }
 
-  FILE *f = fopen(path, "wb");
+  free(rows);
+  free(sizes);
+  ydb_page_free(page);
+  return err;
+}
 
-  char tpl[] = YDB_TABLE_FILE_SIGN                 // File signature
-               "\x01\x00"                          // File version FIXME magic
-               "\x1E\x00\x00\x00\x00\x00\x00\x00"  // First page offset
-               "\x1E\x00\x00\x00\x00\x00\x00\x00"  // Last page offset
-               "\x00\x00\x00\x00\x00\x00\x00\x00"; // Last free page offset
-  fwrite(tpl, sizeof(tpl)-1, 1, f);
+// Scans columns of the pages that could match the predicates (none to scan every page).
+static YDB_Error __ydb_scan_columns(YDB_Engine *instance, const size_t *columns, size_t column_count,
+                                   const YDB_Predicate *predicates, size_t predicate_count,
+                                   YDB_ColumnScanFn callback, void *ctx) {
+  YDB_Error err = __ydb_dir_ensure(instance);
+  if (err) return err;
+
+  const YDB_PageSize data_size = __ydb_data_size(instance);
+  YDB_PaxColumn *minipages = malloc((column_count + 1) * sizeof(YDB_PaxColumn));
+  char *image = NULL;
+  size_t image_size = 0;
+  for (size_t i = 0; i < instance->dir_count && !err; i++) {
+    if (!__ydb_zone_may_match(instance, i, predicates, predicate_count)) continue;
+
+    char *frame;
+    err = __ydb_page_pin(instance, instance->dir[i], &frame);
+    if (err) break;
+
+    const YDB_Flags flags = frame[YDB_v1_page_flags_offset];
+    const char *data = NULL;
+    YDB_PageSize size = 0;
+    uint16_t row_count;
+    memcpy(&row_count, frame + YDB_v1_page_row_count_offset, sizeof(row_count));
+    REASSIGN_FROM_LE(row_count);
+
+    YDB_PageSize count = row_count;
+    if (flags & YDB_TABLE_PAGE_FLAG_PAX) {
+      data = frame + instance->layout.data_offset;
+      size = data_size;
+    } else if (flags & YDB_TABLE_PAGE_FLAG_SLOTTED) {
+      err = __ydb_scan_transpose(instance, frame, &image, &image_size, &count);
+      data = image;
+      size = (YDB_PageSize) image_size;
+    }
+
+    for (size_t c = 0; c < column_count && data && !err; c++) {
+      err = ydb_pax_column(data, size, count, instance->schema, columns[c], &minipages[c]);
+    }
+    if (data && !err) err = callback(ctx, i, minipages, count);
+    __ydb_page_unpin(instance, instance->dir[i]);
+  }
 
-  char *first_page = calloc(1, YDB_TABLE_PAGE_SIZE);
-  fwrite(first_page, YDB_TABLE_PAGE_SIZE, 1, f);
-  free(first_page);
+  free(image);
+  free(minipages);
+  return err;
+}
 
-  fclose(f);
+YDB_Error ydb_scan_columns(YDB_Engine *instance, const size_t *columns, size_t column_count,
+                           YDB_ColumnScanFn callback, void *ctx) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(instance->schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(callback, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(columns || !column_count, YDB_ERR_WRITE_TO_NULLPTR);
+  for (size_t i = 0; i < column_count; i++) {
+    THROW_IF_NULL(columns[i] < ydb_schema_column_count(instance->schema), YDB_ERR_COLUMN_NOT_EXIST);
+  }
 
-  return ydb_load_table(instance, path);
+  return __ydb_scan_columns(instance, columns, column_count, NULL, 0, callback, ctx);
 }
 
-YDB_Error ydb_prev_page(YDB_Engine *instance) {
+/**
+ * @struct __YDB_FilterScan
+ * @brief A filtered scan on top of a column scan, where minipages of predicate columns follow the requested ones.
+ */
+typedef struct __YDB_FilterScan {
+  const YDB_Schema *schema; /**< Table schema. */
+  const YDB_Predicate *predicates; /**< Predicates. */
+  size_t predicate_count; /**< The amount of predicates. */
+  size_t column_count; /**< The amount of requested columns. */
+  YDB_FilterIsa isa; /**< Kernels to use. */
+  uint8_t *selection; /**< Selection of the page. */
+  uint8_t *matches; /**< Matches of a predicate. */
+  YDB_FilterScanFn callback; /**< User callback. */
+  void *ctx; /**< User context. */
+} __YDB_FilterScan;
+
+static YDB_Error __ydb_filter_scan_page(void *ctx, size_t index, const YDB_PaxColumn *columns,
+                                        YDB_PageSize row_count) {
+  __YDB_FilterScan *scan = ctx;
+  const size_t bytes = (row_count + 7) / 8;
+  memset(scan->selection, 0xFF, bytes);
+  if (row_count % 8) scan->selection[bytes - 1] = (uint8_t) ((1 << (row_count % 8)) - 1);
+
+  // A page is dropped as soon as nothing is left selected
+  int any = row_count > 0;
+  for (size_t i = 0; i < scan->predicate_count && any; i++) {
+    ydb_filter_minipage(scan->schema, &scan->predicates[i], &columns[scan->column_count + i], scan->isa,
+                        scan->matches);
+    any = 0;
+    for (size_t b = 0; b < bytes; b++) {
+      scan->selection[b] &= scan->matches[b];
+      any |= scan->selection[b];
+    }
+  }
+  if (!any) return YDB_ERR_SUCCESS;
+  return scan->callback(scan->ctx, index, columns, row_count, scan->selection);
+}
+
+// Builds zone maps of all the pages if they are not built.
+static YDB_Error __ydb_zone_ensure(YDB_Engine *inst) {
+  YDB_Error err = __ydb_dir_ensure(inst);
+  if (err || inst->zones_valid) return err;
+
+  __ydb_zone_init(inst);
+  for (size_t i = 0; i < inst->dir_count && inst->zone_column_count; i++) {
+    char *frame;
+    err = __ydb_page_pin(inst, inst->dir[i], &frame);
+    if (err) break;
+    YDB_TablePage *page = __ydb_index_frame_view(inst, frame);
+    __ydb_zone_update(inst, i, page);
+    ydb_page_free(page);
+    __ydb_page_unpin(inst, inst->dir[i]);
+  }
+  if (err) __ydb_zone_clear(inst);
+  return err;
+}
+
+YDB_Error ydb_scan_filter(YDB_Engine *instance, const YDB_Predicate *predicates, size_t predicate_count,
+                          const size_t *columns, size_t column_count, YDB_FilterScanFn callback, void *ctx) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
   THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
-  THROW_IF_NULL(instance->prev_page_offset, YDB_ERR_NO_MORE_PAGES);
+  THROW_IF_NULL(instance->schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(callback, YDB_ERR_WRITE_TO_NULLPTR);
+  THROW_IF_NULL(predicates || !predicate_count, YDB_ERR_PREDICATE_INVALID);
+  THROW_IF_NULL(columns || !column_count, YDB_ERR_WRITE_TO_NULLPTR);
+  for (size_t i = 0; i < predicate_count; i++) {
+    YDB_Error err = ydb_predicate_check(instance->schema, &predicates[i]);
+    if (err) return err;
+  }
 
-  instance->curr_page_offset = instance->prev_page_offset;
-  return __ydb_read_page(instance);
+  const size_t total = column_count + predicate_count;
+  size_t *all = malloc((total + 1) * sizeof(size_t));
+  for (size_t i = 0; i < column_count; i++) {
+    all[i] = columns[i];
+  }
+  for (size_t i = 0; i < predicate_count; i++) {
+    all[column_count + i] = predicates[i].column;
+  }
+
+  const size_t bitmap_size = (YDB_TABLE_PAGE_MAX_ROW_COUNT + 7) / 8;
+  __YDB_FilterScan scan = {instance->schema, predicates, predicate_count, column_count, ydb_filter_isa(),
+                           malloc(bitmap_size), malloc(bitmap_size), callback, ctx};
+  YDB_Error err = __ydb_zone_ensure(instance);
+  if (!err) err = __ydb_scan_columns(instance, all, total, predicates, predicate_count, __ydb_filter_scan_page, &scan);
+  free(scan.selection);
+  free(scan.matches);
+  free(all);
+  return err;
 }
 
-YDB_Error ydb_next_page(YDB_Engine *instance) {
+YDB_Error ydb_get_zone_map(YDB_Engine *instance, size_t page_index, size_t column, YDB_ZoneMap *zone) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
   THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
-  THROW_IF_NULL(instance->next_page_offset, YDB_ERR_NO_MORE_PAGES);
+  THROW_IF_NULL(instance->schema, YDB_ERR_SCHEMA_INVALID);
+  THROW_IF_NULL(zone, YDB_ERR_WRITE_TO_NULLPTR);
 
-  instance->curr_page_offset = instance->next_page_offset;
-  return __ydb_read_page(instance);
+  YDB_Error err = __ydb_zone_ensure(instance);
+  if (err) return err;
+  THROW_IF_NULL(page_index < instance->zone_count, YDB_ERR_PAGE_INDEX_OUT_OF_RANGE);
+
+  for (size_t k = 0; k < instance->zone_column_count; k++) {
+    if (instance->zone_columns[k] != column) continue;
+    *zone = instance->zones[page_index * instance->zone_column_count + k];
+    return YDB_ERR_SUCCESS;
+  }
+  return YDB_ERR_COLUMN_NOT_EXIST;
 }
 
-YDB_TablePage* ydb_get_current_page(YDB_Engine *instance) {
+YDB_PageAllocator *ydb_get_page_allocator(YDB_Engine *instance) {
   THROW_IF_NULL(instance, NULL);
-  THROW_IF_NULL(instance->in_use, NULL);
-
-  return instance->curr_page;
+  return instance->allocator;
 }
 
-YDB_Error ydb_append_page(YDB_Engine* instance, YDB_TablePage* page) {
+YDB_Error ydb_get_page_data_size(YDB_Engine *instance, YDB_PageSize *size) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
   THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(size, YDB_ERR_WRITE_TO_NULLPTR);
 
-  YDB_Offset new_page_offset = __ydb_allocate_page_and_seek(instance);
+  *size = __ydb_data_size(instance);
+  return YDB_ERR_SUCCESS;
+}
 
-  YDB_PageSize rc = ydb_page_row_count_get(page);
-  YDB_PageSize rc_le = TO_LE(rc);
-  YDB_Flags f = ydb_page_flags_get(page);
+YDB_Error ydb_set_cache_capacity(YDB_Engine *instance, size_t capacity) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
-  char d[YDB_TABLE_PAGE_SIZE - YDB_v1_page_data_offset];
-  ydb_page_data_seek(page, 0);
-  if (ydb_page_data_read(page, d, sizeof(d))) {
-    return YDB_ERR_UNKNOWN; // FIXME
+  if (capacity < YDB_CACHE_MIN_CAPACITY) {
+    capacity = YDB_CACHE_MIN_CAPACITY;
   }
+  instance->cache_capacity = capacity;
+  return YDB_ERR_SUCCESS;
+}
 
-  fwrite(&f, sizeof(f), 1, instance->fd);
-  fseek(instance->fd, new_page_offset + YDB_v1_page_row_count_offset, SEEK_SET);
-  fwrite(&rc_le, sizeof(rc), 1, instance->fd);
-  fwrite(d, sizeof(d), 1, instance->fd);
-
-  fflush(instance->fd);
-
-  __ydb_read_page(instance);
+YDB_Error ydb_set_io_mode(YDB_Engine *instance, YDB_IOMode mode) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
+  instance->io_mode = mode;
   return YDB_ERR_SUCCESS;
 }
 
-YDB_Error ydb_replace_current_page(YDB_Engine *instance, YDB_TablePage *page) {
+YDB_Error ydb_set_readahead(YDB_Engine *instance, size_t pages) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
-  THROW_IF_NULL(page, YDB_ERR_PAGE_NOT_INITIALIZED);
 
-  if (instance->curr_page == page) {
-    return YDB_ERR_SAME_PAGE_ADDRESS;
+  instance->readahead_depth = pages;
+  if (instance->in_use) {
+    __ydb_readahead_restart(instance);
+    ydb_readahead_hint(instance->readahead, instance->next_page_offset);
   }
+  return YDB_ERR_SUCCESS;
+}
 
-  // Seek to current page in file
-  fseek(instance->fd, instance->curr_page_offset, SEEK_SET);
+YDB_Error ydb_set_wal(YDB_Engine *instance, int enabled) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
-  // Write flags
-  YDB_Flags page_flags = ydb_page_flags_get(page);
-  fwrite(&page_flags, sizeof(YDB_Flags), 1, instance->fd);
+  instance->wal_enabled = enabled != 0;
+  return YDB_ERR_SUCCESS;
+}
 
-  // Skip next and prev page offsets
-  fseek(instance->fd, YDB_v1_page_next_size + YDB_v1_page_prev_size, SEEK_CUR);
+YDB_Error ydb_set_compression(YDB_Engine *instance, int enabled) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
-  // Write row count
-  YDB_PageSize row_cnt = ydb_page_row_count_get(page);
-  YDB_PageSize row_cnt_le = TO_LE(row_cnt);
-  fwrite(&row_cnt_le, sizeof(row_cnt), 1, instance->fd);
+  instance->compression = enabled != 0;
+  return YDB_ERR_SUCCESS;
+}
 
-  // Write data
-  char page_data[YDB_TABLE_PAGE_SIZE - YDB_v1_page_data_offset];
-  ydb_page_data_seek(page, 0);
-  if (ydb_page_data_read(page, page_data, sizeof(page_data))) {
-    return YDB_ERR_UNKNOWN; // FIXME
-  }
-  fwrite(page_data, sizeof(page_data), 1, instance->fd);
+YDB_Error ydb_set_checksums(YDB_Engine *instance, int enabled) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
-  // Flush buffer
-  fflush(instance->fd);
+  instance->checksums = enabled != 0;
+  return YDB_ERR_SUCCESS;
+}
 
-  ydb_page_free(instance->curr_page);
-  instance->curr_page = page;
+YDB_Error ydb_set_page_size(YDB_Engine *instance, YDB_PageSize size) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
+  THROW_IF_NULL(__ydb_page_size_valid(size), YDB_ERR_PAGE_SIZE_INVALID);
 
+  instance->create_page_size = size;
   return YDB_ERR_SUCCESS;
 }
 
-YDB_Error ydb_delete_current_page(YDB_Engine *instance) {
+YDB_Error ydb_set_wal_storage(YDB_Engine *instance, YDB_Storage *storage) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(!instance->in_use, YDB_ERR_INSTANCE_IN_USE);
 
-  if (instance->prev_page_offset == 0 && instance->next_page_offset == 0) {
-    // Just clear page header. That's all.
-    fseek(instance->fd, instance->curr_page_offset, SEEK_SET);
-    char* empty_header = calloc(1, YDB_v1_page_data_offset);
-    fwrite(empty_header, YDB_v1_page_data_offset, 1, instance->fd);
-    free(empty_header);
-    return YDB_ERR_SUCCESS;
-  }
+  ydb_storage_close(instance->wal_storage);
+  instance->wal_storage = storage;
+  return YDB_ERR_SUCCESS;
+}
 
-  // Mark page as deleted
-  fseek(instance->fd, instance->curr_page_offset, SEEK_SET);
-  fputc(YDB_TABLE_PAGE_FLAG_DELETED, instance->fd);
+YDB_Error ydb_set_group_commit(YDB_Engine *instance, size_t ops) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
 
-  // Write last_free_page_offset as the next page for current one
-  YDB_Offset lfp_le = TO_LE(instance->last_free_page_offset);
-  fwrite(&lfp_le, sizeof(YDB_Offset), 1, instance->fd);
+  instance->group_commit = ops;
+  ydb_wal_set_group_commit(instance->wal, ops);
+  return YDB_ERR_SUCCESS;
+}
 
-  // Link the previous page with next one (could be null ptr)
-  if (instance->prev_page_offset != 0) {
-    fseek(instance->fd, instance->prev_page_offset + YDB_v1_page_next_offset, SEEK_SET);
-  } else {
-    // If it was the first page, rewrite first_page_offset with next_page_offset
-    fseek(instance->fd, YDB_v1_first_page_offset, SEEK_SET);
-  }
-  YDB_Offset np_le = TO_LE(instance->next_page_offset);
-  fwrite(&np_le, sizeof(YDB_Offset), 1, instance->fd);
+YDB_Error ydb_commit(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
 
-  // Link the next page with previous one (could be null ptr)
-  if (instance->next_page_offset != 0) {
-    fseek(instance->fd, instance->next_page_offset + YDB_v1_page_prev_offset, SEEK_SET);
-  } else {
-    // If it was the last page, rewrite last_page_offset with prev_page_offset
-    fseek(instance->fd, YDB_v1_last_page_offset, SEEK_SET);
+  YDB_Error err = __ydb_index_flush_all(instance);
+  if (err) return err;
+
+  if (instance->wal) {
+    pthread_mutex_lock(&instance->io_lock);
+    err = ydb_wal_sync(instance->wal);
+    pthread_mutex_unlock(&instance->io_lock);
+    return err;
   }
-  YDB_Offset pp_le = TO_LE(instance->prev_page_offset);
-  fwrite(&pp_le, sizeof(YDB_Offset), 1, instance->fd);
+  return __ydb_storage_sync(instance);
+}
 
-  // Rewrite last_free_page_offset with current offset
-  fseek(instance->fd, YDB_v1_last_free_page_offset, SEEK_SET);
-  YDB_Offset cp_le = TO_LE(instance->curr_page_offset);
-  fwrite(&cp_le, sizeof(YDB_Offset), 1, instance->fd);
+YDB_Error ydb_checkpoint(YDB_Engine *instance) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
 
-  // Flush buffer
-  fflush(instance->fd);
+  YDB_Error err = __ydb_index_flush_all(instance);
+  if (err) return err;
 
-  // Seek to the next page if it's not the last, else seek to the previous one
-  if (instance->next_page_offset != 0) {
-    instance->curr_page_offset = instance->next_page_offset;
-  } else {
-    instance->curr_page_offset = instance->prev_page_offset;
+  if (instance->wal) {
+    return __ydb_checkpoint(instance);
   }
-  return __ydb_read_page(instance);
+  return __ydb_storage_sync(instance);
 }
 
-YDB_Error ydb_seek_to_begin(YDB_Engine *instance) {
+YDB_Error ydb_get_cache_stats(YDB_Engine *instance, YDB_CacheStats *stats) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
   THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
+  THROW_IF_NULL(stats, YDB_ERR_WRITE_TO_NULLPTR);
 
-  if (instance->prev_page_offset == 0)
-    return YDB_ERR_SUCCESS;
+  memset(stats, 0, sizeof(YDB_CacheStats));
+  ydb_cache_stats_get(instance->cache, stats);
+  return YDB_ERR_SUCCESS;
+}
 
-  instance->curr_page_offset = instance->prev_page_offset;
-  return __ydb_read_page(instance);
+YDB_Error ydb_get_stats(YDB_Engine *instance, YDB_Stats *stats) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+  THROW_IF_NULL(stats, YDB_ERR_WRITE_TO_NULLPTR);
+
+  pthread_mutex_lock(&instance->stats_lock);
+  *stats = instance->stats;
+  pthread_mutex_unlock(&instance->stats_lock);
+  memset(&stats->cache, 0, sizeof(YDB_CacheStats));
+  if (instance->in_use) {
+    ydb_cache_stats_get(instance->cache, &stats->cache);
+  }
+  return YDB_ERR_SUCCESS;
 }
 
-YDB_Error ydb_seek_to_end(YDB_Engine *instance) {
+YDB_Error ydb_reset_stats(YDB_Engine *instance) {
   THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
-  THROW_IF_NULL(instance->in_use, YDB_ERR_INSTANCE_NOT_IN_USE);
 
-  if (instance->next_page_offset == 0)
-    return YDB_ERR_SUCCESS;
+  pthread_mutex_lock(&instance->stats_lock);
+  memset(&instance->stats, 0, sizeof(YDB_Stats));
+  pthread_mutex_unlock(&instance->stats_lock);
+  return YDB_ERR_SUCCESS;
+}
 
-  instance->curr_page_offset = instance->next_page_offset;
-  return __ydb_read_page(instance);
+YDB_Error ydb_set_trace(YDB_Engine *instance, YDB_TraceFn trace, void *ctx) {
+  THROW_IF_NULL(instance, YDB_ERR_INSTANCE_NOT_INITIALIZED);
+
+  pthread_mutex_lock(&instance->stats_lock);
+  instance->trace = trace;
+  instance->trace_ctx = ctx;
+  pthread_mutex_unlock(&instance->stats_lock);
+  return YDB_ERR_SUCCESS;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include "tests.h"
+
+#define COMPACT_TEST_MAX_PAGES (256)
+#define COMPACT_TEST_ROW_SIZE (200)
+
+typedef struct {
+  uint64_t ids[COMPACT_TEST_MAX_PAGES];
+  size_t count;
+  uint64_t next_id;
+} CompactModel;
+
+// Test configurations: bit 0 enables the write-ahead log.
+static YDB_Engine *compact_instance(int config, TestDisk *log) {
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  if (config & 1) {
+    ck_assert_ydb(ydb_set_wal_storage(e, test_disk_open(log)));
+  }
+  return e;
+}
+
+static void compact_append(YDB_Engine *e, CompactModel *model) {
+  uint64_t id = model->next_id++;
+  YDB_TablePage *page = test_page_new(e, id, COMPACT_TEST_ROW_SIZE);
+  ck_assert_ydb(ydb_append_page(e, page));
+  ydb_page_free(page);
+  model->ids[model->count++] = id;
+}
+
+static void compact_replace(YDB_Engine *e, CompactModel *model, size_t i) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  uint64_t id = model->next_id++;
+  ck_assert_ydb(ydb_replace_current_page(e, test_page_new(e, id, COMPACT_TEST_ROW_SIZE)));
+  model->ids[i] = id;
+}
+
+static void compact_delete(YDB_Engine *e, CompactModel *model, size_t i) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  ck_assert_ydb(ydb_delete_current_page(e));
+  memmove(model->ids + i, model->ids + i + 1, (model->count - i - 1) * sizeof(uint64_t));
+  model->count--;
+}
+
+// Checks that the pages lie in the file in page chain order, looking their offsets up in the index.
+static void compact_check_order(YDB_Index *index, const CompactModel *model) {
+  YDB_Offset prev = 0;
+  for (size_t i = 0; i < model->count; i++) {
+    uint8_t key[TEST_KEY_SIZE];
+    test_key(model->ids[i], key);
+    YDB_RowLocation location;
+    ck_assert_ydb(ydb_index_find(index, key, &location));
+    ck_assert_uint_gt(location.page, prev);
+    prev = location.page;
+  }
+}
+
+START_TEST(test_compact_full)
+{
+  TestDisk *table = test_disk_new();
+  TestDisk *log = test_disk_new();
+  CompactModel model = {.next_id = 1};
+
+  YDB_Engine *e = compact_instance(_i, log);
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  YDB_Index *index;
+  ck_assert_ydb(ydb_index_create_in(e, ydb_storage_memory_open(), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+
+  for (int i = 0; i < 90; i++) {
+    compact_append(e, &model);
+  }
+  for (size_t i = model.count; i-- > 0;) {
+    if (i % 3 == 0) compact_delete(e, &model, i);
+  }
+  for (size_t i = 0; i < model.count; i += 7) {
+    compact_replace(e, &model, i);
+  }
+  // New pages reuse the free ones, so the chain jumps back and forth through the file
+  for (int i = 0; i < 12; i++) {
+    compact_append(e, &model);
+  }
+  ck_assert_ydb(ydb_checkpoint(e));
+  YDB_Offset size = ydb_storage_size(table->data);
+
+  int done = 0;
+  ck_assert_ydb(ydb_compact(e, 0, &done));
+  ck_assert_int_eq(done, 1);
+  test_check_ids(e, model.ids, model.count);
+  compact_check_order(index, &model);
+  ck_assert_ydb(ydb_checkpoint(e));
+  ck_assert_uint_lt(ydb_storage_size(table->data), size);
+
+  // A compact table stays as it is
+  ck_assert_ydb(ydb_compact(e, 0, &done));
+  ck_assert_int_eq(done, 1);
+  test_check_ids(e, model.ids, model.count);
+
+  ck_assert_ydb(ydb_index_close(index));
+  ck_assert_ydb(ydb_unload_table(e));
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, model.ids, model.count);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+  test_disk_free(log);
+}
+END_TEST
+
+START_TEST(test_compact_steps)
+{
+  TestDisk *table = test_disk_new();
+  TestDisk *log = test_disk_new();
+  CompactModel model = {.next_id = 1};
+
+  YDB_Engine *e = compact_instance(_i, log);
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  YDB_Index *index;
+  ck_assert_ydb(ydb_index_create_in(e, ydb_storage_memory_open(), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+
+  for (int i = 0; i < 60; i++) {
+    compact_append(e, &model);
+  }
+  for (size_t i = model.count; i-- > 0;) {
+    if (i % 2 == 0) compact_delete(e, &model, i);
+  }
+
+  // The table is changed between steps, compaction has to keep up with it
+  int done = 0;
+  size_t steps = 0;
+  while (!done) {
+    ck_assert_ydb(ydb_compact(e, 1, &done));
+    steps++;
+    ck_assert_uint_lt(steps, 1000);
+    if (steps % 5 == 0 && steps <= 40) {
+      switch (steps / 5 % 3) {
+        case 0: compact_append(e, &model); break;
+        case 1: compact_replace(e, &model, steps % model.count); break;
+        default: compact_delete(e, &model, steps % model.count); break;
+      }
+      done = 0;
+    }
+    test_check_ids(e, model.ids, model.count);
+  }
+  ck_assert_uint_gt(steps, 1);
+  compact_check_order(index, &model);
+
+  ck_assert_ydb(ydb_index_close(index));
+  ck_assert_ydb(ydb_unload_table(e));
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, model.ids, model.count);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+  test_disk_free(log);
+}
+END_TEST
+
+Suite *compact_suite(void) {
+  Suite *s = suite_create("compact");
+  TCase *tc = tcase_create("core");
+  tcase_set_timeout(tc, 60);
+  tcase_add_loop_test(tc, test_compact_full, 0, 2);
+  tcase_add_loop_test(tc, test_compact_steps, 0, 2);
+  suite_add_tcase(s, tc);
+  return s;
+}
@@ -0,0 +1,297 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include <YeltsinDB/filter.h>
+#include <YeltsinDB/pax.h>
+#include <YeltsinDB/schema.h>
+#include "tests.h"
+
+#define FILTER_TEST_MAX_ROWS (2048)
+#define FILTER_TEST_MAX_PAGES (128)
+#define FILTER_TEST_PAGE_ROWS (40)
+#define FILTER_TEST_ROW_MAX_SIZE (64)
+
+enum { FILTER_ID, FILTER_V, FILTER_F, FILTER_NAME };
+
+typedef struct {
+  int64_t id;
+  int32_t v;
+  int v_null;
+  double f;
+  char data[FILTER_TEST_ROW_MAX_SIZE];
+  YDB_PageSize size;
+} FilterRow;
+
+// Rows of a page: a range of the row array.
+typedef struct {
+  size_t first;
+  size_t count;
+} FilterPage;
+
+typedef struct {
+  YDB_Schema *schema;
+  FilterRow rows[FILTER_TEST_MAX_ROWS];
+  size_t row_count;
+  FilterPage pages[FILTER_TEST_MAX_PAGES];
+  size_t page_count;
+} FilterModel;
+
+typedef struct {
+  int64_t ids[FILTER_TEST_MAX_ROWS];
+  size_t count;
+} FilterResult;
+
+static YDB_Schema *filter_schema(void) {
+  YDB_Schema *schema = ydb_schema_new();
+  ck_assert_ydb(ydb_schema_add_column(schema, "id", YDB_COLUMN_INT64, 0, YDB_COLUMN_FLAG_ZONE_MAP));
+  ck_assert_ydb(ydb_schema_add_column(schema, "v", YDB_COLUMN_INT32, 0,
+                                      YDB_COLUMN_FLAG_NULLABLE | YDB_COLUMN_FLAG_ZONE_MAP));
+  ck_assert_ydb(ydb_schema_add_column(schema, "f", YDB_COLUMN_FLOAT64, 0, YDB_COLUMN_FLAG_ZONE_MAP));
+  ck_assert_ydb(ydb_schema_add_column(schema, "name", YDB_COLUMN_VARBYTES, 0, 0));
+  return schema;
+}
+
+// Makes rows with growing ids and floats, so zone maps rule pages out, and scattered v values.
+static size_t filter_rows_new(FilterModel *model, size_t count) {
+  size_t first = model->row_count;
+  ck_assert_uint_le(first + count, FILTER_TEST_MAX_ROWS);
+  for (size_t i = first; i < first + count; i++) {
+    FilterRow *row = &model->rows[i];
+    row->id = (int64_t) i + 1;
+    row->v = (int32_t) ((i * 7919) % 1000) - 500;
+    row->v_null = i % 11 == 0;
+    row->f = i % 13 == 0 ? NAN : (double) i * 0.5;
+
+    char name[16];
+    int name_size = snprintf(name, sizeof(name), "row%zu", i);
+    YDB_Value values[] = {
+        {&row->id, sizeof(row->id)},
+        {row->v_null ? NULL : &row->v, sizeof(row->v)},
+        {&row->f, sizeof(row->f)},
+        {name, (YDB_PageSize) name_size},
+    };
+    ck_assert_ydb(ydb_row_encode(model->schema, values, row->data, sizeof(row->data), &row->size));
+  }
+  model->row_count += count;
+  return first;
+}
+
+// Makes a page of new rows, a PAX one or a slotted one.
+static YDB_TablePage *filter_page_new(YDB_Engine *e, FilterModel *model, int pax, FilterPage *rows) {
+  YDB_PageSize data_size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &data_size));
+  YDB_TablePage *page = ydb_page_alloc(data_size);
+  rows->first = filter_rows_new(model, FILTER_TEST_PAGE_ROWS);
+  rows->count = FILTER_TEST_PAGE_ROWS;
+
+  if (pax) {
+    const void *data[FILTER_TEST_PAGE_ROWS];
+    YDB_PageSize sizes[FILTER_TEST_PAGE_ROWS];
+    for (size_t i = 0; i < rows->count; i++) {
+      data[i] = model->rows[rows->first + i].data;
+      sizes[i] = model->rows[rows->first + i].size;
+    }
+    size_t written;
+    ck_assert_ydb(ydb_page_pax_build(page, model->schema, data, sizes, rows->count, &written));
+    ck_assert_uint_eq(written, rows->count);
+  } else {
+    ck_assert_ydb(ydb_page_slotted_init(page));
+    for (size_t i = 0; i < rows->count; i++) {
+      const FilterRow *row = &model->rows[rows->first + i];
+      ck_assert_ydb(ydb_page_row_insert(page, row->data, row->size, NULL));
+    }
+  }
+  return page;
+}
+
+static void filter_append(YDB_Engine *e, FilterModel *model, int pax) {
+  ck_assert_uint_lt(model->page_count, FILTER_TEST_MAX_PAGES);
+  FilterPage *rows = &model->pages[model->page_count];
+  YDB_TablePage *page = filter_page_new(e, model, pax, rows);
+  ck_assert_ydb(ydb_append_page(e, page));
+  ydb_page_free(page);
+  model->page_count++;
+}
+
+// Page 0 is the empty first page of the table.
+static void filter_replace(YDB_Engine *e, FilterModel *model, size_t i, int pax) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  ck_assert_ydb(ydb_replace_current_page(e, filter_page_new(e, model, pax, &model->pages[i])));
+}
+
+static void filter_delete(YDB_Engine *e, FilterModel *model, size_t i) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  ck_assert_ydb(ydb_delete_current_page(e));
+  memmove(model->pages + i, model->pages + i + 1, (model->page_count - i - 1) * sizeof(FilterPage));
+  model->page_count--;
+}
+
+static int64_t filter_row_value(const FilterRow *row, size_t column) {
+  return column == FILTER_ID ? row->id : row->v;
+}
+
+static int filter_row_matches(const FilterRow *row, const YDB_Predicate *predicate) {
+  if (predicate->column == FILTER_F) {
+    const double *values = predicate->values;
+    double f = row->f;
+    switch (predicate->op) {
+      case YDB_CMP_EQ: return f == values[0];
+      case YDB_CMP_LT: return f < values[0];
+      case YDB_CMP_GT: return f > values[0];
+      case YDB_CMP_BETWEEN: return f >= values[0] && f <= values[1];
+      default:
+        for (size_t k = 0; k < predicate->value_count; k++) {
+          if (f == values[k]) return 1;
+        }
+        return 0;
+    }
+  }
+
+  if (predicate->column == FILTER_V && row->v_null) return 0;
+  int64_t x = filter_row_value(row, predicate->column);
+  int64_t values[8];
+  for (size_t k = 0; k < predicate->value_count; k++) {
+    if (predicate->column == FILTER_ID) {
+      values[k] = ((const int64_t *) predicate->values)[k];
+    } else {
+      values[k] = ((const int32_t *) predicate->values)[k];
+    }
+  }
+  switch (predicate->op) {
+    case YDB_CMP_EQ: return x == values[0];
+    case YDB_CMP_LT: return x < values[0];
+    case YDB_CMP_GT: return x > values[0];
+    case YDB_CMP_BETWEEN: return x >= values[0] && x <= values[1];
+    default:
+      for (size_t k = 0; k < predicate->value_count; k++) {
+        if (x == values[k]) return 1;
+      }
+      return 0;
+  }
+}
+
+static YDB_Error filter_collect(void *ctx, size_t index, const YDB_PaxColumn *columns, YDB_PageSize row_count,
+                                const uint8_t *selection) {
+  (void) index;
+  FilterResult *result = ctx;
+  for (YDB_PageSize r = 0; r < row_count; r++) {
+    if (!(selection[r / 8] >> (r % 8) & 1)) continue;
+    ck_assert_uint_lt(result->count, FILTER_TEST_MAX_ROWS);
+    memcpy(&result->ids[result->count++], (const char *) columns[0].values + r * sizeof(int64_t), sizeof(int64_t));
+  }
+  return YDB_ERR_SUCCESS;
+}
+
+// Compares a filtered scan with every predicate set against the rows that match it by brute force.
+static void filter_check(YDB_Engine *e, const FilterModel *model) {
+  const int64_t id_eq = 123;
+  const int64_t id_between[] = {100, 300};
+  const int64_t id_gt = 1000000;
+  const int32_t v_lt = 0;
+  const int32_t v_gt = 250;
+  const int32_t v_in[] = {-500, 0, 7, 499, 13};
+  const int32_t v_gt_low = -100;
+  const double f_lt = 40.0;
+  const double f_between[] = {100.0, 120.0};
+
+  const YDB_Predicate sets[][2] = {
+      {{FILTER_ID, YDB_CMP_EQ, &id_eq, 1}},
+      {{FILTER_ID, YDB_CMP_BETWEEN, id_between, 2}, {FILTER_V, YDB_CMP_LT, &v_lt, 1}},
+      {{FILTER_V, YDB_CMP_GT, &v_gt, 1}},
+      {{FILTER_V, YDB_CMP_IN, v_in, 5}},
+      {{FILTER_F, YDB_CMP_LT, &f_lt, 1}},
+      {{FILTER_F, YDB_CMP_BETWEEN, f_between, 2}, {FILTER_V, YDB_CMP_GT, &v_gt_low, 1}},
+      {{FILTER_ID, YDB_CMP_GT, &id_gt, 1}},
+  };
+  const size_t set_sizes[] = {1, 2, 1, 1, 1, 2, 1};
+  const size_t columns[] = {FILTER_ID};
+
+  FilterResult *result = malloc(sizeof(FilterResult));
+  for (size_t s = 0; s <= sizeof(set_sizes) / sizeof(set_sizes[0]); s++) {
+    // The last round has no predicates and matches every row
+    const size_t n = s < sizeof(set_sizes) / sizeof(set_sizes[0]) ? set_sizes[s] : 0;
+    result->count = 0;
+    ck_assert_ydb(ydb_scan_filter(e, n ? sets[s] : NULL, n, columns, 1, filter_collect, result));
+
+    size_t found = 0;
+    for (size_t p = 0; p < model->page_count; p++) {
+      for (size_t i = 0; i < model->pages[p].count; i++) {
+        const FilterRow *row = &model->rows[model->pages[p].first + i];
+        int matches = 1;
+        for (size_t k = 0; k < n; k++) {
+          matches = matches && filter_row_matches(row, &sets[s][k]);
+        }
+        if (!matches) continue;
+        ck_assert_uint_lt(found, result->count);
+        ck_assert_int_eq(result->ids[found], row->id);
+        found++;
+      }
+    }
+    ck_assert_uint_eq(found, result->count);
+  }
+  free(result);
+}
+
+// Test configurations: bit 0 enables compression, bit 1 makes the first page a PAX one.
+START_TEST(test_filter_brute_force)
+{
+  TestDisk *table = test_disk_new();
+  FilterModel *model = calloc(1, sizeof(FilterModel));
+  model->schema = filter_schema();
+
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_set_compression(e, _i & 1));
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  ck_assert_ydb(ydb_set_schema(e, model->schema));
+
+  for (int i = 0; i < 30; i++) {
+    filter_append(e, model, (i + (_i >> 1)) % 2);
+  }
+  filter_check(e, model);
+
+  YDB_ZoneMap zone;
+  ck_assert_ydb(ydb_get_zone_map(e, 1, FILTER_ID, &zone));
+  ck_assert_int_eq(zone.min.i, model->rows[model->pages[0].first].id);
+  ck_assert_int_eq(zone.max.i, model->rows[model->pages[0].first + FILTER_TEST_PAGE_ROWS - 1].id);
+  ck_assert_ydb(ydb_get_zone_map(e, 1, FILTER_V, &zone));
+  ck_assert_uint_eq(zone.value_count + zone.null_count, FILTER_TEST_PAGE_ROWS);
+  ck_assert_uint_gt(zone.null_count, 0);
+  ck_assert_ydb(ydb_get_zone_map(e, 1, FILTER_F, &zone));
+  ck_assert_uint_lt(zone.value_count, FILTER_TEST_PAGE_ROWS);
+
+  // Changed pages get new zone maps, so new rows are found and old ones are not
+  for (size_t i = 2; i < model->page_count; i += 5) {
+    filter_replace(e, model, i, (int) i % 2);
+  }
+  for (size_t i = model->page_count; i-- > 0;) {
+    if (i % 6 == 4) filter_delete(e, model, i);
+  }
+  filter_check(e, model);
+
+  // Zone maps are loaded with the page directory
+  ck_assert_ydb(ydb_unload_table(e));
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  filter_check(e, model);
+  filter_append(e, model, 1);
+  filter_check(e, model);
+
+  ydb_terminate_instance(e);
+  ydb_schema_free(model->schema);
+  free(model);
+  test_disk_free(table);
+}
+END_TEST
+
+Suite *filter_suite(void) {
+  Suite *s = suite_create("filter");
+  TCase *tc = tcase_create("core");
+  tcase_set_timeout(tc, 60);
+  tcase_add_loop_test(tc, test_filter_brute_force, 0, 4);
+  suite_add_tcase(s, tc);
+  return s;
+}
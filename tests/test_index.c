@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include "tests.h"
+
+#define INDEX_TEST_MAX_PAGES (256)
+#define INDEX_TEST_ROW_SIZE (64)
+
+typedef struct {
+  uint64_t ids[INDEX_TEST_MAX_PAGES];
+  size_t count;
+  uint64_t next_id;
+} IndexModel;
+
+typedef struct {
+  uint64_t last_id;
+  size_t count;
+} IndexVisit;
+
+// Test configurations: 0 is a B+-tree index, 1 is a hash one.
+static YDB_Index *index_create(YDB_Engine *e, int config) {
+  YDB_Index *index;
+  if (config) {
+    ck_assert_ydb(ydb_hash_index_create_in(e, ydb_storage_memory_open(), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+  } else {
+    ck_assert_ydb(ydb_index_create_in(e, ydb_storage_memory_open(), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+  }
+  return index;
+}
+
+static void index_append(YDB_Engine *e, IndexModel *model, uint64_t id) {
+  YDB_TablePage *page = test_page_new(e, id, INDEX_TEST_ROW_SIZE);
+  ck_assert_ydb(ydb_append_page(e, page));
+  ydb_page_free(page);
+  model->ids[model->count++] = id;
+}
+
+// Checks that a key leads to a row with it.
+static void index_check_found(YDB_Engine *e, YDB_Index *index, uint64_t id) {
+  uint8_t key[TEST_KEY_SIZE];
+  test_key(id, key);
+  YDB_RowLocation location;
+  ck_assert_ydb(ydb_index_find(index, key, &location));
+  ck_assert_ydb(ydb_seek_to_offset(e, location.page));
+  const void *row;
+  YDB_PageSize size;
+  ck_assert_ydb(ydb_page_row_get(ydb_get_current_page(e), location.row, &row, &size));
+  uint64_t row_id;
+  memcpy(&row_id, row, sizeof(row_id));
+  ck_assert_uint_eq(row_id, id);
+}
+
+static void index_check_missing(YDB_Index *index, uint64_t id) {
+  uint8_t key[TEST_KEY_SIZE];
+  test_key(id, key);
+  YDB_RowLocation location;
+  ck_assert_int_eq(ydb_index_find(index, key, &location), YDB_ERR_KEY_NOT_FOUND);
+}
+
+static void index_check(YDB_Engine *e, YDB_Index *index, const IndexModel *model) {
+  for (size_t i = 0; i < model->count; i++) {
+    index_check_found(e, index, model->ids[i]);
+  }
+}
+
+static YDB_Error index_visit(void *ctx, const void *key, YDB_RowLocation location) {
+  (void) location;
+  IndexVisit *visit = ctx;
+  uint64_t id = test_key_id(key);
+  ck_assert_uint_ge(id, visit->last_id);
+  visit->last_id = id;
+  visit->count++;
+  return YDB_ERR_SUCCESS;
+}
+
+START_TEST(test_index_maintenance)
+{
+  IndexModel model = {.next_id = 1};
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+
+  // Pages appended before the index is created are indexed by it
+  for (int i = 0; i < 30; i++) {
+    index_append(e, &model, model.next_id++);
+  }
+  YDB_Index *index = index_create(e, _i);
+  index_check(e, index, &model);
+
+  YDB_TablePage *pages[10];
+  for (int i = 0; i < 10; i++) {
+    pages[i] = test_page_new(e, model.next_id + i, INDEX_TEST_ROW_SIZE);
+    model.ids[model.count++] = model.next_id + i;
+  }
+  ck_assert_ydb(ydb_append_pages(e, pages, 10));
+  for (int i = 0; i < 10; i++) {
+    ydb_page_free(pages[i]);
+  }
+  model.next_id += 10;
+  for (int i = 0; i < 30; i++) {
+    index_append(e, &model, model.next_id++);
+  }
+  index_check(e, index, &model);
+
+  // Replaced and deleted rows leave the index
+  for (size_t i = 3; i < model.count; i += 9) {
+    uint64_t old_id = model.ids[i];
+    ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+    ck_assert_ydb(ydb_replace_current_page(e, test_page_new(e, model.next_id, INDEX_TEST_ROW_SIZE)));
+    model.ids[i] = model.next_id++;
+    index_check_missing(index, old_id);
+  }
+  for (size_t i = model.count; i-- > 0;) {
+    if (i % 4 != 1) continue;
+    uint64_t old_id = model.ids[i];
+    ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+    ck_assert_ydb(ydb_delete_current_page(e));
+    memmove(model.ids + i, model.ids + i + 1, (model.count - i - 1) * sizeof(uint64_t));
+    model.count--;
+    index_check_missing(index, old_id);
+  }
+  test_check_ids(e, model.ids, model.count);
+  index_check(e, index, &model);
+
+  // Moved rows are found at their new place
+  int done;
+  ck_assert_ydb(ydb_compact(e, 0, &done));
+  ck_assert_int_eq(done, 1);
+  index_check(e, index, &model);
+
+  ck_assert_ydb(ydb_index_rebuild(index));
+  index_check(e, index, &model);
+  index_check_missing(index, model.next_id);
+
+  ck_assert_ydb(ydb_index_close(index));
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+START_TEST(test_index_duplicates_and_ranges)
+{
+  IndexModel model = {.next_id = 1};
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_Index *index = index_create(e, _i);
+
+  // Ids are appended out of order, some of them twice
+  for (uint64_t i = 0; i < 100; i++) {
+    index_append(e, &model, (i * 37) % 100 + 1);
+  }
+  for (uint64_t id = 10; id <= 50; id += 10) {
+    index_append(e, &model, id);
+  }
+  index_check(e, index, &model);
+
+  uint8_t key[TEST_KEY_SIZE];
+  test_key(20, key);
+  IndexVisit visit = {0};
+  ck_assert_ydb(ydb_index_find_all(index, key, index_visit, &visit));
+  ck_assert_uint_eq(visit.count, 2);
+  test_key(21, key);
+  visit = (IndexVisit) {0};
+  ck_assert_ydb(ydb_index_find_all(index, key, index_visit, &visit));
+  ck_assert_uint_eq(visit.count, 1);
+
+  uint8_t from[TEST_KEY_SIZE];
+  uint8_t to[TEST_KEY_SIZE];
+  test_key(15, from);
+  test_key(45, to);
+  visit = (IndexVisit) {0};
+  YDB_Error err = ydb_index_scan(index, from, to, index_visit, &visit);
+  if (_i) {
+    ck_assert_int_eq(err, YDB_ERR_INDEX_NOT_ORDERED);
+  } else {
+    ck_assert_ydb(err);
+    ck_assert_uint_eq(visit.count, 31 + 3);
+    ck_assert_uint_eq(visit.last_id, 45);
+
+    visit = (IndexVisit) {0};
+    ck_assert_ydb(ydb_index_scan(index, NULL, NULL, index_visit, &visit));
+    ck_assert_uint_eq(visit.count, model.count);
+    ck_assert_uint_eq(visit.last_id, 100);
+  }
+
+  ck_assert_ydb(ydb_index_close(index));
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+// With write-ahead log, a page replace that fails to update an index is not committed.
+START_TEST(test_index_replace_failure)
+{
+  TestDisk *storage = test_disk_new();
+  TestDisk *log = test_disk_new();
+  IndexModel model = {.next_id = 1};
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_set_wal_storage(e, test_disk_open(log)));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  for (int i = 0; i < 10; i++) {
+    index_append(e, &model, model.next_id++);
+  }
+  YDB_Index *index;
+  if (_i) {
+    ck_assert_ydb(ydb_hash_index_create_in(e, test_disk_open(storage), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+  } else {
+    ck_assert_ydb(ydb_index_create_in(e, test_disk_open(storage), TEST_KEY_SIZE, test_key_fn, NULL, &index));
+  }
+
+  ck_assert_ydb(ydb_seek_to_page(e, 5));
+  YDB_TablePage *page = test_page_new(e, model.next_id, INDEX_TEST_ROW_SIZE);
+  storage->fail_after = 0;
+  ck_assert_int_eq(ydb_replace_current_page(e, page), YDB_ERR_TABLE_DATA_WRITE_FAILED);
+  ydb_page_free(page);
+  test_check_ids(e, model.ids, model.count);
+
+  ck_assert_ydb(ydb_index_close(index));
+  ydb_terminate_instance(e);
+  test_disk_free(storage);
+  test_disk_free(log);
+}
+END_TEST
+
+Suite *index_suite(void) {
+  Suite *s = suite_create("index");
+  TCase *tc = tcase_create("core");
+  tcase_set_timeout(tc, 60);
+  tcase_add_loop_test(tc, test_index_maintenance, 0, 2);
+  tcase_add_loop_test(tc, test_index_duplicates_and_ranges, 0, 2);
+  tcase_add_loop_test(tc, test_index_replace_failure, 0, 2);
+  suite_add_tcase(s, tc);
+  return s;
+}
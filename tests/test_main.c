@@ -0,0 +1,47 @@
+/**
+ * @file test_main.c
+ * @brief Unit test runner.
+ *
+ * Runs all the suites, or the one named by the first argument (that's how CTest runs them one by one).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests.h"
+
+typedef struct {
+  const char *name;
+  Suite *(*create)(void);
+} TestSuite;
+
+// Ends with an empty entry.
+static const TestSuite test_suites[] = {
+    {"pages", pages_suite},
+    {"wal", wal_suite},
+    {"compact", compact_suite},
+    {"index", index_suite},
+    {"filter", filter_suite},
+    {NULL, NULL},
+};
+
+int main(int argc, char **argv) {
+  SRunner *runner = NULL;
+  for (const TestSuite *suite = test_suites; suite->name; suite++) {
+    if (argc > 1 && strcmp(argv[1], suite->name) != 0) continue;
+    if (runner) {
+      srunner_add_suite(runner, suite->create());
+    } else {
+      runner = srunner_create(suite->create());
+    }
+  }
+  if (!runner) {
+    fprintf(stderr, "Unknown suite: %s\n", argc > 1 ? argv[1] : "(none)");
+    return EXIT_FAILURE;
+  }
+
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
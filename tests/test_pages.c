@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include "tests.h"
+
+#define PAGES_TEST_ROW_SIZE (300)
+
+START_TEST(test_pages_size)
+{
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_int_eq(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN / 2), YDB_ERR_PAGE_SIZE_INVALID);
+  ck_assert_int_eq(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN + 1000), YDB_ERR_PAGE_SIZE_INVALID);
+  ck_assert_int_eq(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MAX * 2), YDB_ERR_PAGE_SIZE_INVALID);
+
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_PageSize size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &size));
+  ck_assert_uint_lt(size, YDB_TABLE_PAGE_SIZE_MIN);
+  ck_assert_ydb(ydb_unload_table(e));
+
+  // Checksums take some room of every page
+  ck_assert_ydb(ydb_set_checksums(e, 1));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_PageSize checked_size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &checked_size));
+  ck_assert_uint_lt(checked_size, size);
+
+  YDB_TablePage *page = ydb_page_alloc(checked_size + 1);
+  ck_assert_int_eq(ydb_append_page(e, page), YDB_ERR_PAGE_TOO_LARGE);
+  ydb_page_free(page);
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+START_TEST(test_pages_short)
+{
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_PageSize size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &size));
+
+  // Short pages are padded with zeros, both when appended and when put in place of a page
+  char data[100];
+  memset(data, 0x5A, sizeof(data));
+  for (int replace = 0; replace < 2; replace++) {
+    YDB_TablePage *page = ydb_page_alloc(sizeof(data));
+    ck_assert_ydb(ydb_page_data_write(page, data, sizeof(data)));
+    if (replace) {
+      // The page in place has data all the way to its end
+      char fill[sizeof(data)];
+      memset(fill, 0x7E, sizeof(fill));
+      YDB_TablePage *full = ydb_page_alloc(size);
+      ck_assert_ydb(ydb_page_data_write(full, fill, sizeof(fill)));
+      ck_assert_ydb(ydb_page_data_seek(full, size - sizeof(fill)));
+      ck_assert_ydb(ydb_page_data_write(full, fill, sizeof(fill)));
+      ck_assert_ydb(ydb_append_page(e, full));
+      ydb_page_free(full);
+      ck_assert_ydb(ydb_seek_to_end(e));
+      ck_assert_ydb(ydb_replace_current_page(e, page));
+    } else {
+      ck_assert_ydb(ydb_append_page(e, page));
+      ydb_page_free(page);
+    }
+
+    // After a replace the current page is the one passed, so the stored one is read again
+    ck_assert_ydb(ydb_seek_to_begin(e));
+    ck_assert_ydb(ydb_seek_to_end(e));
+    YDB_TablePage *read = ydb_get_current_page(e);
+    ck_assert_uint_eq(ydb_page_size_get(read), size);
+    const char *bytes = ydb_page_data_ptr(read);
+    for (YDB_PageSize i = 0; i < size; i++) {
+      ck_assert_int_eq(bytes[i], i < sizeof(data) ? 0x5A : 0);
+    }
+  }
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+// A load that fails on any page of the file leaves the instance free for the next one.
+START_TEST(test_pages_load_failure)
+{
+  TestDisk *table = test_disk_new();
+  uint64_t ids[20];
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_set_checksums(e, 1));
+  ck_assert_ydb(ydb_set_readahead(e, 2));
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  for (size_t i = 0; i < 20; i++) {
+    ids[i] = i + 1;
+    YDB_TablePage *page = test_page_new(e, ids[i], PAGES_TEST_ROW_SIZE);
+    ck_assert_ydb(ydb_append_page(e, page));
+    ydb_page_free(page);
+  }
+  ck_assert_ydb(ydb_unload_table(e));
+
+  const YDB_Offset size = ydb_storage_size(table->data);
+  char *data = malloc(size);
+  ck_assert_ydb(ydb_storage_read_at(table->data, 0, data, size));
+  size_t failed = 0;
+  for (YDB_Offset offset = 0; offset < size; offset += YDB_TABLE_PAGE_SIZE_MIN) {
+    YDB_Storage *broken = ydb_storage_memory_open();
+    data[offset + 64] ^= 0x55;
+    ck_assert_ydb(ydb_storage_write_at(broken, 0, data, size));
+    data[offset + 64] ^= 0x55;
+
+    YDB_Error err = ydb_load_table_from(e, broken);
+    if (err) {
+      ydb_storage_close(broken);
+      failed++;
+    } else {
+      ck_assert_ydb(ydb_unload_table(e));
+    }
+    ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+    test_check_ids(e, ids, 20);
+    ck_assert_ydb(ydb_unload_table(e));
+  }
+  ck_assert_uint_gt(failed, 0);
+
+  free(data);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+}
+END_TEST
+
+START_TEST(test_pages_slotted_fill)
+{
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_PageSize size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &size));
+
+  YDB_TablePage *page = ydb_page_alloc(size);
+  ck_assert_ydb(ydb_page_slotted_init(page));
+  char row[PAGES_TEST_ROW_SIZE];
+  YDB_PageSize count = 0;
+  YDB_Error err;
+  for (;;) {
+    YDB_PageSize free_space = ydb_page_free_space(page);
+    memset(row, count, sizeof(row));
+    YDB_PageSize row_id;
+    if ((err = ydb_page_row_insert(page, row, sizeof(row), &row_id))) break;
+    ck_assert_uint_eq(row_id, count);
+    ck_assert_uint_lt(ydb_page_free_space(page), free_space - sizeof(row) + 1);
+    count++;
+  }
+  ck_assert_int_eq(err, YDB_ERR_PAGE_NO_MORE_MEM);
+  ck_assert_uint_eq(count, size / PAGES_TEST_ROW_SIZE);
+
+  // A deleted row leaves room for one more
+  ck_assert_ydb(ydb_page_row_delete(page, 3));
+  memset(row, count, sizeof(row));
+  ck_assert_ydb(ydb_page_row_insert(page, row, sizeof(row), NULL));
+  ck_assert_int_eq(ydb_page_row_insert(page, row, sizeof(row), NULL), YDB_ERR_PAGE_NO_MORE_MEM);
+
+  ck_assert_ydb(ydb_append_page(e, page));
+  ydb_page_free(page);
+  ck_assert_ydb(ydb_seek_to_end(e));
+  YDB_TablePage *read = ydb_get_current_page(e);
+  for (YDB_PageSize i = 0; i < count; i++) {
+    const void *data;
+    YDB_PageSize data_size;
+    ck_assert_ydb(ydb_page_row_get(read, i, &data, &data_size));
+    ck_assert_uint_eq(data_size, sizeof(row));
+    ck_assert_int_eq(*(const char *) data, (char) (i == 3 ? count : i));
+  }
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+// Free space of a page is known until the page is gone, the only page of a table included.
+START_TEST(test_pages_free_space)
+{
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_create_table_in(e, ydb_storage_memory_open()));
+  YDB_PageSize size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &size));
+
+  // A new table has one empty page
+  YDB_TablePage *page = ydb_page_alloc(size);
+  ck_assert_ydb(ydb_page_slotted_init(page));
+  ck_assert_ydb(ydb_replace_current_page(e, page));
+  ck_assert_ydb(ydb_seek_to_free_space(e, PAGES_TEST_ROW_SIZE));
+
+  ck_assert_ydb(ydb_delete_current_page(e));
+  ck_assert_int_eq(ydb_seek_to_free_space(e, PAGES_TEST_ROW_SIZE), YDB_ERR_NO_MORE_PAGES);
+  ydb_terminate_instance(e);
+}
+END_TEST
+
+// Test configurations: bit 0 enables the write-ahead log, which needs a larger cache.
+START_TEST(test_pages_small_cache)
+{
+  TestDisk *table = test_disk_new();
+  TestDisk *log = test_disk_new();
+  uint64_t ids[300];
+  size_t count = 0;
+
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_set_cache_capacity(e, 1));
+  if (_i & 1) {
+    ck_assert_ydb(ydb_set_wal_storage(e, test_disk_open(log)));
+  }
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+
+  for (; count < 100; count++) {
+    ids[count] = count + 1;
+    YDB_TablePage *page = test_page_new(e, ids[count], PAGES_TEST_ROW_SIZE);
+    ck_assert_ydb(ydb_append_page(e, page));
+    ydb_page_free(page);
+  }
+
+  // A batch of more pages than the cache holds is written all the same
+  YDB_TablePage *pages[200];
+  for (size_t i = 0; i < 200; i++) {
+    ids[count + i] = count + i + 1;
+    pages[i] = test_page_new(e, ids[count + i], PAGES_TEST_ROW_SIZE);
+  }
+  ck_assert_ydb(ydb_append_pages(e, pages, 200));
+  for (size_t i = 0; i < 200; i++) {
+    ydb_page_free(pages[i]);
+  }
+  count += 200;
+  test_check_ids(e, ids, count);
+
+  YDB_CacheStats stats;
+  ck_assert_ydb(ydb_get_cache_stats(e, &stats));
+  ck_assert_uint_gt(stats.evictions, 0);
+
+  ck_assert_ydb(ydb_unload_table(e));
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, ids, count);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+  test_disk_free(log);
+}
+END_TEST
+
+Suite *pages_suite(void) {
+  Suite *s = suite_create("pages");
+  TCase *tc = tcase_create("core");
+  tcase_set_timeout(tc, 60);
+  tcase_add_test(tc, test_pages_size);
+  tcase_add_test(tc, test_pages_short);
+  tcase_add_test(tc, test_pages_load_failure);
+  tcase_add_test(tc, test_pages_slotted_fill);
+  tcase_add_test(tc, test_pages_free_space);
+  tcase_add_loop_test(tc, test_pages_small_cache, 0, 2);
+  suite_add_tcase(s, tc);
+  return s;
+}
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include "tests.h"
+
+typedef struct {
+  YDB_Storage base;
+  TestDisk *disk;
+} TestDiskStorage;
+
+static TestDisk *__test_disk(YDB_Storage *storage) {
+  return ((TestDiskStorage *) storage)->disk;
+}
+
+// Whether the next write goes through, it does not when it is the one to fail.
+static YDB_Error __test_disk_write_check(TestDisk *disk) {
+  if (disk->fail_after < 0) return YDB_ERR_SUCCESS;
+  if (disk->fail_after == 0) {
+    disk->fail_after = -1;
+    return YDB_ERR_TABLE_DATA_WRITE_FAILED;
+  }
+  disk->fail_after--;
+  return YDB_ERR_SUCCESS;
+}
+
+static YDB_Error __test_disk_read_at(YDB_Storage *storage, YDB_Offset offset, void *dst, size_t size) {
+  return ydb_storage_read_at(__test_disk(storage)->data, offset, dst, size);
+}
+
+static YDB_Error __test_disk_write_at(YDB_Storage *storage, YDB_Offset offset, const void *src, size_t size) {
+  TestDisk *disk = __test_disk(storage);
+  if (disk->crashed) return YDB_ERR_SUCCESS;
+  YDB_Error err = __test_disk_write_check(disk);
+  if (err) return err;
+  return ydb_storage_write_at(disk->data, offset, src, size);
+}
+
+static YDB_Error __test_disk_writev_at(YDB_Storage *storage, YDB_Offset offset, const YDB_IOVec *iov, size_t count) {
+  TestDisk *disk = __test_disk(storage);
+  if (disk->crashed) return YDB_ERR_SUCCESS;
+  YDB_Error err = __test_disk_write_check(disk);
+  if (err) return err;
+  return ydb_storage_writev_at(disk->data, offset, iov, count);
+}
+
+static YDB_Error __test_disk_sync(YDB_Storage *storage) {
+  TestDisk *disk = __test_disk(storage);
+  if (disk->crashed) return YDB_ERR_SUCCESS;
+
+  disk->synced_size = ydb_storage_size(disk->data);
+  disk->synced = realloc(disk->synced, disk->synced_size + 1);
+  YDB_Error err = disk->synced_size ? ydb_storage_read_at(disk->data, 0, disk->synced, disk->synced_size)
+                                    : YDB_ERR_SUCCESS;
+  if (err) return err;
+  return ydb_storage_sync(disk->data);
+}
+
+static YDB_Offset __test_disk_size(YDB_Storage *storage) {
+  return ydb_storage_size(__test_disk(storage)->data);
+}
+
+static YDB_Error __test_disk_truncate(YDB_Storage *storage, YDB_Offset size) {
+  TestDisk *disk = __test_disk(storage);
+  if (disk->crashed) return YDB_ERR_SUCCESS;
+  return ydb_storage_truncate(disk->data, size);
+}
+
+static void __test_disk_close(YDB_Storage *storage) {
+  free(storage);
+}
+
+static const YDB_StorageOps __test_disk_ops = {
+    "test", __test_disk_read_at, __test_disk_write_at, __test_disk_writev_at, __test_disk_sync,
+    __test_disk_size, __test_disk_truncate, NULL, NULL, __test_disk_close,
+};
+
+TestDisk *test_disk_new(void) {
+  TestDisk *disk = calloc(1, sizeof(TestDisk));
+  disk->data = ydb_storage_memory_open();
+  disk->fail_after = -1;
+  return disk;
+}
+
+void test_disk_free(TestDisk *disk) {
+  ydb_storage_close(disk->data);
+  free(disk->synced);
+  free(disk);
+}
+
+void test_disk_power_loss(TestDisk *disk) {
+  ck_assert_ydb(ydb_storage_truncate(disk->data, 0));
+  if (disk->synced_size) {
+    ck_assert_ydb(ydb_storage_write_at(disk->data, 0, disk->synced, disk->synced_size));
+  }
+}
+
+YDB_Storage *test_disk_open(TestDisk *disk) {
+  TestDiskStorage *storage = calloc(1, sizeof(TestDiskStorage));
+  storage->base.ops = &__test_disk_ops;
+  storage->disk = disk;
+  return &storage->base;
+}
+
+YDB_TablePage *test_page_new(YDB_Engine *e, uint64_t id, YDB_PageSize row_size) {
+  YDB_PageSize data_size;
+  ck_assert_ydb(ydb_get_page_data_size(e, &data_size));
+  YDB_TablePage *page = ydb_page_alloc(data_size);
+  ck_assert_ydb(ydb_page_slotted_init(page));
+
+  char *row = malloc(row_size);
+  memset(row, (int) (id & 0xFF), row_size);
+  memcpy(row, &id, sizeof(id));
+  ck_assert_ydb(ydb_page_row_insert(page, row, row_size, NULL));
+  free(row);
+  return page;
+}
+
+uint64_t test_page_id(YDB_TablePage *page) {
+  if (!(ydb_page_flags_get(page) & YDB_TABLE_PAGE_FLAG_SLOTTED) || !ydb_page_row_count_get(page)) return 0;
+  const void *row;
+  YDB_PageSize size;
+  if (ydb_page_row_get(page, 0, &row, &size) || size < sizeof(uint64_t)) return 0;
+  uint64_t id;
+  memcpy(&id, row, sizeof(id));
+  return id;
+}
+
+void test_check_ids(YDB_Engine *e, const uint64_t *ids, size_t count) {
+  size_t page_count;
+  ck_assert_ydb(ydb_get_page_count(e, &page_count));
+
+  // Forward through the chain, then back, so both links are checked
+  size_t found = 0;
+  size_t pages = 0;
+  ck_assert_ydb(ydb_seek_to_begin(e));
+  YDB_Error err;
+  do {
+    uint64_t id = test_page_id(ydb_get_current_page(e));
+    if (id) {
+      ck_assert_uint_lt(found, count);
+      ck_assert_uint_eq(id, ids[found]);
+      found++;
+    }
+    pages++;
+  } while (!(err = ydb_next_page(e)));
+  ck_assert_int_eq(err, YDB_ERR_NO_MORE_PAGES);
+  ck_assert_uint_eq(found, count);
+  ck_assert_uint_eq(pages, page_count);
+
+  do {
+    uint64_t id = test_page_id(ydb_get_current_page(e));
+    if (id) {
+      ck_assert_uint_gt(found, 0);
+      ck_assert_uint_eq(id, ids[--found]);
+    }
+  } while (!(err = ydb_prev_page(e)));
+  ck_assert_int_eq(err, YDB_ERR_NO_MORE_PAGES);
+  ck_assert_uint_eq(found, 0);
+}
+
+void test_key(uint64_t id, void *key) {
+  uint8_t *dst = key;
+  for (int i = TEST_KEY_SIZE - 1; i >= 0; i--) {
+    dst[i] = (uint8_t) id;
+    id >>= 8;
+  }
+}
+
+uint64_t test_key_id(const void *key) {
+  const uint8_t *src = key;
+  uint64_t id = 0;
+  for (int i = 0; i < TEST_KEY_SIZE; i++) {
+    id = id << 8 | src[i];
+  }
+  return id;
+}
+
+int test_key_fn(void *ctx, const void *row, YDB_PageSize size, void *key) {
+  (void) ctx;
+  if (size < sizeof(uint64_t)) return 0;
+  uint64_t id;
+  memcpy(&id, row, sizeof(id));
+  test_key(id, key);
+  return 1;
+}
@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <YeltsinDB/constants.h>
+#include <YeltsinDB/error_code.h>
+#include "tests.h"
+
+#define WAL_TEST_MAX_PAGES (256)
+#define WAL_TEST_ROW_SIZE (100)
+
+// Table ids in page order, kept next to the table.
+typedef struct {
+  uint64_t ids[WAL_TEST_MAX_PAGES];
+  size_t count;
+  uint64_t next_id;
+} WalModel;
+
+static void wal_model_remove(WalModel *model, size_t i) {
+  memmove(model->ids + i, model->ids + i + 1, (model->count - i - 1) * sizeof(uint64_t));
+  model->count--;
+}
+
+// Test configurations: bit 0 enables compression, bit 1 checksums.
+static YDB_Engine *wal_instance(int config, TestDisk *log) {
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_set_page_size(e, YDB_TABLE_PAGE_SIZE_MIN));
+  ck_assert_ydb(ydb_set_compression(e, config & 1));
+  ck_assert_ydb(ydb_set_checksums(e, (config >> 1) & 1));
+  ck_assert_ydb(ydb_set_wal_storage(e, test_disk_open(log)));
+  return e;
+}
+
+// Appends a page and records it if the append succeeded.
+static YDB_Error wal_append(YDB_Engine *e, WalModel *model) {
+  uint64_t id = model->next_id++;
+  YDB_TablePage *page = test_page_new(e, id, WAL_TEST_ROW_SIZE);
+  YDB_Error err = ydb_append_page(e, page);
+  ydb_page_free(page);
+  if (!err) model->ids[model->count++] = id;
+  return err;
+}
+
+static YDB_Error wal_append_batch(YDB_Engine *e, WalModel *model, size_t n) {
+  YDB_TablePage *pages[8];
+  for (size_t i = 0; i < n; i++) {
+    pages[i] = test_page_new(e, model->next_id + i, WAL_TEST_ROW_SIZE);
+  }
+  YDB_Error err = ydb_append_pages(e, pages, n);
+  for (size_t i = 0; i < n; i++) {
+    if (!err) model->ids[model->count++] = model->next_id + i;
+    ydb_page_free(pages[i]);
+  }
+  model->next_id += n;
+  return err;
+}
+
+// Replaces the i-th page with an id. Page 0 is the empty first page of the table.
+static YDB_Error wal_replace(YDB_Engine *e, WalModel *model, size_t i) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  uint64_t id = model->next_id++;
+  YDB_TablePage *page = test_page_new(e, id, WAL_TEST_ROW_SIZE);
+  YDB_Error err = ydb_replace_current_page(e, page);
+  if (err) {
+    ydb_page_free(page);
+    return err;
+  }
+  model->ids[i] = id;
+  return err;
+}
+
+static YDB_Error wal_delete(YDB_Engine *e, WalModel *model, size_t i) {
+  ck_assert_ydb(ydb_seek_to_page(e, i + 1));
+  YDB_Error err = ydb_delete_current_page(e);
+  if (!err) wal_model_remove(model, i);
+  return err;
+}
+
+START_TEST(test_wal_replay_after_crash)
+{
+  TestDisk *table = test_disk_new();
+  TestDisk *log = test_disk_new();
+  WalModel model = {.next_id = 1};
+
+  YDB_Engine *e = wal_instance(_i, log);
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  ck_assert_ydb(ydb_set_group_commit(e, 0));
+  ck_assert_ydb(ydb_checkpoint(e));
+
+  // The table file is not synced until the next checkpoint, so the changes survive in the log only
+  for (int i = 0; i < 20; i++) {
+    ck_assert_ydb(wal_append(e, &model));
+  }
+  ck_assert_ydb(wal_append_batch(e, &model, 5));
+  ck_assert_ydb(wal_replace(e, &model, 2));
+  ck_assert_ydb(wal_delete(e, &model, 7));
+  ck_assert_ydb(wal_delete(e, &model, model.count - 1));
+  ck_assert_ydb(ydb_commit(e));
+  test_check_ids(e, model.ids, model.count);
+
+  // An operation after the last commit is lost, even if a part of its log made it to the disk
+  ck_assert_ydb(wal_append(e, &model));
+  model.count--;
+  YDB_Offset log_size = ydb_storage_size(log->data);
+  char *log_tail = NULL;
+  YDB_Offset tail_size = log_size > log->synced_size ? (log_size - log->synced_size) / 2 : 0;
+  if (tail_size) {
+    log_tail = malloc(tail_size);
+    ck_assert_ydb(ydb_storage_read_at(log->data, log->synced_size, log_tail, tail_size));
+  }
+
+  table->crashed = 1;
+  log->crashed = 1;
+  ydb_terminate_instance(e);
+  table->crashed = 0;
+  log->crashed = 0;
+  test_disk_power_loss(table);
+  test_disk_power_loss(log);
+  if (tail_size) {
+    ck_assert_ydb(ydb_storage_write_at(log->data, log->synced_size, log_tail, tail_size));
+  }
+  free(log_tail);
+
+  e = wal_instance(_i, log);
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, model.ids, model.count);
+  ck_assert_ydb(wal_append(e, &model));
+  ck_assert_ydb(ydb_unload_table(e));
+
+  // Unload is a checkpoint, the table file holds everything without the log
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, model.ids, model.count);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+  test_disk_free(log);
+}
+END_TEST
+
+START_TEST(test_wal_rollback_failed_operations)
+{
+  TestDisk *table = test_disk_new();
+  TestDisk *log = test_disk_new();
+  WalModel model = {.next_id = 1};
+
+  YDB_Engine *e = wal_instance(_i, log);
+  ck_assert_ydb(ydb_create_table_in(e, test_disk_open(table)));
+  for (int i = 0; i < 10; i++) {
+    ck_assert_ydb(wal_append(e, &model));
+  }
+
+  // Every operation gets one of its log writes failed, or none, and must either happen or leave no trace
+  size_t failed = 0;
+  for (long k = 0; k < 120; k++) {
+    log->fail_after = k % 5 == 4 ? -1 : k % 4;
+    YDB_Error err;
+    switch (k % 4) {
+      case 0: err = wal_append(e, &model); break;
+      case 1: err = wal_append_batch(e, &model, 3); break;
+      case 2: err = wal_replace(e, &model, (size_t) k % model.count); break;
+      default: err = model.count > 1 ? wal_delete(e, &model, (size_t) k % model.count) : YDB_ERR_SUCCESS; break;
+    }
+    log->fail_after = -1;
+    if (err) failed++;
+    test_check_ids(e, model.ids, model.count);
+  }
+  ck_assert_uint_gt(failed, 0);
+
+  ck_assert_ydb(ydb_unload_table(e));
+  ydb_terminate_instance(e);
+  e = wal_instance(_i, log);
+  ck_assert_ydb(ydb_load_table_from(e, test_disk_open(table)));
+  test_check_ids(e, model.ids, model.count);
+  ydb_terminate_instance(e);
+  test_disk_free(table);
+  test_disk_free(log);
+}
+END_TEST
+
+// A table is neither created nor loaded without its log.
+START_TEST(test_wal_open_failure)
+{
+  char dir[] = "/tmp/ydb_test_XXXXXX";
+  ck_assert_ptr_nonnull(mkdtemp(dir));
+  char path[sizeof(dir) + 16];
+  char wal_path[sizeof(path) + sizeof(YDB_WAL_FILE_SUFFIX)];
+  strcpy(path, dir);
+  strcat(path, "/table");
+  strcpy(wal_path, path);
+  strcat(wal_path, YDB_WAL_FILE_SUFFIX);
+  // A directory in place of the log cannot be opened as a file
+  ck_assert_int_eq(mkdir(wal_path, 0700), 0);
+
+  YDB_Engine *e = ydb_init_instance();
+  ck_assert_ptr_nonnull(e);
+  ck_assert_ydb(ydb_create_table(e, path));
+  ck_assert_ydb(ydb_unload_table(e));
+  ck_assert_ydb(ydb_set_wal(e, 1));
+  ck_assert_int_eq(ydb_load_table(e, path), YDB_ERR_WAL_OPEN_FAILED);
+  ck_assert_int_eq(unlink(path), 0);
+  ck_assert_int_eq(ydb_create_table(e, path), YDB_ERR_WAL_OPEN_FAILED);
+  ydb_terminate_instance(e);
+
+  unlink(path);
+  rmdir(wal_path);
+  rmdir(dir);
+}
+END_TEST
+
+Suite *wal_suite(void) {
+  Suite *s = suite_create("wal");
+  TCase *tc = tcase_create("core");
+  tcase_set_timeout(tc, 60);
+  tcase_add_loop_test(tc, test_wal_replay_after_crash, 0, 4);
+  tcase_add_loop_test(tc, test_wal_rollback_failed_operations, 0, 4);
+  tcase_add_test(tc, test_wal_open_failure);
+  suite_add_tcase(s, tc);
+  return s;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+ * @file tests.h
+ * @brief Unit test suites and the helpers they share.
+ *
+ * Tables are kept in memory storage, so the tests leave no files behind. Every page written by the helpers
+ * is a slotted page with a single row that starts with the page id, so the page chain could be checked against
+ * a list of ids kept by the test.
+ */
+
+#include <check.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <YeltsinDB/storage.h>
+#include <YeltsinDB/table_page.h>
+#include <YeltsinDB/ydb.h>
+
+/** @brief Checks that an engine call succeeded. */
+#define ck_assert_ydb(x) ck_assert_int_eq((x), YDB_ERR_SUCCESS)
+
+/**
+ * @brief Memory storage that outlives the instances using it.
+ *
+ * A table could be loaded again from it after a simulated crash, and its writes could be made to fail.
+ */
+typedef struct {
+  YDB_Storage *data; /**< The data. */
+  char *synced; /**< A copy of the data as of the last sync. */
+  YDB_Offset synced_size; /**< Size of the copy. */
+  int crashed; /**< Set to drop writes, truncates and syncs, as if the process had stopped. */
+  long fail_after; /**< The amount of writes to pass before the next one fails, -1 to never fail. */
+} TestDisk;
+
+/**
+ * @brief Create an empty disk.
+ * @return A disk.
+ */
+TestDisk *test_disk_new(void);
+
+/**
+ * @brief Free a disk and its data.
+ * @param disk A disk, not used by any instance.
+ */
+void test_disk_free(TestDisk *disk);
+
+/**
+ * @brief Lose everything written to a disk since the last sync, as on power loss.
+ * @param disk A disk, not used by any instance.
+ */
+void test_disk_power_loss(TestDisk *disk);
+
+/**
+ * @brief Open a disk as storage. Closing the storage keeps the disk.
+ * @param disk A disk.
+ * @return Storage.
+ */
+YDB_Storage *test_disk_open(TestDisk *disk);
+
+/**
+ * @brief Make a page with a single row holding a page id.
+ * @param e A *busy* instance, page size is taken from its table.
+ * @param id Page id, not 0.
+ * @param row_size Row size, at least 8 bytes. The rest of the row is filled from the id.
+ * @return A page.
+ */
+YDB_TablePage *test_page_new(YDB_Engine *e, uint64_t id, YDB_PageSize row_size);
+
+/**
+ * @brief Get the id of a page made by test_page_new().
+ * @param page A page.
+ * @return Page id, 0 for any other page (e.g. the empty first page of a new table).
+ */
+uint64_t test_page_id(YDB_TablePage *page);
+
+/**
+ * @brief Walk the whole page chain and check that pages with ids are the expected ones, in order.
+ * @param e A *busy* instance.
+ * @param ids Expected page ids in page order.
+ * @param count The amount of ids.
+ */
+void test_check_ids(YDB_Engine *e, const uint64_t *ids, size_t count);
+
+/** @brief Key size of test_key_fn(). */
+#define TEST_KEY_SIZE (8)
+
+/**
+ * @brief Make the index key of a page id: the id in big-endian, so keys sort like ids.
+ * @param id Page id.
+ * @param[out] key #TEST_KEY_SIZE bytes.
+ */
+void test_key(uint64_t id, void *key);
+
+/**
+ * @brief Get the page id of a key made by test_key().
+ * @param key A key.
+ * @return Page id.
+ */
+uint64_t test_key_id(const void *key);
+
+/**
+ * @brief An index key callback for rows made by test_page_new() (see #YDB_IndexKeyFn).
+ * @param ctx Unused.
+ * @param row Row data.
+ * @param size Row size.
+ * @param[out] key The key of the page id the row starts with.
+ * @return Non-zero if the row has a key.
+ */
+int test_key_fn(void *ctx, const void *row, YDB_PageSize size, void *key);
+
+Suite *pages_suite(void);
+Suite *wal_suite(void);
+Suite *compact_suite(void);
+Suite *index_suite(void);
+Suite *filter_suite(void);